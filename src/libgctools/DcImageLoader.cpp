@@ -15,6 +15,17 @@
 
 // C includes. (C++ namespace)
 #include <cstring>
+
+// SSE2 is used for the pixel conversion loops.
+// It's always available on amd64.
+// NOTE: SSE2 is only available on little-endian systems,
+// so the ARGB4444 data doesn't need to be byteswapped.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define DCIMAGELOADER_USE_SSE2 1
+#endif
+
 /**
  * Convert an ARGB4444 pixel to ARGB32.
  * @param px16 RGB5A3 pixel.
@@ -65,8 +76,21 @@ GcImage *DcImageLoader::fromPalette16(int w, int h,
 		d->palette[i] = ARGB4444_to_ARGB32(le16_to_cpu(pal_buf[i]));
 	}
 
+	// Each byte has two pixels.
+	// NOTE: MSN == left-most pixel.
 	uint8_t *px_dest = (uint8_t*)d->imageData;
-	for (int i = img_siz; i > 0; i--, img_buf++, px_dest += 2) {
+	int i = (w * h) / 2;
+#ifdef DCIMAGELOADER_USE_SSE2
+	const __m128i mask_0F = _mm_set1_epi8(0x0F);
+	for (; i >= 16; i -= 16, img_buf += 16, px_dest += 32) {
+		const __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(img_buf));
+		const __m128i hi = _mm_and_si128(_mm_srli_epi16(src, 4), mask_0F);
+		const __m128i lo = _mm_and_si128(src, mask_0F);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(px_dest), _mm_unpacklo_epi8(hi, lo));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(px_dest + 16), _mm_unpackhi_epi8(hi, lo));
+	}
+#endif /* DCIMAGELOADER_USE_SSE2 */
+	for (; i > 0; i--, img_buf++, px_dest += 2) {
 		*px_dest = (*img_buf >> 4);
 		*(px_dest+1) = (*img_buf & 0xF);
 	}
@@ -100,7 +124,24 @@ GcImage *DcImageLoader::fromARGB4444(int w, int h, const uint16_t *img_buf, int
 	d->init(w, h, GcImage::PXFMT_ARGB32);
 
 	uint32_t *px_dest = (uint32_t*)d->imageData;
-	for (int i = img_siz; i > 0; i--, img_buf++, px_dest++) {
+	int i = (w * h);
+#ifdef DCIMAGELOADER_USE_SSE2
+	const __m128i mask_0F = _mm_set1_epi8(0x0F);
+	for (; i >= 8; i -= 8, img_buf += 8, px_dest += 8) {
+		const __m128i src = _mm_loadu_si128(reinterpret_cast<const __m128i*>(img_buf));
+		// Low byte: G|B; high byte: A|R
+		const __m128i lo = _mm_and_si128(src, mask_0F);			// B, R
+		const __m128i hi = _mm_and_si128(_mm_srli_epi16(src, 4), mask_0F);	// G, A
+		// Interleave to B, G, R, A, then copy to the top nybble.
+		__m128i px0 = _mm_unpacklo_epi8(lo, hi);
+		__m128i px1 = _mm_unpackhi_epi8(lo, hi);
+		px0 = _mm_or_si128(px0, _mm_slli_epi16(px0, 4));
+		px1 = _mm_or_si128(px1, _mm_slli_epi16(px1, 4));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(px_dest), px0);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(px_dest + 4), px1);
+	}
+#endif /* DCIMAGELOADER_USE_SSE2 */
+	for (; i > 0; i--, img_buf++, px_dest++) {
 		*px_dest = ARGB4444_to_ARGB32(le16_to_cpu(*img_buf));
 	}
 
@@ -145,7 +186,24 @@ GcImage *DcImageLoader::fromMonochrome(int w, int h,
 
 	// NOTE: MSB == left-most pixel.
 	uint8_t *px_dest = (uint8_t*)d->imageData;
-	for (int i = img_siz; i > 0; i--, img_buf++) {
+	int i = (w * h) / 8;
+#ifdef DCIMAGELOADER_USE_SSE2
+	// Each bit is expanded to a byte by copying the source byte
+	// to all 8 bytes, then checking the bit for each pixel.
+	const __m128i bits = _mm_set_epi8(
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80,
+		0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, (char)0x80);
+	const __m128i one = _mm_set1_epi8(1);
+	for (; i >= 2; i -= 2, img_buf += 2, px_dest += 16) {
+		__m128i px = _mm_cvtsi32_si128(img_buf[0] | (img_buf[1] << 8));
+		px = _mm_unpacklo_epi8(px, px);		// b0 b0 b1 b1
+		px = _mm_unpacklo_epi16(px, px);	// b0 x4, b1 x4
+		px = _mm_unpacklo_epi32(px, px);	// b0 x8, b1 x8
+		px = _mm_cmpeq_epi8(_mm_and_si128(px, bits), bits);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(px_dest), _mm_and_si128(px, one));
+	}
+#endif /* DCIMAGELOADER_USE_SSE2 */
+	for (; i > 0; i--, img_buf++) {
 		uint8_t px_src = *img_buf;
 		for (int j = 0; j < 8; j++, px_src <<= 1) {
 			// TODO: Which is faster:
@@ -15,6 +15,7 @@
 // GIF dlopen() wrapper.
 #ifdef USE_GIF
 #include "GIF_dlopen.h"
+#include "OctreeQuantizer.hpp"
 #endif /* USE_GIF */
 
 // C includes.
@@ -24,6 +25,15 @@
 // C includes. (C++ namespace)
 #include <cassert>
 #include <cerrno>
+#include <cstring>
+
+// SSE2 is used for comparing frames.
+// It's always available on amd64.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define GCIMAGEWRITER_USE_SSE2 1
+#endif
 
 // C++ includes.
 #include <vector>
@@ -33,6 +43,13 @@ using std::vector;
 
 GcImageWriterPrivate::GcImageWriterPrivate(GcImageWriter *const q)
 	: q(q)
+	, memBufferSink(this)
+	, sink(nullptr)
+	, sinkErr(0)
+	, compression(GcImageWriter::COMPRESSION_DEFAULT)
+#ifdef USE_GIF
+	, octree(nullptr)
+#endif /* USE_GIF */
 { }
 
 GcImageWriterPrivate::~GcImageWriterPrivate()
@@ -42,6 +59,115 @@ GcImageWriterPrivate::~GcImageWriterPrivate()
 	for (auto iter = memBuffer.begin(); iter != memBuffer.end(); ++iter) {
 		delete *iter;
 	}
+
+#ifdef USE_GIF
+	delete octree;
+#endif /* USE_GIF */
+}
+
+/**
+ * Start writing a file.
+ * A new internal memory buffer is created.
+ * @param idx	[in] File number.
+ * @param count	[in] Total number of files.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcImageWriterPrivate::MemBufferSink::open(int idx, int count)
+{
+	((void)idx);
+	((void)count);
+
+	delete buf;
+	buf = new vector<uint8_t>();
+	buf->reserve(32768);	// 32 KB should cover most of the use cases.
+	return 0;
+}
+
+/**
+ * Write data to the current file.
+ * @param buf	[in] Data.
+ * @param len	[in] Size of buf.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcImageWriterPrivate::MemBufferSink::write(const uint8_t *buf, size_t len)
+{
+	if (!this->buf)
+		return -EBADF;
+	this->buf->insert(this->buf->end(), buf, buf + len);
+	return 0;
+}
+
+/**
+ * Finish writing the current file.
+ * If successful, the buffer is added to the internal memory buffers.
+ * @param ok	[in] True if the file was written successfully;
+ *		     false if it should be discarded.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcImageWriterPrivate::MemBufferSink::close(bool ok)
+{
+	if (!buf)
+		return -EBADF;
+
+	if (ok) {
+		d->memBuffer.push_back(buf);
+	} else {
+		delete buf;
+	}
+	buf = nullptr;
+	return 0;
+}
+
+/**
+ * Write data to the current sink.
+ * Errors are saved in sinkErr.
+ * @param buf	[in] Data.
+ * @param len	[in] Size of buf.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcImageWriterPrivate::sinkWrite(const uint8_t *buf, size_t len)
+{
+	if (sinkErr != 0) {
+		// A previous write failed.
+		return sinkErr;
+	}
+
+	int ret = sink->write(buf, len);
+	if (ret != 0) {
+		sinkErr = ret;
+	}
+	return ret;
+}
+
+/**
+ * Start writing a file to the current sink.
+ * @param idx	[in] File number.
+ * @param count	[in] Total number of files.
+ * @return 0 on success; negative POSIX error code on error.
+ */
+int GcImageWriterPrivate::openFile(int idx, int count)
+{
+	sinkErr = 0;
+	return sink->open(idx, count);
+}
+
+/**
+ * Finish writing a file to the current sink.
+ * @param ret	[in] Return value from the image writer.
+ * @return ret, or the sink's error code if it failed.
+ */
+int GcImageWriterPrivate::closeFile(int ret)
+{
+	if (ret != 0 && sinkErr != 0) {
+		// The image writer failed because of the sink.
+		ret = sinkErr;
+	}
+
+	const int closeRet = sink->close(ret == 0);
+	if (ret == 0) {
+		ret = closeRet;
+	}
+	return ret;
 }
 
 /**
@@ -104,6 +230,167 @@ vector<const GcImage*> *GcImageWriterPrivate::gcImages_from_CI8_UNIQUE(const vec
 	return gcImagesARGB32;
 }
 
+/**
+ * Find the first and last bytes that differ between two rows.
+ * @param a	[in] First row.
+ * @param b	[in] Second row.
+ * @param len	[in] Length of each row, in bytes.
+ * @param first	[out] First differing byte.
+ * @param last	[out] Last differing byte.
+ * @return True if the rows differ; false if they're identical.
+ */
+static bool diffRow(const uint8_t *a, const uint8_t *b, int len, int *first, int *last)
+{
+	// Find the first differing byte.
+	int i = 0;
+#ifdef GCIMAGEWRITER_USE_SSE2
+	for (; i + 16 <= len; i += 16) {
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[i]));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[i]));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) {
+			// This block has a difference.
+			break;
+		}
+	}
+#endif /* GCIMAGEWRITER_USE_SSE2 */
+	for (; i < len; i++) {
+		if (a[i] != b[i])
+			break;
+	}
+	if (i >= len) {
+		// Rows are identical.
+		return false;
+	}
+	*first = i;
+
+	// Find the last differing byte.
+	int j = len;
+#ifdef GCIMAGEWRITER_USE_SSE2
+	for (; j - 16 > i; j -= 16) {
+		const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&a[j-16]));
+		const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&b[j-16]));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) != 0xFFFF) {
+			// This block has a difference.
+			break;
+		}
+	}
+#endif /* GCIMAGEWRITER_USE_SSE2 */
+	for (j--; j > i; j--) {
+		if (a[j] != b[j])
+			break;
+	}
+	*last = j;
+	return true;
+}
+
+/**
+ * Find the region that differs between two frames.
+ * The frames must have the same size and pixel format.
+ * @param prev	[in] Previous frame.
+ * @param cur	[in] Current frame.
+ * @param frame	[out] Changed region. (w/h are 0 if the frames are identical)
+ */
+void GcImageWriterPrivate::diffFrames(const GcImage *prev, const GcImage *cur, AnimFrame *frame)
+{
+	const int w = cur->width();
+	const int h = cur->height();
+	const int bytespp = (cur->pxFmt() == GcImage::PXFMT_ARGB32 ? 4 : 1);
+	const int pitch = w * bytespp;
+
+	int minX = w, maxX = -1;
+	int minY = h, maxY = -1;
+	const uint8_t *pPrev = static_cast<const uint8_t*>(prev->imageData());
+	const uint8_t *pCur = static_cast<const uint8_t*>(cur->imageData());
+	for (int y = 0; y < h; y++, pPrev += pitch, pCur += pitch) {
+		int first, last;
+		if (!diffRow(pPrev, pCur, pitch, &first, &last))
+			continue;
+
+		if (minY > y)
+			minY = y;
+		maxY = y;
+		if (minX > first / bytespp)
+			minX = first / bytespp;
+		if (maxX < last / bytespp)
+			maxX = last / bytespp;
+	}
+
+	if (maxY < 0) {
+		// Frames are identical.
+		frame->x = 0; frame->y = 0;
+		frame->w = 0; frame->h = 0;
+		return;
+	}
+
+	frame->x = minX;
+	frame->y = minY;
+	frame->w = maxX - minX + 1;
+	frame->h = maxY - minY + 1;
+}
+
+/**
+ * Determine the frames to write for an animated image.
+ * The first frame is always written in full. Subsequent frames
+ * only contain the region that changed, and frames that are
+ * identical to the previous frame are merged into it.
+ * @param gcImages	[in] Vector of GcImage.
+ * @param gcIconDelays	[in] Icon delays.
+ * @param frames	[out] Frames to write.
+ */
+void GcImageWriterPrivate::getAnimFrames(const vector<const GcImage*> *gcImages,
+					 const vector<int> *gcIconDelays,
+					 vector<AnimFrame> &frames)
+{
+	frames.clear();
+	frames.reserve(gcImages->size());
+
+	// First frame.
+	const GcImage *gcImage0 = gcImages->at(0);
+	AnimFrame frame;
+	frame.idx = 0;
+	frame.x = 0; frame.y = 0;
+	frame.w = gcImage0->width();
+	frame.h = gcImage0->height();
+	frame.delay = gcIconDelays->at(0);
+	frames.push_back(frame);
+
+	for (int i = 1; i < (int)gcImages->size(); i++) {
+		// NOTE: NULL images should be removed by write().
+		const GcImage *prev = gcImages->at(i-1);
+		const GcImage *cur = gcImages->at(i);
+		frame.idx = i;
+		frame.delay = gcIconDelays->at(i);
+
+		if (cur->pxFmt() == GcImage::PXFMT_CI8 &&
+		    memcmp(prev->palette(), cur->palette(), 256*sizeof(uint32_t)) != 0)
+		{
+			// CI8_UNIQUE with a different palette.
+			// The color indexes can't be compared.
+			frame.x = 0; frame.y = 0;
+			frame.w = cur->width();
+			frame.h = cur->height();
+		} else {
+			diffFrames(prev, cur, &frame);
+		}
+
+		if (frame.w == 0) {
+			// Frame is identical to the previous frame.
+			AnimFrame &prevFrame = frames.back();
+			if (prevFrame.delay + frame.delay <= ANIM_FRAME_MAX_DELAY) {
+				// Extend the previous frame.
+				prevFrame.delay += frame.delay;
+				continue;
+			}
+
+			// Delay is too long. Write a single pixel.
+			frame.w = 1;
+			frame.h = 1;
+		}
+
+		frames.push_back(frame);
+	}
+}
+
 /** GcImageWriter **/
 
 GcImageWriter::GcImageWriter()
@@ -312,6 +599,64 @@ GcImageWriter::AnimImageFormat GcImageWriter::animImageFormatFromName(const char
 	return ANIMGF_UNKNOWN;
 }
 
+/**
+ * Get the name of the specified compression profile.
+ * @param profile Compression profile.
+ * @return Name of the compression profile, or nullptr if invalid.
+ */
+const char *GcImageWriter::nameOfCompressionProfile(CompressionProfile profile)
+{
+	switch (profile) {
+		case COMPRESSION_DEFAULT:	return "default";
+		case COMPRESSION_FAST:		return "fast";
+		case COMPRESSION_ARCHIVAL:	return "archival";
+		default:			break;
+	}
+
+	return nullptr;
+}
+
+/**
+ * Look up a compression profile from its name.
+ * @param profile_str Compression profile name.
+ * @return Compression profile, or COMPRESSION_DEFAULT if unknown.
+ */
+GcImageWriter::CompressionProfile GcImageWriter::compressionProfileFromName(const char *profile_str)
+{
+	if (!profile_str) {
+		return COMPRESSION_DEFAULT;
+	} else if (!strcasecmp(profile_str, "fast")) {
+		return COMPRESSION_FAST;
+	} else if (!strcasecmp(profile_str, "archival")) {
+		return COMPRESSION_ARCHIVAL;
+	}
+
+	// Unknown compression profile.
+	return COMPRESSION_DEFAULT;
+}
+
+/**
+ * Get the compression profile.
+ * @return Compression profile.
+ */
+GcImageWriter::CompressionProfile GcImageWriter::compressionProfile(void) const
+{
+	return d->compression;
+}
+
+/**
+ * Set the compression profile.
+ * This is used for all subsequent writes.
+ * @param profile Compression profile.
+ */
+void GcImageWriter::setCompressionProfile(CompressionProfile profile)
+{
+	assert(profile >= COMPRESSION_DEFAULT && profile < COMPRESSION_MAX);
+	if (profile < COMPRESSION_DEFAULT || profile >= COMPRESSION_MAX)
+		profile = COMPRESSION_DEFAULT;
+	d->compression = profile;
+}
+
 /**
  * Get the internal memory buffer. (first file only)
  * @return Internal memory buffer, or nullptr if no files are in memory.
@@ -368,10 +713,47 @@ void GcImageWriter::clearMemBuffer(void)
  */
 int GcImageWriter::write(const GcImage *gcImage, ImageFormat imgf)
 {
+	return write(gcImage, imgf, &d->memBufferSink);
+}
+
+/**
+ * Write an animated GcImage to the internal memory buffer.
+ * @param gcImages	[in] Vector of GcImage.
+ * @param gcIconDelays	[in] Icon delays.
+ * @param animImgf	[in] Animated image format.
+ * @return 0 on success; non-zero on error.
+ */
+int GcImageWriter::write(const vector<const GcImage*> *gcImages,
+			 const vector<int> *gcIconDelays,
+			 AnimImageFormat animImgf)
+{
+	return write(gcImages, gcIconDelays, animImgf, &d->memBufferSink);
+}
+
+/**
+ * Write a GcImage to a sink.
+ * @param gcImage	[in] GcImage.
+ * @param imgf		[in] Image format.
+ * @param sink		[in] Sink.
+ * @return 0 on success; non-zero on error.
+ */
+int GcImageWriter::write(const GcImage *gcImage, ImageFormat imgf, Sink *sink)
+{
+	assert(sink != nullptr);
+	if (!sink)
+		return -EINVAL;
+
 	switch (imgf) {
 #ifdef HAVE_PNG
-		case IMGF_PNG:
-			return d->writePng(gcImage);
+		case IMGF_PNG: {
+			d->sink = sink;
+			int ret = d->openFile(0, 1);
+			if (ret == 0) {
+				ret = d->closeFile(d->writePng(gcImage));
+			}
+			d->sink = nullptr;
+			return ret;
+		}
 #endif /* HAVE_PNG */
 		default:
 			break;
@@ -382,20 +764,22 @@ int GcImageWriter::write(const GcImage *gcImage, ImageFormat imgf)
 }
 
 /**
- * Write an animated GcImage to the internal memory buffer.
+ * Write an animated GcImage to a sink.
  * @param gcImages	[in] Vector of GcImage.
  * @param gcIconDelays	[in] Icon delays.
  * @param animImgf	[in] Animated image format.
+ * @param sink		[in] Sink.
  * @return 0 on success; non-zero on error.
  */
 int GcImageWriter::write(const vector<const GcImage*> *gcImages,
 			 const vector<int> *gcIconDelays,
-			 AnimImageFormat animImgf)
+			 AnimImageFormat animImgf, Sink *sink)
 {
 	assert(gcImages != nullptr);
 	assert(!gcImages->empty());
 	assert(gcImages->at(0) != nullptr);
-	if (!gcImages || gcImages->empty() || !gcImages->at(0))
+	assert(sink != nullptr);
+	if (!gcImages || gcImages->empty() || !gcImages->at(0) || !sink)
 		return -EINVAL;
 	if (!isAnimImageFormatSupported(animImgf))
 		return -ENOSYS;
@@ -442,22 +826,32 @@ int GcImageWriter::write(const vector<const GcImage*> *gcImages,
 		}
 	}
 
+	int ret;
+	d->sink = sink;
 	switch (animImgf) {
 #ifdef HAVE_PNG
 		case ANIMGF_APNG:
 		case ANIMGF_PNG_FPF:
 		case ANIMGF_PNG_VS:
 		case ANIMGF_PNG_HS:
-			return d->writePng_anim(&adjGcImages, &adjGcIconDelays, animImgf);
+			// NOTE: writePng_anim() starts its own files,
+			// since PNG FPF writes one file per frame.
+			ret = d->writePng_anim(&adjGcImages, &adjGcIconDelays, animImgf);
+			break;
 #endif /* HAVE_PNG */
 #ifdef USE_GIF
 		case ANIMGF_GIF:
-			return d->writeGif_anim(&adjGcImages, &adjGcIconDelays);
+			ret = d->openFile(0, 1);
+			if (ret == 0) {
+				ret = d->closeFile(d->writeGif_anim(&adjGcImages, &adjGcIconDelays));
+			}
+			break;
 #endif /* USE_GIF */
 		default:
+			// Invalid image format.
+			ret = -EINVAL;
 			break;
 	}
-
-	// Invalid image format.
-	return -EINVAL;
+	d->sink = nullptr;
+	return ret;
 }
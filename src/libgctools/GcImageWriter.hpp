@@ -10,6 +10,7 @@
 #define __LIBGCTOOLS_GCIMAGEWRITER_HPP__
 
 // C includes.
+#include <stddef.h>
 #include <stdint.h>
 
 // C++ includes.
@@ -30,6 +31,44 @@ class GcImageWriter
 		GcImageWriter();
 		~GcImageWriter();
 
+		/**
+		 * Output sink.
+		 * Image data is written directly to the sink
+		 * as it's encoded, without an intermediate buffer.
+		 *
+		 * Some formats (e.g. PNG FPF) write multiple files.
+		 * Each file is started with open() and finished with close().
+		 */
+		class Sink
+		{
+			public:
+				virtual ~Sink() { }
+
+				/**
+				 * Start writing a file.
+				 * @param idx	[in] File number.
+				 * @param count	[in] Total number of files.
+				 * @return 0 on success; negative POSIX error code on error.
+				 */
+				virtual int open(int idx, int count) = 0;
+
+				/**
+				 * Write data to the current file.
+				 * @param buf	[in] Data.
+				 * @param len	[in] Size of buf.
+				 * @return 0 on success; negative POSIX error code on error.
+				 */
+				virtual int write(const uint8_t *buf, size_t len) = 0;
+
+				/**
+				 * Finish writing the current file.
+				 * @param ok	[in] True if the file was written successfully;
+				 *		     false if it should be discarded.
+				 * @return 0 on success; negative POSIX error code on error.
+				 */
+				virtual int close(bool ok) = 0;
+		};
+
 	private:
 		friend class GcImageWriterPrivate;
 		GcImageWriterPrivate *const d;
@@ -130,6 +169,44 @@ class GcImageWriter
 		 */
 		static AnimImageFormat animImageFormatFromName(const char *animImgf_str);
 
+		/**
+		 * Compression profiles.
+		 * These only affect PNG; GIF always uses LZW.
+		 */
+		enum CompressionProfile {
+			COMPRESSION_DEFAULT	= 0,	// zlib level 5, no filters
+			COMPRESSION_FAST,		// zlib level 1, no filters
+			COMPRESSION_ARCHIVAL,		// zlib level 9, adaptive filters
+			COMPRESSION_MAX
+		};
+
+		/**
+		 * Get the name of the specified compression profile.
+		 * @param profile Compression profile.
+		 * @return Name of the compression profile, or nullptr if invalid.
+		 */
+		static const char *nameOfCompressionProfile(CompressionProfile profile);
+
+		/**
+		 * Look up a compression profile from its name.
+		 * @param profile_str Compression profile name.
+		 * @return Compression profile, or COMPRESSION_DEFAULT if unknown.
+		 */
+		static CompressionProfile compressionProfileFromName(const char *profile_str);
+
+		/**
+		 * Get the compression profile.
+		 * @return Compression profile.
+		 */
+		CompressionProfile compressionProfile(void) const;
+
+		/**
+		 * Set the compression profile.
+		 * This is used for all subsequent writes.
+		 * @param profile Compression profile.
+		 */
+		void setCompressionProfile(CompressionProfile profile);
+
 		/**
 		 * Get the internal memory buffer. (first file only)
 		 * @return Internal memory buffer, or nullptr if no files are in memory.
@@ -172,6 +249,27 @@ class GcImageWriter
 		int write(const std::vector<const GcImage*> *gcImages,
 			  const std::vector<int> *gcIconDelays,
 			  AnimImageFormat animImgf);
+
+		/**
+		 * Write a GcImage to a sink.
+		 * @param gcImage	[in] GcImage.
+		 * @param imgf		[in] Image format.
+		 * @param sink		[in] Sink.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int write(const GcImage *gcImage, ImageFormat imgf, Sink *sink);
+
+		/**
+		 * Write an animated GcImage to a sink.
+		 * @param gcImages	[in] Vector of GcImage.
+		 * @param gcIconDelays	[in] Icon delays.
+		 * @param animImgf	[in] Animated image format.
+		 * @param sink		[in] Sink.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int write(const std::vector<const GcImage*> *gcImages,
+			  const std::vector<int> *gcIconDelays,
+			  AnimImageFormat animImgf, Sink *sink);
 };
 
 #endif /* __LIBGCTOOLS_CHECKSUM_HPP__ */
@@ -23,27 +23,12 @@
 using std::unique_ptr;
 using std::vector;
 
-#ifdef USE_INTERNAL_GIF
-// giflib-5.2.1 declares GifQuantizeBuffer in getarg.h.
-#include "getarg.h"
-#else /* !USE_INTERNAL_GIF */
-// giflib-4.2 doesn't have QuantizeBuffer().
-// To prevent issues, we're including our own copy of
-// giflib-5.2.1's GifQuantizeBuffer() if we're not
-// using an internal copy of giflib.
-extern "C"
-int gcn_GifQuantizeBuffer(unsigned int Width, unsigned int Height,
-                   int *ColorMapSize, GifByteType * RedInput,
-                   GifByteType * GreenInput, GifByteType * BlueInput,
-                   GifByteType * OutputBuffer,
-                   GifColorType * OutputColorMap);
-#define GifQuantizeBuffer(Width, Height, ColorMapSize, RedInput, GreenInput, BlueInput, OutputBuffer, OutputColorMap) \
-	gcn_GifQuantizeBuffer((Width), (Height), (ColorMapSize), (RedInput), (GreenInput), (BlueInput), (OutputBuffer), (OutputColorMap))
-#endif /* !USE_INTERNAL_GIF */
+// Color quantizer.
+#include "OctreeQuantizer.hpp"
 
 /**
  * GIF write function.
- * @param gif	[in] GifFileType pointer.
+ * @param gif	[in] GifFileType pointer. (UserData is GcImageWriterPrivate*)
  * @param buf	[in] Data to write.
  * @param len	[in] Size of buf.
  * @return Number of bytes written.
@@ -54,11 +39,11 @@ int GcImageWriterPrivate::gif_output_func(GifFileType *gif, const GifByteType *b
 	if (!userData || len <= 0)
 		return 0;
 
-	// Assuming the UserData is a vector<uint8_t>*.
-	vector<uint8_t> *gifBuffer = static_cast<vector<uint8_t>*>(userData);
-	size_t pos = gifBuffer->size();
-	gifBuffer->resize(pos + len);
-	memcpy(&gifBuffer->data()[pos], buf, len);
+	GcImageWriterPrivate *const d = static_cast<GcImageWriterPrivate*>(userData);
+	if (d->sinkWrite(buf, len) != 0) {
+		// Error writing to the sink.
+		return 0;
+	}
 	return len;
 }
 
@@ -81,8 +66,6 @@ int GcImageWriterPrivate::paletteToGifColorMap(ColorMapObject *colorMap, const u
 		// Check for full transparency.
 		// NOTE: GIF doesn't support alpha-transparency;
 		// semi-transparent pixels will be opaque.
-		// TODO: If multiple entries are fully-transparent,
-		// convert them all to the first entry.
 		if (((*palette >> 24) & 0xFF) == 0) {
 			// Color is fully transparent.
 			if (trans_idx < 0) {
@@ -147,9 +130,11 @@ int GcImageWriterPrivate::gif_addLoopExtension(GifFileType *gif, uint16_t loopCo
  * @param gif		[in] GIF image.
  * @param trans_idx	[in] Transparent color index. (-1 for no transparency)
  * @param iconDelay	[in] Icon delay, in centiseconds.
+ * @param disposal	[in] Disposal method. (see GIF89a spec)
  * @return GIF_OK on success; GIF_ERROR on error.
  */
-int GcImageWriterPrivate::gif_addGraphicsControlBlock(GifFileType *gif, int trans_idx, uint16_t iconDelay)
+int GcImageWriterPrivate::gif_addGraphicsControlBlock(GifFileType *gif, int trans_idx,
+						      uint16_t iconDelay, int disposal)
 {
 	/**
 	 * Graphics control block.
@@ -172,6 +157,7 @@ int GcImageWriterPrivate::gif_addGraphicsControlBlock(GifFileType *gif, int tran
 		animctrl[0] = 0;
 		animctrl[3] = 0xFF;
 	}
+	animctrl[0] |= ((disposal & 7) << 2);
 
 	// Icon delay.
 	animctrl[1] = iconDelay & 0xFF;
@@ -181,62 +167,227 @@ int GcImageWriterPrivate::gif_addGraphicsControlBlock(GifFileType *gif, int tran
 }
 
 /**
- * Write an ARGB32 image to a GIF.
- * This will reduce the image to 256 colors first.
- * @param gif		[in] GIF image.
- * @param gcImage	[in] GcImage to write.
- * @param colorMap	[in] Color map object to use.
- * @return GIF_OK on success; GIF_ERROR on error.
+ * Check if a pixel is fully transparent.
+ * @param gcImage	[in] GcImage.
+ * @param i		[in] Pixel index.
+ * @return True if the pixel is fully transparent; false if not.
  */
-int GcImageWriterPrivate::gif_writeARGB32Image(GifFileType *gif,
-		const GcImage *gcImage, ColorMapObject *colorMap)
+static inline bool isPixelTransparent(const GcImage *gcImage, int i)
 {
-	// Split the image into separate Red/Green/Blue buffers.
-	// TODO: Transparency?
-	const size_t bufSz = gcImage->width() * gcImage->height();
-	const size_t fullBufSz = bufSz * 4;
-	unique_ptr<GifByteType[]> full(new GifByteType[fullBufSz]);
-	GifByteType *red = full.get();
-	GifByteType *green = red + bufSz;
-	GifByteType *blue = green + bufSz;
-	GifByteType *out = blue + bufSz;
+	if (gcImage->pxFmt() == GcImage::PXFMT_CI8) {
+		const uint8_t *imageData = (const uint8_t*)gcImage->imageData();
+		return ((gcImage->palette()[imageData[i]] >> 24) == 0);
+	}
 
-	const uint32_t *src = (const uint32_t*)gcImage->imageData();
-	for (size_t i = bufSz; i > 0; i--, src++) {
-		*red++   = ((*src >> 16) & 0xFF);
-		*green++ = ((*src >>  8) & 0xFF);
-		*blue++  = ( *src        & 0xFF);
+	const uint32_t *imageData = (const uint32_t*)gcImage->imageData();
+	return ((imageData[i] >> 24) == 0);
+}
+
+/**
+ * Determine the disposal method for each GIF frame.
+ * GIF frames can't make a pixel transparent once it's been
+ * drawn, so if a frame does that, the previous frame is
+ * cleared to the background, and both frames are written
+ * in full. Otherwise, frames are left in place.
+ * @param gcImages	[in] Vector of GcImage.
+ * @param frames	[in/out] Frames from getAnimFrames().
+ * @param disposal	[out] Disposal method for each frame.
+ */
+void GcImageWriterPrivate::gif_getDisposal(const vector<const GcImage*> *gcImages,
+					   vector<AnimFrame> &frames,
+					   vector<uint8_t> &disposal)
+{
+	// Disposal method 1: Leave the frame in place.
+	disposal.assign(frames.size(), 1);
+
+	for (int i = 1; i < (int)frames.size(); i++) {
+		AnimFrame &frame = frames[i];
+		const GcImage *prev = gcImages->at(frames[i-1].idx);
+		const GcImage *cur = gcImages->at(frame.idx);
+		const int w = cur->width();
+
+		// Only the changed region needs to be checked.
+		bool clear = false;
+		for (int y = frame.y; y < frame.y + frame.h && !clear; y++) {
+			for (int x = frame.x; x < frame.x + frame.w; x++) {
+				const int px = (y * w) + x;
+				if (isPixelTransparent(cur, px) && !isPixelTransparent(prev, px)) {
+					clear = true;
+					break;
+				}
+			}
+		}
+		if (!clear)
+			continue;
+
+		// Disposal method 2: Restore to background.
+		// This only clears the previous frame's region,
+		// so the previous frame must cover the whole image.
+		AnimFrame &prevFrame = frames[i-1];
+		prevFrame.x = 0; prevFrame.y = 0;
+		prevFrame.w = w; prevFrame.h = cur->height();
+		disposal[i-1] = 2;
+		frame.x = 0; frame.y = 0;
+		frame.w = w; frame.h = cur->height();
 	}
+}
 
-	// Reset the buffer pointers.
-	red = full.get();
-	green = red + bufSz;
-	blue = green + bufSz;
-
-	// Quantize the image buffer.
-	int colorCount = 256;
-	GifDlSetColorMapCount(colorMap, colorCount);
-	int ret = GifQuantizeBuffer(gcImage->width(), gcImage->height(),
-			&colorCount, red, green, blue, out,
-			GifDlGetColorMapArray(colorMap));
-	GifDlSetColorMapCount(colorMap, colorCount);
+/**
+ * Write a CI8 image to a GIF.
+ * Fully-transparent palette entries are remapped to trans_idx.
+ * @param gif		[in] GIF image.
+ * @param gcImage	[in] GcImage to write.
+ * @param frame		[in] Region of the image to write.
+ * @param colorMap	[in] Local color map, or nullptr to use the global color map.
+ * @param trans_idx	[in] Transparent color index. (-1 for no transparency)
+ * @param line		[in] Line buffer. (must have room for one row)
+ * @return GIF_OK on success; GIF_ERROR on error.
+ */
+int GcImageWriterPrivate::gif_writeCI8Image(GifFileType *gif,
+		const GcImage *gcImage, const AnimFrame &frame,
+		ColorMapObject *colorMap, int trans_idx, GifByteType *line)
+{
+	// Start the frame.
+	int ret = EGifDlPutImageDesc(gif, frame.x, frame.y, frame.w, frame.h, false, colorMap);
 	if (ret != GIF_OK) {
 		// Error!
 		return ret;
 	}
 
+	// GIF only has one transparent color.
+	// Remap all fully-transparent colors to it.
+	uint8_t remap[256];
+	bool needsRemap = false;
+	const uint32_t *palette = gcImage->palette();
+	for (int i = 0; i < 256; i++) {
+		if (trans_idx >= 0 && i != trans_idx && (palette[i] >> 24) == 0) {
+			remap[i] = (uint8_t)trans_idx;
+			needsRemap = true;
+		} else {
+			remap[i] = (uint8_t)i;
+		}
+	}
+
+	// Write the changed region.
+	const int pitch = gcImage->width();
+	const uint8_t *src = (const uint8_t*)gcImage->imageData();
+	src += (frame.y * pitch) + frame.x;
+	for (int y = frame.h; y > 0; y--, src += pitch) {
+		const GifByteType *out;
+		if (needsRemap) {
+			for (int x = 0; x < frame.w; x++) {
+				line[x] = remap[src[x]];
+			}
+			out = line;
+		} else {
+			out = src;
+		}
+
+		ret = EGifDlPutLine(gif, const_cast<GifByteType*>(out), frame.w);
+		if (ret != GIF_OK) {
+			// Error!
+			return ret;
+		}
+	}
+
+	// Image written.
+	return GIF_OK;
+}
+
+/**
+ * Build a global palette for ARGB32 frames.
+ * GIF doesn't support alpha-transparency, so fully-transparent
+ * pixels use a separate transparent color, and all other
+ * pixels are opaque.
+ * @param octree	[out] Quantizer.
+ * @param gcImages	[in] Vector of GcImage. (must be ARGB32)
+ * @param colorMap	[out] GIF ColorMapObject.
+ * @return Index of transparent color, or -1 if no transparent color.
+ */
+int GcImageWriterPrivate::gif_buildARGB32Palette(OctreeQuantizer &octree,
+		const vector<const GcImage*> *gcImages,
+		ColorMapObject *colorMap)
+{
+	// Check for fully-transparent pixels.
+	bool hasTransparency = false;
+	for (auto iter = gcImages->cbegin(); iter != gcImages->cend() && !hasTransparency; ++iter) {
+		const GcImage *gcImage = *iter;
+		const uint32_t *src = (const uint32_t*)gcImage->imageData();
+		for (int i = gcImage->width() * gcImage->height(); i > 0; i--, src++) {
+			if ((*src >> 24) == 0) {
+				hasTransparency = true;
+				break;
+			}
+		}
+	}
+
+	// Use the same palette for all frames.
+	// If there's transparency, reserve one color for it.
+	octree.reset(hasTransparency ? 255 : 256);
+	for (auto iter = gcImages->cbegin(); iter != gcImages->cend(); ++iter) {
+		const GcImage *gcImage = *iter;
+		octree.addPixels((const uint32_t*)gcImage->imageData(),
+				 gcImage->width() * gcImage->height());
+	}
+
+	uint32_t palette[256];
+	const int colorCount = octree.getPalette(palette);
+
+	// Convert the palette.
+	// NOTE: Unused entries are black.
+	GifColorType *color = GifDlGetColorMapArray(colorMap);
+	for (int i = 0; i < 256; i++, color++) {
+		const uint32_t argb = (i < colorCount ? palette[i] : 0);
+		color->Red   = ((argb >> 16) & 0xFF);
+		color->Green = ((argb >>  8) & 0xFF);
+		color->Blue  = ( argb        & 0xFF);
+	}
+
+	// Transparent color is after the quantized colors.
+	return (hasTransparency ? colorCount : -1);
+}
+
+/**
+ * Write an ARGB32 image to a GIF.
+ * The pixels are mapped to the palette from gif_buildARGB32Palette().
+ * @param gif		[in] GIF image.
+ * @param gcImage	[in] GcImage to write.
+ * @param frame		[in] Region of the image to write.
+ * @param octree	[in] Quantizer from gif_buildARGB32Palette().
+ * @param trans_idx	[in] Transparent color index. (-1 for no transparency)
+ * @param line		[in] Line buffer. (must have room for one row)
+ * @return GIF_OK on success; GIF_ERROR on error.
+ */
+int GcImageWriterPrivate::gif_writeARGB32Image(GifFileType *gif,
+		const GcImage *gcImage, const AnimFrame &frame,
+		const OctreeQuantizer &octree, int trans_idx, GifByteType *line)
+{
 	// Start the frame.
-	ret = EGifDlPutImageDesc(gif, 0, 0, gcImage->width(), gcImage->height(), false, colorMap);
+	// NOTE: ARGB32 images always use the global palette.
+	int ret = EGifDlPutImageDesc(gif, frame.x, frame.y, frame.w, frame.h, false, nullptr);
 	if (ret != GIF_OK) {
 		// Error!
 		return ret;
 	}
 
-	// Write the entire image.
-	ret = EGifDlPutLine(gif, out, bufSz);
-	if (ret != GIF_OK) {
-		// Error!
-		return ret;
+	// Write the changed region.
+	const int pitch = gcImage->width();
+	const uint32_t *src = (const uint32_t*)gcImage->imageData();
+	src += (frame.y * pitch) + frame.x;
+	for (int y = frame.h; y > 0; y--, src += pitch) {
+		for (int x = 0; x < frame.w; x++) {
+			if (trans_idx >= 0 && (src[x] >> 24) == 0) {
+				line[x] = (GifByteType)trans_idx;
+			} else {
+				line[x] = octree.lookup(src[x]);
+			}
+		}
+
+		ret = EGifDlPutLine(gif, line, frame.w);
+		if (ret != GIF_OK) {
+			// Error!
+			return ret;
+		}
 	}
 
 	// Image written.
@@ -244,7 +395,8 @@ int GcImageWriterPrivate::gif_writeARGB32Image(GifFileType *gif,
 }
 
 /**
- * Write an animated GcImage to the internal memory buffer in some GIF format.
+ * Write an animated GcImage to the current sink in GIF format.
+ * The file must have been started with openFile().
  * @param gcImages	[in] Vector of GcImage.
  * @param gcIconDelays	[in] Icon delays.
  * @return 0 on success; non-zero on error.
@@ -270,26 +422,52 @@ int GcImageWriterPrivate::writeGif_anim(const vector<const GcImage*> *gcImages,
 		return -1;
 	}
 
+	// Transparent color index for the global palette.
+	int trans_idx = -1;
+
 	bool is_CI8_UNIQUE = false;
-	if (gcImage0->pxFmt() == GcImage::PXFMT_CI8) {
-		// May be CI8 or CI8_UNIQUE.
-		is_CI8_UNIQUE = is_gcImages_CI8_UNIQUE(gcImages);
-		if (!is_CI8_UNIQUE) {
-			// Convert the palette from the first frame.
-			paletteToGifColorMap(colorMap, gcImage0->palette());
-		}
+	switch (gcImage0->pxFmt()) {
+		case GcImage::PXFMT_CI8:
+			// May be CI8 or CI8_UNIQUE.
+			// CI8 images already have an exact palette,
+			// so they don't need to be quantized.
+			is_CI8_UNIQUE = is_gcImages_CI8_UNIQUE(gcImages);
+			if (!is_CI8_UNIQUE) {
+				// Convert the palette from the first frame.
+				trans_idx = paletteToGifColorMap(colorMap, gcImage0->palette());
+			}
+			break;
+
+		case GcImage::PXFMT_ARGB32:
+			// Reduce all frames to a single 256-color palette.
+			// NOTE: The quantizer has a fixed-size node pool,
+			// so it's allocated on first use and kept.
+			if (!octree) {
+				octree = new OctreeQuantizer();
+			}
+			trans_idx = gif_buildARGB32Palette(*octree, gcImages, colorMap);
+			break;
+
+		default:
+			// Unsupported pixel format.
+			GifDlFreeMapObject(colorMap);
+			return -9;
 	}
 
-	// Initialize the internal buffer.
-	vector<uint8_t> *gifBuffer = new vector<uint8_t>();
-	gifBuffer->reserve(32768);	// 32 KB should cover most of the use cases.
+	// Determine which region of each frame needs to be written.
+	vector<AnimFrame> frames;
+	vector<uint8_t> disposal;
+	getAnimFrames(gcImages, gcIconDelays, frames);
+	gif_getDisposal(gcImages, frames, disposal);
+
+	// Line buffer.
+	unique_ptr<GifByteType[]> line(new GifByteType[w]);
 
 	// TODO: Make use of the giflib error code.
 	int err = GIF_OK;
-	GifFileType *gif = EGifDlOpen(gifBuffer, gif_output_func, &err);
+	GifFileType *gif = EGifDlOpen(this, gif_output_func, &err);
 	if (!gif) {
 		// Error!
-		delete gifBuffer;
 		GifDlFreeMapObject(colorMap);
 		return -1;
 	}
@@ -308,7 +486,6 @@ int GcImageWriterPrivate::writeGif_anim(const vector<const GcImage*> *gcImages,
 	if (EGifDlPutScreenDesc(gif, w, h, 8, 0, (is_CI8_UNIQUE ? nullptr : colorMap)) != GIF_OK) {
 		// Error!
 		EGifDlCloseFile(gif, &err);
-		delete gifBuffer;
 		GifDlFreeMapObject(colorMap);
 		return -2;
 	}
@@ -317,85 +494,55 @@ int GcImageWriterPrivate::writeGif_anim(const vector<const GcImage*> *gcImages,
 	if (gif_addLoopExtension(gif, 0) != GIF_OK) {
 		// Error!
 		EGifDlCloseFile(gif, &err);
-		delete gifBuffer;
 		GifDlFreeMapObject(colorMap);
 		return -3;
 	}
 
 	// Write the frames.
-	for (int i = 0; i < (int)gcImages->size(); i++) {
+	// Each frame only contains the region that changed
+	// since the previous frame.
+	for (int i = 0; i < (int)frames.size(); i++) {
 		// NOTE: NULL images should be removed by write().
-		const GcImage *gcImage = gcImages->at(i);
+		const AnimFrame &frame = frames[i];
+		const GcImage *gcImage = gcImages->at(frame.idx);
 
 		// NOTE: Icon delay is in units of 8 NTSC frames.
-		const float fIconDelay = (float)(gcIconDelays->at(i) * 8 * 100) / 60.0f;
+		const float fIconDelay = (float)(frame.delay * 8 * 100) / 60.0f;
 		const uint16_t uIconDelay = (uint16_t)fIconDelay;
 
+		if (is_CI8_UNIQUE) {
+			// Update the ColorMap for this frame.
+			trans_idx = paletteToGifColorMap(colorMap, gcImage->palette());
+		}
+
 		// Graphics control block.
-		// TODO: Transparent color index.
-		if (gif_addGraphicsControlBlock(gif, -1, uIconDelay) != GIF_OK) {
+		if (gif_addGraphicsControlBlock(gif, trans_idx, uIconDelay, disposal[i]) != GIF_OK) {
 			// Error!
 			EGifDlCloseFile(gif, &err);
-			delete gifBuffer;
 			GifDlFreeMapObject(colorMap);
 			return -5;
 		}
 
-		if (is_CI8_UNIQUE) {
-			// Update the ColorMap for this frame.
-			paletteToGifColorMap(colorMap, gcImage->palette());
+		int ret;
+		if (gcImage->pxFmt() == GcImage::PXFMT_CI8) {
+			ret = gif_writeCI8Image(gif, gcImage, frame,
+				(is_CI8_UNIQUE ? colorMap : nullptr), trans_idx, line.get());
+		} else {
+			ret = gif_writeARGB32Image(gif, gcImage, frame,
+				*octree, trans_idx, line.get());
 		}
-
-		switch (gcImage->pxFmt()) {
-			case GcImage::PXFMT_CI8:
-				// Start the frame.
-				if (EGifDlPutImageDesc(gif, 0, 0, w, h, false,
-				    (is_CI8_UNIQUE ? colorMap : nullptr)) != GIF_OK)
-				{
-					// Error!
-					EGifDlCloseFile(gif, &err);
-					delete gifBuffer;
-					GifDlFreeMapObject(colorMap);
-					return -6;
-				}
-
-				// Write the entire image.
-				if (EGifDlPutLine(gif, (uint8_t*)gcImage->imageData(),
-				    gcImage->imageData_len()) != GIF_OK)
-				{
-					// Error!
-					EGifDlCloseFile(gif, &err);
-					delete gifBuffer;
-					GifDlFreeMapObject(colorMap);
-					return -7;
-				}
-				break;
-
-			case GcImage::PXFMT_ARGB32:
-				// Reduce the image to 256 colors.
-				// TODO: Use a similar palette for all images?
-				// Otherwise it might look weird...
-				if (gif_writeARGB32Image(gif, gcImage, colorMap) != GIF_OK) {
-					// Error!
-					EGifDlCloseFile(gif, &err);
-					delete gifBuffer;
-					GifDlFreeMapObject(colorMap);
-					return -8;
-				}
-				break;
-
-			default:
-				// Unsupported pixel format.
-				delete gifBuffer;
-				GifDlFreeMapObject(colorMap);
-				return -9;
+		if (ret != GIF_OK) {
+			// Error!
+			EGifDlCloseFile(gif, &err);
+			GifDlFreeMapObject(colorMap);
+			return -6;
 		}
 	}
 
 	GifDlFreeMapObject(colorMap);
-	EGifDlCloseFile(gif, &err);
-
-	// Add the gifBuffer to the memBuffer.
-	memBuffer.push_back(gifBuffer);
+	if (EGifDlCloseFile(gif, &err) != GIF_OK) {
+		// Error writing the GIF trailer.
+		return -7;
+	}
 	return 0;
 }
@@ -27,7 +27,7 @@ using std::vector;
 
 /**
  * PNG write function.
- * @param png_ptr	[in] PNG pointer.
+ * @param png_ptr	[in] PNG pointer. (io_ptr is GcImageWriterPrivate*)
  * @param buf		[in] Data to write.
  * @param len		[in] Size of buf.
  */
@@ -37,11 +37,12 @@ void GcImageWriterPrivate::png_io_write(png_structp png_ptr, png_bytep buf, png_
 	if (!io_ptr || len == 0)
 		return;
 
-	// Assuming the io_ptr is a vector<uint8_t>*.
-	vector<uint8_t> *pngBuffer = static_cast<vector<uint8_t>*>(io_ptr);
-	size_t pos = pngBuffer->size();
-	pngBuffer->resize(pos + len);
-	memcpy(&pngBuffer->data()[pos], buf, len);
+	GcImageWriterPrivate *const d = static_cast<GcImageWriterPrivate*>(io_ptr);
+	if (d->sinkWrite(buf, len) != 0) {
+		// Error writing to the sink.
+		// NOTE: This doesn't return.
+		png_error(png_ptr, "Error writing to the sink.");
+	}
 }
 
 /**
@@ -90,7 +91,69 @@ int GcImageWriterPrivate::writePng_PLTE(
 }
 
 /**
- * Write a GcImage to the internal memory buffer in PNG format.
+ * Create the libpng write and info structs.
+ * The write function is set to the current sink.
+ *
+ * NOTE: libpng can't reset a write struct once an image
+ * has been written, so a new one is needed for each file.
+ * The caller must set up setjmp() after calling this.
+ *
+ * @param png_ptr	[out] PNG pointer.
+ * @param info_ptr	[out] PNG info pointer.
+ * @return 0 on success; non-zero on error.
+ */
+int GcImageWriterPrivate::pngCreate(png_structp *png_ptr, png_infop *info_ptr)
+{
+	*png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+	if (!*png_ptr) {
+		// Could not create PNG write struct.
+		return -0x101;
+	}
+	*info_ptr = png_create_info_struct(*png_ptr);
+	if (!*info_ptr) {
+		// Could not create PNG info struct.
+		png_destroy_write_struct(png_ptr, (png_infopp)NULL);
+		return -0x102;
+	}
+
+	// Initialize the sink write function.
+	png_set_write_fn(*png_ptr, this, png_io_write, png_io_flush);
+	return 0;
+}
+
+/**
+ * Set the compression parameters for the current profile.
+ * This must be called after png_set_IHDR().
+ * @param png_ptr	[in] PNG pointer.
+ * @param isPalette	[in] True if the image uses a palette.
+ */
+void GcImageWriterPrivate::pngSetCompression(png_structp png_ptr, bool isPalette) const
+{
+	switch (compression) {
+		case GcImageWriter::COMPRESSION_FAST:
+			png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
+			png_set_compression_level(png_ptr, 1);
+			break;
+
+		case GcImageWriter::COMPRESSION_ARCHIVAL:
+			// Filters rarely help with paletted images,
+			// so only use them for ARGB32.
+			png_set_filter(png_ptr, 0, (isPalette ? PNG_FILTER_NONE : PNG_ALL_FILTERS));
+			png_set_compression_level(png_ptr, 9);
+			png_set_compression_mem_level(png_ptr, 9);
+			break;
+
+		case GcImageWriter::COMPRESSION_DEFAULT:
+		default:
+			png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
+			png_set_compression_level(png_ptr, 5);
+			break;
+	}
+}
+
+/**
+ * Write a GcImage to the current sink in PNG format.
+ * The file must have been started with openFile().
  * @param gcImage	[in] GcImage.
  * @return 0 on success; non-zero on error.
  */
@@ -103,40 +166,19 @@ int GcImageWriterPrivate::writePng(const GcImage *gcImage)
 	png_infop info_ptr;
 
 	// Initialize libpng.
-	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	if (!png_ptr) {
-		// Could not create PNG write struct.
-		return -0x101;
-	}
-	info_ptr = png_create_info_struct(png_ptr);
-	if (!info_ptr) {
-		// Could not create PNG info struct.
-		png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
-		return -0x102;
-	}
-
-	// Initialize the internal buffer.
-	vector<uint8_t> *pngBuffer = new vector<uint8_t>();
-	pngBuffer->reserve(32768);	// 32 KB should cover most of the use cases.
-	vector<const uint8_t*> row_pointers;
+	int ret = pngCreate(&png_ptr, &info_ptr);
+	if (ret != 0)
+		return ret;
 
 	// WARNING: Do NOT initialize any C++ objects past this point!
 #ifdef PNG_SETJMP_SUPPORTED
 	if (setjmp(png_jmpbuf(png_ptr))) {
 		// PNG write failed.
 		png_destroy_write_struct(&png_ptr, &info_ptr);
-		delete pngBuffer;
 		return -0x103;
 	}
 #endif /* PNG_SETJMP_SUPPORTED */
 
-	// Initialize the memory write function.
-	png_set_write_fn(png_ptr, pngBuffer, png_io_write, png_io_flush);
-
-	// Initialize compression parameters.
-	png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
-	png_set_compression_level(png_ptr, 5);	// TODO: Customizable?
-
 	const int w = gcImage->width();
 	const int h = gcImage->height();
 
@@ -168,10 +210,12 @@ int GcImageWriterPrivate::writePng(const GcImage *gcImage)
 		default:
 			// Unsupported pixel format.
 			png_destroy_write_struct(&png_ptr, (png_infopp)nullptr);
-			delete pngBuffer;
 			return -EINVAL;
 	}
 
+	// Initialize compression parameters.
+	pngSetCompression(png_ptr, (gcImage->pxFmt() == GcImage::PXFMT_CI8));
+
 	// Write the PNG information to the file.
 	png_write_info(png_ptr, info_ptr);
 
@@ -182,24 +226,22 @@ int GcImageWriterPrivate::writePng(const GcImage *gcImage)
 
 	// Calculate the row pointers.
 	const uint8_t *imageData = (const uint8_t*)gcImage->imageData();
-	row_pointers.resize(h);
+	rowPointers.resize(h);
 	for (int y = 0; y < h; y++, imageData += pitch)
-		row_pointers[y] = imageData;
+		rowPointers[y] = imageData;
 
 	// Write the image data.
-	png_write_image(png_ptr, (png_bytepp)row_pointers.data());
+	png_write_image(png_ptr, (png_bytepp)rowPointers.data());
 
 	// Finished writing.
 	png_write_end(png_ptr, info_ptr);
 	png_destroy_write_struct(&png_ptr, &info_ptr);
 
-	// Add the pngBuffer to the memBuffer.
-	memBuffer.push_back(pngBuffer);
 	return 0;
 }
 
 /**
- * Write an animated GcImage to the internal memory buffer in APNG format.
+ * Write an animated GcImage to the current sink in APNG format.
  * @param gcImages	[in] Vector of GcImage.
  * @param gcIconDelays	[in] Icon delays.
  * @return 0 on success; non-zero on error.
@@ -213,47 +255,30 @@ int GcImageWriterPrivate::writeAPng(const vector<const GcImage*> *gcImages, cons
 	png_infop info_ptr;
 
 	// Initialize libpng.
-	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	if (!png_ptr) {
-		// Could not create PNG write struct.
-		return -0x101;
-	}
-	info_ptr = png_create_info_struct(png_ptr);
-	if (!info_ptr) {
-		// Could not create PNG info struct.
-		png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
-		return -0x102;
-	}
+	int ret = pngCreate(&png_ptr, &info_ptr);
+	if (ret != 0)
+		return ret;
 
-	// Initialize the internal buffer.
-	vector<uint8_t> *pngBuffer = new vector<uint8_t>();
-	pngBuffer->reserve(32768);	// 32 KB should cover most of the use cases.
-	vector<const uint8_t*> row_pointers;
+	// Determine which region of each frame needs to be written.
+	vector<AnimFrame> frames;
+	getAnimFrames(gcImages, gcIconDelays, frames);
 
 	// WARNING: Do NOT initialize any C++ objects past this point!
 #ifdef PNG_SETJMP_SUPPORTED
 	if (setjmp(png_jmpbuf(png_ptr))) {
 		// PNG write failed.
 		png_destroy_write_struct(&png_ptr, &info_ptr);
-		delete pngBuffer;
 		return -0x103;
 	}
 #endif /* PNG_SETJMP_SUPPORTED */
 
-	// Initialize the memory write function.
-	png_set_write_fn(png_ptr, pngBuffer, png_io_write, png_io_flush);
-
-	// Initialize compression parameters.
-	png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
-	png_set_compression_level(png_ptr, 5);	// TODO: Customizable?
-
 	const GcImage *gcImage0 = gcImages->at(0);
 	const int w = gcImage0->width();
 	const int h = gcImage0->height();
 	const GcImage::PxFmt pxFmt = gcImage0->pxFmt();
 
 	// Write the PNG header.
-	int pitch;
+	int bytespp;
 	switch (pxFmt) {
 		case GcImage::PXFMT_ARGB32:
 			png_set_IHDR(png_ptr, info_ptr, w, h,
@@ -261,7 +286,7 @@ int GcImageWriterPrivate::writeAPng(const vector<const GcImage*> *gcImages, cons
 					PNG_INTERLACE_NONE,
 					PNG_COMPRESSION_TYPE_DEFAULT,
 					PNG_FILTER_TYPE_DEFAULT);
-			pitch = (w * 4);
+			bytespp = 4;
 			break;
 
 		case GcImage::PXFMT_CI8: {
@@ -270,7 +295,7 @@ int GcImageWriterPrivate::writeAPng(const vector<const GcImage*> *gcImages, cons
 					PNG_INTERLACE_NONE,
 					PNG_COMPRESSION_TYPE_DEFAULT,
 					PNG_FILTER_TYPE_DEFAULT);
-			pitch = w;
+			bytespp = 1;
 
 			// Set the palette and tRNS values.
 			writePng_PLTE(png_ptr, info_ptr, gcImage0->palette(), 256);
@@ -280,12 +305,15 @@ int GcImageWriterPrivate::writeAPng(const vector<const GcImage*> *gcImages, cons
 		default:
 			// Unsupported pixel format.
 			png_destroy_write_struct(&png_ptr, (png_infopp)nullptr);
-			delete pngBuffer;
 			return -EINVAL;
 	}
+	const int pitch = (w * bytespp);
 
 	// Write an acTL to indicate that this is an APNG.
-	APNG_png_set_acTL(png_ptr, info_ptr, gcImages->size(), 0);
+	APNG_png_set_acTL(png_ptr, info_ptr, frames.size(), 0);
+
+	// Initialize compression parameters.
+	pngSetCompression(png_ptr, (pxFmt == GcImage::PXFMT_CI8));
 
 	// Write the PNG information to the file.
 	png_write_info(png_ptr, info_ptr);
@@ -296,29 +324,34 @@ int GcImageWriterPrivate::writeAPng(const vector<const GcImage*> *gcImages, cons
 	png_set_bgr(png_ptr);
 
 	// Initialize the row pointers.
-	row_pointers.resize(h);
-	for (int i = 0; i < (int)gcImages->size(); i++) {
+	rowPointers.resize(h);
+	for (int i = 0; i < (int)frames.size(); i++) {
 		// NOTE: NULL images should be removed by write().
-		const GcImage *gcImage = gcImages->at(i);
+		const AnimFrame &frame = frames[i];
+		const GcImage *gcImage = gcImages->at(frame.idx);
 
 		// NOTE: Icon delay is in units of 8 NTSC frames.
-		const uint16_t iconDelay = (uint16_t)(gcIconDelays->at(i) * 8);
+		const uint16_t iconDelay = (uint16_t)(frame.delay * 8);
 		static const uint16_t iconDelayDenom = 60;
 
-		// Calculate the row pointers.
+		// Calculate the row pointers for the changed region.
 		const uint8_t *imageData = (const uint8_t*)gcImage->imageData();
-		for (int y = 0; y < h; y++, imageData += pitch)
-			row_pointers[y] = imageData;
+		imageData += (frame.y * pitch) + (frame.x * bytespp);
+		for (int y = 0; y < frame.h; y++, imageData += pitch)
+			rowPointers[y] = imageData;
 
 		// Frame header.
-		APNG_png_write_frame_head(png_ptr, info_ptr, (png_bytepp)row_pointers.data(),
-				w, h, 0, 0,			// width, height, x offset, y offset
+		// The previous frame is left in place, and the
+		// changed region is replaced, including alpha.
+		APNG_png_write_frame_head(png_ptr, info_ptr, (png_bytepp)rowPointers.data(),
+				frame.w, frame.h,		// width, height
+				frame.x, frame.y,		// x offset, y offset
 				iconDelay, iconDelayDenom,	// delay numerator and denominator
 				PNG_DISPOSE_OP_NONE,
 				PNG_BLEND_OP_SOURCE);
 
 		// Write the image data.
-		png_write_image(png_ptr, (png_bytepp)row_pointers.data());
+		png_write_image(png_ptr, (png_bytepp)rowPointers.data());
 
 		// Frame tail.
 		APNG_png_write_frame_tail(png_ptr, info_ptr);
@@ -328,13 +361,12 @@ int GcImageWriterPrivate::writeAPng(const vector<const GcImage*> *gcImages, cons
 	png_write_end(png_ptr, info_ptr);
 	png_destroy_write_struct(&png_ptr, &info_ptr);
 
-	// Add the pngBuffer to the memBuffer.
-	memBuffer.push_back(pngBuffer);
 	return 0;
 }
 
 /**
- * Write an animated GcImage to the internal memory buffer in PNG FPF format.
+ * Write an animated GcImage to the current sink in PNG FPF format.
+ * Each frame is written to a separate file.
  * @param gcImages	[in] Vector of GcImage.
  * @return 0 on success; non-zero on error.
  */
@@ -342,8 +374,12 @@ int GcImageWriterPrivate::writePng_FPF(const vector<const GcImage*> *gcImages)
 {
 	// PNG FPF (file per frame) stores each frame
 	// in its own PNG file.
-	for (int i = 0; i < (int)gcImages->size(); i++) {
-		int ret = writePng(gcImages->at(i));
+	const int count = (int)gcImages->size();
+	for (int i = 0; i < count; i++) {
+		int ret = openFile(i, count);
+		if (ret != 0)
+			return ret;
+		ret = closeFile(writePng(gcImages->at(i)));
 		if (ret != 0)
 			return ret;
 	}
@@ -351,7 +387,7 @@ int GcImageWriterPrivate::writePng_FPF(const vector<const GcImage*> *gcImages)
 }
 
 /**
- * Write an animated GcImage to the internal memory buffer in PNG VS format.
+ * Write an animated GcImage to the current sink in PNG VS format.
  * @param gcImages	[in] Vector of GcImage.
  * @return 0 on success; non-zero on error.
  */
@@ -363,40 +399,19 @@ int GcImageWriterPrivate::writePng_VS(const vector<const GcImage*> *gcImages)
 	png_infop info_ptr;
 
 	// Initialize libpng.
-	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	if (!png_ptr) {
-		// Could not create PNG write struct.
-		return -0x101;
-	}
-	info_ptr = png_create_info_struct(png_ptr);
-	if (!info_ptr) {
-		// Could not create PNG info struct.
-		png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
-		return -0x102;
-	}
-
-	// Initialize the internal buffer.
-	vector<uint8_t> *pngBuffer = new vector<uint8_t>();
-	pngBuffer->reserve(32768);	// 32 KB should cover most of the use cases.
-	vector<const uint8_t*> row_pointers;
+	int ret = pngCreate(&png_ptr, &info_ptr);
+	if (ret != 0)
+		return ret;
 
 	// WARNING: Do NOT initialize any C++ objects past this point!
 #ifdef PNG_SETJMP_SUPPORTED
 	if (setjmp(png_jmpbuf(png_ptr))) {
 		// PNG write failed.
 		png_destroy_write_struct(&png_ptr, &info_ptr);
-		delete pngBuffer;
 		return -0x103;
 	}
 #endif /* PNG_SETJMP_SUPPORTED */
 
-	// Initialize the memory write function.
-	png_set_write_fn(png_ptr, pngBuffer, png_io_write, png_io_flush);
-
-	// Initialize compression parameters.
-	png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
-	png_set_compression_level(png_ptr, 5);	// TODO: Customizable?
-
 	const GcImage *gcImage0 = gcImages->at(0);
 	const int w = gcImage0->width();
 	const int h = gcImage0->height();
@@ -433,10 +448,12 @@ int GcImageWriterPrivate::writePng_VS(const vector<const GcImage*> *gcImages)
 		default:
 			// Unsupported pixel format.
 			png_destroy_write_struct(&png_ptr, (png_infopp)nullptr);
-			delete pngBuffer;
 			return -EINVAL;
 	}
 
+	// Initialize compression parameters.
+	pngSetCompression(png_ptr, (pxFmt == GcImage::PXFMT_CI8));
+
 	// Write the PNG information to the file.
 	png_write_info(png_ptr, info_ptr);
 
@@ -446,7 +463,7 @@ int GcImageWriterPrivate::writePng_VS(const vector<const GcImage*> *gcImages)
 	png_set_bgr(png_ptr);
 
 	// Initialize the row pointers.
-	row_pointers.resize(vs_h);
+	rowPointers.resize(vs_h);
 	// Append each image to the PNG row pointer data, vertically.
 	for (int i = 0, vs_y = 0; i < (int)gcImages->size(); i++, vs_y += h) {
 		// NOTE: NULL images should be removed by write().
@@ -455,23 +472,21 @@ int GcImageWriterPrivate::writePng_VS(const vector<const GcImage*> *gcImages)
 		// Calculate the row pointers.
 		const uint8_t *imageData = (const uint8_t*)gcImage->imageData();
 		for (int y = 0; y < h; y++, imageData += pitch)
-			row_pointers[vs_y + y] = imageData;
+			rowPointers[vs_y + y] = imageData;
 	}
 
 	// Write the image data.
-	png_write_image(png_ptr, (png_bytepp)row_pointers.data());
+	png_write_image(png_ptr, (png_bytepp)rowPointers.data());
 
 	// Finished writing.
 	png_write_end(png_ptr, info_ptr);
 	png_destroy_write_struct(&png_ptr, &info_ptr);
 
-	// Add the pngBuffer to the memBuffer.
-	memBuffer.push_back(pngBuffer);
 	return 0;
 }
 
 /**
- * Write an animated GcImage to the internal memory buffer in PNG HS format.
+ * Write an animated GcImage to the current sink in PNG HS format.
  * @param gcImages	[in] Vector of GcImage.
  * @return 0 on success; non-zero on error.
  */
@@ -483,41 +498,19 @@ int GcImageWriterPrivate::writePng_HS(const vector<const GcImage*> *gcImages)
 	png_infop info_ptr;
 
 	// Initialize libpng.
-	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-	if (!png_ptr) {
-		// Could not create PNG write struct.
-		return -0x101;
-	}
-	info_ptr = png_create_info_struct(png_ptr);
-	if (!info_ptr) {
-		// Could not create PNG info struct.
-		png_destroy_write_struct(&png_ptr, (png_infopp)NULL);
-		return -0x102;
-	}
-
-	// Initialize the internal buffer.
-	vector<uint8_t> *pngBuffer = new vector<uint8_t>();
-	pngBuffer->reserve(32768);	// 32 KB should cover most of the use cases.
-	vector<uint8_t> imgBuf;		// Temporary image buffer.
-	vector<const uint8_t*> row_pointers;
+	int ret = pngCreate(&png_ptr, &info_ptr);
+	if (ret != 0)
+		return ret;
 
 	// WARNING: Do NOT initialize any C++ objects past this point!
 #ifdef PNG_SETJMP_SUPPORTED
 	if (setjmp(png_jmpbuf(png_ptr))) {
 		// PNG write failed.
 		png_destroy_write_struct(&png_ptr, &info_ptr);
-		delete pngBuffer;
 		return -0x103;
 	}
 #endif /* PNG_SETJMP_SUPPORTED */
 
-	// Initialize the memory write function.
-	png_set_write_fn(png_ptr, pngBuffer, png_io_write, png_io_flush);
-
-	// Initialize compression parameters.
-	png_set_filter(png_ptr, 0, PNG_FILTER_NONE);
-	png_set_compression_level(png_ptr, 5);	// TODO: Customizable?
-
 	const GcImage *gcImage0 = gcImages->at(0);
 	const int w = gcImage0->width();
 	const int h = gcImage0->height();
@@ -554,10 +547,12 @@ int GcImageWriterPrivate::writePng_HS(const vector<const GcImage*> *gcImages)
 		default:
 			// Unsupported pixel format.
 			png_destroy_write_struct(&png_ptr, (png_infopp)nullptr);
-			delete pngBuffer;
 			return -EINVAL;
 	}
 
+	// Initialize compression parameters.
+	pngSetCompression(png_ptr, (pxFmt == GcImage::PXFMT_CI8));
+
 	// Write the PNG information to the file.
 	png_write_info(png_ptr, info_ptr);
 
@@ -571,9 +566,9 @@ int GcImageWriterPrivate::writePng_HS(const vector<const GcImage*> *gcImages)
 	imgBuf.resize(vs_pitch * h);
 
 	// Initialize the row pointers.
-	row_pointers.resize(h);
+	rowPointers.resize(h);
 	for (int y = 0, pos = 0; y < h; y++, pos += vs_pitch) {
-		row_pointers[y] = (imgBuf.data() + pos);
+		rowPointers[y] = (imgBuf.data() + pos);
 	}
 
 	// Append each image to the PNG row pointer data, horizontally.
@@ -589,19 +584,17 @@ int GcImageWriterPrivate::writePng_HS(const vector<const GcImage*> *gcImages)
 	}
 
 	// Write the image data.
-	png_write_image(png_ptr, (png_bytepp)row_pointers.data());
+	png_write_image(png_ptr, (png_bytepp)rowPointers.data());
 
 	// Finished writing.
 	png_write_end(png_ptr, info_ptr);
 	png_destroy_write_struct(&png_ptr, &info_ptr);
 
-	// Add the pngBuffer to the memBuffer.
-	memBuffer.push_back(pngBuffer);
 	return 0;
 }
 
 /**
- * Write an animated GcImage to the internal memory buffer in some PNG format.
+ * Write an animated GcImage to the current sink in some PNG format.
  * @param gcImages	[in] Vector of GcImage.
  * @param gcIconDelays	[in] Icon delays.
  * @param animImgf	[in] Animated image format.
@@ -638,20 +631,24 @@ int GcImageWriterPrivate::writePng_anim(const vector<const GcImage*> *gcImages,
 		gcImages = gcImagesARGB32;
 	}
 
-	int ret;
-	switch (animImgf) {
-		case GcImageWriter::ANIMGF_APNG:
-			ret = writeAPng(gcImages, gcIconDelays);
-			break;
-		case GcImageWriter::ANIMGF_PNG_HS:
-			ret = writePng_HS(gcImages);
-			break;
-		case GcImageWriter::ANIMGF_PNG_VS:
-			ret = writePng_VS(gcImages);
-			break;
-		default:
-			ret = -EINVAL;
-			break;
+	// APNG, PNG HS, and PNG VS are written as a single file.
+	int ret = openFile(0, 1);
+	if (ret == 0) {
+		switch (animImgf) {
+			case GcImageWriter::ANIMGF_APNG:
+				ret = writeAPng(gcImages, gcIconDelays);
+				break;
+			case GcImageWriter::ANIMGF_PNG_HS:
+				ret = writePng_HS(gcImages);
+				break;
+			case GcImageWriter::ANIMGF_PNG_VS:
+				ret = writePng_VS(gcImages);
+				break;
+			default:
+				ret = -EINVAL;
+				break;
+		}
+		ret = closeFile(ret);
 	}
 
 	// Check if we had to convert any icons to ARGB32.
@@ -27,6 +27,7 @@ class GcImage;
 
 // giflib
 #include "GIF_dlopen.h"
+class OctreeQuantizer;
 
 // TODO: Split PNG and GIF into separate classes.
 // Need to make a common class for the CI8_UNIQUE functions.
@@ -45,9 +46,80 @@ class GcImageWriterPrivate
 
 	public:
 		// Internal memory buffers.
-		// Each call to write() creates a new buffer.
+		// Each file written by write() without a sink
+		// creates a new buffer.
 		std::vector<std::vector<uint8_t>* > memBuffer;
 
+		/**
+		 * Sink for the internal memory buffers.
+		 */
+		class MemBufferSink : public GcImageWriter::Sink
+		{
+			public:
+				explicit MemBufferSink(GcImageWriterPrivate *d)
+					: d(d), buf(nullptr) { }
+
+			private:
+				GcImageWriterPrivate *const d;
+				std::vector<uint8_t> *buf;
+
+			public:
+				int open(int idx, int count) final;
+				int write(const uint8_t *buf, size_t len) final;
+				int close(bool ok) final;
+		};
+		MemBufferSink memBufferSink;
+
+		// Current sink.
+		GcImageWriter::Sink *sink;
+
+		// First error returned by the sink while writing
+		// the current file, or 0 if no errors occurred.
+		int sinkErr;
+
+		// Compression profile.
+		GcImageWriter::CompressionProfile compression;
+
+		/**
+		 * Scratch buffers.
+		 * These are kept between writes, so writing many
+		 * small images with the same GcImageWriter doesn't
+		 * reallocate them for every image.
+		 * NOTE: Since these aren't stack objects, they're
+		 * not affected by longjmp() from libpng errors.
+		 */
+#ifdef HAVE_PNG
+		std::vector<const uint8_t*> rowPointers;	// PNG row pointers.
+		std::vector<uint8_t> imgBuf;			// PNG HS image buffer.
+#endif /* HAVE_PNG */
+#ifdef USE_GIF
+		OctreeQuantizer *octree;			// GIF quantizer. (allocated on first use)
+#endif /* USE_GIF */
+
+		/**
+		 * Write data to the current sink.
+		 * Errors are saved in sinkErr.
+		 * @param buf	[in] Data.
+		 * @param len	[in] Size of buf.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int sinkWrite(const uint8_t *buf, size_t len);
+
+		/**
+		 * Start writing a file to the current sink.
+		 * @param idx	[in] File number.
+		 * @param count	[in] Total number of files.
+		 * @return 0 on success; negative POSIX error code on error.
+		 */
+		int openFile(int idx, int count);
+
+		/**
+		 * Finish writing a file to the current sink.
+		 * @param ret	[in] Return value from the image writer.
+		 * @return ret, or the sink's error code if it failed.
+		 */
+		int closeFile(int ret);
+
 	private:
 		/**
 		 * Check if a vector of gcImages is CI8_UNIQUE.
@@ -66,10 +138,51 @@ class GcImageWriterPrivate
 		static std::vector<const GcImage*> *gcImages_from_CI8_UNIQUE(
 			const std::vector<const GcImage*> *gcImages);
 
+		/**
+		 * Animated image frame.
+		 * Only the region that changed since the previous
+		 * frame is written; the rest is left in place.
+		 */
+		struct AnimFrame {
+			int idx;	// Index in gcImages.
+			int x, y;	// Position of the changed region.
+			int w, h;	// Size of the changed region.
+			int delay;	// Icon delay. (units of 8 NTSC frames)
+		};
+
+		/**
+		 * Maximum combined icon delay for identical frames.
+		 * This keeps the delay within 16 bits in both
+		 * APNG (1/60ths) and GIF (centiseconds).
+		 */
+		static const int ANIM_FRAME_MAX_DELAY = 4096;
+
+		/**
+		 * Find the region that differs between two frames.
+		 * The frames must have the same size and pixel format.
+		 * @param prev	[in] Previous frame.
+		 * @param cur	[in] Current frame.
+		 * @param frame	[out] Changed region. (w/h are 0 if the frames are identical)
+		 */
+		static void diffFrames(const GcImage *prev, const GcImage *cur, AnimFrame *frame);
+
+		/**
+		 * Determine the frames to write for an animated image.
+		 * The first frame is always written in full. Subsequent frames
+		 * only contain the region that changed, and frames that are
+		 * identical to the previous frame are merged into it.
+		 * @param gcImages	[in] Vector of GcImage.
+		 * @param gcIconDelays	[in] Icon delays.
+		 * @param frames	[out] Frames to write.
+		 */
+		static void getAnimFrames(const std::vector<const GcImage*> *gcImages,
+					  const std::vector<int> *gcIconDelays,
+					  std::vector<AnimFrame> &frames);
+
 #ifdef HAVE_PNG
 		/**
 		 * PNG write function.
-		 * @param png_ptr	[in] PNG pointer.
+		 * @param png_ptr	[in] PNG pointer. (io_ptr is GcImageWriterPrivate*)
 		 * @param buf		[in] Data to write.
 		 * @param len		[in] Size of buf.
 		 */
@@ -95,7 +208,29 @@ class GcImageWriterPrivate
 					 const uint32_t *palette, int num_entries);
 
 		/**
-		 * Write an animated GcImage to the internal memory buffer in APNG format.
+		 * Create the libpng write and info structs.
+		 * The write function is set to the current sink.
+		 *
+		 * NOTE: libpng can't reset a write struct once an image
+		 * has been written, so a new one is needed for each file.
+		 * The caller must set up setjmp() after calling this.
+		 *
+		 * @param png_ptr	[out] PNG pointer.
+		 * @param info_ptr	[out] PNG info pointer.
+		 * @return 0 on success; non-zero on error.
+		 */
+		int pngCreate(png_structp *png_ptr, png_infop *info_ptr);
+
+		/**
+		 * Set the compression parameters for the current profile.
+		 * This must be called after png_set_IHDR().
+		 * @param png_ptr	[in] PNG pointer.
+		 * @param isPalette	[in] True if the image uses a palette.
+		 */
+		void pngSetCompression(png_structp png_ptr, bool isPalette) const;
+
+		/**
+		 * Write an animated GcImage to the current sink in APNG format.
 		 * @param gcImages	[in] Vector of GcImage.
 		 * @param gcIconDelays	[in] Icon delays.
 		 * @return 0 on success; non-zero on error.
@@ -103,21 +238,22 @@ class GcImageWriterPrivate
 		int writeAPng(const std::vector<const GcImage*> *gcImages, const std::vector<int> *gcIconDelays);
 
 		/**
-		 * Write an animated GcImage to the internal memory buffer in PNG FPF format.
+		 * Write an animated GcImage to the current sink in PNG FPF format.
+		 * Each frame is written to a separate file.
 		 * @param gcImages	[in] Vector of GcImage.
 		 * @return 0 on success; non-zero on error.
 		 */
 		int writePng_FPF(const std::vector<const GcImage*> *gcImages);
 
 		/**
-		 * Write an animated GcImage to the internal memory buffer in PNG VS format.
+		 * Write an animated GcImage to the current sink in PNG VS format.
 		 * @param gcImages	[in] Vector of GcImage.
 		 * @return 0 on success; non-zero on error.
 		 */
 		int writePng_VS(const std::vector<const GcImage*> *gcImages);
 
 		/**
-		 * Write an animated GcImage to the internal memory buffer in PNG HS format.
+		 * Write an animated GcImage to the current sink in PNG HS format.
 		 * @param gcImages	[in] Vector of GcImage.
 		 * @return 0 on success; non-zero on error.
 		 */
@@ -127,7 +263,7 @@ class GcImageWriterPrivate
 #ifdef USE_GIF
 		/**
 		 * GIF write function.
-		 * @param gif	[in] GifFileType pointer.
+		 * @param gif	[in] GifFileType pointer. (UserData is GcImageWriterPrivate*)
 		 * @param buf	[in] Data to write.
 		 * @param len	[in] Size of buf.
 		 * @return Number of bytes written.
@@ -155,32 +291,82 @@ class GcImageWriterPrivate
 		 * @param gif		[in] GIF image.
 		 * @param trans_idx	[in] Transparent color index. (-1 for no transparency)
 		 * @param iconDelay	[in] Icon delay, in centiseconds.
+		 * @param disposal	[in] Disposal method. (see GIF89a spec)
+		 */
+		static int gif_addGraphicsControlBlock(GifFileType *gif, int trans_idx,
+						       uint16_t iconDelay, int disposal = 0);
+
+		/**
+		 * Determine the disposal method for each GIF frame.
+		 * GIF frames can't make a pixel transparent once it's been
+		 * drawn, so if a frame does that, the previous frame is
+		 * cleared to the background, and both frames are written
+		 * in full. Otherwise, frames are left in place.
+		 * @param gcImages	[in] Vector of GcImage.
+		 * @param frames	[in/out] Frames from getAnimFrames().
+		 * @param disposal	[out] Disposal method for each frame.
+		 */
+		static void gif_getDisposal(const std::vector<const GcImage*> *gcImages,
+					    std::vector<AnimFrame> &frames,
+					    std::vector<uint8_t> &disposal);
+
+		/**
+		 * Write a CI8 image to a GIF.
+		 * Fully-transparent palette entries are remapped to trans_idx.
+		 * @param gif		[in] GIF image.
+		 * @param gcImage	[in] GcImage to write.
+		 * @param frame		[in] Region of the image to write.
+		 * @param colorMap	[in] Local color map, or nullptr to use the global color map.
+		 * @param trans_idx	[in] Transparent color index. (-1 for no transparency)
+		 * @param line		[in] Line buffer. (must have room for one row)
+		 * @return GIF_OK on success; GIF_ERROR on error.
+		 */
+		static int gif_writeCI8Image(GifFileType *gif,
+				const GcImage *gcImage, const AnimFrame &frame,
+				ColorMapObject *colorMap, int trans_idx, GifByteType *line);
+
+		/**
+		 * Build a global palette for ARGB32 frames.
+		 * GIF doesn't support alpha-transparency, so fully-transparent
+		 * pixels use a separate transparent color, and all other
+		 * pixels are opaque.
+		 * @param octree	[out] Quantizer.
+		 * @param gcImages	[in] Vector of GcImage. (must be ARGB32)
+		 * @param colorMap	[out] GIF ColorMapObject.
+		 * @return Index of transparent color, or -1 if no transparent color.
 		 */
-		static int gif_addGraphicsControlBlock(GifFileType *gif, int trans_idx, uint16_t iconDelay);
+		static int gif_buildARGB32Palette(OctreeQuantizer &octree,
+				const std::vector<const GcImage*> *gcImages,
+				ColorMapObject *colorMap);
 
 		/**
 		 * Write an ARGB32 image to a GIF.
-		 * This will reduce the image to 256 colors first.
+		 * The pixels are mapped to the palette from gif_buildARGB32Palette().
 		 * @param gif		[in] GIF image.
 		 * @param gcImage	[in] GcImage to write.
-		 * @param colorMap	[in] Color map object to use.
+		 * @param frame		[in] Region of the image to write.
+		 * @param octree	[in] Quantizer from gif_buildARGB32Palette().
+		 * @param trans_idx	[in] Transparent color index. (-1 for no transparency)
+		 * @param line		[in] Line buffer. (must have room for one row)
 		 * @return GIF_OK on success; GIF_ERROR on error.
 		 */
 		static int gif_writeARGB32Image(GifFileType *gif,
-				const GcImage *gcImage, ColorMapObject *colorMap);
+				const GcImage *gcImage, const AnimFrame &frame,
+				const OctreeQuantizer &octree, int trans_idx, GifByteType *line);
 #endif /* USE_GIF */
 
 	public:
 #ifdef HAVE_PNG
 		/**
-		 * Write a GcImage to the internal memory buffer in PNG format.
+		 * Write a GcImage to the current sink in PNG format.
+		 * The file must have been started with openFile().
 		 * @param gcImage	[in] GcImage.
 		 * @return 0 on success; non-zero on error.
 		 */
 		int writePng(const GcImage *gcImage);
 
 		/**
-		 * Write an animated GcImage to the internal memory buffer in some PNG format.
+		 * Write an animated GcImage to the current sink in some PNG format.
 		 * @param gcImages	[in] Vector of GcImage.
 		 * @param gcIconDelays	[in] Icon delays.
 		 * @param animImgf	[in] Animated image format.
@@ -193,7 +379,8 @@ class GcImageWriterPrivate
 
 #ifdef USE_GIF
 		/**
-		 * Write an animated GcImage to the internal memory buffer in GIF format.
+		 * Write an animated GcImage to the current sink in GIF format.
+		 * The file must have been started with openFile().
 		 * @param gcImages	[in] Vector of GcImage.
 		 * @param gcIconDelays	[in] Icon delays.
 		 * @return 0 on success; non-zero on error.
@@ -0,0 +1,252 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * OctreeQuantizer.cpp: Octree color quantizer.                            *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "OctreeQuantizer.hpp"
+
+// C includes. (C++ namespace)
+#include <cassert>
+#include <cstring>
+
+OctreeQuantizer::OctreeQuantizer()
+{
+	reset();
+}
+
+/**
+ * Reset the quantizer.
+ * @param maxColors Maximum number of colors. (1-256)
+ */
+void OctreeQuantizer::reset(int maxColors)
+{
+	assert(maxColors >= 1 && maxColors <= MAX_COLORS);
+	if (maxColors < 1) {
+		maxColors = 1;
+	} else if (maxColors > MAX_COLORS) {
+		maxColors = MAX_COLORS;
+	}
+	m_maxColors = maxColors;
+
+	m_nodeCount = 0;
+	m_freeList = 0;
+	memset(m_reducible, 0, sizeof(m_reducible));
+	m_leafCount = 0;
+
+	// Root node.
+	newNode(0);
+}
+
+/**
+ * Allocate a node from the pool.
+ * @param level Tree level.
+ * @return Node index.
+ */
+uint16_t OctreeQuantizer::newNode(int level)
+{
+	uint16_t idx;
+	if (m_freeList != 0) {
+		idx = m_freeList;
+		m_freeList = m_nodes[idx].next;
+	} else {
+		assert(m_nodeCount < MAX_NODES);
+		idx = (uint16_t)m_nodeCount++;
+	}
+
+	Node &node = m_nodes[idx];
+	memset(&node, 0, sizeof(node));
+	node.level = (uint8_t)level;
+	if (level >= MAX_DEPTH) {
+		node.isLeaf = 1;
+		m_leafCount++;
+	} else if (level > 0) {
+		// Internal node. Add it to the reducible list.
+		// NOTE: The root node can't be in a reducible list,
+		// since its index is 0. reduce() handles it separately.
+		node.next = m_reducible[level];
+		m_reducible[level] = idx;
+	}
+	return idx;
+}
+
+/**
+ * Add a pixel to the tree.
+ * @param pixel ARGB32 pixel.
+ */
+inline void OctreeQuantizer::addPixel(uint32_t pixel)
+{
+	const uint8_t r = (pixel >> 16) & 0xFF;
+	const uint8_t g = (pixel >>  8) & 0xFF;
+	const uint8_t b =  pixel        & 0xFF;
+
+	uint16_t idx = 0;
+	for (int level = 0; ; level++) {
+		Node *node = &m_nodes[idx];
+		node->count++;
+		if (node->isLeaf) {
+			node->r += r;
+			node->g += g;
+			node->b += b;
+			break;
+		}
+
+		const int shift = 7 - level;
+		const int childIdx = (((r >> shift) & 1) << 2) |
+				     (((g >> shift) & 1) << 1) |
+				      ((b >> shift) & 1);
+		uint16_t child = node->child[childIdx];
+		if (child == 0) {
+			child = newNode(level + 1);
+			node->child[childIdx] = child;
+		}
+		idx = child;
+	}
+
+	// Keep the number of leaves within the limit.
+	while (m_leafCount > m_maxColors) {
+		reduce();
+	}
+}
+
+/**
+ * Merge the children of the deepest internal node
+ * with the fewest pixels into that node.
+ */
+void OctreeQuantizer::reduce(void)
+{
+	// Find the deepest level with an internal node.
+	// All children of these nodes are leaves.
+	int level = MAX_DEPTH - 1;
+	while (level > 0 && m_reducible[level] == 0) {
+		level--;
+	}
+
+	uint16_t best = 0;	// If there are no other internal nodes, use the root.
+	if (level > 0) {
+		// Find the node with the fewest pixels.
+		uint16_t prev = 0, bestPrev = 0;
+		best = m_reducible[level];
+		for (uint16_t idx = best; idx != 0; prev = idx, idx = m_nodes[idx].next) {
+			if (m_nodes[idx].count < m_nodes[best].count) {
+				best = idx;
+				bestPrev = prev;
+			}
+		}
+
+		// Remove the node from the reducible list.
+		if (bestPrev != 0) {
+			m_nodes[bestPrev].next = m_nodes[best].next;
+		} else {
+			m_reducible[level] = m_nodes[best].next;
+		}
+	}
+
+	Node &node = m_nodes[best];
+	if (node.isLeaf) {
+		// Nothing to reduce.
+		return;
+	}
+
+	// Merge the children into this node.
+	for (int i = 0; i < 8; i++) {
+		const uint16_t childIdx = node.child[i];
+		if (childIdx == 0)
+			continue;
+
+		Node &child = m_nodes[childIdx];
+		node.r += child.r;
+		node.g += child.g;
+		node.b += child.b;
+
+		// Free the child.
+		child.isLeaf = 0;
+		child.count = 0;
+		child.next = m_freeList;
+		m_freeList = childIdx;
+		m_leafCount--;
+		node.child[i] = 0;
+	}
+
+	node.isLeaf = 1;
+	node.next = 0;
+	m_leafCount++;
+}
+
+/**
+ * Add ARGB32 pixels to the quantizer.
+ * Fully-transparent pixels are skipped.
+ * @param pixels	[in] ARGB32 pixels.
+ * @param count		[in] Number of pixels.
+ */
+void OctreeQuantizer::addPixels(const uint32_t *pixels, int count)
+{
+	for (; count > 0; count--, pixels++) {
+		if ((*pixels >> 24) == 0)
+			continue;
+		addPixel(*pixels);
+	}
+}
+
+/**
+ * Get the palette.
+ * This also assigns palette indexes for lookup().
+ * @param palette	[out] Palette. (ARGB32 format; must have room for maxColors entries)
+ * @return Number of colors.
+ */
+int OctreeQuantizer::getPalette(uint32_t *palette)
+{
+	// Free nodes have a count of 0, and
+	// live leaves have at least one pixel.
+	int n = 0;
+	for (int i = 0; i < m_nodeCount; i++) {
+		Node &node = m_nodes[i];
+		if (!node.isLeaf || node.count == 0)
+			continue;
+
+		const uint32_t half = node.count / 2;
+		const uint32_t r = (node.r + half) / node.count;
+		const uint32_t g = (node.g + half) / node.count;
+		const uint32_t b = (node.b + half) / node.count;
+		palette[n] = 0xFF000000 | (r << 16) | (g << 8) | b;
+		node.palIdx = (uint8_t)n;
+		n++;
+	}
+	return n;
+}
+
+/**
+ * Get the palette index for a pixel.
+ * getPalette() must be called first.
+ * Alpha is ignored.
+ * @param pixel ARGB32 pixel. (should have been added with addPixels())
+ * @return Palette index.
+ */
+uint8_t OctreeQuantizer::lookup(uint32_t pixel) const
+{
+	const uint8_t r = (pixel >> 16) & 0xFF;
+	const uint8_t g = (pixel >>  8) & 0xFF;
+	const uint8_t b =  pixel        & 0xFF;
+
+	const Node *node = &m_nodes[0];
+	for (int level = 0; !node->isLeaf && level < MAX_DEPTH; level++) {
+		const int shift = 7 - level;
+		const int childIdx = (((r >> shift) & 1) << 2) |
+				     (((g >> shift) & 1) << 1) |
+				      ((b >> shift) & 1);
+		uint16_t child = node->child[childIdx];
+		if (child == 0) {
+			// Pixel wasn't added to the tree.
+			// Use the first child that's present.
+			for (int i = 0; i < 8 && child == 0; i++) {
+				child = node->child[i];
+			}
+			if (child == 0)
+				break;
+		}
+		node = &m_nodes[child];
+	}
+	return node->palIdx;
+}
@@ -0,0 +1,123 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * OctreeQuantizer.hpp: Octree color quantizer.                            *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_OCTREEQUANTIZER_HPP__
+#define __LIBGCTOOLS_OCTREEQUANTIZER_HPP__
+
+// C includes.
+#include <stdint.h>
+
+/**
+ * Octree color quantizer.
+ *
+ * All nodes are stored in a fixed-size pool, so adding pixels
+ * never allocates memory. The pool is large enough for any
+ * number of pixels, since the tree is reduced whenever it
+ * has more leaves than the maximum number of colors.
+ *
+ * If the pixels have no more colors than the maximum,
+ * the palette contains the exact colors.
+ *
+ * Usage:
+ * - reset()
+ * - addPixels() for each image
+ * - getPalette()
+ * - lookup() for each pixel
+ */
+class OctreeQuantizer
+{
+	public:
+		OctreeQuantizer();
+
+	private:
+		// TODO: Copy Qt's Q_DISABLE_COPY() macro.
+		OctreeQuantizer(const OctreeQuantizer &);
+		OctreeQuantizer &operator=(const OctreeQuantizer &);
+
+	public:
+		/**
+		 * Reset the quantizer.
+		 * @param maxColors Maximum number of colors. (1-256)
+		 */
+		void reset(int maxColors = 256);
+
+		/**
+		 * Add ARGB32 pixels to the quantizer.
+		 * Fully-transparent pixels are skipped.
+		 * @param pixels	[in] ARGB32 pixels.
+		 * @param count		[in] Number of pixels.
+		 */
+		void addPixels(const uint32_t *pixels, int count);
+
+		/**
+		 * Get the palette.
+		 * This also assigns palette indexes for lookup().
+		 * @param palette	[out] Palette. (ARGB32 format; must have room for maxColors entries)
+		 * @return Number of colors.
+		 */
+		int getPalette(uint32_t *palette);
+
+		/**
+		 * Get the palette index for a pixel.
+		 * getPalette() must be called first.
+		 * Alpha is ignored.
+		 * @param pixel ARGB32 pixel. (should have been added with addPixels())
+		 * @return Palette index.
+		 */
+		uint8_t lookup(uint32_t pixel) const;
+
+	private:
+		// Each level of the tree uses one bit of each color channel.
+		static const int MAX_DEPTH = 8;
+		static const int MAX_COLORS = 256;
+
+		// Maximum number of nodes.
+		// Each internal node has at least one leaf below it, so
+		// there are at most MAX_DEPTH internal nodes per leaf.
+		// There can be one extra leaf and MAX_DEPTH new nodes
+		// before the tree is reduced.
+		static const int MAX_NODES = ((MAX_COLORS + 1) * (MAX_DEPTH + 1)) + MAX_DEPTH;
+
+		struct Node {
+			uint32_t r, g, b;	// Color sums. (leaves only)
+			uint32_t count;		// Number of pixels in this subtree.
+			uint16_t child[8];	// Child nodes. (0 == none)
+			uint16_t next;		// Next reducible node at this level, or next free node.
+			uint8_t level;		// Tree level.
+			uint8_t isLeaf;		// Non-zero if this is a leaf.
+			uint8_t palIdx;		// Palette index. (leaves only)
+		};
+
+		Node m_nodes[MAX_NODES];
+		int m_nodeCount;			// Number of nodes used from the pool.
+		uint16_t m_freeList;			// First free node. (0 == none)
+		uint16_t m_reducible[MAX_DEPTH];	// First reducible node at each level. (0 == none)
+		int m_leafCount;
+		int m_maxColors;
+
+		/**
+		 * Allocate a node from the pool.
+		 * @param level Tree level.
+		 * @return Node index.
+		 */
+		uint16_t newNode(int level);
+
+		/**
+		 * Add a pixel to the tree.
+		 * @param pixel ARGB32 pixel.
+		 */
+		void addPixel(uint32_t pixel);
+
+		/**
+		 * Merge the children of the deepest internal node
+		 * with the fewest pixels into that node.
+		 */
+		void reduce(void);
+};
+
+#endif /* __LIBGCTOOLS_OCTREEQUANTIZER_HPP__ */
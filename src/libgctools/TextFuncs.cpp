@@ -0,0 +1,200 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * TextFuncs.cpp: Text encoding functions.                                 *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "TextFuncs.hpp"
+#include "TextFuncs_sjis.inc.h"
+
+// SSE2 is used for the ASCII fast path.
+// It's always available on amd64.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define TEXTFUNCS_USE_SSE2 1
+#endif
+
+namespace TextFuncs {
+
+/**
+ * cp1252 characters 0x80-0x9F.
+ * Undefined characters are mapped to C1 control codes,
+ * same as Windows.
+ */
+static const uint16_t cp1252_80_9F[32] = {
+	0x20AC, 0x0081, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+	0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0x008D, 0x017D, 0x008F,
+	0x0090, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+	0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0x009D, 0x017E, 0x0178,
+};
+
+/**
+ * Copy ASCII characters to a UTF-16 buffer.
+ * Copying stops at the first non-ASCII character.
+ * @param dest	[out] Destination buffer.
+ * @param src	[in] Source text.
+ * @param len	[in] Length of src, in bytes.
+ * @return Number of characters copied.
+ */
+static inline int ascii_copy(uint16_t *dest, const uint8_t *src, int len)
+{
+	int i = 0;
+#ifdef TEXTFUNCS_USE_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i]));
+		if (_mm_movemask_epi8(v) != 0) {
+			// Found a non-ASCII character.
+			break;
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i]), _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&dest[i+8]), _mm_unpackhi_epi8(v, zero));
+	}
+#endif /* TEXTFUNCS_USE_SSE2 */
+
+	for (; i < len; i++) {
+		if (src[i] & 0x80)
+			break;
+		dest[i] = src[i];
+	}
+	return i;
+}
+
+/**
+ * Check if text is ASCII.
+ * ASCII text decodes identically in all supported encodings.
+ * @param src	[in] Text.
+ * @param len	[in] Length of src, in bytes.
+ * @return True if all bytes are 0x00-0x7F; false if not.
+ */
+bool is_ascii(const char *src, int len)
+{
+	const uint8_t *const p = reinterpret_cast<const uint8_t*>(src);
+	int i = 0;
+#ifdef TEXTFUNCS_USE_SSE2
+	for (; i + 16 <= len; i += 16) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&p[i]));
+		if (_mm_movemask_epi8(v) != 0)
+			return false;
+	}
+#endif /* TEXTFUNCS_USE_SSE2 */
+
+	for (; i < len; i++) {
+		if (p[i] & 0x80)
+			return false;
+	}
+	return true;
+}
+
+/**
+ * Convert cp1252 text to UTF-16.
+ * Undefined cp1252 characters are mapped to C1 control codes.
+ * @param dest	[out] Destination buffer. (must have room for len characters)
+ * @param src	[in] cp1252 text.
+ * @param len	[in] Length of src, in bytes.
+ * @return Number of UTF-16 characters written.
+ */
+int cp1252_to_utf16(uint16_t *dest, const char *src, int len)
+{
+	const uint8_t *const p = reinterpret_cast<const uint8_t*>(src);
+	int i = 0;
+	while (i < len) {
+		// ASCII fast path.
+		i += ascii_copy(&dest[i], &p[i], len - i);
+		if (i >= len)
+			break;
+
+		// Non-ASCII character.
+		const uint8_t chr = p[i];
+		dest[i] = (chr < 0xA0 ? cp1252_80_9F[chr - 0x80] : chr);
+		i++;
+	}
+	return len;
+}
+
+/**
+ * Convert Shift-JIS text to UTF-16.
+ * Supports JIS X 0201, JIS X 0208, and the cp932 extensions.
+ * @param dest	[out] Destination buffer. (must have room for len characters)
+ * @param src	[in] Shift-JIS text.
+ * @param len	[in] Length of src, in bytes.
+ * @param strict [in] If true, stop at the first invalid sequence and return -1.
+ *                    If false, invalid sequences are replaced with U+FFFD.
+ * @return Number of UTF-16 characters written, or -1 if strict and src is invalid.
+ */
+int sjis_to_utf16(uint16_t *dest, const char *src, int len, bool strict)
+{
+	const uint8_t *const p = reinterpret_cast<const uint8_t*>(src);
+	int i = 0;	// Source index.
+	int j = 0;	// Destination index.
+	while (i < len) {
+		// ASCII fast path.
+		const int n = ascii_copy(&dest[j], &p[i], len - i);
+		i += n;
+		j += n;
+		if (i >= len)
+			break;
+
+		const uint8_t lead = p[i];
+		if (lead >= 0xA1 && lead <= 0xDF) {
+			// JIS X 0201 halfwidth katakana.
+			dest[j++] = 0xFF61 + (lead - 0xA1);
+			i++;
+			continue;
+		}
+
+		// Double-byte character. (JIS X 0208 or cp932 extension)
+		const uint8_t row = sjis_lead_to_row[lead - 0x80];
+		if (row != 0 && i + 1 < len) {
+			const uint8_t trail = p[i+1];
+			int idx = -1;
+			if (trail >= 0x40 && trail <= 0x7E) {
+				idx = trail - 0x40;
+			} else if (trail >= 0x80 && trail <= 0xFC) {
+				idx = trail - 0x41;
+			}
+
+			if (idx >= 0) {
+				const uint16_t chr = sjis_rows[row - 1][idx];
+				if (chr == 0 && strict) {
+					// Unassigned character.
+					return -1;
+				}
+				dest[j++] = (chr != 0 ? chr : 0xFFFD);
+				i += 2;
+				continue;
+			}
+		}
+
+		// Invalid byte.
+		if (strict)
+			return -1;
+		dest[j++] = 0xFFFD;
+		i++;
+	}
+
+	return j;
+}
+
+/**
+ * Convert Shift-JIS text to UTF-16.
+ * If the text isn't valid Shift-JIS, it's converted as cp1252.
+ * @param dest	[out] Destination buffer. (must have room for len characters)
+ * @param src	[in] Text.
+ * @param len	[in] Length of src, in bytes.
+ * @return Number of UTF-16 characters written.
+ */
+int sjis_or_cp1252_to_utf16(uint16_t *dest, const char *src, int len)
+{
+	int ret = sjis_to_utf16(dest, src, len, true);
+	if (ret < 0) {
+		// Not valid Shift-JIS.
+		ret = cp1252_to_utf16(dest, src, len);
+	}
+	return ret;
+}
+
+}
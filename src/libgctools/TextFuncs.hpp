@@ -0,0 +1,69 @@
+/***************************************************************************
+ * GameCube Tools Library.                                                 *
+ * TextFuncs.hpp: Text encoding functions.                                 *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBGCTOOLS_TEXTFUNCS_HPP__
+#define __LIBGCTOOLS_TEXTFUNCS_HPP__
+
+// C includes.
+#include <stdint.h>
+
+/**
+ * Text decoders for GCN and Dreamcast text.
+ *
+ * These decode directly into a caller-provided UTF-16 buffer,
+ * so they don't require QTextCodec or any allocations.
+ *
+ * Each input byte produces at most one UTF-16 character,
+ * so the destination buffer must have room for len characters.
+ */
+namespace TextFuncs {
+
+/**
+ * Check if text is ASCII.
+ * ASCII text decodes identically in all supported encodings.
+ * @param src	[in] Text.
+ * @param len	[in] Length of src, in bytes.
+ * @return True if all bytes are 0x00-0x7F; false if not.
+ */
+bool is_ascii(const char *src, int len);
+
+/**
+ * Convert cp1252 text to UTF-16.
+ * Undefined cp1252 characters are mapped to C1 control codes.
+ * @param dest	[out] Destination buffer. (must have room for len characters)
+ * @param src	[in] cp1252 text.
+ * @param len	[in] Length of src, in bytes.
+ * @return Number of UTF-16 characters written.
+ */
+int cp1252_to_utf16(uint16_t *dest, const char *src, int len);
+
+/**
+ * Convert Shift-JIS text to UTF-16.
+ * Supports JIS X 0201, JIS X 0208, and the cp932 extensions.
+ * @param dest	[out] Destination buffer. (must have room for len characters)
+ * @param src	[in] Shift-JIS text.
+ * @param len	[in] Length of src, in bytes.
+ * @param strict [in] If true, stop at the first invalid sequence and return -1.
+ *                    If false, invalid sequences are replaced with U+FFFD.
+ * @return Number of UTF-16 characters written, or -1 if strict and src is invalid.
+ */
+int sjis_to_utf16(uint16_t *dest, const char *src, int len, bool strict = false);
+
+/**
+ * Convert Shift-JIS text to UTF-16.
+ * If the text isn't valid Shift-JIS, it's converted as cp1252.
+ * @param dest	[out] Destination buffer. (must have room for len characters)
+ * @param src	[in] Text.
+ * @param len	[in] Length of src, in bytes.
+ * @return Number of UTF-16 characters written.
+ */
+int sjis_or_cp1252_to_utf16(uint16_t *dest, const char *src, int len);
+
+}
+
+#endif /* __LIBGCTOOLS_TEXTFUNCS_HPP__ */
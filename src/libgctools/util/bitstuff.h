@@ -43,6 +43,29 @@ static inline unsigned int uilog2(unsigned int n)
 #endif
 }
 
+/**
+ * Count trailing zeroes.
+ * @param n Value. (must be non-zero)
+ * @return Number of trailing zeroes, i.e. the index of the lowest set bit.
+ */
+static inline unsigned int uictz(unsigned int n)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(n);
+#elif defined(_MSC_VER)
+	unsigned long index;
+	_BitScanForward(&index, n);
+	return index;
+#else
+	unsigned int ret = 0;
+	while (!(n & 1)) {
+		n >>= 1;
+		ret++;
+	}
+	return ret;
+#endif
+}
+
 /**
  * Population count function.
  * @param x Value.
@@ -0,0 +1,211 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * BlockMap.cpp: Used block map.                                           *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "BlockMap.hpp"
+#include "util/bitstuff.h"
+
+// C++ includes.
+#include <limits>
+
+/**
+ * Create a BlockMap.
+ * All blocks are initially free.
+ * @param totalBlocks Total number of blocks.
+ */
+BlockMap::BlockMap(int totalBlocks)
+	: m_size(0)
+{
+	reset(totalBlocks);
+}
+
+/**
+ * Reset the BlockMap.
+ * All blocks will be marked as free.
+ * @param totalBlocks Total number of blocks.
+ */
+void BlockMap::reset(int totalBlocks)
+{
+	if (totalBlocks < 0)
+		totalBlocks = 0;
+	m_size = totalBlocks;
+	m_overflow.clear();
+	m_bits = QVector<uint32_t>((totalBlocks + 31) / 32, 0);
+
+	// Mark the unused bits in the last word as used.
+	if (totalBlocks & 31) {
+		m_bits.last() = ~((1U << (totalBlocks & 31)) - 1);
+	}
+}
+
+/**
+ * Get a block's reference count.
+ * @param block Block number.
+ * @return Reference count. (0 if free or out of range)
+ */
+int BlockMap::refCount(int block) const
+{
+	if (!isUsed(block))
+		return 0;
+	return m_overflow.value(static_cast<uint16_t>(block), 1);
+}
+
+/**
+ * Add a reference to a block.
+ * The reference count saturates at 255.
+ * @param block Block number.
+ */
+void BlockMap::ref(int block)
+{
+	if (block < 0 || block >= m_size)
+		return;
+
+	uint32_t &word = m_bits[block >> 5];
+	const uint32_t bit = (1U << (block & 31));
+	if (!(word & bit)) {
+		// Block was free.
+		word |= bit;
+		return;
+	}
+
+	// Block is already used.
+	// Increment the overflow reference count.
+	uint8_t &count = m_overflow[static_cast<uint16_t>(block)];
+	if (count == 0) {
+		// New overflow entry.
+		count = 2;
+	} else if (count < std::numeric_limits<uint8_t>::max()) {
+		count++;
+	}
+}
+
+/**
+ * Mark a range of blocks as used.
+ * This adds a reference to each block in the range.
+ * @param first First block.
+ * @param count Number of blocks.
+ */
+void BlockMap::markUsed(int first, int count)
+{
+	const int last = (first + count < m_size ? first + count : m_size);
+	for (int block = (first >= 0 ? first : 0); block < last; block++) {
+		ref(block);
+	}
+}
+
+/** Search functions **/
+
+/**
+ * Find the next free block.
+ * @param from First block to check.
+ * @return Next free block at or after from, or -1 if none.
+ */
+int BlockMap::findNextFree(int from) const
+{
+	if (from < 0)
+		from = 0;
+	if (from >= m_size)
+		return -1;
+
+	const int words = m_bits.size();
+	int w = (from >> 5);
+	uint32_t free = ~m_bits.at(w) & (~0U << (from & 31));
+	while (!free) {
+		if (++w >= words)
+			return -1;
+		free = ~m_bits.at(w);
+	}
+
+	// NOTE: Unused bits in the last word are marked as used,
+	// so this will always be less than m_size.
+	return (w << 5) + uictz(free);
+}
+
+/**
+ * Find the next used block.
+ * @param from First block to check.
+ * @return Next used block at or after from, or -1 if none.
+ */
+int BlockMap::findNextUsed(int from) const
+{
+	if (from < 0)
+		from = 0;
+	if (from >= m_size)
+		return -1;
+
+	const int words = m_bits.size();
+	int w = (from >> 5);
+	uint32_t used = m_bits.at(w) & (~0U << (from & 31));
+	while (!used) {
+		if (++w >= words)
+			return -1;
+		used = m_bits.at(w);
+	}
+
+	// Unused bits in the last word are marked as used.
+	const int block = (w << 5) + uictz(used);
+	return (block < m_size ? block : -1);
+}
+
+/**
+ * Count the free blocks in a range.
+ * @param first First block.
+ * @param last Last block, plus one.
+ * @return Number of free blocks in [first, last).
+ */
+int BlockMap::countFree(int first, int last) const
+{
+	if (first < 0)
+		first = 0;
+	if (last > m_size)
+		last = m_size;
+	if (first >= last)
+		return 0;
+
+	const int wFirst = (first >> 5);
+	const int wLast = ((last - 1) >> 5);
+	const uint32_t maskFirst = (~0U << (first & 31));
+	const uint32_t maskLast = (~0U >> (31 - ((last - 1) & 31)));
+
+	int used;
+	if (wFirst == wLast) {
+		// Range is within a single word.
+		used = popcount(m_bits.at(wFirst) & maskFirst & maskLast);
+	} else {
+		used = popcount(m_bits.at(wFirst) & maskFirst);
+		for (int w = wFirst + 1; w < wLast; w++) {
+			used += popcount(m_bits.at(w));
+		}
+		used += popcount(m_bits.at(wLast) & maskLast);
+	}
+
+	return (last - first) - used;
+}
+
+/**
+ * Get all runs of free blocks, in ascending order.
+ * @param from First block to check.
+ * @return Runs of free blocks.
+ */
+QVector<BlockMap::Run> BlockMap::freeRuns(int from) const
+{
+	QVector<Run> runs;
+	int start = findNextFree(from);
+	while (start >= 0) {
+		int end = findNextUsed(start);
+		if (end < 0)
+			end = m_size;
+
+		Run run;
+		run.start = static_cast<uint16_t>(start);
+		run.length = static_cast<uint16_t>(end - start);
+		runs.append(run);
+
+		start = findNextFree(end);
+	}
+	return runs;
+}
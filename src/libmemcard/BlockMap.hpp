@@ -0,0 +1,169 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * BlockMap.hpp: Used block map.                                           *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_BLOCKMAP_HPP__
+#define __LIBMEMCARD_BLOCKMAP_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// Qt includes.
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+
+/**
+ * Used block map.
+ *
+ * Each block has a reference count indicating how many files
+ * are "using" that block. This should be 0 for free blocks,
+ * 1 for normal files, and >1 for "lost" files that are
+ * overlapping other files.
+ *
+ * The used/free state is stored as a packed bitset, so searching
+ * for free blocks and counting them uses ctz/popcount on whole
+ * words. Reference counts greater than 1 are rare, so they're
+ * stored separately in a sparse hash.
+ *
+ * BlockMap uses implicitly-shared Qt containers internally,
+ * so copying it is cheap.
+ */
+class BlockMap
+{
+	public:
+		/**
+		 * Create a BlockMap.
+		 * All blocks are initially free.
+		 * @param totalBlocks Total number of blocks.
+		 */
+		explicit BlockMap(int totalBlocks = 0);
+
+	public:
+		/**
+		 * Reset the BlockMap.
+		 * All blocks will be marked as free.
+		 * @param totalBlocks Total number of blocks.
+		 */
+		void reset(int totalBlocks);
+
+		/**
+		 * Get the total number of blocks.
+		 * @return Total number of blocks.
+		 */
+		inline int size(void) const
+		{
+			return m_size;
+		}
+
+		/**
+		 * Is this BlockMap empty?
+		 * @return True if empty; false if not.
+		 */
+		inline bool isEmpty(void) const
+		{
+			return (m_size == 0);
+		}
+
+		/**
+		 * Is a block used?
+		 * @param block Block number.
+		 * @return True if used; false if free or out of range.
+		 */
+		inline bool isUsed(int block) const
+		{
+			if (block < 0 || block >= m_size)
+				return false;
+			return !!(m_bits.at(block >> 5) & (1U << (block & 31)));
+		}
+
+		/**
+		 * Get a block's reference count.
+		 * @param block Block number.
+		 * @return Reference count. (0 if free or out of range)
+		 */
+		int refCount(int block) const;
+
+		/**
+		 * Add a reference to a block.
+		 * The reference count saturates at 255.
+		 * @param block Block number.
+		 */
+		void ref(int block);
+
+		/**
+		 * Mark a range of blocks as used.
+		 * This adds a reference to each block in the range.
+		 * @param first First block.
+		 * @param count Number of blocks.
+		 */
+		void markUsed(int first, int count);
+
+	public:
+		/** Search functions **/
+
+		/**
+		 * Find the next free block.
+		 * @param from First block to check.
+		 * @return Next free block at or after from, or -1 if none.
+		 */
+		int findNextFree(int from) const;
+
+		/**
+		 * Find the next used block.
+		 * @param from First block to check.
+		 * @return Next used block at or after from, or -1 if none.
+		 */
+		int findNextUsed(int from) const;
+
+		/**
+		 * Count the free blocks in a range.
+		 * @param first First block.
+		 * @param last Last block, plus one.
+		 * @return Number of free blocks in [first, last).
+		 */
+		int countFree(int first, int last) const;
+
+		/**
+		 * Count all free blocks.
+		 * @return Number of free blocks.
+		 */
+		inline int countFree(void) const
+		{
+			return countFree(0, m_size);
+		}
+
+		/**
+		 * Run of free blocks.
+		 */
+		struct Run {
+			uint16_t start;		// First block.
+			uint16_t length;	// Number of blocks.
+		};
+
+		/**
+		 * Get all runs of free blocks, in ascending order.
+		 * @param from First block to check.
+		 * @return Runs of free blocks.
+		 */
+		QVector<Run> freeRuns(int from = 0) const;
+
+	private:
+		// Packed bitset. (1 == used)
+		// Unused bits in the last word are marked as used
+		// so they're never reported as free.
+		QVector<uint32_t> m_bits;
+
+		// Reference counts for blocks with refcount > 1.
+		QHash<uint16_t, uint8_t> m_overflow;
+
+		// Total number of blocks.
+		int m_size;
+};
+
+Q_DECLARE_TYPEINFO(BlockMap::Run, Q_PRIMITIVE_TYPE);
+
+#endif /* __LIBMEMCARD_BLOCKMAP_HPP__ */
@@ -9,21 +9,68 @@
 #include "Card.hpp"
 #include "Card_p.hpp"
 #include "File.hpp"
+#include "FileImageLoader.hpp"
+#include "ChecksumVerifier.hpp"
+#include "TimeFuncs.hpp"
+
+// C includes.
+#ifdef _WIN32
+# include <windows.h>
+# include <io.h>
+#else /* !_WIN32 */
+# include <unistd.h>
+#endif /* _WIN32 */
 
 // C includes. (C++ namespace)
+#include <cerrno>
 #include <cstring>
 #include <cstdio>
 #include <cassert>
 
 // C++ includes.
+#include <algorithm>
 #include <limits>
 
 // Qt includes.
 #include <QtCore/QFile>
+#include <QtCore/QLocale>
 #include <QtCore/QVector>
+#include <QtCore/QReadLocker>
+#include <QtCore/QWriteLocker>
 
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
 
+#ifdef _WIN32
+/**
+ * Convert a Win32 error code to a POSIX error code.
+ * @param dwError Win32 error code. (from GetLastError())
+ * @return Positive POSIX error code. (EIO if unknown)
+ */
+static int w32err_to_posix(DWORD dwError)
+{
+	switch (dwError) {
+		case ERROR_DISK_FULL:
+		case ERROR_HANDLE_DISK_FULL:
+			return ENOSPC;
+		case ERROR_ACCESS_DENIED:
+		case ERROR_LOCK_VIOLATION:
+		case ERROR_SHARING_VIOLATION:
+			return EACCES;
+		case ERROR_WRITE_PROTECT:
+			return EROFS;
+		case ERROR_INVALID_HANDLE:
+			return EBADF;
+		case ERROR_INVALID_PARAMETER:
+			return EINVAL;
+		case ERROR_NOT_ENOUGH_MEMORY:
+		case ERROR_OUTOFMEMORY:
+			return ENOMEM;
+		default:
+			return EIO;
+	}
+}
+#endif /* _WIN32 */
+
 /** CardPrivate **/
 
 CardPrivate::CardPrivate(Card *q, uint32_t blockSize,
@@ -44,6 +91,9 @@ CardPrivate::CardPrivate(Card *q, uint32_t blockSize,
 	, totalPhysBlocks(0)
 	, totalUserBlocks(0)
 	, freeBlocks(0)
+	, openFlags(Card::OpenFlags())
+	, imageLoader(nullptr)
+	, checksumVerifier(nullptr)
 {
 	assert(isPow2(blockSize));
 	assert(blockSize > 0);
@@ -77,6 +127,23 @@ CardPrivate::~CardPrivate()
 	}
 }
 
+/**
+ * Set the open flags.
+ * This must be called before open().
+ * @param openFlags Open flags.
+ */
+void CardPrivate::setOpenFlags(Card::OpenFlags openFlags)
+{
+	this->openFlags = openFlags;
+	if ((openFlags & Card::OPEN_ASYNC) && !imageLoader) {
+		// Create the background image loader.
+		// It has to be connected to the Card's signals
+		// before any files are loaded.
+		Q_Q(Card);
+		imageLoader = new FileImageLoader(q);
+	}
+}
+
 /**
  * Open a Memory Card image.
  * totalPhysBlocks is initialized after the file is opened.
@@ -102,9 +169,12 @@ int CardPrivate::open(const QString &filename, QIODevice::OpenModeFlag openMode)
 	}
 
 	// Open the file.
+	// NOTE: The file is opened unbuffered, since all I/O
+	// goes through pread() and pwrite(). QFile's internal
+	// buffer would otherwise go stale.
 	Q_Q(Card);
 	QFile *tmp_file = new QFile(filename, q);
-	if (!tmp_file->open(openMode)) {
+	if (!tmp_file->open(openMode | QIODevice::Unbuffered)) {
 		// Error opening the file.
 		// NOTE: Qt doesn't return the raw error number.
 		// QFile::error() has a useless generic error number.
@@ -153,6 +223,7 @@ int CardPrivate::open(const QString &filename, QIODevice::OpenModeFlag openMode)
  */
 void CardPrivate::close(void)
 {
+	QWriteLocker locker(&fileLock);
 	if (!file) {
 		// Card is not open.
 		return;
@@ -161,6 +232,8 @@ void CardPrivate::close(void)
 	file->close();
 	delete file;
 	file = nullptr;
+	prefetchCache.clear();
+	prefetchData.clear();
 
 	// Clear the cached values.
 	filename.clear();
@@ -170,6 +243,204 @@ void CardPrivate::close(void)
 	freeBlocks = 0;
 }
 
+/**
+ * Read data from the card image.
+ * This uses positional I/O and does not modify the file pointer,
+ * so it can be called from multiple threads at the same time.
+ * NOTE: pos is an absolute file position. headerSize is not added.
+ * @param buf	[out] Buffer to read the data into.
+ * @param size	[in] Number of bytes to read.
+ * @param pos	[in] File position.
+ * @return Number of bytes read on success; negative POSIX error code on error.
+ */
+qint64 CardPrivate::pread(void *buf, qint64 size, qint64 pos) const
+{
+	QReadLocker locker(&fileLock);
+	if (!file)
+		return -EBADF;
+	else if (size < 0 || pos < 0)
+		return -EINVAL;
+	else if (size == 0)
+		return 0;
+
+	const int fd = file->handle();
+	if (fd < 0)
+		return -EBADF;
+
+#ifdef _WIN32
+	// ReadFile() with an OVERLAPPED offset reads from
+	// the specified position, regardless of the file pointer.
+	// NOTE: Card images are always smaller than 4 GB,
+	// so a single ReadFile() call is sufficient.
+	HANDLE hFile = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+	if (hFile == INVALID_HANDLE_VALUE)
+		return -EBADF;
+
+	OVERLAPPED ov;
+	memset(&ov, 0, sizeof(ov));
+	ov.Offset = static_cast<DWORD>(pos & 0xFFFFFFFFU);
+	ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+	DWORD dwRead = 0;
+	if (!ReadFile(hFile, buf, static_cast<DWORD>(size), &dwRead, &ov)) {
+		// ERROR_HANDLE_EOF indicates we're past the end of the file.
+		const DWORD dwError = GetLastError();
+		return (dwError == ERROR_HANDLE_EOF ? 0 : -w32err_to_posix(dwError));
+	}
+	return static_cast<qint64>(dwRead);
+#else /* !_WIN32 */
+	uint8_t *p = static_cast<uint8_t*>(buf);
+	qint64 total = 0;
+	while (size > 0) {
+		ssize_t ret = ::pread(fd, p, static_cast<size_t>(size), static_cast<off_t>(pos));
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		} else if (ret == 0) {
+			// End of file.
+			break;
+		}
+		p += ret;
+		pos += ret;
+		size -= ret;
+		total += ret;
+	}
+	return total;
+#endif /* _WIN32 */
+}
+
+/**
+ * Write data to the card image.
+ * Writes are serialized with respect to each other and to pread().
+ * NOTE: pos is an absolute file position. headerSize is not added.
+ * @param buf	[in] Buffer containing the data to write.
+ * @param size	[in] Number of bytes to write.
+ * @param pos	[in] File position.
+ * @return Number of bytes written on success; negative POSIX error code on error.
+ */
+qint64 CardPrivate::pwrite(const void *buf, qint64 size, qint64 pos)
+{
+	QWriteLocker locker(&fileLock);
+	if (!file)
+		return -EBADF;
+	else if (size < 0 || pos < 0)
+		return -EINVAL;
+	else if (size == 0)
+		return 0;
+
+	const int fd = file->handle();
+	if (fd < 0)
+		return -EBADF;
+
+#ifdef _WIN32
+	HANDLE hFile = reinterpret_cast<HANDLE>(_get_osfhandle(fd));
+	if (hFile == INVALID_HANDLE_VALUE)
+		return -EBADF;
+
+	OVERLAPPED ov;
+	memset(&ov, 0, sizeof(ov));
+	ov.Offset = static_cast<DWORD>(pos & 0xFFFFFFFFU);
+	ov.OffsetHigh = static_cast<DWORD>(pos >> 32);
+	DWORD dwWritten = 0;
+	if (!WriteFile(hFile, buf, static_cast<DWORD>(size), &dwWritten, &ov)) {
+		return -w32err_to_posix(GetLastError());
+	}
+	return static_cast<qint64>(dwWritten);
+#else /* !_WIN32 */
+	const uint8_t *p = static_cast<const uint8_t*>(buf);
+	qint64 total = 0;
+	while (size > 0) {
+		ssize_t ret = ::pwrite(fd, p, static_cast<size_t>(size), static_cast<off_t>(pos));
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		} else if (ret == 0) {
+			// Nothing was written.
+			return -EIO;
+		}
+		p += ret;
+		pos += ret;
+		size -= ret;
+		total += ret;
+	}
+	return total;
+#endif /* _WIN32 */
+}
+
+/**
+ * Prefetch blocks from the card image.
+ * Contiguous and nearby blocks are coalesced into
+ * a single read. Subsequent calls to Card::readBlock()
+ * for these blocks will use the prefetched data.
+ * This replaces any previously-prefetched blocks.
+ * @param blocks Physical block numbers. (Order and duplicates don't matter.)
+ */
+void CardPrivate::prefetch(QVector<uint16_t> blocks)
+{
+	clearPrefetch();
+	if (!file || blocks.isEmpty())
+		return;
+
+	// Sort the block list and remove duplicates.
+	std::sort(blocks.begin(), blocks.end());
+	blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+	// Gaps of up to this many blocks are read along with
+	// the surrounding blocks instead of being skipped.
+	// This trades a small amount of extra data for
+	// fewer reads on high-latency storage.
+	static const int PREFETCH_MAX_GAP = 4;
+
+	QVector<QByteArray> data;
+	QHash<uint16_t, const char*> cache;
+	cache.reserve(blocks.size());
+
+	int i = 0;
+	while (i < blocks.size()) {
+		// Find the end of this run.
+		int j = i + 1;
+		while (j < blocks.size() && (blocks[j] - blocks[j-1]) <= PREFETCH_MAX_GAP) {
+			j++;
+		}
+
+		const int firstBlock = blocks[i];
+		const int blockCount = (blocks[j-1] - firstBlock + 1);
+		QByteArray run;
+		run.resize(blockCount * (int)blockSize);
+		const qint64 pos = ((qint64)firstBlock * blockSize) + headerSize;
+		const qint64 sz = pread(run.data(), run.size(), pos);
+		if (sz == run.size()) {
+			// Read successful. Cache all blocks in the run.
+			// NOTE: QByteArray is implicitly shared, so this
+			// pointer remains valid once the run is in data.
+			const char *ptr = run.constData();
+			for (int k = 0; k < blockCount; k++, ptr += blockSize) {
+				cache.insert((uint16_t)(firstBlock + k), ptr);
+			}
+			data.append(run);
+		}
+		// NOTE: If a short read occurs, the blocks aren't cached,
+		// and Card::readBlock() will read them from the file.
+
+		i = j;
+	}
+
+	QWriteLocker locker(&fileLock);
+	prefetchData.swap(data);
+	prefetchCache.swap(cache);
+}
+
+/**
+ * Clear all prefetched blocks.
+ */
+void CardPrivate::clearPrefetch(void)
+{
+	QWriteLocker locker(&fileLock);
+	prefetchCache.clear();
+	prefetchData.clear();
+}
+
 /**
  * Find the most common byte in a block of data.
  * This is useful for determining header garbage.
@@ -223,9 +494,88 @@ Card::Card(CardPrivate *d, QObject *parent)
 
 Card::~Card()
 {
+	// Stop the background image loader and checksum verifier first.
+	// They use the card's tables, which are owned by the subclass.
+	Q_D(Card);
+	delete d->imageLoader;
+	d->imageLoader = nullptr;
+	delete d->checksumVerifier;
+	d->checksumVerifier = nullptr;
+
 	delete d_ptr;
 }
 
+/**
+ * Get the flags this card was opened with.
+ * @return Open flags.
+ */
+Card::OpenFlags Card::openFlags(void) const
+{
+	Q_D(const Card);
+	return d->openFlags;
+}
+
+/**
+ * Are files still being loaded in the background?
+ * This is only true if the card was opened with OPEN_ASYNC.
+ * @return True if loading; false if not.
+ */
+bool Card::isLoading(void) const
+{
+	Q_D(const Card);
+	return (d->imageLoader && d->imageLoader->isLoading());
+}
+
+/**
+ * Wait for background loading to finish.
+ * All files will have their banners and icons loaded
+ * once this returns. Does nothing if the card wasn't
+ * opened with OPEN_ASYNC.
+ * This must be called from the GUI thread.
+ */
+void Card::waitForLoad(void)
+{
+	Q_D(Card);
+	if (d->imageLoader && d->imageLoader->isLoading()) {
+		d->imageLoader->waitForDone();
+	}
+}
+
+/**
+ * Get the image atlas containing the banner
+ * and icon images for all files on this card.
+ * @return Image atlas.
+ */
+ImageAtlas *Card::imageAtlas(void) const
+{
+	Q_D(const Card);
+	return const_cast<ImageAtlas*>(&d->imageAtlas);
+}
+
+/**
+ * Format a file timestamp for display.
+ * Formatted strings are cached, so this is
+ * cheap enough to call from item views.
+ * @param unixTime Unix timestamp, UTC.
+ * @return Formatted timestamp, or empty string if invalid.
+ */
+QString Card::formatTimestamp(int64_t unixTime) const
+{
+	if (unixTime == TimeFuncs::INVALID_TIME)
+		return QString();
+
+	Q_D(const Card);
+	auto iter = d->timestampCache.constFind(unixTime);
+	if (iter != d->timestampCache.constEnd())
+		return *iter;
+
+	// NOTE: Same format as QStyledItemDelegate uses for QDateTime.
+	const QString str = QLocale().toString(
+		TimeFuncs::fromUnixTime(unixTime), QLocale::ShortFormat);
+	d->timestampCache.insert(unixTime, str);
+	return str;
+}
+
 /**
  * Check if the memory card is open.
  * @return True if open; false if not.
@@ -305,7 +655,7 @@ int Card::setReadOnly(bool readOnly)
 	// FIXME: Do we need to close the first QFile due to sharing?
 	// Open the file.
 	QFile *tmp_file = new QFile(d->filename, this);
-	if (!tmp_file->open(openMode)) {
+	if (!tmp_file->open(openMode | QIODevice::Unbuffered)) {
 		// Error opening the file.
 		// NOTE: Qt doesn't return the raw error number.
 		// QFile::error() has a useless generic error number.
@@ -317,9 +667,12 @@ int Card::setReadOnly(bool readOnly)
 	}
 
 	// TODO: Validate that this file is the same as the one we had before.
-	// TODO: Atomic swap of d->file and tmp_file.
+	// NOTE: The write lock ensures no reads are in progress
+	// while the QFile is being swapped.
+	QWriteLocker locker(&d->fileLock);
 	std::swap(d->file, tmp_file);
 	d->readOnly = readOnly;
+	locker.unlock();
 	tmp_file->close();
 	delete tmp_file;
 	return 0;
@@ -601,10 +954,28 @@ bool Card::isFreeBlockCountValid(int idx) const
 	return d->isFreeBlockCountValid(idx);
 }
 
+/**
+ * Get the used block map.
+ * NOTE: This is only valid for regular files, not "lost" files.
+ * BlockMap is implicitly shared, so this doesn't copy the map.
+ * @return Used block map, or empty BlockMap if not open.
+ */
+BlockMap Card::usedBlockMap(void) const
+{
+	if (!isOpen())
+		return BlockMap();
+	Q_D(const Card);
+	return d->usedBlockMap;
+}
+
 /** Card I/O **/
 
 /**
  * Read a block.
+ *
+ * This function is thread-safe. Multiple threads may read
+ * blocks from the same Card at the same time.
+ *
  * @param buf Buffer to read the block data into.
  * @param siz Size of buffer. (Must be >= blockSize.)
  * @param blockIdx Block index.
@@ -614,22 +985,33 @@ int Card::readBlock(void *buf, int siz, uint16_t blockIdx)
 {
 	Q_D(Card);
 	if (!isOpen())
-		return EBADF;
+		return -EBADF;
 	else if (siz < (int)d->blockSize)
 		return -EINVAL;
 	else if (siz == 0)
 		return 0;
 
+	// Check if this block was prefetched.
+	{
+		QReadLocker locker(&d->fileLock);
+		const char *const cached = d->prefetchCache.value(blockIdx, nullptr);
+		if (cached) {
+			memcpy(buf, cached, d->blockSize);
+			return (int)d->blockSize;
+		}
+	}
+
 	// Read the specified block.
 	const qint64 pos = ((qint64)blockIdx * d->blockSize) + d->headerSize;
-	if (!d->file->seek(pos))
-		return -EIO;	// TODO: Proper error code?
-	int ret = (int)d->file->read((char*)buf, d->blockSize);
-	return (ret >= 0 ? ret : -EIO);
+	return (int)d->pread(buf, d->blockSize, pos);
 }
 
 /**
  * Write a block.
+ *
+ * This function is thread-safe. Writes are serialized
+ * with respect to other writes and to readBlock().
+ *
  * @param buf Buffer containing the data to write.
  * @param siz Size of buffer. (Must be equal to blockSize.)
  * @param blockIdx Block index.
@@ -649,13 +1031,15 @@ int Card::writeBlock(const void *buf, int siz, uint16_t blockIdx)
 	if (d->readOnly)
 		return -EROFS;
 
+	// Make sure a stale prefetched copy isn't used.
+	{
+		QWriteLocker locker(&d->fileLock);
+		d->prefetchCache.remove(blockIdx);
+	}
+
 	// Write the specified block.
 	const qint64 pos = ((qint64)blockIdx * d->blockSize) + d->headerSize;
-	if (!d->file->seek(pos))
-		return -EIO;    // TODO: Proper error code?
-	// TODO: Check for errors?
-	int ret = (int)d->file->write((char*)buf, d->blockSize);
-	return (ret >= 0 ? ret : -EIO);
+	return (int)d->pwrite(buf, d->blockSize, pos);
 }
 
 // TODO: Add readBlocks() and writeBlocks() functions?
@@ -766,6 +1150,42 @@ void Card::removeLostFiles(void)
 	}
 }
 
+/** Checksums **/
+
+/**
+ * Set the checksum definitions for multiple files.
+ *
+ * Checksums are verified on worker threads, and
+ * checksumsChanged() is emitted as results are applied.
+ * Use File::setChecksumDefs() to verify a single file
+ * synchronously.
+ *
+ * @param files Files.
+ * @param checksumDefs Checksum definitions for each file.
+ */
+void Card::setChecksumDefs(const QVector<File*> &files,
+	const QVector<QVector<Checksum::ChecksumDef> > &checksumDefs)
+{
+	if (files.isEmpty())
+		return;
+
+	Q_D(Card);
+	if (!d->checksumVerifier) {
+		d->checksumVerifier = new ChecksumVerifier(this);
+	}
+	d->checksumVerifier->setChecksumDefs(files, checksumDefs);
+}
+
+/**
+ * Are file checksums still being verified?
+ * @return True if verifying; false if not.
+ */
+bool Card::isVerifyingChecksums(void) const
+{
+	Q_D(const Card);
+	return (d->checksumVerifier && d->checksumVerifier->isVerifying());
+}
+
 /** Errors **/
 
 /**
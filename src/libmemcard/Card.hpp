@@ -17,9 +17,14 @@
 #include <QtCore/QObject>
 #include <QtCore/QString>
 #include <QtCore/QTextCodec>
+#include <QtCore/QVector>
 #include <QtGui/QColor>
 
+#include "BlockMap.hpp"
+#include "Checksum.hpp"
+
 class File;
+class ImageAtlas;
 
 class CardPrivate;
 class Card : public QObject
@@ -29,6 +34,7 @@ class Card : public QObject
 
 	Q_ENUMS(Card::Encoding)
 	Q_FLAGS(Error Errors)
+	Q_FLAGS(OpenFlag OpenFlags)
 
 	Q_PROPERTY(bool open READ isOpen)
 	Q_PROPERTY(QString errorString READ errorString)
@@ -76,6 +82,59 @@ class Card : public QObject
 		Q_DECLARE_PRIVATE(Card)
 	private:
 		Q_DISABLE_COPY(Card)
+		friend class FileImageLoaderPrivate;
+
+	public:
+		/**
+		 * Card open flags.
+		 */
+		enum OpenFlag {
+			// Load file banners and icons in the background.
+			// The file list is available as soon as open()
+			// returns; fileChanged() is emitted as each file's
+			// images are loaded, and loadFinished() is emitted
+			// once all files have been loaded.
+			OPEN_ASYNC	= (1U << 0),
+		};
+		Q_DECLARE_FLAGS(OpenFlags, OpenFlag)
+
+		/**
+		 * Get the flags this card was opened with.
+		 * @return Open flags.
+		 */
+		OpenFlags openFlags(void) const;
+
+		/**
+		 * Are files still being loaded in the background?
+		 * This is only true if the card was opened with OPEN_ASYNC.
+		 * @return True if loading; false if not.
+		 */
+		bool isLoading(void) const;
+
+		/**
+		 * Wait for background loading to finish.
+		 * All files will have their banners and icons loaded
+		 * once this returns. Does nothing if the card wasn't
+		 * opened with OPEN_ASYNC.
+		 * This must be called from the GUI thread.
+		 */
+		void waitForLoad(void);
+
+		/**
+		 * Get the image atlas containing the banner
+		 * and icon images for all files on this card.
+		 * @return Image atlas.
+		 */
+		ImageAtlas *imageAtlas(void) const;
+
+		/**
+		 * Format a file timestamp for display.
+		 * Formatted strings are cached, so this is
+		 * cheap enough to call from item views.
+		 * @param unixTime Unix timestamp, UTC.
+		 * @return Formatted timestamp, or empty string if invalid.
+		 */
+		QString formatTimestamp(int64_t unixTime) const;
 
 	// TODO: Add basic file handling to the base class.
 	// Requires "CardFile" class.
@@ -106,6 +165,23 @@ class Card : public QObject
 		 */
 		void activeBatIdxChanged(int idx);
 
+		/**
+		 * A file's banner and icons have been loaded. (OPEN_ASYNC)
+		 * @param idx File index.
+		 */
+		void fileChanged(int idx);
+
+		/**
+		 * All files have been loaded. (OPEN_ASYNC)
+		 */
+		void loadFinished(void);
+
+		/**
+		 * File checksums have been verified. (setChecksumDefs())
+		 * @param files Files whose checksums have changed.
+		 */
+		void checksumsChanged(const QVector<const File*> &files);
+
 	public:
 		/**
 		 * Check if the memory card is open.
@@ -295,11 +371,23 @@ class Card : public QObject
 		 */
 		bool isFreeBlockCountValid(int idx) const;
 
+		/**
+		 * Get the used block map.
+		 * NOTE: This is only valid for regular files, not "lost" files.
+		 * BlockMap is implicitly shared, so this doesn't copy the map.
+		 * @return Used block map, or empty BlockMap if not open.
+		 */
+		BlockMap usedBlockMap(void) const;
+
 	public:
 		/** Card I/O **/
 
 		/**
 		 * Read a block.
+		 *
+		 * This function is thread-safe. Multiple threads may read
+		 * blocks from the same Card at the same time.
+		 *
 		 * @param buf Buffer to read the block data into.
 		 * @param siz Size of buffer. (Must be >= blockSize.)
 		 * @param blockIdx Block index.
@@ -309,6 +397,10 @@ class Card : public QObject
 
 		/**
 		 * Write a block.
+		 *
+		 * This function is thread-safe. Writes are serialized
+		 * with respect to other writes and to readBlock().
+		 *
 		 * @param buf Buffer containing the data to write.
 		 * @param siz Size of buffer. (Must be equal to blockSize.)
 		 * @param blockIdx Block index.
@@ -380,6 +472,28 @@ class Card : public QObject
 		 */
 		void removeLostFiles(void);
 
+		/** Checksums **/
+
+		/**
+		 * Set the checksum definitions for multiple files.
+		 *
+		 * Checksums are verified on worker threads, and
+		 * checksumsChanged() is emitted as results are applied.
+		 * Use File::setChecksumDefs() to verify a single file
+		 * synchronously.
+		 *
+		 * @param files Files.
+		 * @param checksumDefs Checksum definitions for each file.
+		 */
+		void setChecksumDefs(const QVector<File*> &files,
+			const QVector<QVector<Checksum::ChecksumDef> > &checksumDefs);
+
+		/**
+		 * Are file checksums still being verified?
+		 * @return True if verifying; false if not.
+		 */
+		bool isVerifyingChecksums(void) const;
+
 		/** Errors **/
 
 		/**
@@ -474,6 +588,7 @@ class Card : public QObject
 };
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(Card::Errors);
+Q_DECLARE_OPERATORS_FOR_FLAGS(Card::OpenFlags);
 Q_DECLARE_METATYPE(Card::Encoding)
 
 #endif /* __LIBMEMCARD_CARD_HPP__ */
@@ -10,15 +10,21 @@
 #define __LIBMEMCARD_CARD_P_HPP__
 
 #include "Card.hpp"
+#include "BlockMap.hpp"
+#include "ImageAtlas.hpp"
 
 // Qt includes.
 #include <QtCore/QFile>
 #include <QtCore/QFlags>
+#include <QtCore/QHash>
+#include <QtCore/QReadWriteLock>
 #include <QtCore/QString>
 #include <QtCore/QVector>
 #include <QtGui/QPixmap>
 
 class File;
+class FileImageLoader;
+class ChecksumVerifier;
 
 class CardPrivate
 {
@@ -57,6 +63,20 @@ class CardPrivate
 		QString filename;
 		QFile *file;
 		quint64 filesize;
+
+		// File lock.
+		// pread() takes a read lock, so multiple threads can
+		// read from the card at the same time. pwrite() and
+		// anything that replaces or closes the QFile takes
+		// a write lock.
+		mutable QReadWriteLock fileLock;
+
+		// Prefetched blocks.
+		// Card::readBlock() checks this before reading from the file.
+		// prefetchCache points into the buffers in prefetchData.
+		// Protected by fileLock.
+		QVector<QByteArray> prefetchData;
+		QHash<uint16_t, const char*> prefetchCache;
 		bool readOnly;
 		bool canMakeWritable;	// subclass should set this
 
@@ -104,7 +124,32 @@ class CardPrivate
 		// Files.
 		QVector<File*> lstFiles;
 
-		// TODO: Move usedBlockMap here?
+		// Open flags.
+		Card::OpenFlags openFlags;
+
+		// Background image loader. (OPEN_ASYNC only)
+		// NOTE: Deleted by ~Card() before the private class,
+		// since its worker threads use the card's tables.
+		FileImageLoader *imageLoader;
+
+		// Background checksum verifier.
+		// Created by Card::setChecksumDefs().
+		// NOTE: Deleted by ~Card() before the private class.
+		ChecksumVerifier *checksumVerifier;
+
+		// Banner and icon images for all files.
+		ImageAtlas imageAtlas;
+
+		// Formatted timestamps, keyed by Unix timestamp.
+		// Used by Card::formatTimestamp().
+		mutable QHash<qint64, QString> timestampCache;
+
+		/**
+		 * Used block map.
+		 * NOTE: This is only valid for regular files, not "lost" files.
+		 * Must be initialized by the subclass.
+		 */
+		BlockMap usedBlockMap;
 
 		/**
 		 * Check if a number is a power of 2.
@@ -119,6 +164,13 @@ class CardPrivate
 
 		/** Convenience functions for Card subclasses. **/
 
+		/**
+		 * Set the open flags.
+		 * This must be called before open().
+		 * @param openFlags Open flags.
+		 */
+		void setOpenFlags(Card::OpenFlags openFlags);
+
 		/**
 		 * Open a Memory Card image.
 		 * totalPhysBlocks is initialized after the file is opened.
@@ -136,6 +188,44 @@ class CardPrivate
 		 */
 		void close(void);
 
+		/**
+		 * Read data from the card image.
+		 * This uses positional I/O and does not modify the file pointer,
+		 * so it can be called from multiple threads at the same time.
+		 * NOTE: pos is an absolute file position. headerSize is not added.
+		 * @param buf	[out] Buffer to read the data into.
+		 * @param size	[in] Number of bytes to read.
+		 * @param pos	[in] File position.
+		 * @return Number of bytes read on success; negative POSIX error code on error.
+		 */
+		qint64 pread(void *buf, qint64 size, qint64 pos) const;
+
+		/**
+		 * Write data to the card image.
+		 * Writes are serialized with respect to each other and to pread().
+		 * NOTE: pos is an absolute file position. headerSize is not added.
+		 * @param buf	[in] Buffer containing the data to write.
+		 * @param size	[in] Number of bytes to write.
+		 * @param pos	[in] File position.
+		 * @return Number of bytes written on success; negative POSIX error code on error.
+		 */
+		qint64 pwrite(const void *buf, qint64 size, qint64 pos);
+
+		/**
+		 * Prefetch blocks from the card image.
+		 * Contiguous and nearby blocks are coalesced into
+		 * a single read. Subsequent calls to Card::readBlock()
+		 * for these blocks will use the prefetched data.
+		 * This replaces any previously-prefetched blocks.
+		 * @param blocks Physical block numbers. (Order and duplicates don't matter.)
+		 */
+		void prefetch(QVector<uint16_t> blocks);
+
+		/**
+		 * Clear all prefetched blocks.
+		 */
+		void clearPrefetch(void);
+
 		/**
 		 * Find the most common byte in a block of data.
 		 * This is useful for determining header garbage.
@@ -0,0 +1,413 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * ChecksumVerifier.cpp: Background checksum verifier.                     *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "ChecksumVerifier.hpp"
+
+#include "Card.hpp"
+#include "File.hpp"
+#include "File_p.hpp"
+
+// Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QSet>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QThreadPool>
+
+/** ChecksumVerifierPrivate **/
+
+class ChecksumVerifierPrivate
+{
+	public:
+		ChecksumVerifierPrivate(ChecksumVerifier *q, Card *card);
+		~ChecksumVerifierPrivate();
+
+	protected:
+		ChecksumVerifier *const q_ptr;
+		Q_DECLARE_PUBLIC(ChecksumVerifier)
+	private:
+		Q_DISABLE_COPY(ChecksumVerifierPrivate)
+
+	public:
+		Card *const card;
+
+		// Worker threads.
+		QThreadPool pool;
+
+		/**
+		 * Checksum verification job.
+		 */
+		struct Job {
+			File *file;
+			FilePrivate *fileD;
+			QVector<Checksum::ChecksumDef> checksumDefs;
+			int serial;
+		};
+
+		// Jobs whose results haven't been applied yet.
+		// Only accessed on the GUI thread.
+		QHash<File*, Job> pending;
+
+		// Last job serial number.
+		// A result is only applied if its serial number matches
+		// the file's pending job, so results from jobs that were
+		// replaced or restarted are discarded.
+		int serial;
+
+		/**
+		 * Jobs shared by all tasks started by start().
+		 * Each task takes the next unclaimed job, so
+		 * tasks that finish early pick up the rest.
+		 */
+		struct Batch {
+			QVector<Job> jobs;
+			QAtomicInt next;
+		};
+
+		// Set by stop() to make running tasks exit early.
+		QAtomicInt stopping;
+
+		/**
+		 * Checksum result from a worker thread.
+		 */
+		struct Result {
+			File *file;
+			int serial;
+			QVector<Checksum::ChecksumDef> checksumDefs;
+			FilePrivate::ChecksumResult checksum;
+		};
+
+		// Results waiting to be applied.
+		// Protected by resultsMutex.
+		QMutex resultsMutex;
+		QVector<Result*> results;
+
+		/**
+		 * Create a job for a file.
+		 * The job replaces the file's pending job, if any.
+		 * @param file File.
+		 * @param checksumDefs Checksum definitions.
+		 * @return Job.
+		 */
+		Job makeJob(File *file, const QVector<Checksum::ChecksumDef> &checksumDefs);
+
+		/**
+		 * Start verifying jobs on the worker threads.
+		 * @param jobs Jobs.
+		 */
+		void start(const QVector<Job> &jobs);
+
+		/**
+		 * Stop all running tasks and discard their results.
+		 * Pending jobs are kept.
+		 */
+		void stop(void);
+
+		/**
+		 * Discard all results that haven't been applied yet.
+		 */
+		void discardResults(void);
+
+		/**
+		 * Apply all results for pending jobs.
+		 * This must be called from the GUI thread.
+		 */
+		void applyResults(void);
+};
+
+/**
+ * Task to verify checksums on a worker thread.
+ */
+class ChecksumVerifyTask : public QRunnable
+{
+	public:
+		ChecksumVerifyTask(ChecksumVerifier *verifier, ChecksumVerifierPrivate *d,
+				   const QSharedPointer<ChecksumVerifierPrivate::Batch> &batch)
+			: verifier(verifier)
+			, d(d)
+			, batch(batch)
+		{ }
+
+	private:
+		Q_DISABLE_COPY(ChecksumVerifyTask)
+
+	public:
+		void run(void) final
+		{
+			// Scratch buffer for the file data.
+			// This is reused for all files verified by this task.
+			QByteArray fileData;
+
+			const QVector<ChecksumVerifierPrivate::Job> &jobs = batch->jobs;
+			while (!d->stopping.load()) {
+				const int idx = batch->next.fetchAndAddRelaxed(1);
+				if (idx >= jobs.size())
+					break;
+
+				const ChecksumVerifierPrivate::Job &job = jobs.at(idx);
+				ChecksumVerifierPrivate::Result *result = new ChecksumVerifierPrivate::Result;
+				result->file = job.file;
+				result->serial = job.serial;
+				result->checksumDefs = job.checksumDefs;
+				job.fileD->calculateChecksum(job.checksumDefs, fileData, &result->checksum);
+
+				bool wasEmpty;
+				{
+					QMutexLocker locker(&d->resultsMutex);
+					wasEmpty = d->results.isEmpty();
+					d->results.append(result);
+				}
+
+				// Only one notification is needed for
+				// results that arrive in quick succession.
+				if (wasEmpty) {
+					QMetaObject::invokeMethod(verifier, "resultsReady_slot", Qt::QueuedConnection);
+				}
+			}
+		}
+
+	private:
+		ChecksumVerifier *const verifier;
+		ChecksumVerifierPrivate *const d;
+		const QSharedPointer<ChecksumVerifierPrivate::Batch> batch;
+};
+
+ChecksumVerifierPrivate::ChecksumVerifierPrivate(ChecksumVerifier *q, Card *card)
+	: q_ptr(q)
+	, card(card)
+	, serial(0)
+{ }
+
+ChecksumVerifierPrivate::~ChecksumVerifierPrivate()
+{
+	stop();
+}
+
+/**
+ * Create a job for a file.
+ * The job replaces the file's pending job, if any.
+ * @param file File.
+ * @param checksumDefs Checksum definitions.
+ * @return Job.
+ */
+ChecksumVerifierPrivate::Job ChecksumVerifierPrivate::makeJob(
+	File *file, const QVector<Checksum::ChecksumDef> &checksumDefs)
+{
+	Job job;
+	job.file = file;
+	job.fileD = file->d_func();
+	job.checksumDefs = checksumDefs;
+	job.serial = ++serial;
+	pending.insert(file, job);
+	return job;
+}
+
+/**
+ * Start verifying jobs on the worker threads.
+ * @param jobs Jobs.
+ */
+void ChecksumVerifierPrivate::start(const QVector<Job> &jobs)
+{
+	if (jobs.isEmpty())
+		return;
+
+	QSharedPointer<Batch> batch(new Batch);
+	batch->jobs = jobs;
+
+	// One task per worker thread.
+	// Each task verifies jobs until there are none left,
+	// so a few large files don't hold up the rest.
+	Q_Q(ChecksumVerifier);
+	const int taskCount = qMin(pool.maxThreadCount(), jobs.size());
+	for (int i = 0; i < taskCount; i++) {
+		pool.start(new ChecksumVerifyTask(q, this, batch));
+	}
+}
+
+/**
+ * Stop all running tasks and discard their results.
+ * Pending jobs are kept.
+ */
+void ChecksumVerifierPrivate::stop(void)
+{
+	stopping.store(1);
+	pool.clear();
+	pool.waitForDone();
+	stopping.store(0);
+	discardResults();
+}
+
+/**
+ * Discard all results that haven't been applied yet.
+ */
+void ChecksumVerifierPrivate::discardResults(void)
+{
+	QMutexLocker locker(&resultsMutex);
+	qDeleteAll(results);
+	results.clear();
+}
+
+/**
+ * Apply all results for pending jobs.
+ * This must be called from the GUI thread.
+ */
+void ChecksumVerifierPrivate::applyResults(void)
+{
+	QVector<Result*> ready;
+	{
+		QMutexLocker locker(&resultsMutex);
+		ready.swap(results);
+	}
+
+	QVector<const File*> changed;
+	changed.reserve(ready.size());
+	foreach (Result *result, ready) {
+		auto iter = pending.find(result->file);
+		if (iter != pending.end() && iter->serial == result->serial) {
+			// Apply the checksum.
+			File *const file = result->file;
+			file->d_func()->applyChecksum(result->checksumDefs, &result->checksum);
+			pending.erase(iter);
+			changed.append(file);
+			emit file->checksumChanged();
+		}
+		delete result;
+	}
+
+	if (!changed.isEmpty()) {
+		emit card->checksumsChanged(changed);
+	}
+}
+
+/** ChecksumVerifier **/
+
+ChecksumVerifier::ChecksumVerifier(Card *card)
+	: super(card)
+	, d_ptr(new ChecksumVerifierPrivate(this, card))
+{
+	connect(card, &Card::filesAboutToBeRemoved,
+		this, &ChecksumVerifier::card_filesAboutToBeRemoved_slot);
+	connect(card, &Card::filesRemoved,
+		this, &ChecksumVerifier::card_filesRemoved_slot);
+}
+
+ChecksumVerifier::~ChecksumVerifier()
+{
+	Q_D(ChecksumVerifier);
+	delete d;
+}
+
+/**
+ * Set the checksum definitions for multiple files.
+ * Checksums are verified in the background.
+ * If a file already has a pending verification,
+ * it's replaced with the new checksum definitions.
+ * @param files Files.
+ * @param checksumDefs Checksum definitions for each file.
+ */
+void ChecksumVerifier::setChecksumDefs(const QVector<File*> &files,
+	const QVector<QVector<Checksum::ChecksumDef> > &checksumDefs)
+{
+	Q_ASSERT(files.size() == checksumDefs.size());
+	const int count = qMin(files.size(), checksumDefs.size());
+
+	Q_D(ChecksumVerifier);
+	QVector<ChecksumVerifierPrivate::Job> jobs;
+	jobs.reserve(count);
+	for (int i = 0; i < count; i++) {
+		if (files.at(i)) {
+			jobs.append(d->makeJob(files.at(i), checksumDefs.at(i)));
+		}
+	}
+	d->start(jobs);
+}
+
+/**
+ * Are any checksums still being verified?
+ * @return True if verifying; false if not.
+ */
+bool ChecksumVerifier::isVerifying(void) const
+{
+	Q_D(const ChecksumVerifier);
+	return !d->pending.isEmpty();
+}
+
+/**
+ * Cancel all pending verifications and wait for
+ * running verifications to finish.
+ * Results from running verifications are discarded.
+ */
+void ChecksumVerifier::cancel(void)
+{
+	Q_D(ChecksumVerifier);
+	d->stop();
+	d->pending.clear();
+}
+
+/** Private slots. **/
+
+/**
+ * Files are about to be removed from the Card.
+ * @param start First file index.
+ * @param end Last file index.
+ */
+void ChecksumVerifier::card_filesAboutToBeRemoved_slot(int start, int end)
+{
+	Q_UNUSED(start);
+	Q_UNUSED(end);
+
+	// The files will be deleted after this signal,
+	// so all workers must be stopped first.
+	// Files that weren't removed will be restarted
+	// once the removal is complete.
+	Q_D(ChecksumVerifier);
+	d->stop();
+}
+
+/**
+ * Files have been removed from the Card.
+ */
+void ChecksumVerifier::card_filesRemoved_slot(void)
+{
+	Q_D(ChecksumVerifier);
+	if (d->pending.isEmpty())
+		return;
+
+	const QVector<File*> files = d->card->getFiles();
+	QSet<const File*> remaining;
+	remaining.reserve(files.size());
+	foreach (const File *file, files) {
+		remaining.insert(file);
+	}
+
+	// Restart verification for files that are still present.
+	QVector<ChecksumVerifierPrivate::Job> jobs;
+	jobs.reserve(d->pending.size());
+	for (auto iter = d->pending.begin(); iter != d->pending.end(); ) {
+		if (remaining.contains(iter.key())) {
+			jobs.append(*iter);
+			++iter;
+		} else {
+			iter = d->pending.erase(iter);
+		}
+	}
+	d->start(jobs);
+}
+
+/**
+ * Checksum results are ready to be applied.
+ * This is called from the worker threads via a queued connection.
+ */
+void ChecksumVerifier::resultsReady_slot(void)
+{
+	Q_D(ChecksumVerifier);
+	d->applyResults();
+}
@@ -0,0 +1,98 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * ChecksumVerifier.hpp: Background checksum verifier.                     *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_CHECKSUMVERIFIER_HPP__
+#define __LIBMEMCARD_CHECKSUMVERIFIER_HPP__
+
+#include "Checksum.hpp"
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QVector>
+
+class Card;
+class File;
+
+/**
+ * Background checksum verifier.
+ *
+ * Used by Card::setChecksumDefs(). File data is loaded and
+ * checksummed on worker threads, and the results are applied
+ * to the File objects on the GUI thread. Results that finish
+ * while the GUI thread is busy are applied together, and
+ * Card::checksumsChanged() is emitted once for each group.
+ *
+ * If files are removed from the card while checksums are
+ * being verified, verification is restarted for the files
+ * that remain.
+ *
+ * NOTE: This must be deleted before the Card's private class,
+ * since the worker threads access the card's file system tables.
+ */
+class ChecksumVerifierPrivate;
+class ChecksumVerifier : public QObject
+{
+	Q_OBJECT
+	typedef QObject super;
+
+	public:
+		explicit ChecksumVerifier(Card *card);
+		virtual ~ChecksumVerifier();
+
+	protected:
+		ChecksumVerifierPrivate *const d_ptr;
+		Q_DECLARE_PRIVATE(ChecksumVerifier)
+	private:
+		Q_DISABLE_COPY(ChecksumVerifier)
+
+	public:
+		/**
+		 * Set the checksum definitions for multiple files.
+		 * Checksums are verified in the background.
+		 * If a file already has a pending verification,
+		 * it's replaced with the new checksum definitions.
+		 * @param files Files.
+		 * @param checksumDefs Checksum definitions for each file.
+		 */
+		void setChecksumDefs(const QVector<File*> &files,
+			const QVector<QVector<Checksum::ChecksumDef> > &checksumDefs);
+
+		/**
+		 * Are any checksums still being verified?
+		 * @return True if verifying; false if not.
+		 */
+		bool isVerifying(void) const;
+
+		/**
+		 * Cancel all pending verifications and wait for
+		 * running verifications to finish.
+		 * Results from running verifications are discarded.
+		 */
+		void cancel(void);
+
+	private slots:
+		/**
+		 * Files are about to be removed from the Card.
+		 * @param start First file index.
+		 * @param end Last file index.
+		 */
+		void card_filesAboutToBeRemoved_slot(int start, int end);
+
+		/**
+		 * Files have been removed from the Card.
+		 */
+		void card_filesRemoved_slot(void);
+
+		/**
+		 * Checksum results are ready to be applied.
+		 * This is called from the worker threads via a queued connection.
+		 */
+		void resultsReady_slot(void);
+};
+
+#endif /* __LIBMEMCARD_CHECKSUMVERIFIER_HPP__ */
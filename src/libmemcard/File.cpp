@@ -9,15 +9,20 @@
 #include "File.hpp"
 #include "File_p.hpp"
 #include "Card.hpp"
+#include "TimeFuncs.hpp"
 
 // GcImage.
 #include "GcImage.hpp"
 #include "GcToolsQt.hpp"
 #include "GcImageWriter.hpp"
 
+// Text decoding.
+#include "TextFuncs.hpp"
+
 // C includes. (C++ namespace)
 #include <cerrno>
 #include <cassert>
+#include <cstring>
 
 // C++ includes.
 #include <string>
@@ -27,9 +32,10 @@ using std::vector;
 
 // Qt includes.
 #include <QtCore/QByteArray>
-#include <QtCore/QTextCodec>
+#include <QtCore/QVarLengthArray>
 #include <QtCore/QFile>
 #include <QtCore/QIODevice>
+#include <QtCore/QThreadStorage>
 
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
 
@@ -43,14 +49,20 @@ using std::vector;
 FilePrivate::FilePrivate(File *q, Card *card)
 	: q_ptr(q)
 	, card(card)
+	, mtime(TimeFuncs::INVALID_TIME)
 	, mode(0)
 	, gcBanner(nullptr)
 	, iconAnimMode(0)
+	, imagesLoaded(false)
 	, lostFile(false)
+	, checksumStatus(Checksum::CHKST_UNKNOWN)
 { }
 
 FilePrivate::~FilePrivate()
 {
+	// Remove the images from the atlas.
+	releaseImages();
+
 	// Delete the GcImages.
 	delete gcBanner;
 	qDeleteAll(gcIcons);
@@ -87,6 +99,22 @@ uint16_t FilePrivate::fileBlockAddrToPhysBlockAddr(uint16_t fileBlock) const
  * @return QByteArray with file data, or empty QByteArray on error.
  */
 QByteArray FilePrivate::loadFileData(void)
+{
+	QByteArray fileData;
+	if (!loadFileData(fileData)) {
+		return QByteArray();
+	}
+	return fileData;
+}
+
+/**
+ * Load the file data into an existing buffer.
+ * The buffer is resized as needed, so it can be
+ * reused for multiple files without reallocating.
+ * @param fileData	[out] Buffer for the file data.
+ * @return True on success; false on error.
+ */
+bool FilePrivate::loadFileData(QByteArray &fileData)
 {
 	// TODO: Combine with readBlocks()?
 	// TODO: Add a generic read() function?
@@ -94,11 +122,14 @@ QByteArray FilePrivate::loadFileData(void)
 	if (this->size() > card->totalUserBlocks()) {
 		// File is larger than the card.
 		// This shouldn't happen...
-		return QByteArray();
+		fileData.clear();
+		return false;
 	}
 
-	QByteArray fileData;
 	// FIXME: Optimize blockSize multiplication by using shifts.
+	// NOTE: QByteArray::resize() doesn't release memory
+	// when shrinking, so a reused buffer won't reallocate
+	// unless this file is larger than any previous file.
 	fileData.resize(this->size() * blockSize);
 
 	uint8_t *fileDataPtr = (uint8_t*)fileData.data();
@@ -106,7 +137,7 @@ QByteArray FilePrivate::loadFileData(void)
 		const uint16_t physBlockAddr = fileBlockAddrToPhysBlockAddr(i);
 		card->readBlock(fileDataPtr, blockSize, physBlockAddr);
 	}
-	return fileData;
+	return true;
 }
 
 /**
@@ -139,12 +170,37 @@ QByteArray FilePrivate::readBlocks(uint16_t blockStart, int len)
 
 	uint8_t *blockDataPtr = (uint8_t*)blockData.data();
 	for (int i = 0; i < len; i++, blockDataPtr += blockSize) {
-		const uint16_t physBlockAddr = fileBlockAddrToPhysBlockAddr(i);
+		const uint16_t physBlockAddr = fileBlockAddrToPhysBlockAddr(blockStart + i);
 		card->readBlock(blockDataPtr, blockSize, physBlockAddr);
 	}
 	return blockData;
 }
 
+/**
+ * Read the specified byte range from the file.
+ * Only the blocks containing the range are read.
+ * @param offset Starting offset, in bytes.
+ * @param len Length, in bytes.
+ * @return QByteArray with file data. This may be shorter than len
+ * if the range extends past the end of the file.
+ */
+QByteArray FilePrivate::readData(uint32_t offset, int len)
+{
+	if (len <= 0)
+		return QByteArray();
+
+	const int blockSize = card->blockSize();
+	const uint32_t blockStart = (offset / blockSize);
+	const uint32_t blockEnd = ((offset + len - 1) / blockSize);
+	if (blockStart >= (uint32_t)this->size()) {
+		// Starting block is larger than the filesize.
+		return QByteArray();
+	}
+
+	QByteArray blockData = readBlocks((uint16_t)blockStart, (int)(blockEnd - blockStart + 1));
+	return blockData.mid(offset % blockSize, len);
+}
+
 /**
  * Strip invalid DOS characters from a filename.
  * @param filename Filename.
@@ -188,12 +244,7 @@ QString FilePrivate::StripInvalidDosChars(
  */
 QString FilePrivate::decodeText_SJISorCP1252(const char *str, int len)
 {
-	// Static codec initialization.
-	// NOTE: Assuming cp1252 always works.
-	static QTextCodec *shiftJis = QTextCodec::codecForName("Shift_JIS");
-	static QTextCodec *cp1252 = QTextCodec::codecForName("cp1252");
-
-	// Remove trailing NULL characters before converting to UTF-8.
+	// Remove trailing NULL characters before converting to UTF-16.
 	for (int i = len-1; i >= 0; i--) {
 		if (str[i] == 0) {
 			// Found a NULL.
@@ -204,37 +255,36 @@ QString FilePrivate::decodeText_SJISorCP1252(const char *str, int len)
 		}
 	}
 
-	if (!shiftJis) {
-		// Shift-JIS isn't available.
-		// Always use cp1252.
-		assert(cp1252 != nullptr);
-		if (!cp1252) {
-			// Should not happen...
-			return QString::fromLatin1(str, len);
-		}
-		return cp1252->toUnicode(str, len);
-	}
+	// Valid Shift-JIS is decoded in a single pass.
+	// Only invalid Shift-JIS falls back to cp1252.
+	QVarLengthArray<uint16_t, 256> buf(len);
+	len = TextFuncs::sjis_or_cp1252_to_utf16(buf.data(), str, len);
+	return QString(reinterpret_cast<const QChar*>(buf.constData()), len);
+}
 
-	// Attempt to decode as Shift-JIS.
-	// TODO: There should be a faster way to check if the text isn't valid...
-	// (iconv can return an error if an invalid character is encountered.)
-	QTextCodec::ConverterState state(QTextCodec::ConvertInvalidToNull);
-	QString text = shiftJis->toUnicode(str, len);
-	// U+FFFD: REPLACEMENT CHARACTER
-	// QTextCodec uses this if it encounters
-	// an invalid Shift-JIS sequence.
-	if (text.contains(QChar(0xFFFD))) {
-		// Invalid characters detected.
-		// Use cp1252 instead.
-		if (!cp1252) {
-			// Should not happen...
-			return QString::fromLatin1(str, len);
-		}
-		return cp1252->toUnicode(str, len);
+/**
+ * Decode text using the specified encoding.
+ * Text is truncated at the first NULL character.
+ * @param str Text data.
+ * @param len Maximum length of str.
+ * @param encoding Text encoding. (Unknown is handled as cp1252.)
+ * @return Unicode QString.
+ */
+QString FilePrivate::decodeText(const char *str, int len, Card::Encoding encoding)
+{
+	const char *const p_nullChr = static_cast<const char*>(memchr(str, 0, len));
+	if (p_nullChr) {
+		len = (int)(p_nullChr - str);
 	}
 
-	// Text decoded as Shift-JIS.
-	return text;
+	QVarLengthArray<uint16_t, 256> buf(len);
+	if (encoding == Card::Encoding::Shift_JIS) {
+		// Invalid characters are replaced with U+FFFD.
+		len = TextFuncs::sjis_to_utf16(buf.data(), str, len);
+	} else {
+		len = TextFuncs::cp1252_to_utf16(buf.data(), str, len);
+	}
+	return QString(reinterpret_cast<const QChar*>(buf.constData()), len);
 }
 
 /** Images **/
@@ -244,55 +294,174 @@ QString FilePrivate::decodeText_SJISorCP1252(const char *str, int len)
  * TODO: Move to File?
  */
 void FilePrivate::loadImages(void)
+{
+	if (card->openFlags() & Card::OPEN_ASYNC) {
+		// Images will be loaded by FileImageLoader.
+		return;
+	}
+
+	DecodedImages images;
+	decodeImages(&images);
+	applyImages(&images);
+}
+
+FilePrivate::DecodedImages::~DecodedImages()
+{
+	// Delete the GcImages if they weren't applied.
+	delete gcBanner;
+	qDeleteAll(gcIcons);
+}
+
+/**
+ * Decode the banner and icon images.
+ *
+ * This function is thread-safe as long as the card's
+ * file list isn't modified while it's running.
+ * NOTE: loadIconImages() sets iconSpeed and iconAnimMode.
+ * These aren't used until the icons are applied.
+ *
+ * @param images	[out] Decoded images.
+ */
+void FilePrivate::decodeImages(DecodedImages *images)
 {
 	// Load the banner.
-	this->gcBanner = loadBannerImage();
-	if (gcBanner) {
-		// Set the new banner image.
-		QImage qBanner = gcImageToQImage(gcBanner);
-		if (!qBanner.isNull())
-			banner = QPixmap::fromImage(qBanner);
-		else
-			banner = QPixmap();
+	images->gcBanner = loadBannerImage();
+	if (images->gcBanner) {
+		images->banner = gcImageToQImage(images->gcBanner);
 	} else {
 		// No banner image.
-		banner = QPixmap();
+		images->banner = QImage();
 	}
 
 	// Load the icons.
-	this->gcIcons = loadIconImages();
-	icons.clear();
-	icons.reserve(gcIcons.size());
-	foreach (GcImage *gcIcon, gcIcons) {
+	images->gcIcons = loadIconImages();
+	images->icons.clear();
+	images->icons.reserve(images->gcIcons.size());
+	foreach (const GcImage *gcIcon, images->gcIcons) {
 		if (gcIcon) {
-			QImage qIcon = gcImageToQImage(gcIcon);
-			if (!qIcon.isNull())
-				icons.append(QPixmap::fromImage(qIcon));
-			else
-				icons.append(QPixmap());
+			images->icons.append(gcImageToQImage(gcIcon));
 		} else {
 			// No icon image.
-			icons.append(QPixmap());
+			images->icons.append(QImage());
 		}
 	}
 }
 
+/**
+ * Apply decoded banner and icon images.
+ * This must be called from the GUI thread,
+ * since it adds the images to the card's ImageAtlas.
+ * @param images	[in/out] Decoded images. (GcImages are taken over by FilePrivate.)
+ */
+void FilePrivate::applyImages(DecodedImages *images)
+{
+	// Take over the GcImages.
+	delete gcBanner;
+	qDeleteAll(gcIcons);
+	gcBanner = images->gcBanner;
+	gcIcons = images->gcIcons;
+	images->gcBanner = nullptr;
+	images->gcIcons.clear();
+
+	// Add the new images to the atlas.
+	// NOTE: Null images result in empty regions.
+	releaseImages();
+	ImageAtlas *const atlas = card->imageAtlas();
+	bannerRegion = atlas->add(images->banner);
+	iconRegions.reserve(images->icons.size());
+	foreach (const QImage &qIcon, images->icons) {
+		iconRegions.append(atlas->add(qIcon));
+	}
+
+	imagesLoaded = true;
+}
+
+/**
+ * Remove the banner and icon images from the card's ImageAtlas.
+ */
+void FilePrivate::releaseImages(void)
+{
+	ImageAtlas *const atlas = card->imageAtlas();
+	atlas->remove(bannerRegion);
+	bannerRegion = ImageAtlas::Region();
+	foreach (const ImageAtlas::Region &region, iconRegions) {
+		atlas->remove(region);
+	}
+	iconRegions.clear();
+}
+
 /** Checksums **/
 
 /**
  * Calculate the file checksum.
+ * This also updates the cached checksum status
+ * and formatted checksum values.
  */
 void FilePrivate::calculateChecksum(void)
 {
-	checksumValues.clear();
+	QByteArray fileData;
+	ChecksumResult result;
+	calculateChecksum(checksumDefs, fileData, &result);
+	applyChecksum(checksumDefs, &result);
+}
 
-	if (checksumDefs.empty()) {
-		// No checksum definitions were set.
-		return;
+/**
+ * Calculate the file checksum using the specified definitions.
+ *
+ * This function is thread-safe as long as the card's
+ * file list isn't modified while it's running.
+ * It doesn't modify the FilePrivate.
+ *
+ * @param checksumDefs	[in] Checksum definitions.
+ * @param fileData	[in/out] Scratch buffer for the file data.
+ * @param result	[out] Checksum result.
+ */
+void FilePrivate::calculateChecksum(const QVector<Checksum::ChecksumDef> &checksumDefs,
+	QByteArray &fileData, ChecksumResult *result)
+{
+	result->values.clear();
+	result->formatted.clear();
+	if (!checksumDefs.isEmpty() && loadFileData(fileData)) {
+		calculateChecksumValues(checksumDefs, fileData, result->values);
 	}
 
-	// Load the file data.
-	QByteArray fileData = loadFileData();
+	// Determine the checksum status and formatted values.
+	const vector<Checksum::ChecksumValue> values = result->values.toStdVector();
+	result->status = Checksum::ChecksumStatus(values);
+
+	const vector<string> vs = Checksum::ChecksumValuesFormatted(values);
+	result->formatted.reserve((int)vs.size());
+	for (auto iter = vs.cbegin(); iter != vs.cend(); ++iter) {
+		result->formatted.append(QString::fromStdString(*iter));
+	}
+}
+
+/**
+ * Apply a calculated checksum.
+ * This must be called from the GUI thread.
+ * @param checksumDefs	[in] Checksum definitions used to calculate result.
+ * @param result	[in/out] Checksum result. (Contents are taken over by FilePrivate.)
+ */
+void FilePrivate::applyChecksum(const QVector<Checksum::ChecksumDef> &checksumDefs,
+	ChecksumResult *result)
+{
+	this->checksumDefs = checksumDefs;
+	checksumValues.swap(result->values);
+	checksumStatus = result->status;
+	checksumValuesFormatted.swap(result->formatted);
+}
+
+/**
+ * Calculate the file checksum values.
+ * Called by calculateChecksum().
+ * @param checksumDefs	[in] Checksum definitions.
+ * @param fileData	[in/out] File data. (Modified temporarily.)
+ * @param values	[out] Checksum values.
+ */
+void FilePrivate::calculateChecksumValues(const QVector<Checksum::ChecksumDef> &checksumDefs,
+	QByteArray &fileData, QVector<Checksum::ChecksumValue> &values)
+{
+	values.clear();
 	if (fileData.isEmpty()) {
 		// File is empty.
 		return;
@@ -426,7 +595,7 @@ void FilePrivate::calculateChecksum(void)
 		Checksum::ChecksumValue checksumValue;
 		checksumValue.expected = expected;
 		checksumValue.actual = actual;
-		checksumValues.push_back(checksumValue);
+		values.push_back(checksumValue);
 	}
 }
 
@@ -528,6 +697,7 @@ int File::write(uint32_t address, const void *const data, uint32_t length)
 			memcpy(block.data() + blockStartOffset, data_u8, length);
 			d->card->writeBlock(block.data(), blockSize, physBlockStartIdx);
 			// FIXME: Trigger card metadata update.
+			d->calculateChecksum();
 			return 0;
 		}
 
@@ -544,7 +714,7 @@ int File::write(uint32_t address, const void *const data, uint32_t length)
 	// Write entire blocks.
 	for (; length >= (uint32_t)blockSize; length -= blockSize, data_u8 += blockSize, address += blockSize) {
 		const uint16_t physBlockIdx = d->fileBlockAddrToPhysBlockAddr(address / blockSize);
-		d->card->writeBlock(data, blockSize, physBlockIdx);
+		d->card->writeBlock(data_u8, blockSize, physBlockIdx);
 	}
 
 	// Check if we still have data left (not a full block).
@@ -560,6 +730,9 @@ int File::write(uint32_t address, const void *const data, uint32_t length)
 		d->card->writeBlock(block.data(), blockSize, physBlockEndIdx);
 	}
 
+	// File data has changed. Recalculate the checksum.
+	d->calculateChecksum();
+
 	// Data written successfully.
 	return 0;
 }
@@ -576,9 +749,21 @@ QString File::gameID(void) const
 
 /**
  * Get the last modified time.
+ * NOTE: This constructs a QDateTime, so it should only
+ * be used for display. Use mtimeUnix() for comparisons.
  * @return Last modified time.
  */
 QDateTime File::mtime(void) const
+{
+	Q_D(const File);
+	return TimeFuncs::fromUnixTime(d->mtime);
+}
+
+/**
+ * Get the last modified time as a Unix timestamp.
+ * @return Last modified time. (Unix timestamp, UTC; TimeFuncs::INVALID_TIME if not available)
+ */
+int64_t File::mtimeUnix(void) const
 {
 	Q_D(const File);
 	return d->mtime;
@@ -628,7 +813,17 @@ int File::size(void) const
 QPixmap File::banner(void) const
 {
 	Q_D(const File);
-	return d->banner;
+	return d->card->imageAtlas()->pixmap(d->bannerRegion);
+}
+
+/**
+ * Get the banner image's region in the card's ImageAtlas.
+ * @return Banner region, or empty region if there's no banner.
+ */
+ImageAtlas::Region File::bannerRegion(void) const
+{
+	Q_D(const File);
+	return d->bannerRegion;
 }
 
 /**
@@ -638,7 +833,7 @@ QPixmap File::banner(void) const
 int File::iconCount(void) const
 {
 	Q_D(const File);
-	return d->icons.size();
+	return d->iconRegions.size();
 }
 
 /**
@@ -649,9 +844,22 @@ int File::iconCount(void) const
 QPixmap File::icon(int idx) const
 {
 	Q_D(const File);
-	if (idx < 0 || idx >= d->icons.size())
+	if (idx < 0 || idx >= d->iconRegions.size())
 		return QPixmap();
-	return d->icons.at(idx);
+	return d->card->imageAtlas()->pixmap(d->iconRegions.at(idx));
+}
+
+/**
+ * Get an icon's region in the card's ImageAtlas.
+ * @param idx Icon number.
+ * @return Icon region, or empty region on error.
+ */
+ImageAtlas::Region File::iconRegion(int idx) const
+{
+	Q_D(const File);
+	if (idx < 0 || idx >= d->iconRegions.size())
+		return ImageAtlas::Region();
+	return d->iconRegions.at(idx);
 }
 
 /**
@@ -680,6 +888,18 @@ int File::iconAnimMode(void) const
 	return (d->iconAnimMode & 0x4);
 }
 
+/**
+ * Have the banner and icon images been loaded?
+ * This is always true unless the card was opened
+ * with Card::OPEN_ASYNC.
+ * @return True if loaded; false if not.
+ */
+bool File::isImagesLoaded(void) const
+{
+	Q_D(const File);
+	return d->imagesLoaded;
+}
+
 /** Lost File information **/
 
 /**
@@ -722,18 +942,142 @@ int File::exportToFile(const QString &filename)
 
 /** Images **/
 
+/**
+ * GcImageWriter sink that writes to a QIODevice.
+ * Only one file can be written.
+ */
+class QIODeviceImageSink : public GcImageWriter::Sink
+{
+	public:
+		explicit QIODeviceImageSink(QIODevice *qioDevice)
+			: qioDevice(qioDevice)
+		{ }
+
+	private:
+		Q_DISABLE_COPY(QIODeviceImageSink)
+
+	public:
+		int open(int idx, int count) final
+		{
+			Q_UNUSED(idx);
+			return (count == 1 ? 0 : -EINVAL);
+		}
+
+		int write(const uint8_t *buf, size_t len) final
+		{
+			const qint64 ret = qioDevice->write(reinterpret_cast<const char*>(buf), len);
+			return (ret == (qint64)len ? 0 : -EIO);
+		}
+
+		int close(bool ok) final
+		{
+			Q_UNUSED(ok);
+			return 0;
+		}
+
+	private:
+		QIODevice *const qioDevice;
+};
+
+/**
+ * GcImageWriter sink that writes each file to a QFile.
+ * If multiple files are written, the file number is
+ * appended to the filename.
+ */
+class QFileImageSink : public GcImageWriter::Sink
+{
+	public:
+		QFileImageSink(const QString &filenameNoExt, const char *ext)
+			: filenameNoExt(filenameNoExt)
+			, ext(ext)
+		{ }
+
+	private:
+		Q_DISABLE_COPY(QFileImageSink)
+
+	public:
+		int open(int idx, int count) final
+		{
+			QString filename = filenameNoExt;
+			if (count > 1) {
+				// Multiple files.
+				// Append the file number.
+				char tmp[8];
+				snprintf(tmp, sizeof(tmp), "%02d", idx+1);
+				filename += QChar(L'.') + QLatin1String(tmp);
+			}
+
+			// Append the file extension.
+			if (ext)
+				filename += QChar(L'.') + QLatin1String(ext);
+
+			file.setFileName(filename);
+			if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+				// Error opening the file.
+				// TODO: Convert QFileError to a POSIX error code.
+				// TODO: Delete previous files?
+				return -EIO;
+			}
+			return 0;
+		}
+
+		int write(const uint8_t *buf, size_t len) final
+		{
+			const qint64 ret = file.write(reinterpret_cast<const char*>(buf), len);
+			return (ret == (qint64)len ? 0 : -EIO);
+		}
+
+		int close(bool ok) final
+		{
+			if (!file.isOpen())
+				return 0;
+
+			file.close();
+			if (!ok) {
+				// Error saving the file.
+				file.remove();
+			}
+			return 0;
+		}
+
+	private:
+		const QString filenameNoExt;
+		const char *const ext;
+		QFile file;
+};
+
+/**
+ * Get the GcImageWriter for the current thread.
+ * The writer is reused for all images saved on this thread,
+ * so its scratch buffers are only allocated once when
+ * extracting images from many files.
+ * @return GcImageWriter.
+ */
+static GcImageWriter *threadImageWriter(void)
+{
+	static QThreadStorage<GcImageWriter*> writers;
+	if (!writers.hasLocalData()) {
+		writers.setLocalData(new GcImageWriter());
+	}
+	return writers.localData();
+}
+
 /**
  * Save the banner image.
+ * NOTE: If the card was opened with Card::OPEN_ASYNC,
+ * call Card::waitForLoad() first.
  * @param filenameNoExt Filename for the GCI file, sans extension.
+ * @param compression Compression profile.
  * @return 0 on success; non-zero on error.
  * TODO: Error code constants.
  */
-int File::saveBanner(const QString &filenameNoExt) const
+int File::saveBanner(const QString &filenameNoExt,
+	GcImageWriter::CompressionProfile compression) const
 {
 	Q_D(const File);
 	// TODO: Make GcImageWriter more generic and move the
 	// internal image data here.
-	if (d->banner.isNull())
+	if (d->bannerRegion.isNull())
 		return -EINVAL;
 
 	// Append the correct extension.
@@ -750,7 +1094,7 @@ int File::saveBanner(const QString &filenameNoExt) const
 	}
 
 	// Write the banner image.
-	int ret = saveBanner(&file);
+	int ret = saveBanner(&file, compression);
 	file.close();
 
 	if (ret != 0) {
@@ -763,39 +1107,42 @@ int File::saveBanner(const QString &filenameNoExt) const
 
 /**
  * Save the banner image.
+ * NOTE: If the card was opened with Card::OPEN_ASYNC,
+ * call Card::waitForLoad() first.
+ * The image is written as it's encoded, so the QIODevice
+ * may contain partial data if an error occurs.
  * @param qioDevice QIODevice to write the banner image to.
+ * @param compression Compression profile.
  * @return 0 on success; non-zero on error.
  * TODO: Error code constants.
  */
-int File::saveBanner(QIODevice *qioDevice) const
+int File::saveBanner(QIODevice *qioDevice,
+	GcImageWriter::CompressionProfile compression) const
 {
 	Q_D(const File);
 	if (!d->gcBanner)
 		return -EINVAL;
 
-	GcImageWriter gcImageWriter;
-	int ret = gcImageWriter.write(d->gcBanner, GcImageWriter::IMGF_PNG);
-	if (!ret) {
-		const vector<uint8_t> *pngData = gcImageWriter.memBuffer();
-		ret = qioDevice->write(reinterpret_cast<const char*>(pngData->data()), pngData->size());
-		if (ret != (qint64)pngData->size())
-			return -EIO;
-		ret = 0;
-	}
-
-	// Saved the banner image.
-	return ret;
+	// The image is written directly to the QIODevice.
+	QIODeviceImageSink sink(qioDevice);
+	GcImageWriter *const gcImageWriter = threadImageWriter();
+	gcImageWriter->setCompressionProfile(compression);
+	return gcImageWriter->write(d->gcBanner, GcImageWriter::IMGF_PNG, &sink);
 }
 
 /**
  * Save the icon.
+ * NOTE: If the card was opened with Card::OPEN_ASYNC,
+ * call Card::waitForLoad() first.
  * @param filenameNoExt Filename for the icon, sans extension.
  * @param animImgf Animated image format to use for animated icons.
+ * @param compression Compression profile.
  * @return 0 on success; non-zero on error.
  * TODO: Error code constants.
  */
 int File::saveIcon(const QString &filenameNoExt,
-	GcImageWriter::AnimImageFormat animImgf) const
+	GcImageWriter::AnimImageFormat animImgf,
+	GcImageWriter::CompressionProfile compression) const
 {
 	Q_D(const File);
 	if (d->gcIcons.isEmpty())
@@ -813,7 +1160,10 @@ int File::saveIcon(const QString &filenameNoExt,
 
 	// NOTE: Due to PNG_FPF saving multiple files, we can't simply
 	// call a version of saveIcon() that takes a QIODevice.
-	GcImageWriter gcImageWriter;
+	// The sink opens a new file for each image file.
+	QFileImageSink sink(filenameNoExt, ext);
+	GcImageWriter *const gcImageWriter = threadImageWriter();
+	gcImageWriter->setCompressionProfile(compression);
 	int ret;
 	if (d->gcIcons.size() > 1) {
 		// Animated icon.
@@ -845,52 +1195,10 @@ int File::saveIcon(const QString &filenameNoExt,
 			}
 		}
 
-		ret = gcImageWriter.write(&gcImages, &gcIconDelays, animImgf);
+		ret = gcImageWriter->write(&gcImages, &gcIconDelays, animImgf, &sink);
 	} else {
 		// Static icon.
-		ret = gcImageWriter.write(d->gcIcons.at(0), GcImageWriter::IMGF_PNG);
-	}
-
-	if (ret != 0) {
-		// Error writing the icon.
-		return ret;
-	}
-
-	// Icon written successfully.
-	// Save it to a file.
-	for (int i = 0; i < gcImageWriter.numFiles(); i++) {
-		QString filename = filenameNoExt;
-		if (gcImageWriter.numFiles() > 1) {
-			// Multiple files.
-			// Append the file number.
-			char tmp[8];
-			snprintf(tmp, sizeof(tmp), "%02d", i+1);
-			filename += QChar(L'.') + QLatin1String(tmp);
-		}
-
-		// Append the file extension.
-		if (ext)
-			filename += QChar(L'.') + QLatin1String(ext);
-
-		QFile file(filename);
-		if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-			// Error opening the file.
-			// TODO: Convert QFileError to a POSIX error code.
-			// TODO: Delete previous files?
-			return -EIO;
-		}
-
-		const vector<uint8_t> *pngData = gcImageWriter.memBuffer(i);
-		ret = file.write(reinterpret_cast<const char*>(pngData->data()), pngData->size());
-		file.close();
-
-		if (ret != (qint64)pngData->size()) {
-			// Error saving the icon.
-			file.remove();
-			return -EIO;
-		}
-
-		ret = 0;
+		ret = gcImageWriter->write(d->gcIcons.at(0), GcImageWriter::IMGF_PNG, &sink);
 	}
 
 	return ret;
@@ -949,7 +1257,7 @@ Checksum::ChkAlgorithm File::checksumAlgorithm(void) const
 Checksum::ChkStatus File::checksumStatus(void) const
 {
 	Q_D(const File);
-	return Checksum::ChecksumStatus(d->checksumValues.toStdVector());
+	return d->checksumStatus;
 }
 
 /**
@@ -961,13 +1269,7 @@ Checksum::ChkStatus File::checksumStatus(void) const
 QVector<QString> File::checksumValuesFormatted(void) const
 {
 	Q_D(const File);
-	vector<string> vs = Checksum::ChecksumValuesFormatted(d->checksumValues.toStdVector());
-	QVector<QString> ret;
-	ret.reserve((int)vs.size());
-	for (auto iter = vs.cbegin(); iter != vs.cend(); ++iter) {
-		ret.append(QString::fromStdString(*iter));
-	}
-	return ret;
+	return d->checksumValuesFormatted;
 }
 
 /** Writing functions. **/
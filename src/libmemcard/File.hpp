@@ -10,6 +10,7 @@
 #define __LIBMEMCARD_FILE_HPP__
 
 #include "Card.hpp"
+#include "ImageAtlas.hpp"
 
 // TODO: "Generic" image writer?
 #include "GcImageWriter.hpp"
@@ -88,6 +89,8 @@ class File : public QObject
 		Q_DECLARE_PRIVATE(File)
 	private:
 		Q_DISABLE_COPY(File)
+		friend class FileImageLoaderPrivate;
+		friend class ChecksumVerifierPrivate;
 
 	public:
 		/** File information **/
@@ -131,10 +134,18 @@ class File : public QObject
 
 		/**
 		 * Get the last modified time.
+		 * NOTE: This constructs a QDateTime, so it should only
+		 * be used for display. Use mtimeUnix() for comparisons.
 		 * @return Last modified time.
 		 */
 		QDateTime mtime(void) const;
 
+		/**
+		 * Get the last modified time as a Unix timestamp.
+		 * @return Last modified time. (Unix timestamp, UTC; TimeFuncs::INVALID_TIME if not available)
+		 */
+		int64_t mtimeUnix(void) const;
+
 		/**
 		 * Get the file's description.
 		 * This is for UI purposes only.
@@ -184,6 +195,12 @@ class File : public QObject
 		 */
 		QPixmap banner(void) const;
 
+		/**
+		 * Get the banner image's region in the card's ImageAtlas.
+		 * @return Banner region, or empty region if there's no banner.
+		 */
+		ImageAtlas::Region bannerRegion(void) const;
+
 		/**
 		 * Get the number of icons in the file.
 		 * @return Number of icons.
@@ -197,6 +214,13 @@ class File : public QObject
 		 */
 		QPixmap icon(int idx) const;
 
+		/**
+		 * Get an icon's region in the card's ImageAtlas.
+		 * @param idx Icon number.
+		 * @return Icon region, or empty region on error.
+		 */
+		ImageAtlas::Region iconRegion(int idx) const;
+
 		/**
 		 * Get the delay for a given icon.
 		 * FIXME: Use system-independent values.
@@ -214,6 +238,29 @@ class File : public QObject
 		 */
 		int iconAnimMode(void) const;
 
+		/**
+		 * Have the banner and icon images been loaded?
+		 * This is always true unless the card was opened
+		 * with Card::OPEN_ASYNC.
+		 * @return True if loaded; false if not.
+		 */
+		bool isImagesLoaded(void) const;
+
+	signals:
+		/**
+		 * The banner and icon images have changed.
+		 * This is emitted when the images are loaded
+		 * in the background. (Card::OPEN_ASYNC)
+		 */
+		void imagesChanged(void);
+
+		/**
+		 * The checksum has been verified.
+		 * This is emitted when the checksum is verified
+		 * in the background. (Card::setChecksumDefs())
+		 */
+		void checksumChanged(void);
+
 	public:
 		/** Lost File information **/
 
@@ -253,29 +300,43 @@ class File : public QObject
 
 		/**
 		 * Save the banner image.
+		 * NOTE: If the card was opened with Card::OPEN_ASYNC,
+		 * call Card::waitForLoad() first.
 		 * @param filenameNoExt Filename for the banner image, sans extension.
+		 * @param compression Compression profile.
 		 * @return 0 on success; non-zero on error.
 		 * TODO: Error code constants.
 		 */
-		int saveBanner(const QString &filenameNoExt) const;
+		int saveBanner(const QString &filenameNoExt,
+			GcImageWriter::CompressionProfile compression = GcImageWriter::COMPRESSION_DEFAULT) const;
 
 		/**
 		 * Save the banner image.
+		 * NOTE: If the card was opened with Card::OPEN_ASYNC,
+		 * call Card::waitForLoad() first.
+		 * The image is written as it's encoded, so the QIODevice
+		 * may contain partial data if an error occurs.
 		 * @param qioDevice QIODevice to write the banner image to.
+		 * @param compression Compression profile.
 		 * @return 0 on success; non-zero on error.
 		 * TODO: Error code constants.
 		 */
-		int saveBanner(QIODevice *qioDevice) const;
+		int saveBanner(QIODevice *qioDevice,
+			GcImageWriter::CompressionProfile compression = GcImageWriter::COMPRESSION_DEFAULT) const;
 
 		/**
 		 * Save the icon.
+		 * NOTE: If the card was opened with Card::OPEN_ASYNC,
+		 * call Card::waitForLoad() first.
 		 * @param filenameNoExt Filename for the icon, sans extension.
 		 * @param animImgf Animated image format for animated icons.
+		 * @param compression Compression profile.
 		 * @return 0 on success; non-zero on error.
 		 * TODO: Error code constants.
 		 */
 		int saveIcon(const QString &filenameNoExt,
-			     GcImageWriter::AnimImageFormat animImgf) const;
+			     GcImageWriter::AnimImageFormat animImgf,
+			     GcImageWriter::CompressionProfile compression = GcImageWriter::COMPRESSION_DEFAULT) const;
 
 	public:
 		/** Checksums **/
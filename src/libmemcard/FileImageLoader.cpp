@@ -0,0 +1,393 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * FileImageLoader.cpp: Background banner and icon loader.                 *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "FileImageLoader.hpp"
+
+#include "Card.hpp"
+#include "Card_p.hpp"
+#include "File.hpp"
+#include "File_p.hpp"
+
+// Qt includes.
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
+
+/** FileImageLoaderPrivate **/
+
+class FileImageLoaderPrivate
+{
+	public:
+		FileImageLoaderPrivate(FileImageLoader *q, Card *card);
+		~FileImageLoaderPrivate();
+
+	protected:
+		FileImageLoader *const q_ptr;
+		Q_DECLARE_PUBLIC(FileImageLoader)
+	private:
+		Q_DISABLE_COPY(FileImageLoaderPrivate)
+
+	public:
+		Card *const card;
+
+		// Worker threads.
+		QThreadPool pool;
+
+		// Load generation.
+		// This is incremented by cancel(). Results from
+		// older generations are discarded.
+		int generation;
+
+		// Number of files queued in the current generation.
+		int pending;
+
+		// Was a load in progress when files were removed?
+		bool wasLoading;
+
+		// Row insert start/end indexes.
+		int insertStart;
+		int insertEnd;
+
+		/**
+		 * Decoded images from a worker thread.
+		 */
+		struct Result {
+			int generation;
+			File *file;
+			FilePrivate::DecodedImages images;
+		};
+
+		// Decoded images waiting to be applied.
+		// Protected by resultsMutex.
+		QMutex resultsMutex;
+		QVector<Result*> results;
+
+		/**
+		 * Queue a file for loading.
+		 * Does nothing if the file's images are already loaded.
+		 * @param file File.
+		 */
+		void queue(File *file);
+
+		/**
+		 * Queue all files on the card that haven't been loaded yet.
+		 */
+		void queueAll(void);
+
+		/**
+		 * Discard all results that haven't been applied yet.
+		 */
+		void discardResults(void);
+
+		/**
+		 * Apply all results from the current generation.
+		 * This must be called from the GUI thread.
+		 */
+		void applyResults(void);
+
+		/**
+		 * All pending files have been loaded.
+		 * Releases the card's prefetched blocks, which the
+		 * worker threads may have been reading, and emits
+		 * Card::loadFinished().
+		 */
+		void finished(void);
+};
+
+/**
+ * Task to decode a file's images on a worker thread.
+ */
+class FileImageLoadTask : public QRunnable
+{
+	public:
+		FileImageLoadTask(FileImageLoader *loader, FileImageLoaderPrivate *d,
+				  File *file, FilePrivate *fileD)
+			: loader(loader)
+			, d(d)
+			, file(file)
+			, fileD(fileD)
+			, generation(d->generation)
+		{ }
+
+	private:
+		Q_DISABLE_COPY(FileImageLoadTask)
+
+	public:
+		void run(void) final
+		{
+			FileImageLoaderPrivate::Result *result = new FileImageLoaderPrivate::Result;
+			result->generation = generation;
+			result->file = file;
+			fileD->decodeImages(&result->images);
+
+			bool wasEmpty;
+			{
+				QMutexLocker locker(&d->resultsMutex);
+				wasEmpty = d->results.isEmpty();
+				d->results.append(result);
+			}
+
+			// Only one notification is needed for
+			// results that arrive in quick succession.
+			if (wasEmpty) {
+				QMetaObject::invokeMethod(loader, "resultsReady_slot", Qt::QueuedConnection);
+			}
+		}
+
+	private:
+		FileImageLoader *const loader;
+		FileImageLoaderPrivate *const d;
+		File *const file;
+		FilePrivate *const fileD;
+		const int generation;
+};
+
+FileImageLoaderPrivate::FileImageLoaderPrivate(FileImageLoader *q, Card *card)
+	: q_ptr(q)
+	, card(card)
+	, generation(0)
+	, pending(0)
+	, wasLoading(false)
+	, insertStart(-1)
+	, insertEnd(-1)
+{ }
+
+FileImageLoaderPrivate::~FileImageLoaderPrivate()
+{
+	pool.clear();
+	pool.waitForDone();
+	discardResults();
+}
+
+/**
+ * Queue a file for loading.
+ * Does nothing if the file's images are already loaded.
+ * @param file File.
+ */
+void FileImageLoaderPrivate::queue(File *file)
+{
+	if (!file)
+		return;
+	FilePrivate *const fileD = file->d_func();
+	if (fileD->imagesLoaded)
+		return;
+
+	Q_Q(FileImageLoader);
+	pending++;
+	pool.start(new FileImageLoadTask(q, this, file, fileD));
+}
+
+/**
+ * Queue all files on the card that haven't been loaded yet.
+ */
+void FileImageLoaderPrivate::queueAll(void)
+{
+	const int count = card->fileCount();
+	for (int i = 0; i < count; i++) {
+		queue(card->getFile(i));
+	}
+}
+
+/**
+ * Discard all results that haven't been applied yet.
+ */
+void FileImageLoaderPrivate::discardResults(void)
+{
+	QMutexLocker locker(&resultsMutex);
+	qDeleteAll(results);
+	results.clear();
+}
+
+/**
+ * Apply all results from the current generation.
+ * This must be called from the GUI thread.
+ */
+void FileImageLoaderPrivate::applyResults(void)
+{
+	QVector<Result*> ready;
+	{
+		QMutexLocker locker(&resultsMutex);
+		ready.swap(results);
+	}
+
+	bool loaded = false;
+	foreach (Result *result, ready) {
+		if (result->generation == generation) {
+			// Apply the images.
+			File *const file = result->file;
+			file->d_func()->applyImages(&result->images);
+			pending--;
+			loaded = true;
+
+			emit file->imagesChanged();
+			const int idx = card->getFiles().indexOf(file);
+			if (idx >= 0) {
+				emit card->fileChanged(idx);
+			}
+		}
+		delete result;
+	}
+
+	if (loaded && pending == 0) {
+		// All files have been loaded.
+		finished();
+	}
+}
+
+/**
+ * All pending files have been loaded.
+ * Releases the card's prefetched blocks, which the
+ * worker threads may have been reading, and emits
+ * Card::loadFinished().
+ */
+void FileImageLoaderPrivate::finished(void)
+{
+	card->d_func()->clearPrefetch();
+	emit card->loadFinished();
+}
+
+/** FileImageLoader **/
+
+FileImageLoader::FileImageLoader(Card *card)
+	: super(card)
+	, d_ptr(new FileImageLoaderPrivate(this, card))
+{
+	connect(card, &Card::filesAboutToBeInserted,
+		this, &FileImageLoader::card_filesAboutToBeInserted_slot);
+	connect(card, &Card::filesInserted,
+		this, &FileImageLoader::card_filesInserted_slot);
+	connect(card, &Card::filesAboutToBeRemoved,
+		this, &FileImageLoader::card_filesAboutToBeRemoved_slot);
+	connect(card, &Card::filesRemoved,
+		this, &FileImageLoader::card_filesRemoved_slot);
+}
+
+FileImageLoader::~FileImageLoader()
+{
+	Q_D(FileImageLoader);
+	delete d;
+}
+
+/**
+ * Are any files still being loaded?
+ * @return True if loading; false if not.
+ */
+bool FileImageLoader::isLoading(void) const
+{
+	Q_D(const FileImageLoader);
+	return (d->pending > 0);
+}
+
+/**
+ * Cancel all pending loads and wait for
+ * running loads to finish.
+ * Results from running loads are discarded.
+ */
+void FileImageLoader::cancel(void)
+{
+	Q_D(FileImageLoader);
+	d->pool.clear();
+	d->pool.waitForDone();
+	d->discardResults();
+	d->generation++;
+	d->pending = 0;
+}
+
+/**
+ * Wait for all pending loads to finish
+ * and apply their results.
+ * This must be called from the GUI thread.
+ */
+void FileImageLoader::waitForDone(void)
+{
+	Q_D(FileImageLoader);
+	d->pool.waitForDone();
+	d->applyResults();
+}
+
+/** Private slots. **/
+
+/**
+ * Files are about to be added to the Card.
+ * @param start First file index.
+ * @param end Last file index.
+ */
+void FileImageLoader::card_filesAboutToBeInserted_slot(int start, int end)
+{
+	Q_D(FileImageLoader);
+	d->insertStart = start;
+	d->insertEnd = end;
+}
+
+/**
+ * Files have been added to the Card.
+ */
+void FileImageLoader::card_filesInserted_slot(void)
+{
+	Q_D(FileImageLoader);
+	if (d->insertStart < 0 || d->insertEnd < 0)
+		return;
+
+	for (int i = d->insertStart; i <= d->insertEnd; i++) {
+		d->queue(d->card->getFile(i));
+	}
+
+	// Reset the row insert start/end indexes.
+	d->insertStart = -1;
+	d->insertEnd = -1;
+
+	if (d->pending == 0) {
+		// All of the new files were already loaded.
+		d->finished();
+	}
+}
+
+/**
+ * Files are about to be removed from the Card.
+ * @param start First file index.
+ * @param end Last file index.
+ */
+void FileImageLoader::card_filesAboutToBeRemoved_slot(int start, int end)
+{
+	Q_UNUSED(start);
+	Q_UNUSED(end);
+
+	// The files will be deleted after this signal,
+	// so all workers must be stopped first.
+	// Files that weren't removed will be requeued
+	// once the removal is complete.
+	Q_D(FileImageLoader);
+	d->wasLoading = isLoading();
+	cancel();
+}
+
+/**
+ * Files have been removed from the Card.
+ */
+void FileImageLoader::card_filesRemoved_slot(void)
+{
+	Q_D(FileImageLoader);
+	d->queueAll();
+	if (d->wasLoading && d->pending == 0) {
+		// Nothing left to load.
+		d->finished();
+	}
+	d->wasLoading = false;
+}
+
+/**
+ * Decoded images are ready to be applied.
+ * This is called from the worker threads via a queued connection.
+ */
+void FileImageLoader::resultsReady_slot(void)
+{
+	Q_D(FileImageLoader);
+	d->applyResults();
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * FileImageLoader.hpp: Background banner and icon loader.                 *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_FILEIMAGELOADER_HPP__
+#define __LIBMEMCARD_FILEIMAGELOADER_HPP__
+
+// Qt includes.
+#include <QtCore/QObject>
+
+class Card;
+class File;
+
+/**
+ * Background banner and icon loader.
+ *
+ * Used by Card if the card was opened with Card::OPEN_ASYNC.
+ * Images are decoded on worker threads and applied to the
+ * File objects on the GUI thread. Card::fileChanged() is emitted
+ * as each file finishes, and Card::loadFinished() is emitted
+ * once all pending files are done.
+ *
+ * Files added to the card after it's opened (e.g. when the
+ * active directory table is changed) are loaded automatically.
+ *
+ * NOTE: This must be deleted before the Card's private class,
+ * since the worker threads access the card's file system tables.
+ */
+class FileImageLoaderPrivate;
+class FileImageLoader : public QObject
+{
+	Q_OBJECT
+	typedef QObject super;
+
+	public:
+		explicit FileImageLoader(Card *card);
+		virtual ~FileImageLoader();
+
+	protected:
+		FileImageLoaderPrivate *const d_ptr;
+		Q_DECLARE_PRIVATE(FileImageLoader)
+	private:
+		Q_DISABLE_COPY(FileImageLoader)
+
+	public:
+		/**
+		 * Are any files still being loaded?
+		 * @return True if loading; false if not.
+		 */
+		bool isLoading(void) const;
+
+		/**
+		 * Cancel all pending loads and wait for
+		 * running loads to finish.
+		 * Results from running loads are discarded.
+		 */
+		void cancel(void);
+
+		/**
+		 * Wait for all pending loads to finish
+		 * and apply their results.
+		 * This must be called from the GUI thread.
+		 */
+		void waitForDone(void);
+
+	private slots:
+		/**
+		 * Files are about to be added to the Card.
+		 * @param start First file index.
+		 * @param end Last file index.
+		 */
+		void card_filesAboutToBeInserted_slot(int start, int end);
+
+		/**
+		 * Files have been added to the Card.
+		 */
+		void card_filesInserted_slot(void);
+
+		/**
+		 * Files are about to be removed from the Card.
+		 * @param start First file index.
+		 * @param end Last file index.
+		 */
+		void card_filesAboutToBeRemoved_slot(int start, int end);
+
+		/**
+		 * Files have been removed from the Card.
+		 */
+		void card_filesRemoved_slot(void);
+
+		/**
+		 * Decoded images are ready to be applied.
+		 * This is called from the worker threads via a queued connection.
+		 */
+		void resultsReady_slot(void);
+};
+
+#endif /* __LIBMEMCARD_FILEIMAGELOADER_HPP__ */
@@ -18,6 +18,9 @@ class GcImage;
 // C includes.
 #include <stdint.h>
 
+// Qt includes.
+#include <QtGui/QImage>
+
 class FilePrivate
 {
 	public:
@@ -46,7 +49,7 @@ class FilePrivate
 		QString filename;	// Internal filename.
 		// TODO: Add a QFlags indicating which fields are valid.
 		QString gameID;		// Game ID, e.g. GALE01
-		QDateTime mtime;	// Last Modified time.
+		int64_t mtime;		// Last Modified time. (Unix timestamp, UTC)
 		QString description;	// Description.
 		uint32_t mode;		// Mode. (attributes, permissions)
 		// Size is calculated using fatEntries.size().
@@ -59,9 +62,14 @@ class FilePrivate
 		QVector<uint8_t> iconSpeed;
 		uint8_t iconAnimMode;
 
-		// QPixmap images.
-		QPixmap banner;
-		QVector<QPixmap> icons;
+		// Banner and icon images in the card's ImageAtlas.
+		ImageAtlas::Region bannerRegion;
+		QVector<ImageAtlas::Region> iconRegions;
+
+		// Have the images been loaded?
+		// If the card was opened with Card::OPEN_ASYNC,
+		// this is false until FileImageLoader is done.
+		bool imagesLoaded;
 
 		// Lost File information.
 		bool lostFile;
@@ -85,6 +93,15 @@ class FilePrivate
 		 */
 		QByteArray loadFileData(void);
 
+		/**
+		 * Load the file data into an existing buffer.
+		 * The buffer is resized as needed, so it can be
+		 * reused for multiple files without reallocating.
+		 * @param fileData	[out] Buffer for the file data.
+		 * @return True on success; false on error.
+		 */
+		bool loadFileData(QByteArray &fileData);
+
 		/**
 		 * Read the specified range from the file.
 		 * @param blockStart First block.
@@ -93,6 +110,16 @@ class FilePrivate
 		 */
 		QByteArray readBlocks(uint16_t blockStart, int len);
 
+		/**
+		 * Read the specified byte range from the file.
+		 * Only the blocks containing the range are read.
+		 * @param offset Starting offset, in bytes.
+		 * @param len Length, in bytes.
+		 * @return QByteArray with file data. This may be shorter than len
+		 * if the range extends past the end of the file.
+		 */
+		QByteArray readData(uint32_t offset, int len);
+
 		/**
 		 * Strip invalid DOS characters from a filename.
 		 * @param filename Filename.
@@ -110,13 +137,69 @@ class FilePrivate
 		 */
 		static QString decodeText_SJISorCP1252(const char *str, int len);
 
+		/**
+		 * Decode text using the specified encoding.
+		 * Text is truncated at the first NULL character.
+		 * @param str Text data.
+		 * @param len Maximum length of str.
+		 * @param encoding Text encoding. (Unknown is handled as cp1252.)
+		 * @return Unicode QString.
+		 */
+		static QString decodeText(const char *str, int len, Card::Encoding encoding);
+
 		/** Images **/
 
 		/**
 		 * Load the banner and icon images.
+		 * If the card was opened with Card::OPEN_ASYNC,
+		 * this does nothing; FileImageLoader will load
+		 * the images later.
 		 */
 		void loadImages(void);
 
+		/**
+		 * Decoded banner and icon images.
+		 * NOTE: The QImages use the GcImage data.
+		 */
+		struct DecodedImages {
+			GcImage *gcBanner;
+			QVector<GcImage*> gcIcons;
+			QImage banner;
+			QVector<QImage> icons;
+
+			DecodedImages()
+				: gcBanner(nullptr) { }
+			~DecodedImages();
+
+			private:
+				Q_DISABLE_COPY(DecodedImages)
+		};
+
+		/**
+		 * Decode the banner and icon images.
+		 *
+		 * This function is thread-safe as long as the card's
+		 * file list isn't modified while it's running.
+		 * NOTE: loadIconImages() sets iconSpeed and iconAnimMode.
+		 * These aren't used until the icons are applied.
+		 *
+		 * @param images	[out] Decoded images.
+		 */
+		void decodeImages(DecodedImages *images);
+
+		/**
+		 * Apply decoded banner and icon images.
+		 * This must be called from the GUI thread,
+		 * since it converts the images to QPixmap.
+		 * @param images	[in/out] Decoded images. (GcImages are taken over by FilePrivate.)
+		 */
+		void applyImages(DecodedImages *images);
+
+		/**
+		 * Remove the banner and icon images from the card's ImageAtlas.
+		 */
+		void releaseImages(void);
+
 		/**
 		 * Load the banner image.
 		 * @return GcImage containing the banner image, or nullptr on error.
@@ -135,10 +218,63 @@ class FilePrivate
 		QVector<Checksum::ChecksumDef> checksumDefs;
 		QVector<Checksum::ChecksumValue> checksumValues;
 
+		// Cached checksum status and formatted values.
+		// Updated by calculateChecksum().
+		Checksum::ChkStatus checksumStatus;
+		QVector<QString> checksumValuesFormatted;
+
 		/**
 		 * Calculate the file checksum.
+		 * This also updates the cached checksum status
+		 * and formatted checksum values.
 		 */
 		void calculateChecksum(void);
+
+		/**
+		 * Calculated checksum values.
+		 */
+		struct ChecksumResult {
+			QVector<Checksum::ChecksumValue> values;
+			Checksum::ChkStatus status;
+			QVector<QString> formatted;
+
+			ChecksumResult()
+				: status(Checksum::CHKST_UNKNOWN) { }
+		};
+
+		/**
+		 * Calculate the file checksum using the specified definitions.
+		 *
+		 * This function is thread-safe as long as the card's
+		 * file list isn't modified while it's running.
+		 * It doesn't modify the FilePrivate.
+		 *
+		 * @param checksumDefs	[in] Checksum definitions.
+		 * @param fileData	[in/out] Scratch buffer for the file data.
+		 * @param result	[out] Checksum result.
+		 */
+		void calculateChecksum(const QVector<Checksum::ChecksumDef> &checksumDefs,
+			QByteArray &fileData, ChecksumResult *result);
+
+		/**
+		 * Apply a calculated checksum.
+		 * This must be called from the GUI thread.
+		 * @param checksumDefs	[in] Checksum definitions used to calculate result.
+		 * @param result	[in/out] Checksum result. (Contents are taken over by FilePrivate.)
+		 */
+		void applyChecksum(const QVector<Checksum::ChecksumDef> &checksumDefs,
+			ChecksumResult *result);
+
+	private:
+		/**
+		 * Calculate the file checksum values.
+		 * Called by calculateChecksum().
+		 * @param checksumDefs	[in] Checksum definitions.
+		 * @param fileData	[in/out] File data. (Modified temporarily.)
+		 * @param values	[out] Checksum values.
+		 */
+		static void calculateChecksumValues(const QVector<Checksum::ChecksumDef> &checksumDefs,
+			QByteArray &fileData, QVector<Checksum::ChecksumValue> &values);
 };
 
 #endif /* __LIBMEMCARD_FILE_P_HPP__ */
@@ -85,8 +85,7 @@ int GciCardPrivate::open(const QString &filename)
 
 	// Load the directory entry.
 	// This is the first 64 bytes of the GCI file.
-	file->seek(0);
-	qint64 sz = file->read((char*)&dirEntry, sizeof(dirEntry));
+	qint64 sz = pread(&dirEntry, sizeof(dirEntry), 0);
 	if (sz != (qint64)sizeof(dirEntry)) {
 		// Error reading the card header.
 		this->errors |= Card::MCE_SHORT_READ;
@@ -144,12 +143,15 @@ GciCard::GciCard(QObject *parent)
  * Open an existing GCI file.
  * @param filename Filename.
  * @param parent Parent object.
+ * @param flags Open flags.
  * @return GciCard object, or nullptr on error.
  */
-GciCard *GciCard::open(const QString& filename, QObject *parent)
+GciCard *GciCard::open(const QString& filename, QObject *parent,
+	Card::OpenFlags flags)
 {
 	GciCard *const gciFile = new GciCard(parent);
 	GciCardPrivate *const d = gciFile->d_func();
+	d->setOpenFlags(flags);
 	d->open(filename);
 	// NOTE: GCI files aren't powers of two, so clear that error.
 	// TODO: Report a different incorrect size error. (Must be a multiple of 8 KiB + 64.)
@@ -42,9 +42,11 @@ class GciCard : public Card
 		 * Open an existing GCI file.
 		 * @param filename Filename.
 		 * @param parent Parent object.
+		 * @param flags Open flags.
 		 * @return GciCard object, or nullptr on error.
 		 */
-		static GciCard *open(const QString& filename, QObject *parent);
+		static GciCard *open(const QString& filename, QObject *parent,
+			Card::OpenFlags flags = Card::OpenFlags());
 
 	public:
 		/** File system **/
@@ -18,6 +18,10 @@
 
 // C++ includes.
 #include <limits>
+#include <memory>
+
+// Qt includes.
+#include <QtCore/QMultiHash>
 using std::list;
 
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
@@ -76,13 +80,26 @@ class GcnCardPrivate : public CardPrivate
 		card_bat *mc_bat;
 
 		/**
-		 * Used block map.
-		 * NOTE: This is only valid for regular files, not "lost" files.
-		 * Value indicates how many files are "using" that block.
-		 * Should be 0 for free, 1 for normal files,
-		 * and >1 for "lost" files that are overlapping other files.
+		 * Files that were loaded from a directory table,
+		 * but aren't in the current file list.
+		 *
+		 * When switching between DAT/BAT copies, files whose
+		 * directory entry and FAT chain haven't changed are
+		 * reused instead of being recreated, so their images
+		 * and checksums don't have to be reloaded.
+		 *
+		 * Key is from fileCacheKey(). Lost files aren't cached.
+		 */
+		QMultiHash<QByteArray, GcnFile*> fileCache;
+
+		/**
+		 * Get the file cache key for a directory entry.
+		 * @param dirEntry Directory entry.
+		 * @param fatEntries FAT entries.
+		 * @return File cache key.
 		 */
-		QVector<uint8_t> usedBlockMap;
+		static QByteArray fileCacheKey(const card_direntry *dirEntry,
+			const QVector<uint16_t> &fatEntries);
 
 	private:
 		/**
@@ -99,22 +116,28 @@ class GcnCardPrivate : public CardPrivate
 		int loadSysInfo(void);
 
 		/**
-		 * Load a directory table.
+		 * Load a directory table from the system area.
 		 * @param dat		[out] card_dat to store the directory table in.
+		 * @param sysArea	[in] System area buffer.
+		 * @param sysAreaLen	[in] Length of the system area buffer.
 		 * @param address	[in] Directory table address.
 		 * @param checksum	[out] Calculated checksum. (AddSubDual16)
 		 * @return 0 on success; non-zero on error.
 		 */
-		int loadDirTable(card_dat *dat, uint32_t address, uint32_t *checksum);
+		int loadDirTable(card_dat *dat, const uint8_t *sysArea, qint64 sysAreaLen,
+			uint32_t address, uint32_t *checksum);
 
 		/**
-		 * Load a block allocation table.
+		 * Load a block allocation table from the system area.
 		 * @param bat		[out] card_bat to store the block allocation table in.
+		 * @param sysArea	[in] System area buffer.
+		 * @param sysAreaLen	[in] Length of the system area buffer.
 		 * @param address	[in] Directory table address.
 		 * @param checksum	[out] Calculated checksum. (AddSubDual16)
 		 * @return 0 on success; non-zero on error.
 		 */
-		int loadBlockTable(card_bat *bat, uint32_t address, uint32_t *checksum);
+		int loadBlockTable(card_bat *bat, const uint8_t *sysArea, qint64 sysAreaLen,
+			uint32_t address, uint32_t *checksum);
 
 		/**
 		 * Determine which tables are active.
@@ -155,7 +178,27 @@ GcnCardPrivate::GcnCardPrivate(GcnCard *q)
 
 GcnCardPrivate::~GcnCardPrivate()
 {
-	// TODO: Remove this?
+	// Delete the cached files.
+	// NOTE: Files in lstFiles are deleted by CardPrivate.
+	qDeleteAll(fileCache);
+	fileCache.clear();
+}
+
+/**
+ * Get the file cache key for a directory entry.
+ * @param dirEntry Directory entry.
+ * @param fatEntries FAT entries.
+ * @return File cache key.
+ */
+QByteArray GcnCardPrivate::fileCacheKey(const card_direntry *dirEntry,
+	const QVector<uint16_t> &fatEntries)
+{
+	QByteArray key;
+	key.reserve(sizeof(*dirEntry) + (fatEntries.size() * sizeof(uint16_t)));
+	key.append(reinterpret_cast<const char*>(dirEntry), sizeof(*dirEntry));
+	key.append(reinterpret_cast<const char*>(fatEntries.constData()),
+		   fatEntries.size() * sizeof(uint16_t));
+	return key;
 }
 
 /**
@@ -310,12 +353,9 @@ int GcnCardPrivate::format(const QString &filename)
 
 	// Write everything to the file.
 	// TODO: Check for errors.
-	file->seek(0);
-	file->write((char*)&mc_header, sizeof(mc_header));
-	file->seek(1*blockSize);
-	file->write((char*)mc_dat_int, sizeof(mc_dat_int));
-	file->write((char*)mc_bat_int, sizeof(mc_bat_int));
-	file->flush();
+	pwrite(&mc_header, sizeof(mc_header), 0);
+	pwrite(mc_dat_int, sizeof(mc_dat_int), 1*blockSize);
+	pwrite(mc_bat_int, sizeof(mc_bat_int), 1*blockSize + sizeof(mc_dat_int));
 
 #if SYS_BYTEORDER != SYS_BIG_ENDIAN
 	// Un-byteswap the tables.
@@ -376,10 +416,8 @@ void GcnCardPrivate::resetUsedBlockMap(void)
 {
 	// Initialize the used block map.
 	// (The first 5 blocks are always used.)
-	usedBlockMap = QVector<uint8_t>(totalPhysBlocks, 0);
-	for (int i = 0; i < 5 && i < totalPhysBlocks; i++) {
-		usedBlockMap[i] = 1;
-	}
+	usedBlockMap.reset(totalPhysBlocks);
+	usedBlockMap.markUsed(0, 5);
 }
 
 /**
@@ -391,9 +429,14 @@ int GcnCardPrivate::loadSysInfo(void)
 	if (!file)
 		return -1;
 
+	// Read the entire system area at once.
+	// This includes the header, both directory tables,
+	// and both block allocation tables.
+	const qint64 sysAreaSize = (qint64)CARD_SYSAREA * blockSize;
+	std::unique_ptr<uint8_t[]> sysArea(new uint8_t[sysAreaSize]);
+	qint64 sz = pread(sysArea.get(), sysAreaSize, 0);
+
 	// Header.
-	file->seek(0);
-	qint64 sz = file->read((char*)&mc_header, sizeof(mc_header));
 	if (sz < (qint64)sizeof(mc_header)) {
 		// Error reading the card header.
 		this->errors |= Card::MCE_SHORT_READ;
@@ -431,6 +474,7 @@ int GcnCardPrivate::loadSysInfo(void)
 		checkTables();
 		return -2;
 	}
+	memcpy(&mc_header, sysArea.get(), sizeof(mc_header));
 
 	// Calculate the header checksum.
 	headerChecksumValue.actual = Checksum::AddInvDual16((uint16_t*)&mc_header, 0x1FC, Checksum::CHKENDIAN_BIG);
@@ -487,7 +531,8 @@ int GcnCardPrivate::loadSysInfo(void)
 	bat_info.valid = 0;
 	for (int i = 0; i < 2; i++) {
 		// Load the directory table.
-		int ret = loadDirTable(&mc_dat_int[i], DAT_addr[i], &mc_dat_chk_actual[i]);
+		int ret = loadDirTable(&mc_dat_int[i], sysArea.get(), sz,
+					   DAT_addr[i], &mc_dat_chk_actual[i]);
 		if (ret != 0) {
 			memset(&mc_dat_int[i], 0xFF, sizeof(mc_dat_int[i]));
 			// This checksum can never appear in a valid table.
@@ -506,7 +551,8 @@ int GcnCardPrivate::loadSysInfo(void)
 		}
 
 		// Load the block table.
-		ret = loadBlockTable(&mc_bat_int[i], BAT_addr[i], &mc_bat_chk_actual[i]);
+		ret = loadBlockTable(&mc_bat_int[i], sysArea.get(), sz,
+				     BAT_addr[i], &mc_bat_chk_actual[i]);
 		if (ret != 0) {
 			memset(&mc_bat_int[i], 0x00, sizeof(mc_bat_int[i]));
 			// This checksum can never appear in a valid table.
@@ -553,21 +599,23 @@ int GcnCardPrivate::loadSysInfo(void)
 }
 
 /**
- * Load a directory table.
+ * Load a directory table from the system area.
  * @param dat		[out] card_dat to store the directory table in.
+ * @param sysArea	[in] System area buffer.
+ * @param sysAreaLen	[in] Length of the system area buffer.
  * @param address	[in] Directory table address.
  * @param checksum	[out] Calculated checksum. (AddSubDual16)
  * @return 0 on success; non-zero on error.
  */
-int GcnCardPrivate::loadDirTable(card_dat *dat, uint32_t address, uint32_t *checksum)
+int GcnCardPrivate::loadDirTable(card_dat *dat, const uint8_t *sysArea, qint64 sysAreaLen,
+	uint32_t address, uint32_t *checksum)
 {
-	file->seek(address);
-	qint64 sz = file->read((char*)dat, sizeof(*dat));
-	if (sz < (qint64)sizeof(*dat)) {
+	if ((qint64)address + (qint64)sizeof(*dat) > sysAreaLen) {
 		// Error reading the directory table.
 		this->errors |= Card::MCE_SHORT_READ;
 		return -1;
 	}
+	memcpy(dat, &sysArea[address], sizeof(*dat));
 
 	// Calculate the checksums.
 	if (checksum != nullptr) {
@@ -600,21 +648,23 @@ int GcnCardPrivate::loadDirTable(card_dat *dat, uint32_t address, uint32_t *chec
 }
 
 /**
- * Load a block allocation table.
+ * Load a block allocation table from the system area.
  * @param bat		[out] card_bat to store the block allocation table in.
+ * @param sysArea	[in] System area buffer.
+ * @param sysAreaLen	[in] Length of the system area buffer.
  * @param address	[in] Directory table address.
  * @param checksum	[out] Calculated checksum. (AddSubDual16)
  * @return 0 on success; non-zero on error.
  */
-int GcnCardPrivate::loadBlockTable(card_bat *bat, uint32_t address, uint32_t *checksum)
+int GcnCardPrivate::loadBlockTable(card_bat *bat, const uint8_t *sysArea, qint64 sysAreaLen,
+	uint32_t address, uint32_t *checksum)
 {
-	file->seek(address);
-	qint64 sz = file->read((char*)bat, sizeof(*bat));
-	if (sz < (qint64)sizeof(*bat)) {
-		// Error reading the directory table.
+	if ((qint64)address + (qint64)sizeof(*bat) > sysAreaLen) {
+		// Error reading the block allocation table.
 		this->errors |= Card::MCE_SHORT_READ;
 		return -1;
 	}
+	memcpy(bat, &sysArea[address], sizeof(*bat));
 
 	// Calculate the checksums.
 	if (checksum != nullptr) {
@@ -742,10 +792,20 @@ void GcnCardPrivate::loadGcnFileList(void)
 	Q_Q(GcnCard);
 
 	// Clear the current GcnFile list.
+	// Regular files are moved to the file cache so they can be
+	// reused if the new tables have the same entries.
+	// Lost files are deleted.
 	int init_size = lstFiles.size();
 	if (init_size > 0)
 		emit q->filesAboutToBeRemoved(0, (init_size - 1));
-	qDeleteAll(lstFiles);
+	foreach (File *file, lstFiles) {
+		GcnFile *const gcnFile = qobject_cast<GcnFile*>(file);
+		if (!gcnFile || gcnFile->isLostFile() || !gcnFile->dirEntry()) {
+			delete file;
+			continue;
+		}
+		fileCache.insert(fileCacheKey(gcnFile->dirEntry(), gcnFile->fatEntries()), gcnFile);
+	}
 	lstFiles.clear();
 	if (init_size > 0)
 		emit q->filesRemoved();
@@ -753,10 +813,9 @@ void GcnCardPrivate::loadGcnFileList(void)
 	// Reset the used block map.
 	resetUsedBlockMap();
 
-	QVector<File*> lstFiles_new;
-	lstFiles_new.reserve(NUM_ELEMENTS(mc_dat->entries));
-
-	// Byteswap the directory table contents.
+	// Find the valid directory entries.
+	QVector<int> validEntries;
+	validEntries.reserve(NUM_ELEMENTS(mc_dat->entries));
 	for (int i = 0; i < NUM_ELEMENTS(mc_dat->entries); i++) {
 		const card_direntry *dirEntry = &mc_dat->entries[i];
 
@@ -771,8 +830,56 @@ void GcnCardPrivate::loadGcnFileList(void)
 		if (!dirEntry->filename[0])
 			continue;
 
+		validEntries.append(i);
+	}
+
+	// Check the file cache for each entry.
+	QVector<GcnFile*> cachedFiles(validEntries.size(), nullptr);
+	QVector<QVector<uint16_t> > fatChains(validEntries.size());
+	for (int n = 0; n < validEntries.size(); n++) {
+		const card_direntry *dirEntry = &mc_dat->entries[validEntries.at(n)];
+		fatChains[n] = GcnFile::fatChain(dirEntry, mc_bat, totalUserBlocks);
+		cachedFiles[n] = fileCache.take(fileCacheKey(dirEntry, fatChains.at(n)));
+	}
+
+	// Prefetch the comment, banner, and icon blocks for all
+	// files that weren't cached. GcnFile's constructor reads
+	// these, so batching them here replaces many small reads
+	// with a few larger ones.
+	// NOTE: With Card::OPEN_ASYNC, the banner and icon blocks
+	// are read by FileImageLoader's worker threads, so the
+	// prefetched blocks are kept until it's finished.
+	QVector<uint16_t> prefetchBlocks;
+	prefetchBlocks.reserve(validEntries.size() * 4);
+	for (int n = 0; n < validEntries.size(); n++) {
+		if (cachedFiles.at(n))
+			continue;
+		const card_direntry *dirEntry = &mc_dat->entries[validEntries.at(n)];
+		const QVector<uint16_t> &fatEntries = fatChains.at(n);
+		const QVector<uint16_t> metaBlocks = GcnFile::metadataFileBlocks(dirEntry, blockSize);
+		foreach (uint16_t fileBlock, metaBlocks) {
+			if (fileBlock < fatEntries.size()) {
+				prefetchBlocks.append(fatEntries.at(fileBlock));
+			}
+		}
+	}
+	prefetch(prefetchBlocks);
+
+	QVector<File*> lstFiles_new;
+	lstFiles_new.reserve(validEntries.size());
+
+	for (int n = 0; n < validEntries.size(); n++) {
+		const int i = validEntries.at(n);
+		const card_direntry *dirEntry = &mc_dat->entries[i];
+
 		// Valid directory entry.
-		GcnFile *mcFile = new GcnFile(q, dirEntry, mc_bat);
+		// Reuse the cached file if it's identical.
+		// NOTE: A cached file's dirEntry may point to the other
+		// directory table, but its contents are identical.
+		GcnFile *mcFile = cachedFiles.at(n);
+		if (!mcFile) {
+			mcFile = new GcnFile(q, dirEntry, mc_bat);
+		}
 		lstFiles_new.append(mcFile);
 
 		// Mark the file's blocks as used.
@@ -781,8 +888,7 @@ void GcnCardPrivate::loadGcnFileList(void)
 			if (block >= 5 && block < usedBlockMap.size()) {
 				// Valid block.
 				// Increment its entry in the usedBlockMap.
-				if (usedBlockMap[block] < std::numeric_limits<uint8_t>::max())
-					usedBlockMap[block]++;
+				usedBlockMap.ref(block);
 			} else {
 				// Invalid block.
 				// TODO: Store an error value somewhere.
@@ -793,10 +899,21 @@ void GcnCardPrivate::loadGcnFileList(void)
 
 	if (!lstFiles_new.isEmpty()) {
 		// Files have been added to the memory card.
+		// If the card was opened with Card::OPEN_ASYNC,
+		// FileImageLoader will start loading their images.
 		emit q->filesAboutToBeInserted(0, (lstFiles_new.size() - 1));
 		// NOTE: QVector::swap() was added in qt-4.8.
 		lstFiles = lstFiles_new;
 		emit q->filesInserted();
+	} else if (imageLoader) {
+		// No files, so there's nothing to load.
+		clearPrefetch();
+		emit q->loadFinished();
+	}
+
+	if (!imageLoader) {
+		// Prefetched blocks are no longer needed.
+		clearPrefetch();
 	}
 
 	// Block count has changed.
@@ -818,12 +935,15 @@ GcnCard::~GcnCard()
  * Open an existing Memory Card image.
  * @param filename Filename.
  * @param parent Parent object.
+ * @param flags Open flags.
  * @return GcnCard object, or nullptr on error.
  */
-GcnCard *GcnCard::open(const QString& filename, QObject *parent)
+GcnCard *GcnCard::open(const QString& filename, QObject *parent,
+	Card::OpenFlags flags)
 {
 	GcnCard *gcnCard = new GcnCard(parent);
 	GcnCardPrivate *const d = gcnCard->d_func();
+	d->setOpenFlags(flags);
 	d->open(filename);
 	return gcnCard;
 }
@@ -860,6 +980,7 @@ void GcnCard::setActiveDatIdx(int idx)
 		return;
 	const int old_idx = d->dat_info.active;
 	d->mc_dat = &d->mc_dat_int[idx];
+	d->dat_info.active = idx;
 	d->loadGcnFileList();
 	if (old_idx != idx) {
 		emit activeDatIdxChanged(idx);
@@ -878,8 +999,9 @@ void GcnCard::setActiveBatIdx(int idx)
 	Q_D(GcnCard);
 	if (idx < 0 || idx >= NUM_ELEMENTS(d->mc_bat_int))
 		return;
-	const int old_idx = d->dat_info.active;
+	const int old_idx = d->bat_info.active;
 	d->mc_bat = &d->mc_bat_int[idx];
+	d->bat_info.active = idx;
 	d->loadGcnFileList();
 	if (old_idx != idx) {
 		emit activeBatIdxChanged(idx);
@@ -899,19 +1021,6 @@ QString GcnCard::productName(void) const
 	return tr("GameCube memory card");
 }
 
-/**
- * Get the used block map.
- * NOTE: This is only valid for regular files, not "lost" files.
- * @return Used block map.
- */
-QVector<uint8_t> GcnCard::usedBlockMap(void)
-{
-	if (!isOpen())
-		return QVector<uint8_t>();
-	Q_D(GcnCard);
-	return d->usedBlockMap;
-}
-
 /**
  * Add a "lost" file.
  * NOTE: This is a debugging version.
@@ -987,6 +1096,13 @@ QList<GcnFile*> GcnCard::addLostFiles(const std::list<GcnSearchData> &filesFound
 	const int idxLast = idx + filesFoundList.size() - 1;
 	emit filesAboutToBeInserted(idx, idxLast);
 
+	// Checksums are verified in the background
+	// once all of the files have been added.
+	QVector<File*> chkFiles;
+	QVector<QVector<Checksum::ChecksumDef> > chkDefs;
+	chkFiles.reserve((int)filesFoundList.size());
+	chkDefs.reserve((int)filesFoundList.size());
+
 	for (auto iter = filesFoundList.cbegin(); iter != filesFoundList.cend(); ++iter) {
 		const GcnSearchData &searchData = *iter;
 
@@ -999,11 +1115,16 @@ QList<GcnFile*> GcnCard::addLostFiles(const std::list<GcnSearchData> &filesFound
 		if (file) {
 			files.append(file);
 			d->lstFiles.append(file);
-			file->setChecksumDefs(searchData.checksumDefs);
+			if (!searchData.checksumDefs.isEmpty()) {
+				chkFiles.append(file);
+				chkDefs.append(searchData.checksumDefs);
+			}
 		}
 	}
 
 	emit filesInserted();
+
+	setChecksumDefs(chkFiles, chkDefs);
 	return files;
 }
 
@@ -44,9 +44,11 @@ class GcnCard : public Card
 		 * Open an existing Memory Card image.
 		 * @param filename Filename.
 		 * @param parent Parent object.
+		 * @param flags Open flags.
 		 * @return GcnCard object, or nullptr on error.
 		 */
-		static GcnCard *open(const QString& filename, QObject *parent);
+		static GcnCard *open(const QString& filename, QObject *parent,
+			Card::OpenFlags flags = Card::OpenFlags());
 
 		/**
 		 * Format a new Memory Card image.
@@ -84,13 +86,6 @@ class GcnCard : public Card
 		 */
 		QString productName(void) const final;
 
-		/**
-		 * Get the used block map.
-		 * NOTE: This is only valid for regular files, not "lost" files.
-		 * @return Used block map.
-		 */
-		QVector<uint8_t> usedBlockMap(void);
-
 		/**
 		 * Add a "lost" file.
 		 * NOTE: This is a debugging version.
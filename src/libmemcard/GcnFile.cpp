@@ -30,7 +30,6 @@ using std::vector;
 
 // Qt includes.
 #include <QtCore/QByteArray>
-#include <QtCore/QTextCodec>
 #include <QtCore/QFile>
 #include <QtCore/QIODevice>
 
@@ -80,11 +79,11 @@ class GcnFilePrivate : public FilePrivate
 		Q_DISABLE_COPY(GcnFilePrivate)
 
 		/**
-		 * Get a QTextCodec for a given region.
+		 * Get the text encoding for a given region.
 		 * @param region Region code. (If 0, use the memory card's encoding.)
-		 * @return QTextCodec.
+		 * @return Text encoding.
 		 */
-		QTextCodec *textCodecForRegion(char region) const;
+		Card::Encoding encodingForRegion(char region) const;
 
 		/**
 		 * Load the file information.
@@ -144,34 +143,12 @@ GcnFilePrivate::GcnFilePrivate(GcnFile *q, Card *card,
 		return;
 	}
 
-	// Clamp file length to the size of the memory card.
-	// This shouldn't happen, but it's possible if either
+	// Load the FAT entries.
+	// The file length is clamped to the size of the memory card.
+	// This shouldn't be necessary, but it's possible if either
 	// the filesystem is heavily corrupted, or the file
 	// isn't actually a GCN Memory Card image.
-	int length = dirEntry->length;
-	if (length > card->totalUserBlocks())
-		length = card->totalUserBlocks();
-
-	// Load the FAT entries.
-	fatEntries.clear();
-	fatEntries.reserve(length);
-	uint16_t next_block = dirEntry->block;
-	if (next_block >= 5 && next_block != 0xFFFF &&
-	    next_block < (uint16_t)NUM_ELEMENTS(mc_bat->fat)) {
-		fatEntries.append(next_block);
-
-		// Go through the rest of the blocks.
-		for (int i = length; i > 1; i--) {
-			next_block = mc_bat->fat[next_block - 5];
-			if (next_block == 0xFFFF || next_block < 5 ||
-			    next_block >= (uint16_t)NUM_ELEMENTS(mc_bat->fat))
-			{
-				// Next block is invalid.
-				break;
-			}
-			fatEntries.append(next_block);
-		}
-	}
+	fatEntries = GcnFile::fatChain(dirEntry, mc_bat, card->totalUserBlocks());
 
 	// Load the file information.
 	loadFileInfo();
@@ -243,22 +220,12 @@ GcnFilePrivate::~GcnFilePrivate()
 }
 
 /**
- * Get a QTextCodec for a given region.
+ * Get the text encoding for a given region.
  * @param region Region code. (If 0, use the memory card's encoding.)
- * @return QTextCodec.
+ * @return Text encoding.
  */
-QTextCodec *GcnFilePrivate::textCodecForRegion(char region) const
+Card::Encoding GcnFilePrivate::encodingForRegion(char region) const
 {
-	static QTextCodec *shiftJis = QTextCodec::codecForName("Shift_JIS");
-	static QTextCodec *cp1252 = QTextCodec::codecForName("cp1252");
-
-	if (!shiftJis) {
-		// Shift-JIS isn't available.
-		// Always use cp1252.
-		assert(cp1252 != nullptr);
-		return cp1252;
-	}
-
 	Card::Encoding encoding = Card::Encoding::Unknown;
 	switch (region) {
 		case 0:
@@ -284,8 +251,8 @@ QTextCodec *GcnFilePrivate::textCodecForRegion(char region) const
 	}
 
 	if (encoding == Card::Encoding::Shift_JIS)
-		return shiftJis;
-	return cp1252;
+		return encoding;
+	return Card::Encoding::CP1252;
 }
 
 /**
@@ -300,30 +267,17 @@ void GcnFilePrivate::loadFileInfo(void)
 			sizeof(dirEntry->gamecode) + sizeof(dirEntry->company));
 
 	// TODO: Use decodeText_SJISorCP1252() instead?
-	// Get the appropriate QTextCodec for this file.
+	// Get the appropriate text encoding for this file.
 	const char region = (gameID.size() >= 4
 				? gameID.at(3).toLatin1()
 				: 0);
-	QTextCodec *textCodec = textCodecForRegion(region);
-
-	// Remove trailing NULL characters before converting to UTF-8.
-	QByteArray filenameData(dirEntry->filename, sizeof(dirEntry->filename));
-	int nullChr = filenameData.indexOf('\0');
-	if (nullChr >= 0)
-		filenameData.resize(nullChr);
-
-	// Convert the filename to UTF-8.
-	if (!textCodec) {
-		// No text codec was found.
-		// Default to Latin-1.
-		filename = QString::fromLatin1(filenameData.constData(), filenameData.size());
-	} else {
-		// Use the text codec.
-		filename = textCodec->toUnicode(filenameData.constData(), filenameData.size());
-	}
+	const Card::Encoding encoding = encodingForRegion(region);
+
+	// Filename.
+	filename = decodeText(dirEntry->filename, sizeof(dirEntry->filename), encoding);
 
 	// Timestamp.
-	mtime = TimeFuncs::fromGcnTimestamp(dirEntry->lastmodified);
+	mtime = TimeFuncs::gcnToUnixTime(dirEntry->lastmodified);
 
 	// Mode.
 	// GCN permission bits map nicely to File::ModeBits.
@@ -348,29 +302,9 @@ void GcnFilePrivate::loadFileInfo(void)
 	// NOTE: These comments are supposed to be NULL-terminated.
 	// 0x00: Game description.
 	// 0x20: File description.
-	QByteArray gameDescData(&commentData[commentOffset], 32);
-	QByteArray fileDescData(&commentData[commentOffset+32], 32);
-
-	// Remove trailing NULL characters before converting to UTF-8.
-	nullChr = gameDescData.indexOf('\0');
-	if (nullChr >= 0)
-		gameDescData.resize(nullChr);
-	nullChr = fileDescData.indexOf('\0');
-	if (nullChr >= 0)
-		fileDescData.resize(nullChr);
-
-	// Convert the descriptions to UTF-8.
 	// Trim the descriptions while we're at it.
-	if (!textCodec) {
-		// No text codec was found.
-		// Default to Latin-1.
-		gameDesc = QString::fromLatin1(gameDescData.constData(), gameDescData.size()).trimmed();
-		fileDesc = QString::fromLatin1(fileDescData.constData(), fileDescData.size()).trimmed();
-	} else {
-		// Use the text codec.
-		gameDesc = textCodec->toUnicode(gameDescData.constData(), gameDescData.size()).trimmed();
-		fileDesc = textCodec->toUnicode(fileDescData.constData(), fileDescData.size()).trimmed();
-	}
+	gameDesc = decodeText(&commentData[commentOffset], 32, encoding).trimmed();
+	fileDesc = decodeText(&commentData[commentOffset+32], 32, encoding).trimmed();
 
 	// TODO: Change gameDesc and fileDesc to QStringRefs
 	// pointing to description.
@@ -753,6 +687,114 @@ int GcnFile::exportToFile(QIODevice *qioDevice)
 	return 0;
 }
 
+/**
+ * Follow a file's FAT chain in a block table.
+ * @param dirEntry Directory entry.
+ * @param mc_bat Block table.
+ * @param maxLength Maximum number of blocks.
+ * @return FAT entries. (May be shorter than the file if the chain is broken.)
+ */
+QVector<uint16_t> GcnFile::fatChain(const card_direntry *dirEntry,
+	const card_bat *mc_bat, int maxLength)
+{
+	int length = dirEntry->length;
+	if (length > maxLength)
+		length = maxLength;
+
+	QVector<uint16_t> fatEntries;
+	fatEntries.reserve(length);
+	uint16_t next_block = dirEntry->block;
+	if (length > 0 && next_block >= 5 && next_block != 0xFFFF &&
+	    next_block < (uint16_t)NUM_ELEMENTS(mc_bat->fat)) {
+		fatEntries.append(next_block);
+
+		// Go through the rest of the blocks.
+		for (int i = length; i > 1; i--) {
+			next_block = mc_bat->fat[next_block - 5];
+			if (next_block == 0xFFFF || next_block < 5 ||
+			    next_block >= (uint16_t)NUM_ELEMENTS(mc_bat->fat))
+			{
+				// Next block is invalid.
+				break;
+			}
+			fatEntries.append(next_block);
+		}
+	}
+
+	return fatEntries;
+}
+
+/**
+ * Get the file blocks containing a file's comments, banner, and icons.
+ * This is used to prefetch the blocks when loading the file list.
+ * @param dirEntry Directory entry.
+ * @param blockSize Block size.
+ * @return File block numbers. (NOT physical block numbers.)
+ */
+QVector<uint16_t> GcnFile::metadataFileBlocks(const card_direntry *dirEntry, int blockSize)
+{
+	QVector<uint16_t> blocks;
+	blocks.reserve(4);
+
+	// Comment block.
+	blocks.append((uint16_t)(dirEntry->commentaddr / blockSize));
+
+	// Banner and icons.
+	// This uses the same size calculations as loadBannerImage()
+	// and loadIconImages().
+	uint32_t imgLen = 0;
+	switch (dirEntry->bannerfmt & CARD_BANNER_MASK) {
+		case CARD_BANNER_CI:
+			imgLen += (CARD_BANNER_W * CARD_BANNER_H * 1) + 0x200;
+			break;
+		case CARD_BANNER_RGB:
+			imgLen += (CARD_BANNER_W * CARD_BANNER_H * 2);
+			break;
+		default:
+			break;
+	}
+
+	bool isShared = false;
+	uint16_t iconfmt = dirEntry->iconfmt;
+	uint16_t iconspeed = dirEntry->iconspeed;
+	for (int i = 0; i < CARD_MAXICONS; i++, iconfmt >>= 2, iconspeed >>= 2) {
+		if ((iconspeed & CARD_SPEED_MASK) == CARD_SPEED_END)
+			break;
+
+		switch (iconfmt & CARD_ICON_MASK) {
+			case CARD_ICON_CI_SHARED:
+				imgLen += (CARD_ICON_W * CARD_ICON_H * 1);
+				isShared = true;
+				break;
+			case CARD_ICON_CI_UNIQUE:
+				imgLen += (CARD_ICON_W * CARD_ICON_H * 1) + 0x200;
+				break;
+			case CARD_ICON_RGB:
+				imgLen += (CARD_ICON_W * CARD_ICON_H * 2);
+				break;
+			default:
+				break;
+		}
+	}
+	if (isShared) {
+		// Shared CI8 palette.
+		imgLen += 0x200;
+	}
+
+	if (imgLen > 0) {
+		const uint32_t imgStart = dirEntry->iconaddr;
+		const uint32_t blockStart = (imgStart / blockSize);
+		const uint32_t blockEnd = ((imgStart + imgLen - 1) / blockSize);
+		for (uint32_t block = blockStart; block <= blockEnd && block < 0xFFFF; block++) {
+			if (!blocks.contains((uint16_t)block)) {
+				blocks.append((uint16_t)block);
+			}
+		}
+	}
+
+	return blocks;
+}
+
 /**
  * Get the directory entry.
  * @return Directory entry.
@@ -118,6 +118,26 @@ class GcnFile : public File
 		 * @return Directory entry.
 		 */
 		const card_direntry *dirEntry(void) const;
+
+	public:
+		/**
+		 * Follow a file's FAT chain in a block table.
+		 * @param dirEntry Directory entry.
+		 * @param mc_bat Block table.
+		 * @param maxLength Maximum number of blocks.
+		 * @return FAT entries. (May be shorter than the file if the chain is broken.)
+		 */
+		static QVector<uint16_t> fatChain(const card_direntry *dirEntry,
+			const card_bat *mc_bat, int maxLength);
+
+		/**
+		 * Get the file blocks containing a file's comments, banner, and icons.
+		 * This is used to prefetch the blocks when loading the file list.
+		 * @param dirEntry Directory entry.
+		 * @param blockSize Block size.
+		 * @return File block numbers. (NOT physical block numbers.)
+		 */
+		static QVector<uint16_t> metadataFileBlocks(const card_direntry *dirEntry, int blockSize);
 };
 
 #endif /* __LIBMEMCARD_GCNFILE_HPP__ */
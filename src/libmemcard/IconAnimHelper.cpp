@@ -12,6 +12,12 @@
 #include "card.h"
 #include "File.hpp"
 
+// C includes. (C++ namespace)
+#include <cstring>
+
+// Qt includes.
+#include <QtCore/QVector>
+
 class IconAnimHelperPrivate
 {
 	public:
@@ -32,25 +38,35 @@ class IconAnimHelperPrivate
 		 */
 		bool enabled;
 
-		// Animation data.
-		uint8_t frame;		// Current frame.
-		uint8_t lastValidFrame;	// Last valid frame.
-		bool frameHasIcon;	// If false, use previous frame.
-		uint8_t delayCnt;	// Delay counter.
-		uint8_t delayLen;	// Delay length.
-		uint8_t mode;		// Animation mode.
-		bool direction;		// Current direction for CARD_ANIM_BOUNCE.
+		/**
+		 * Animation step.
+		 * Each step corresponds to a single animation frame.
+		 */
+		struct Step {
+			uint8_t icon;	// Icon to display. (last frame with a valid icon)
+			int delay;	// Step length, in ms.
+		};
+
+		// Animation timeline.
+		// Steps [0, loopStart) are only played once;
+		// steps [loopStart, timeline.size()) are repeated.
+		QVector<Step> timeline;
+		int loopStart;
+
+		// Current step.
+		int step;
 
 		/**
 		 * Reset the animation state.
+		 * This precomputes the animation timeline.
 		 */
 		void reset(void);
 
 		/**
-		 * Timer tick for the animation counter.
+		 * Advance to the next animation step.
 		 * @return True if the current icon has been changed; false if not.
 		 */
-		bool tick(void);
+		bool advance(void);
 };
 
 
@@ -64,100 +80,108 @@ IconAnimHelperPrivate::IconAnimHelperPrivate(IconAnimHelper *q)
 
 /**
  * Reset the animation state.
+ * This precomputes the animation timeline.
  */
 void IconAnimHelperPrivate::reset(void)
 {
-	frame = 0;
-	lastValidFrame = 0;
-	delayCnt = 0;
-	direction = false;
+	timeline.clear();
+	loopStart = 0;
+	step = 0;
 
 	if (!file || file->iconCount() <= 1) {
 		// No file specified, or icon is not animated.
 		enabled = false;
-		frameHasIcon = 0;
-		delayLen = 0;
-		mode = 0;
-	} else {
-		// File is specified.
-		// Determine the initial state.
-		enabled = true;
-		frameHasIcon = !(file->icon(frame).isNull());
-		delayLen = file->iconDelay(frame);
-		mode = file->iconAnimMode();
-	}
-}
-
-
-/**
- * Timer tick for the animation counter.
- * @return True if the current icon has been changed; false if not.
- */
-bool IconAnimHelperPrivate::tick(void)
-{
-	if (!enabled)
-		return false;
-
-	// Check the delay counter.
-	delayCnt++;
-	if (delayCnt < delayLen) {
-		// Animation delay hasn't expired yet.
-		return false;
+		return;
 	}
 
-	// Animation delay has expired.
-	// Go to the next frame.
-	if (!direction) {
-		// Animation is moving forwards.
-		// Check if we're at the last frame.
-		if (frame == (CARD_MAXICONS - 1) ||
-		    (file->iconDelay(frame + 1) == CARD_SPEED_END))
-		{
-			// Last frame.
-			if (mode == CARD_ANIM_BOUNCE) {
-				// "Bounce" animation. Start playing backwards.
-				direction = true;
-				frame--;	// Go to the previous frame.
+	// File is specified.
+	// Run the animation state machine until it repeats.
+	// The state consists of the current frame, the direction,
+	// and the last frame that had a valid icon, so there's a
+	// maximum of (CARD_MAXICONS * 2 * CARD_MAXICONS) states.
+	enabled = true;
+	const int mode = file->iconAnimMode();
+	int seen[CARD_MAXICONS][2][CARD_MAXICONS];
+	memset(seen, 0xFF, sizeof(seen));
+
+	uint8_t frame = 0;		// Current frame.
+	uint8_t lastValidFrame = 0;	// Last valid frame.
+	bool direction = false;		// Current direction for CARD_ANIM_BOUNCE.
+	while (seen[frame][direction][lastValidFrame] < 0) {
+		seen[frame][direction][lastValidFrame] = timeline.size();
+
+		// NOTE: CARD_SPEED_END is only valid as a terminator,
+		// but if the first frame has it, treat it as one tick.
+		const int delayLen = file->iconDelay(frame);
+		Step st;
+		st.icon = lastValidFrame;
+		st.delay = (delayLen > 0 ? delayLen : 1) * IconAnimHelper::FAST_ANIM_TIMER;
+		timeline.append(st);
+
+		// Go to the next frame.
+		if (!direction) {
+			// Animation is moving forwards.
+			// Check if we're at the last frame.
+			if (frame == (CARD_MAXICONS - 1) ||
+			    (file->iconDelay(frame + 1) == CARD_SPEED_END))
+			{
+				// Last frame.
+				if (mode == CARD_ANIM_BOUNCE) {
+					// "Bounce" animation. Start playing backwards.
+					// If this is the only frame, stay here.
+					if (frame > 0) {
+						direction = true;
+						frame--;	// Go to the previous frame.
+					}
+				} else {
+					// "Looping" animation.
+					// Reset to frame 0.
+					frame = 0;
+				}
 			} else {
-				// "Looping" animation.
-				// Reset to frame 0.
-				frame = 0;
+				// Not the last frame.
+				// Go to the next frame.
+				frame++;
 			}
 		} else {
-			// Not the last frame.
-			// Go to the next frame.
-			frame++;
+			// Animation is moving backwards. ("Bounce" animation only.)
+			// Check if we're at the first frame.
+			if (frame == 0) {
+				// First frame. Start playing forwards.
+				direction = false;
+				frame++;	// Go to the next frame.
+			} else {
+				// Not the first frame.
+				// Go to the previous frame.
+				frame--;
+			}
 		}
-	} else {
-		// Animation is moving backwards. ("Bounce" animation only.)
-		// Check if we're at the first frame.
-		if (frame == 0) {
-			// First frame. Start playing forwards.
-			direction = false;
-			frame++;	// Go to the next frame.
-		} else {
-			// Not the first frame.
-			// Go to the previous frame.
-			frame--;
+
+		// If this frame doesn't have an icon, keep the previous one.
+		if (!file->iconRegion(frame).isNull()) {
+			lastValidFrame = frame;
 		}
 	}
 
-	// Update the frame delay data.
-	delayCnt = 0;
-	delayLen = file->iconDelay(frame);
+	loopStart = seen[frame][direction][lastValidFrame];
+}
 
-	// Check if this frame has an icon.
-	frameHasIcon = !file->icon(frame).isNull();
-	if (frameHasIcon && lastValidFrame != frame) {
-		// Frame has an icon. Save this frame as the last valid frame.
-		lastValidFrame = frame;
 
-		// Current icon has been updated.
-		return true;
-	}
+/**
+ * Advance to the next animation step.
+ * @return True if the current icon has been changed; false if not.
+ */
+bool IconAnimHelperPrivate::advance(void)
+{
+	if (!enabled)
+		return false;
 
-	// Current icon has not been updated.
-	return false;
+	const uint8_t prevIcon = timeline.at(step).icon;
+	step++;
+	if (step >= timeline.size()) {
+		step = loopStart;
+	}
+	return (timeline.at(step).icon != prevIcon);
 }
 
 
@@ -248,18 +272,38 @@ QPixmap IconAnimHelper::icon(void) const
 
 	// Get the current icon from this file.
 	// If the icon is not animated, this will always be icon 0.
-	return d->file->icon(d->lastValidFrame);
+	return d->file->icon(d->enabled ? d->timeline.at(d->step).icon : 0);
+}
+
+/**
+ * Get the current icon index for this file.
+ * @return Current icon index.
+ */
+int IconAnimHelper::iconIndex(void) const
+{
+	Q_D(const IconAnimHelper);
+	return (d->enabled ? d->timeline.at(d->step).icon : 0);
+}
+
+/**
+ * Get the time until the current animation step ends.
+ * @return Time until the next step, in ms. (0 if not animated)
+ */
+int IconAnimHelper::delay(void) const
+{
+	Q_D(const IconAnimHelper);
+	return (d->enabled ? d->timeline.at(d->step).delay : 0);
 }
 
 /**
- * Timer tick for the animation counter.
- * WRAPPER FUNCTION for d->tick().
+ * Advance to the next animation step.
+ * WRAPPER FUNCTION for d->advance().
  * @return True if the current icon has been changed; false if not.
  */
-bool IconAnimHelper::tick(void)
+bool IconAnimHelper::advance(void)
 {
 	Q_D(IconAnimHelper);
-	return d->tick();
+	return d->advance();
 }
 
 /** Slots. **/
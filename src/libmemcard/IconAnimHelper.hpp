@@ -40,6 +40,7 @@ class IconAnimHelper : public QObject
 	public:
 		/**
 		 * Time, in ms, for each frame for "fast" animated icons.
+		 * Icon delays are multiples of this value.
 		 * TODO: Figure out the correct timer interval.
 		 */
 		static const int FAST_ANIM_TIMER = 125;
@@ -74,10 +75,23 @@ class IconAnimHelper : public QObject
 		QPixmap icon(void) const;
 
 		/**
-		 * Timer tick for the animation counter.
+		 * Get the current icon index for this file.
+		 * @return Current icon index.
+		 */
+		int iconIndex(void) const;
+
+		/**
+		 * Get the time until the current animation step ends.
+		 * @return Time until the next step, in ms. (0 if not animated)
+		 */
+		int delay(void) const;
+
+		/**
+		 * Advance to the next animation step.
+		 * This should be called once delay() has elapsed.
 		 * @return True if the current icon has been changed; false if not.
 		 */
-		bool tick(void);
+		bool advance(void);
 
 	protected slots:
 		/**
@@ -0,0 +1,436 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * IconAnimScheduler.cpp: Icon animation scheduler.                        *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "IconAnimScheduler.hpp"
+
+#include "File.hpp"
+#include "IconAnimHelper.hpp"
+
+// C++ includes.
+#include <algorithm>
+#include <functional>
+#include <vector>
+using std::vector;
+
+// Qt includes.
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QHash>
+#include <QtCore/QTimer>
+
+/** IconAnimSchedulerPrivate **/
+
+class IconAnimSchedulerPrivate
+{
+	public:
+		explicit IconAnimSchedulerPrivate(IconAnimScheduler *q);
+		~IconAnimSchedulerPrivate();
+
+	protected:
+		IconAnimScheduler *const q_ptr;
+		Q_DECLARE_PUBLIC(IconAnimScheduler)
+	private:
+		Q_DISABLE_COPY(IconAnimSchedulerPrivate)
+
+	public:
+		/**
+		 * Animated file.
+		 * The serial number is used to detect stale deadlines
+		 * if the file is removed or re-added.
+		 */
+		struct Entry {
+			IconAnimHelper *helper;
+			quint32 serial;
+		};
+
+		// Animated files.
+		// NOTE: Keyed by QObject so the destroyed() signal
+		// can be handled without casting.
+		QHash<const QObject*, Entry> entries;
+		quint32 nextSerial;
+
+		/**
+		 * Next icon change for a file.
+		 */
+		struct Deadline {
+			qint64 time;		// Deadline, relative to clock.
+			const QObject *key;	// File.
+			quint32 serial;		// Entry serial number.
+
+			inline bool operator>(const Deadline &other) const
+			{
+				return (time > other.time);
+			}
+		};
+
+		// Deadlines. (min-heap)
+		// Entries for removed files are skipped when popped.
+		vector<Deadline> heap;
+
+		// Animation clock and timer.
+		QElapsedTimer clock;
+		QTimer *timer;
+
+		// Pause count. If >0, animation is paused.
+		int pauseCounter;
+		// Clock value when animation was paused.
+		qint64 pausedAt;
+
+		/**
+		 * Get the current animation time.
+		 * If animation is paused, this is the time it was paused.
+		 * @return Current animation time, in ms.
+		 */
+		inline qint64 now(void) const
+		{
+			return (pauseCounter > 0 ? pausedAt : clock.elapsed());
+		}
+
+		/**
+		 * Add a deadline to the heap.
+		 * @param time Deadline.
+		 * @param key File.
+		 * @param serial Entry serial number.
+		 */
+		void push(qint64 time, const QObject *key, quint32 serial);
+
+		/**
+		 * Remove all deadlines for files that are no longer animated.
+		 */
+		void compact(void);
+
+		/**
+		 * Arm the timer for the earliest deadline.
+		 * The timer is stopped if animation is paused
+		 * or if no files are animated.
+		 */
+		void arm(void);
+};
+
+IconAnimSchedulerPrivate::IconAnimSchedulerPrivate(IconAnimScheduler *q)
+	: q_ptr(q)
+	, nextSerial(0)
+	, timer(new QTimer(q))
+	, pauseCounter(0)
+	, pausedAt(0)
+{
+	timer->setSingleShot(true);
+	QObject::connect(timer, &QTimer::timeout,
+		q, &IconAnimScheduler::timer_slot);
+	clock.start();
+}
+
+IconAnimSchedulerPrivate::~IconAnimSchedulerPrivate()
+{
+	timer->stop();
+	delete timer;
+
+	foreach (const Entry &entry, entries) {
+		delete entry.helper;
+	}
+}
+
+/**
+ * Add a deadline to the heap.
+ * @param time Deadline.
+ * @param key File.
+ * @param serial Entry serial number.
+ */
+void IconAnimSchedulerPrivate::push(qint64 time, const QObject *key, quint32 serial)
+{
+	Deadline dl;
+	dl.time = time;
+	dl.key = key;
+	dl.serial = serial;
+	heap.push_back(dl);
+	std::push_heap(heap.begin(), heap.end(), std::greater<Deadline>());
+}
+
+/**
+ * Remove all deadlines for files that are no longer animated.
+ */
+void IconAnimSchedulerPrivate::compact(void)
+{
+	auto iter = std::remove_if(heap.begin(), heap.end(),
+		[this](const Deadline &dl) {
+			auto entry = entries.constFind(dl.key);
+			return (entry == entries.constEnd() || entry->serial != dl.serial);
+		});
+	heap.erase(iter, heap.end());
+	std::make_heap(heap.begin(), heap.end(), std::greater<Deadline>());
+}
+
+/**
+ * Arm the timer for the earliest deadline.
+ * The timer is stopped if animation is paused
+ * or if no files are animated.
+ */
+void IconAnimSchedulerPrivate::arm(void)
+{
+	// Stale deadlines accumulate if files are removed
+	// frequently, e.g. when switching directory tables.
+	if (heap.size() > (size_t)(entries.size() * 2 + 16)) {
+		compact();
+	}
+
+	if (pauseCounter > 0 || heap.empty()) {
+		timer->stop();
+		return;
+	}
+
+	const qint64 delay = heap.front().time - clock.elapsed();
+	timer->start(delay > 0 ? (int)delay : 0);
+}
+
+/** IconAnimScheduler **/
+
+IconAnimScheduler::IconAnimScheduler(QObject *parent)
+	: super(parent)
+	, d_ptr(new IconAnimSchedulerPrivate(this))
+{ }
+
+IconAnimScheduler::~IconAnimScheduler()
+{
+	Q_D(IconAnimScheduler);
+	delete d;
+}
+
+/**
+ * Add a file to the scheduler.
+ * If the file is already present, its animation is restarted.
+ * Files that don't have an animated icon are ignored.
+ * @param file File.
+ */
+void IconAnimScheduler::addFile(const File *file)
+{
+	removeFile(file);
+	if (!file || file->iconCount() <= 1)
+		return;
+
+	Q_D(IconAnimScheduler);
+	IconAnimSchedulerPrivate::Entry entry;
+	entry.helper = new IconAnimHelper(file);
+	entry.serial = d->nextSerial++;
+	d->entries.insert(file, entry);
+	connect(file, &QObject::destroyed,
+		this, &IconAnimScheduler::file_destroyed_slot);
+
+	d->push(d->now() + entry.helper->delay(), file, entry.serial);
+	d->arm();
+}
+
+/**
+ * Remove a file from the scheduler.
+ * @param file File.
+ */
+void IconAnimScheduler::removeFile(const File *file)
+{
+	Q_D(IconAnimScheduler);
+	auto iter = d->entries.find(file);
+	if (iter == d->entries.end())
+		return;
+
+	disconnect(file, &QObject::destroyed,
+		   this, &IconAnimScheduler::file_destroyed_slot);
+	delete iter->helper;
+	d->entries.erase(iter);
+
+	// NOTE: The file's deadline is left in the heap.
+	// It will be skipped when it expires.
+	if (d->entries.isEmpty()) {
+		d->heap.clear();
+		d->timer->stop();
+	}
+}
+
+/**
+ * Remove all files from the scheduler.
+ */
+void IconAnimScheduler::clear(void)
+{
+	Q_D(IconAnimScheduler);
+	for (auto iter = d->entries.cbegin(); iter != d->entries.cend(); ++iter) {
+		disconnect(iter.key(), &QObject::destroyed,
+			   this, &IconAnimScheduler::file_destroyed_slot);
+		delete iter->helper;
+	}
+	d->entries.clear();
+	d->heap.clear();
+	d->timer->stop();
+}
+
+/**
+ * Are any animated icons present?
+ * @return True if no animated icons are present; false if there are.
+ */
+bool IconAnimScheduler::isEmpty(void) const
+{
+	Q_D(const IconAnimScheduler);
+	return d->entries.isEmpty();
+}
+
+/**
+ * Does a file have an animated icon?
+ * @param file File.
+ * @return True if the file's icon is being animated; false if not.
+ */
+bool IconAnimScheduler::isAnimated(const File *file) const
+{
+	Q_D(const IconAnimScheduler);
+	return d->entries.contains(file);
+}
+
+/**
+ * Get the current icon for a file.
+ * @param file File.
+ * @return Current icon. (icon 0 if the file isn't animated)
+ */
+QPixmap IconAnimScheduler::icon(const File *file) const
+{
+	if (!file)
+		return QPixmap();
+
+	Q_D(const IconAnimScheduler);
+	auto iter = d->entries.constFind(file);
+	if (iter != d->entries.constEnd()) {
+		// Animated icon.
+		return iter->helper->icon();
+	}
+
+	// Not an animated icon.
+	// Return the first icon.
+	return file->icon(0);
+}
+
+/**
+ * Get the current icon index for a file.
+ * @param file File.
+ * @return Current icon index. (0 if the file isn't animated)
+ */
+int IconAnimScheduler::iconIndex(const File *file) const
+{
+	Q_D(const IconAnimScheduler);
+	auto iter = d->entries.constFind(file);
+	return (iter != d->entries.constEnd() ? iter->helper->iconIndex() : 0);
+}
+
+/**
+ * Pause animation.
+ * NOTE: This uses an internal counter; the number of resumes
+ * must match the number of pauses to resume animation.
+ */
+void IconAnimScheduler::pause(void)
+{
+	Q_D(IconAnimScheduler);
+	if (d->pauseCounter == 0) {
+		d->pausedAt = d->clock.elapsed();
+	}
+	d->pauseCounter++;
+	d->timer->stop();
+}
+
+/**
+ * Resume animation.
+ * NOTE: This uses an internal counter; the number of resumes
+ * must match the number of pauses to resume animation.
+ */
+void IconAnimScheduler::resume(void)
+{
+	Q_D(IconAnimScheduler);
+	if (d->pauseCounter <= 0) {
+		// Not paused...
+		d->pauseCounter = 0;
+		return;
+	}
+
+	d->pauseCounter--;
+	if (d->pauseCounter > 0)
+		return;
+
+	// Shift all deadlines by the time spent paused.
+	// This doesn't change the heap order.
+	const qint64 shift = d->clock.elapsed() - d->pausedAt;
+	for (auto iter = d->heap.begin(); iter != d->heap.end(); ++iter) {
+		iter->time += shift;
+	}
+	d->arm();
+}
+
+/**
+ * Is animation paused?
+ * @return True if paused; false if not.
+ */
+bool IconAnimScheduler::isPaused(void) const
+{
+	Q_D(const IconAnimScheduler);
+	return (d->pauseCounter > 0);
+}
+
+/** Private slots. **/
+
+/**
+ * Animation timer has expired.
+ */
+void IconAnimScheduler::timer_slot(void)
+{
+	Q_D(IconAnimScheduler);
+	if (d->pauseCounter > 0)
+		return;
+
+	const qint64 now = d->clock.elapsed();
+	QVector<const File*> changed;
+	while (!d->heap.empty() && d->heap.front().time <= now) {
+		std::pop_heap(d->heap.begin(), d->heap.end(), std::greater<IconAnimSchedulerPrivate::Deadline>());
+		const IconAnimSchedulerPrivate::Deadline dl = d->heap.back();
+		d->heap.pop_back();
+
+		auto iter = d->entries.constFind(dl.key);
+		if (iter == d->entries.constEnd() || iter->serial != dl.serial) {
+			// Stale deadline.
+			continue;
+		}
+
+		IconAnimHelper *const helper = iter->helper;
+		if (helper->advance()) {
+			changed.append(helper->file());
+		}
+
+		// Schedule the next step relative to the previous deadline
+		// to prevent drift. If we fell too far behind, e.g. because
+		// the event loop was blocked, skip ahead instead of
+		// trying to catch up.
+		qint64 next = dl.time + helper->delay();
+		if (next <= now) {
+			next = now + helper->delay();
+		}
+		d->push(next, dl.key, dl.serial);
+	}
+
+	d->arm();
+	if (!changed.isEmpty()) {
+		emit iconsChanged(changed);
+	}
+}
+
+/**
+ * File object was destroyed.
+ * @param obj QObject that was destroyed.
+ */
+void IconAnimScheduler::file_destroyed_slot(QObject *obj)
+{
+	Q_D(IconAnimScheduler);
+	auto iter = d->entries.find(obj);
+	if (iter == d->entries.end())
+		return;
+
+	delete iter->helper;
+	d->entries.erase(iter);
+	if (d->entries.isEmpty()) {
+		d->heap.clear();
+		d->timer->stop();
+	}
+}
@@ -0,0 +1,132 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * IconAnimScheduler.hpp: Icon animation scheduler.                        *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_ICONANIMSCHEDULER_HPP__
+#define __LIBMEMCARD_ICONANIMSCHEDULER_HPP__
+
+// Qt includes.
+#include <QtCore/QObject>
+#include <QtCore/QVector>
+#include <QtGui/QPixmap>
+
+class File;
+
+/**
+ * Icon animation scheduler.
+ *
+ * Animates the icons of multiple files using a single timer.
+ * Each file's animation timeline is precomputed by IconAnimHelper,
+ * and the timer is only armed for the next icon change, so nothing
+ * runs between frames or while animation is paused.
+ */
+class IconAnimSchedulerPrivate;
+class IconAnimScheduler : public QObject
+{
+	Q_OBJECT
+	typedef QObject super;
+
+	public:
+		explicit IconAnimScheduler(QObject *parent = 0);
+		virtual ~IconAnimScheduler();
+
+	protected:
+		IconAnimSchedulerPrivate *const d_ptr;
+		Q_DECLARE_PRIVATE(IconAnimScheduler)
+	private:
+		Q_DISABLE_COPY(IconAnimScheduler)
+
+	public:
+		/**
+		 * Add a file to the scheduler.
+		 * If the file is already present, its animation is restarted.
+		 * Files that don't have an animated icon are ignored.
+		 * @param file File.
+		 */
+		void addFile(const File *file);
+
+		/**
+		 * Remove a file from the scheduler.
+		 * @param file File.
+		 */
+		void removeFile(const File *file);
+
+		/**
+		 * Remove all files from the scheduler.
+		 */
+		void clear(void);
+
+		/**
+		 * Are any animated icons present?
+		 * @return True if no animated icons are present; false if there are.
+		 */
+		bool isEmpty(void) const;
+
+		/**
+		 * Does a file have an animated icon?
+		 * @param file File.
+		 * @return True if the file's icon is being animated; false if not.
+		 */
+		bool isAnimated(const File *file) const;
+
+		/**
+		 * Get the current icon for a file.
+		 * @param file File.
+		 * @return Current icon. (icon 0 if the file isn't animated)
+		 */
+		QPixmap icon(const File *file) const;
+
+		/**
+		 * Get the current icon index for a file.
+		 * @param file File.
+		 * @return Current icon index. (0 if the file isn't animated)
+		 */
+		int iconIndex(const File *file) const;
+
+		/**
+		 * Pause animation.
+		 * NOTE: This uses an internal counter; the number of resumes
+		 * must match the number of pauses to resume animation.
+		 */
+		void pause(void);
+
+		/**
+		 * Resume animation.
+		 * NOTE: This uses an internal counter; the number of resumes
+		 * must match the number of pauses to resume animation.
+		 */
+		void resume(void);
+
+		/**
+		 * Is animation paused?
+		 * @return True if paused; false if not.
+		 */
+		bool isPaused(void) const;
+
+	signals:
+		/**
+		 * Icons have changed.
+		 * All icons that changed at the same time are
+		 * reported in a single signal.
+		 * @param files Files whose icons have changed.
+		 */
+		void iconsChanged(const QVector<const File*> &files);
+
+	private slots:
+		/**
+		 * Animation timer has expired.
+		 */
+		void timer_slot(void);
+
+		/**
+		 * File object was destroyed.
+		 * @param obj QObject that was destroyed.
+		 */
+		void file_destroyed_slot(QObject *obj = 0);
+};
+
+#endif /* __LIBMEMCARD_ICONANIMSCHEDULER_HPP__ */
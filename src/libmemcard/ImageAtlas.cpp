@@ -0,0 +1,249 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * ImageAtlas.cpp: Texture atlas for file banners and icons.               *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "ImageAtlas.hpp"
+
+// Qt includes.
+#include <QtGui/QPainter>
+
+/**
+ * Atlas page.
+ * Images are packed into horizontal shelves.
+ */
+struct ImageAtlas::Page {
+	Page(int width, int height)
+		: image(width, height, QImage::Format_ARGB32_Premultiplied)
+		, shelfX(0)
+		, shelfY(0)
+		, shelfH(0)
+	{
+		image.fill(Qt::transparent);
+	}
+
+	// Page image.
+	QImage image;
+
+	// Current shelf.
+	int shelfX;	// Next free column.
+	int shelfY;	// Top of the shelf.
+	int shelfH;	// Shelf height.
+
+	// Uploaded pixmaps, indexed by (scale - 1).
+	QPixmap pixmaps[MAX_SCALE];
+	// Rectangles that were updated since each pixmap was uploaded.
+	QVector<QRect> pending[MAX_SCALE];
+};
+
+ImageAtlas::ImageAtlas()
+{ }
+
+ImageAtlas::~ImageAtlas()
+{
+	qDeleteAll(m_pages);
+}
+
+/**
+ * Allocate a region for an image.
+ * @param size Image size.
+ * @return Region.
+ */
+ImageAtlas::Region ImageAtlas::allocate(const QSize &size)
+{
+	const int w = size.width();
+	const int h = size.height();
+
+	Page *page = (!m_pages.isEmpty() ? m_pages.last() : nullptr);
+	if (page) {
+		const int pw = page->image.width();
+		const int ph = page->image.height();
+		if (page->shelfX + w <= pw && page->shelfY + h <= ph &&
+		    (h <= page->shelfH || page->shelfX == 0))
+		{
+			// Image fits on the current shelf.
+			if (h > page->shelfH) {
+				page->shelfH = h;
+			}
+		} else if (w <= pw && page->shelfY + page->shelfH + h <= ph) {
+			// Start a new shelf.
+			page->shelfX = 0;
+			page->shelfY += page->shelfH;
+			page->shelfH = h;
+		} else {
+			// Page is full.
+			page = nullptr;
+		}
+	}
+
+	if (!page) {
+		// Start a new page.
+		page = new Page(qMax(w, (int)PAGE_SIZE), qMax(h, (int)PAGE_SIZE));
+		page->shelfH = h;
+		m_pages.append(page);
+	}
+
+	Region region;
+	region.atlas = this;
+	region.page = m_pages.size() - 1;
+	region.rect = QRect(page->shelfX, page->shelfY, w, h);
+	page->shelfX += w;
+	return region;
+}
+
+/**
+ * Add an image to the atlas.
+ * @param image Image.
+ * @return Region containing the image, or an empty region if the image is null.
+ */
+ImageAtlas::Region ImageAtlas::add(const QImage &image)
+{
+	if (image.isNull())
+		return Region();
+
+	// Reuse a free region of the same size if possible.
+	// Most banners and icons have the same size, so
+	// this usually prevents the atlas from growing.
+	Region region;
+	const uint32_t key = ((uint32_t)image.width() << 16) | (uint32_t)image.height();
+	auto iter = m_free.find(key);
+	if (iter != m_free.end() && !iter->isEmpty()) {
+		region = iter->takeLast();
+	} else {
+		region = allocate(image.size());
+	}
+
+	// Copy the image into the page.
+	Page *const page = m_pages.at(region.page);
+	QPainter painter(&page->image);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+	painter.drawImage(region.rect.topLeft(), image);
+	painter.end();
+
+	// Update the uploaded pixmaps the next time they're used.
+	for (int i = 0; i < MAX_SCALE; i++) {
+		if (!page->pixmaps[i].isNull()) {
+			page->pending[i].append(region.rect);
+		}
+	}
+
+	return region;
+}
+
+/**
+ * Remove an image from the atlas.
+ * The region will be reused by an image of the same size.
+ * @param region Region.
+ */
+void ImageAtlas::remove(const Region &region)
+{
+	if (region.atlas != this)
+		return;
+
+	const uint32_t key = ((uint32_t)region.rect.width() << 16) | (uint32_t)region.rect.height();
+	m_free[key].append(region);
+}
+
+/**
+ * Remove all images from the atlas.
+ * All existing regions are invalidated.
+ */
+void ImageAtlas::clear(void)
+{
+	qDeleteAll(m_pages);
+	m_pages.clear();
+	m_free.clear();
+}
+
+/**
+ * Get the pixmap for a page.
+ * The pixmap is created or updated if necessary.
+ * @param page Page index.
+ * @param scale Scale factor.
+ * @return Page pixmap.
+ */
+const QPixmap &ImageAtlas::pagePixmap(int page, int scale) const
+{
+	Page *const p = m_pages.at(page);
+	QPixmap &pxm = p->pixmaps[scale - 1];
+	QVector<QRect> &pending = p->pending[scale - 1];
+
+	if (pxm.isNull()) {
+		// Upload the entire page.
+		// Hi-DPI pages use nearest-neighbor scaling,
+		// since banners and icons are pixel art.
+		if (scale == 1) {
+			pxm = QPixmap::fromImage(p->image);
+		} else {
+			pxm = QPixmap::fromImage(p->image.scaled(
+				p->image.size() * scale,
+				Qt::IgnoreAspectRatio, Qt::FastTransformation));
+		}
+		pending.clear();
+	} else if (!pending.isEmpty()) {
+		// Only update the regions that have changed.
+		QPainter painter(&pxm);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		foreach (const QRect &rect, pending) {
+			const QImage sub = p->image.copy(rect);
+			const QRect target(rect.topLeft() * scale, rect.size() * scale);
+			if (scale == 1) {
+				painter.drawImage(target.topLeft(), sub);
+			} else {
+				painter.drawImage(target.topLeft(), sub.scaled(
+					target.size(), Qt::IgnoreAspectRatio, Qt::FastTransformation));
+			}
+		}
+		painter.end();
+		pending.clear();
+	}
+
+	return pxm;
+}
+
+/**
+ * Draw an image from the atlas.
+ * If the paint device has a device pixel ratio greater than 1,
+ * a pre-scaled page is used.
+ * @param painter QPainter.
+ * @param target Target rectangle.
+ * @param region Region containing the image.
+ */
+void ImageAtlas::draw(QPainter *painter, const QRect &target, const Region &region) const
+{
+	if (region.atlas != this)
+		return;
+
+	int scale = 1;
+#if QT_VERSION >= QT_VERSION_CHECK(5,1,0)
+	if (painter->device()) {
+		scale = painter->device()->devicePixelRatio();
+		if (scale < 1) {
+			scale = 1;
+		} else if (scale > MAX_SCALE) {
+			scale = MAX_SCALE;
+		}
+	}
+#endif /* QT_VERSION >= QT_VERSION_CHECK(5,1,0) */
+
+	const QPixmap &pxm = pagePixmap(region.page, scale);
+	const QRect &rect = region.rect;
+	painter->drawPixmap(target, pxm, QRect(rect.topLeft() * scale, rect.size() * scale));
+}
+
+/**
+ * Copy an image from the atlas into a standalone QPixmap.
+ * This is intended for widgets that require a QPixmap,
+ * e.g. QLabel; item views should use draw() instead.
+ * @param region Region containing the image.
+ * @return QPixmap, or null QPixmap if the region is empty.
+ */
+QPixmap ImageAtlas::pixmap(const Region &region) const
+{
+	if (region.atlas != this)
+		return QPixmap();
+	return QPixmap::fromImage(m_pages.at(region.page)->image.copy(region.rect));
+}
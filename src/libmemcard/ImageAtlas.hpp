@@ -0,0 +1,159 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libmemcard]                      *
+ * ImageAtlas.hpp: Texture atlas for file banners and icons.               *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBMEMCARD_IMAGEATLAS_HPP__
+#define __LIBMEMCARD_IMAGEATLAS_HPP__
+
+// C includes.
+#include <stdint.h>
+
+// Qt includes.
+#include <QtCore/QHash>
+#include <QtCore/QMetaType>
+#include <QtCore/QRect>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
+#include <QtGui/QPixmap>
+
+class QPainter;
+
+/**
+ * Texture atlas for file banners and icons.
+ *
+ * Each Card has an ImageAtlas that holds every decoded banner
+ * and icon frame of its files. Images are packed into large pages,
+ * so views only need to upload one pixmap per page instead of one
+ * pixmap per image, and animating an icon only changes the source
+ * rectangle that's drawn.
+ *
+ * Page pixmaps are created on first use and updated incrementally
+ * as images are added. Scaled variants for Hi-DPI displays are
+ * cached separately.
+ *
+ * NOTE: ImageAtlas must only be used from the GUI thread,
+ * since it uses QPixmap.
+ */
+class ImageAtlas
+{
+	public:
+		ImageAtlas();
+		~ImageAtlas();
+
+	private:
+		Q_DISABLE_COPY(ImageAtlas)
+
+	public:
+		/**
+		 * Page size, in pixels.
+		 * Images larger than this get their own page.
+		 */
+		static const int PAGE_SIZE = 512;
+
+		/**
+		 * Maximum scale factor for Hi-DPI pages.
+		 */
+		static const int MAX_SCALE = 4;
+
+		/**
+		 * Region of the atlas containing an image.
+		 */
+		struct Region {
+			const ImageAtlas *atlas;	// Atlas. (nullptr if the region is empty)
+			int page;			// Page index.
+			QRect rect;			// Position within the page.
+
+			Region()
+				: atlas(nullptr)
+				, page(-1)
+			{ }
+
+			/**
+			 * Is this region empty?
+			 * @return True if empty; false if not.
+			 */
+			inline bool isNull(void) const
+			{
+				return (atlas == nullptr);
+			}
+
+			/**
+			 * Get the image size.
+			 * @return Image size.
+			 */
+			inline QSize size(void) const
+			{
+				return rect.size();
+			}
+		};
+
+		/**
+		 * Add an image to the atlas.
+		 * @param image Image.
+		 * @return Region containing the image, or an empty region if the image is null.
+		 */
+		Region add(const QImage &image);
+
+		/**
+		 * Remove an image from the atlas.
+		 * The region will be reused by an image of the same size.
+		 * @param region Region.
+		 */
+		void remove(const Region &region);
+
+		/**
+		 * Remove all images from the atlas.
+		 * All existing regions are invalidated.
+		 */
+		void clear(void);
+
+		/**
+		 * Draw an image from the atlas.
+		 * If the paint device has a device pixel ratio greater than 1,
+		 * a pre-scaled page is used.
+		 * @param painter QPainter.
+		 * @param target Target rectangle.
+		 * @param region Region containing the image.
+		 */
+		void draw(QPainter *painter, const QRect &target, const Region &region) const;
+
+		/**
+		 * Copy an image from the atlas into a standalone QPixmap.
+		 * This is intended for widgets that require a QPixmap,
+		 * e.g. QLabel; item views should use draw() instead.
+		 * @param region Region containing the image.
+		 * @return QPixmap, or null QPixmap if the region is empty.
+		 */
+		QPixmap pixmap(const Region &region) const;
+
+	private:
+		struct Page;
+		QVector<Page*> m_pages;
+
+		// Free regions, keyed by (width << 16) | height.
+		QHash<uint32_t, QVector<Region> > m_free;
+
+		/**
+		 * Allocate a region for an image.
+		 * @param size Image size.
+		 * @return Region.
+		 */
+		Region allocate(const QSize &size);
+
+		/**
+		 * Get the pixmap for a page.
+		 * The pixmap is created or updated if necessary.
+		 * @param page Page index.
+		 * @param scale Scale factor.
+		 * @return Page pixmap.
+		 */
+		const QPixmap &pagePixmap(int page, int scale) const;
+};
+
+Q_DECLARE_METATYPE(ImageAtlas::Region)
+
+#endif /* __LIBMEMCARD_IMAGEATLAS_HPP__ */
@@ -9,6 +9,7 @@
 #include "MemCardItemDelegate.hpp"
 
 #include "MemCardModel.hpp"
+#include "ImageAtlas.hpp"
 #include "card.h"
 
 // Qt includes.
@@ -38,6 +39,18 @@ class MemCardItemDelegatePrivate
 		QFont fontGameDesc(const QWidget *widget = 0) const;
 		QFont fontFileDesc(const QWidget *widget = 0) const;
 
+		/**
+		 * Paint an image from the card's ImageAtlas.
+		 * @param painter QPainter.
+		 * @param option Style option.
+		 * @param index Model index.
+		 * @param region Image region.
+		 */
+		void paintImageRegion(QPainter *painter,
+			const QStyleOptionViewItem &option,
+			const QModelIndex &index,
+			const ImageAtlas::Region &region) const;
+
 #ifdef Q_OS_WIN
 		// Win32: Theming functions.
 	private:
@@ -99,6 +112,40 @@ QFont MemCardItemDelegatePrivate::fontFileDesc(const QWidget *widget) const
 	return fontFileDesc;
 }
 
+/**
+ * Paint an image from the card's ImageAtlas.
+ * @param painter QPainter.
+ * @param option Style option.
+ * @param index Model index.
+ * @param region Image region.
+ */
+void MemCardItemDelegatePrivate::paintImageRegion(QPainter *painter,
+	const QStyleOptionViewItem &option,
+	const QModelIndex &index,
+	const ImageAtlas::Region &region) const
+{
+	QStyleOptionViewItem bgOption = option;
+	QStyle *const style = bgOption.widget ? bgOption.widget->style() : QApplication::style();
+
+	painter->save();
+
+	// Draw the background color first.
+	const QVariant bg_var = index.data(Qt::BackgroundRole);
+	if (bg_var.canConvert<QBrush>()) {
+		bgOption.backgroundBrush = bg_var.value<QBrush>();
+	}
+	style->drawControl(QStyle::CE_ItemViewItem, &bgOption, painter, bgOption.widget);
+
+	// Draw the image, centered in the cell.
+	if (!region.isNull()) {
+		const QRect target = QStyle::alignedRect(bgOption.direction,
+			Qt::AlignCenter, region.size(), bgOption.rect);
+		region.atlas->draw(painter, target, region);
+	}
+
+	painter->restore();
+}
+
 #ifdef Q_OS_WIN
 typedef bool (WINAPI *PtrIsAppThemed)(void);
 typedef bool (WINAPI *PtrIsThemeActive)(void);
@@ -188,6 +235,15 @@ void MemCardItemDelegate::paint(QPainter *painter,
 		return;
 	}
 
+	// Banners and icons are drawn directly from the card's ImageAtlas.
+	Q_D(const MemCardItemDelegate);
+	const QVariant region_var = index.data(MemCardModel::ImageRegionRole);
+	if (region_var.canConvert<ImageAtlas::Region>()) {
+		d->paintImageRegion(painter, option, index,
+			region_var.value<ImageAtlas::Region>());
+		return;
+	}
+
 	// TODO: Combine code with sizeHint().
 
 	// GCN file comments: "GameDesc\0FileDesc"
@@ -236,7 +292,6 @@ void MemCardItemDelegate::paint(QPainter *painter,
 	//textRect.adjust(hmargin, 0, -hmargin, 0);
 
 	// Get the fonts.
-	Q_D(const MemCardItemDelegate);
 	QFont fontGameDesc = d->fontGameDesc(bgOption.widget);
 	QFont fontFileDesc = d->fontFileDesc(bgOption.widget);
 
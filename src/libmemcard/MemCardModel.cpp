@@ -16,16 +16,18 @@
 #include "card.h"
 #include "util/array_size.h"
 
-// Icon animation helper.
-#include "IconAnimHelper.hpp"
+// Icon animation scheduler.
+#include "IconAnimScheduler.hpp"
 
 // C includes. (C++ namespace)
 #include <cassert>
 #include <climits>
 
+// C++ includes.
+#include <algorithm>
+
 // Qt includes.
 #include <QtCore/QHash>
-#include <QtCore/QTimer>
 #include <QApplication>
 #include <QtGui/QColor>
 #include <QtGui/QFont>
@@ -50,29 +52,61 @@ class MemCardModelPrivate
 	public:
 		Card *card;
 
-		QHash<const File*, IconAnimHelper*> animState;
+		// Icon animation scheduler.
+		IconAnimScheduler *animScheduler;
 
 		/**
 		 * Initialize the animation state for all files.
 		 */
 		void initAnimState(void);
 
+		// Row index for each file.
+		// Used to map animated icons and checksums back to rows.
+		QHash<const File*, int> fileRows;
+
+		/**
+		 * Update the row index for each file.
+		 * This must be called whenever files are added or removed.
+		 */
+		void updateFileRows(void);
+
 		/**
-		 * Initialize the animation state for a given file.
-		 * @param file File.
+		 * Notify the UI that a column has changed for the specified files.
+		 * Adjacent rows are merged into a single range.
+		 * @param files Files.
+		 * @param column Column.
 		 */
-		void initAnimState(const File *file);
+		void emitFilesChanged(const QVector<const File*> &files, int column);
 
 		/**
-		 * Update the animation timer state.
-		 * Starts the timer if animated icons are present; stops the timer if not.
+		 * Precomputed sort and filter keys for a file.
+		 * Strings are case-folded so they can be compared
+		 * without allocating any memory.
 		 */
-		void updateAnimTimerState(void);
+		struct FileKeys {
+			QString description;	// Description. (GameDesc\0FileDesc)
+			QString filename;	// Filename.
+			QString gameID;		// Game ID.
+			qint64 mtime;		// Last modified time. (Unix timestamp)
+			int size;		// Size, in blocks.
+			uint32_t mode;		// Mode.
+
+			// Text used for filtering.
+			// Contains all of the above strings.
+			QString searchText;
+		};
 
-		// Animation timer.
-		QTimer *animTimer;
-		// Pause count. If >0, animation is paused.
-		int pauseCounter;
+		// Keys for each row.
+		// Rebuilt on demand after files are added or removed.
+		mutable QVector<FileKeys> fileKeys;
+		mutable bool fileKeysValid;
+
+		/**
+		 * Get the sort and filter keys for all rows.
+		 * The keys are rebuilt if necessary.
+		 * @return Keys.
+		 */
+		const QVector<FileKeys> &keys(void) const;
 
 		// Style variables.
 		struct style_t {
@@ -130,15 +164,15 @@ class MemCardModelPrivate
 MemCardModelPrivate::MemCardModelPrivate(MemCardModel *q)
 	: q_ptr(q)
 	, card(nullptr)
-	, animTimer(new QTimer(q))
-	, pauseCounter(0)
+	, animScheduler(new IconAnimScheduler(q))
+	, fileKeysValid(false)
 	, fileCount(0)
 	, insertStart(-1)
 	, insertEnd(-1)
 {
-	// Connect animTimer's timeout() signal.
-	QObject::connect(animTimer, &QTimer::timeout,
-			 q, &MemCardModel::animTimerSlot);
+	// Connect animScheduler's iconsChanged() signal.
+	QObject::connect(animScheduler, &IconAnimScheduler::iconsChanged,
+			 q, &MemCardModel::animScheduler_iconsChanged_slot);
 
 	// Initialize the style variables.
 	style.init();
@@ -232,12 +266,7 @@ QIcon MemCardModelPrivate::style_t::loadIcon(const QString &dir, const QString &
 
 MemCardModelPrivate::~MemCardModelPrivate()
 {
-	animTimer->stop();
-	delete animTimer;
-
-	// TODO: Check for race conditions.
-	qDeleteAll(animState);
-	animState.clear();
+	delete animScheduler;
 }
 
 /**
@@ -245,57 +274,117 @@ MemCardModelPrivate::~MemCardModelPrivate()
  */
 void MemCardModelPrivate::initAnimState(void)
 {
-	animTimer->stop();
-
-	// TODO: Check for race conditions.
-	qDeleteAll(animState);
-	animState.clear();
+	animScheduler->clear();
+	updateFileRows();
 
 	if (!card)
 		return;
 
 	// Initialize the animation state.
+	// Files without animated icons are ignored by the scheduler.
 	for (int i = 0; i < fileCount; i++) {
-		const File *file = card->getFile(i);
-		initAnimState(file);
+		animScheduler->addFile(card->getFile(i));
 	}
-
-	// Start the timer if animated icons are present.
-	updateAnimTimerState();
 }
 
 /**
- * Initialize the animation state for a given file.
- * @param file File.
+ * Update the row index for each file.
+ * This must be called whenever files are added or removed.
  */
-void MemCardModelPrivate::initAnimState(const File *file)
+void MemCardModelPrivate::updateFileRows(void)
 {
-	int numIcons = file->iconCount();
-	if (numIcons <= 1) {
-		// Not an animated icon.
-		animState.remove(file);
+	// Row indexes have changed, so the keys need to be rebuilt.
+	fileKeys.clear();
+	fileKeysValid = false;
+
+	fileRows.clear();
+	if (!card)
 		return;
+
+	const int count = card->fileCount();
+	fileRows.reserve(count);
+	for (int i = 0; i < count; i++) {
+		fileRows.insert(card->getFile(i), i);
 	}
+}
+
+/**
+ * Notify the UI that a column has changed for the specified files.
+ * Adjacent rows are merged into a single range.
+ * @param files Files.
+ * @param column Column.
+ */
+void MemCardModelPrivate::emitFilesChanged(const QVector<const File*> &files, int column)
+{
+	if (!card)
+		return;
 
-	IconAnimHelper *helper = new IconAnimHelper(file);
-	animState.insert(file, helper);
+	// Get the rows for the changed files.
+	QVector<int> rows;
+	rows.reserve(files.size());
+	foreach (const File *file, files) {
+		const int row = fileRows.value(file, -1);
+		if (row >= 0 && row < fileCount) {
+			rows.append(row);
+		}
+	}
+	if (rows.isEmpty())
+		return;
+	std::sort(rows.begin(), rows.end());
+
+	Q_Q(MemCardModel);
+	int first = rows.at(0);
+	int last = first;
+	for (int i = 1; i < rows.size(); i++) {
+		const int row = rows.at(i);
+		if (row == last + 1) {
+			last = row;
+			continue;
+		}
+		emit q->dataChanged(q->index(first, column), q->index(last, column));
+		first = last = row;
+	}
+	emit q->dataChanged(q->index(first, column), q->index(last, column));
 }
 
 /**
- * Update the animation timer state.
- * Starts the timer if animated icons are present; stops the timer if not.
+ * Get the sort and filter keys for all rows.
+ * The keys are rebuilt if necessary.
+ * @return Keys.
  */
-void MemCardModelPrivate::updateAnimTimerState(void)
+const QVector<MemCardModelPrivate::FileKeys> &MemCardModelPrivate::keys(void) const
 {
-	if (pauseCounter <= 0 && !animState.isEmpty()) {
-		// Animation is not paused, and we have animated icons.
-		// Start the timer.
-		animTimer->start(IconAnimHelper::FAST_ANIM_TIMER);
-	} else {
-		// Either animation is paused, or we don't have animated icons.
-		// Stop the timer.
-		animTimer->stop();
+	if (fileKeysValid)
+		return fileKeys;
+
+	fileKeys.clear();
+	fileKeysValid = true;
+	if (!card)
+		return fileKeys;
+
+	fileKeys.resize(fileCount);
+	for (int i = 0; i < fileCount; i++) {
+		const File *const file = card->getFile(i);
+		FileKeys &k = fileKeys[i];
+		k.description = file->description().toCaseFolded();
+		k.filename = file->filename().toCaseFolded();
+		k.gameID = file->gameID().toCaseFolded();
+		k.mtime = file->mtimeUnix();
+		k.size = file->size();
+		k.mode = file->mode();
+
+		// NOTE: Fields are separated with newlines so a
+		// search string can't match across fields.
+		k.searchText.reserve(k.description.size() + k.filename.size() + k.gameID.size() + 2);
+		k.searchText = k.description;
+		k.searchText.replace(QChar(L'\0'), QChar(L'\n'));
+		k.searchText += QChar(L'\n');
+		k.searchText += k.filename;
+		k.searchText += QChar(L'\n');
+		k.searchText += k.gameID;
 	}
+
+	return fileKeys;
 }
 
 /** MemCardModel **/
@@ -353,7 +442,9 @@ QVariant MemCardModel::data(const QModelIndex& index, int role) const
 				case COL_SIZE:
 					return file->size();
 				case COL_MTIME:
-					return file->mtime();
+					// NOTE: Formatted by the card to avoid
+					// constructing a QDateTime on every paint.
+					return d->card->formatTimestamp(file->mtimeUnix());
 				case COL_MODE:
 					return file->modeAsString();
 				case COL_GAMEID:
@@ -369,16 +460,9 @@ QVariant MemCardModel::data(const QModelIndex& index, int role) const
 			// Images must use Qt::DecorationRole.
 			switch (index.column()) {
 				case COL_ICON:
-					// Check if this is an animated icon.
-					if (d->animState.contains(file)) {
-						// Animated icon.
-						IconAnimHelper *helper = d->animState.value(file);
-						return helper->icon();
-					} else {
-						// Not an animated icon.
-						// Return the first icon.
-						return file->icon(0);
-					}
+					// Get the current icon.
+					// If the icon isn't animated, this is the first icon.
+					return d->animScheduler->icon(file);
 
 				case COL_BANNER:
 					return file->banner();
@@ -399,6 +483,20 @@ QVariant MemCardModel::data(const QModelIndex& index, int role) const
 			}
 			break;
 
+		case ImageRegionRole:
+			// Images are drawn from the card's ImageAtlas
+			// by MemCardItemDelegate.
+			switch (index.column()) {
+				case COL_ICON:
+					return QVariant::fromValue(
+						file->iconRegion(d->animScheduler->iconIndex(file)));
+				case COL_BANNER:
+					return QVariant::fromValue(file->bannerRegion());
+				default:
+					break;
+			}
+			break;
+
 		case Qt::TextAlignmentRole:
 			switch (index.column()) {
 				case COL_SIZE:
@@ -525,6 +623,86 @@ QVariant MemCardModel::headerData(int section, Qt::Orientation orientation, int
 	return QVariant();
 }
 
+/**
+ * Can a column be sorted using precomputed sort keys?
+ * @param column Column.
+ * @return True if compareRows() can be used for this column; false if not.
+ */
+bool MemCardModel::hasSortKeys(int column) const
+{
+	switch (column) {
+		case COL_DESCRIPTION:
+		case COL_SIZE:
+		case COL_MTIME:
+		case COL_MODE:
+		case COL_GAMEID:
+		case COL_FILENAME:
+			return true;
+		default:
+			break;
+	}
+	return false;
+}
+
+/**
+ * Compare two rows using precomputed sort keys.
+ * Strings are compared case-insensitively.
+ * @param leftRow Left row.
+ * @param rightRow Right row.
+ * @param column Column. (hasSortKeys() must be true)
+ * @return Negative if left < right; 0 if equal; positive if left > right.
+ */
+int MemCardModel::compareRows(int leftRow, int rightRow, int column) const
+{
+	Q_D(const MemCardModel);
+	const QVector<MemCardModelPrivate::FileKeys> &keys = d->keys();
+	assert(leftRow >= 0 && leftRow < keys.size());
+	assert(rightRow >= 0 && rightRow < keys.size());
+	if (leftRow < 0 || leftRow >= keys.size() ||
+	    rightRow < 0 || rightRow >= keys.size())
+	{
+		return 0;
+	}
+
+	const MemCardModelPrivate::FileKeys &kl = keys.at(leftRow);
+	const MemCardModelPrivate::FileKeys &kr = keys.at(rightRow);
+	switch (column) {
+		case COL_DESCRIPTION:
+			return kl.description.compare(kr.description);
+		case COL_SIZE:
+			return (kl.size < kr.size ? -1 : (kl.size > kr.size ? 1 : 0));
+		case COL_MTIME:
+			return (kl.mtime < kr.mtime ? -1 : (kl.mtime > kr.mtime ? 1 : 0));
+		case COL_MODE:
+			return (kl.mode < kr.mode ? -1 : (kl.mode > kr.mode ? 1 : 0));
+		case COL_GAMEID:
+			return kl.gameID.compare(kr.gameID);
+		case COL_FILENAME:
+			return kl.filename.compare(kr.filename);
+		default:
+			break;
+	}
+
+	// No sort key for this column.
+	return 0;
+}
+
+/**
+ * Check if a row contains the specified text.
+ * The description, filename, and game ID are checked.
+ * @param row Row.
+ * @param foldedText Text to search for. (must be case-folded)
+ * @return True if the row contains the text; false if not.
+ */
+bool MemCardModel::rowContainsText(int row, const QString &foldedText) const
+{
+	Q_D(const MemCardModel);
+	const QVector<MemCardModelPrivate::FileKeys> &keys = d->keys();
+	if (row < 0 || row >= keys.size())
+		return false;
+	return keys.at(row).searchText.contains(foldedText);
+}
+
 /**
  * Set the memory card to use in this model.
  * @param card Memory card.
@@ -552,8 +730,13 @@ void MemCardModel::setCard(Card *card)
 			   this, &MemCardModel::card_filesAboutToBeRemoved_slot);
 		disconnect(d->card, &Card::filesRemoved,
 			   this, &MemCardModel::card_filesRemoved_slot);
+		disconnect(d->card, &Card::fileChanged,
+			   this, &MemCardModel::card_fileChanged_slot);
+		disconnect(d->card, &Card::checksumsChanged,
+			   this, &MemCardModel::card_checksumsChanged_slot);
 
 		d->card = nullptr;
+		d->initAnimState();
 
 		// Done removing rows.
 		d->fileCount = 0;
@@ -586,6 +769,10 @@ void MemCardModel::setCard(Card *card)
 			this, &MemCardModel::card_filesAboutToBeRemoved_slot);
 		connect(d->card, &Card::filesRemoved,
 			this, &MemCardModel::card_filesRemoved_slot);
+		connect(d->card, &Card::fileChanged,
+			this, &MemCardModel::card_fileChanged_slot);
+		connect(d->card, &Card::checksumsChanged,
+			this, &MemCardModel::card_checksumsChanged_slot);
 
 		// Done adding rows.
 		if (fileCount > 0)
@@ -604,8 +791,7 @@ void MemCardModel::setCard(Card *card)
 void MemCardModel::pauseAnimation(void)
 {
 	Q_D(MemCardModel);
-	d->pauseCounter++;
-	d->updateAnimTimerState();
+	d->animScheduler->pause();
 }
 
 /**
@@ -617,46 +803,20 @@ void MemCardModel::pauseAnimation(void)
 void MemCardModel::resumeAnimation(void)
 {
 	Q_D(MemCardModel);
-	if (d->pauseCounter > 0) {
-		d->pauseCounter--;
-	} else {
-		// Not paused...
-		d->pauseCounter = 0; // TODO: Probably not needed.
-	}
-
-	d->updateAnimTimerState();
+	d->animScheduler->resume();
 }
 
 /** Private slots. **/
 
 /**
- * Animation timer slot.
+ * Animated icons have changed.
+ * @param files Files whose icons have changed.
  */
-void MemCardModel::animTimerSlot(void)
+void MemCardModel::animScheduler_iconsChanged_slot(const QVector<const File*> &files)
 {
+	// Notify the UI that the icons have changed.
 	Q_D(MemCardModel);
-	if (!d->card) {
-		d->animTimer->stop();
-		return;
-	}
-
-	// Check for icon animations.
-	for (int i = 0; i < d->fileCount; i++) {
-		const File *file = d->card->getFile(i);
-		IconAnimHelper *helper = d->animState.value(file);
-		if (!helper)
-			continue;
-
-		// Tell the IconAnimHelper that a timer tick has occurred.
-		// TODO: Connect the timer to the IconAnimHelper directly?
-		bool iconUpdated = helper->tick();
-		if (iconUpdated) {
-			// Icon has been updated.
-			// Notify the UI that the icon has changed.
-			QModelIndex iconIndex = createIndex(i, MemCardModel::COL_ICON);
-			emit dataChanged(iconIndex, iconIndex);
-		}
-	}
+	d->emitFilesChanged(files, COL_ICON);
 }
 
 /**
@@ -670,6 +830,7 @@ void MemCardModel::card_destroyed_slot(QObject *obj)
 	if (obj == d->card) {
 		// Our Card was destroyed.
 		d->card = nullptr;
+		d->updateFileRows();
 		int old_fileCount = d->fileCount;
 		if (old_fileCount > 0)
 			beginRemoveRows(QModelIndex(), 0, (old_fileCount - 1));
@@ -705,8 +866,7 @@ void MemCardModel::card_filesInserted_slot(void)
 	// If these files have animated icons, add them.
 	if (d->insertStart >= 0 && d->insertEnd >= 0) {
 		for (int i = d->insertStart; i <= d->insertEnd; i++) {
-			const File *file = d->card->getFile(i);
-			d->initAnimState(file);
+			d->animScheduler->addFile(d->card->getFile(i));
 		}
 
 		// Reset the row insert start/end indexes.
@@ -714,12 +874,10 @@ void MemCardModel::card_filesInserted_slot(void)
 		d->insertEnd = -1;
 	}
 
-	// Update the animation timer state.
-	d->updateAnimTimerState();
-
 	// Update the file count.
 	if (d->card)
 		d->fileCount = d->card->fileCount();
+	d->updateFileRows();
 
 	// Done adding rows.
 	endInsertRows();
@@ -738,8 +896,7 @@ void MemCardModel::card_filesAboutToBeRemoved_slot(int start, int end)
 	// Remove animation states for these files.
 	Q_D(MemCardModel);
 	for (int i = start; i <= end; i++) {
-		const File *file = d->card->getFile(i);
-		d->animState.remove(file);
+		d->animScheduler->removeFile(d->card->getFile(i));
 	}
 }
 
@@ -752,11 +909,41 @@ void MemCardModel::card_filesRemoved_slot(void)
 	Q_D(MemCardModel);
 	if (d->card)
 		d->fileCount = d->card->fileCount();
+	d->updateFileRows();
 
 	// Done removing rows.
 	endRemoveRows();
 }
 
+/**
+ * A file's banner and icons have been loaded.
+ * @param idx File index.
+ */
+void MemCardModel::card_fileChanged_slot(int idx)
+{
+	Q_D(MemCardModel);
+	if (!d->card || idx < 0 || idx >= d->fileCount)
+		return;
+
+	// Reinitialize the animation state, since the
+	// file may now have an animated icon.
+	d->animScheduler->addFile(d->card->getFile(idx));
+
+	// Notify the UI that the icon and banner have changed.
+	emit dataChanged(createIndex(idx, COL_ICON), createIndex(idx, COL_BANNER));
+}
+
+/**
+ * File checksums have been verified.
+ * @param files Files whose checksums have changed.
+ */
+void MemCardModel::card_checksumsChanged_slot(const QVector<const File*> &files)
+{
+	// Notify the UI that the checksum status has changed.
+	Q_D(MemCardModel);
+	d->emitFilesChanged(files, COL_ISVALID);
+}
+
 /** Slots. **/
 
 /**
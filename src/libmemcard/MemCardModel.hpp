@@ -10,9 +10,11 @@
 #define __MCRECOVER_MEMCARDMODEL_HPP__
 
 class Card;
+class File;
 
 // Qt includes.
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QVector>
 
 class MemCardModelPrivate;
 
@@ -46,6 +48,12 @@ class MemCardModel : public QAbstractListModel
 			COL_MAX
 		};
 
+		enum Role {
+			// Image region in the card's ImageAtlas.
+			// (ImageAtlas::Region; COL_ICON and COL_BANNER only)
+			ImageRegionRole = Qt::UserRole,
+		};
+
 		// Qt Model/View interface.
 		int rowCount(const QModelIndex& parent = QModelIndex()) const final;
 		int columnCount(const QModelIndex& parent = QModelIndex()) const final;
@@ -59,6 +67,34 @@ class MemCardModel : public QAbstractListModel
 		 */
 		void setCard(Card *card);
 
+		/** Sorting and filtering **/
+
+		/**
+		 * Can a column be sorted using precomputed sort keys?
+		 * @param column Column.
+		 * @return True if compareRows() can be used for this column; false if not.
+		 */
+		bool hasSortKeys(int column) const;
+
+		/**
+		 * Compare two rows using precomputed sort keys.
+		 * Strings are compared case-insensitively.
+		 * @param leftRow Left row.
+		 * @param rightRow Right row.
+		 * @param column Column. (hasSortKeys() must be true)
+		 * @return Negative if left < right; 0 if equal; positive if left > right.
+		 */
+		int compareRows(int leftRow, int rightRow, int column) const;
+
+		/**
+		 * Check if a row contains the specified text.
+		 * The description, filename, and game ID are checked.
+		 * @param row Row.
+		 * @param foldedText Text to search for. (must be case-folded)
+		 * @return True if the row contains the text; false if not.
+		 */
+		bool rowContainsText(int row, const QString &foldedText) const;
+
 	public slots:
 		/**
 		 * Pause animation.
@@ -78,10 +114,10 @@ class MemCardModel : public QAbstractListModel
 
 	private slots:
 		/**
-		 * Animation timer slot.
-		 * Wrapper for MemCardModelPrivate::animTimerSlot().
+		 * Animated icons have changed.
+		 * @param files Files whose icons have changed.
 		 */
-		void animTimerSlot(void);
+		void animScheduler_iconsChanged_slot(const QVector<const File*> &files);
 
 		/**
 		 * Card object was destroyed.
@@ -113,6 +149,18 @@ class MemCardModel : public QAbstractListModel
 		 */
 		void card_filesRemoved_slot(void);
 
+		/**
+		 * A file's banner and icons have been loaded.
+		 * @param idx File index.
+		 */
+		void card_fileChanged_slot(int idx);
+
+		/**
+		 * File checksums have been verified.
+		 * @param files Files whose checksums have changed.
+		 */
+		void card_checksumsChanged_slot(const QVector<const File*> &files);
+
 		/**
 		 * The system theme has changed.
 		 */
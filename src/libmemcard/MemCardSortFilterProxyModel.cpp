@@ -7,13 +7,52 @@
  ***************************************************************************/
 
 #include "MemCardSortFilterProxyModel.hpp"
+#include "MemCardModel.hpp"
 
 MemCardSortFilterProxyModel::MemCardSortFilterProxyModel(QObject *parent)
 	: super(parent)
+	, m_memCardModel(nullptr)
 { }
 
+void MemCardSortFilterProxyModel::setSourceModel(QAbstractItemModel *sourceModel)
+{
+	m_memCardModel = qobject_cast<const MemCardModel*>(sourceModel);
+	super::setSourceModel(sourceModel);
+}
+
+/**
+ * Get the filter text.
+ * @return Filter text.
+ */
+QString MemCardSortFilterProxyModel::filterText(void) const
+{
+	return m_filterText;
+}
+
+/**
+ * Set the filter text.
+ * Only files whose description, filename, or game ID
+ * contain this text (case-insensitive) will be shown.
+ * @param text Filter text. (empty to show all files)
+ */
+void MemCardSortFilterProxyModel::setFilterText(const QString &text)
+{
+	if (m_filterText == text)
+		return;
+
+	m_filterText = text;
+	m_filterTextFolded = text.trimmed().toCaseFolded();
+	invalidateFilter();
+}
+
 bool MemCardSortFilterProxyModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
 {
+	if (m_memCardModel && !m_filterTextFolded.isEmpty()) {
+		// Check the precomputed filter text.
+		if (!m_memCardModel->rowContainsText(source_row, m_filterTextFolded))
+			return false;
+	}
+
 	return super::filterAcceptsRow(source_row, source_parent);
 }
 
@@ -25,11 +64,17 @@ bool MemCardSortFilterProxyModel::lessThan(const QModelIndex &left, const QModel
 		return super::lessThan(left, right);
 	}
 
+	if (m_memCardModel && left.column() == right.column() &&
+	    m_memCardModel->hasSortKeys(left.column()))
+	{
+		// Use the precomputed sort keys.
+		// This doesn't allocate any memory.
+		return (m_memCardModel->compareRows(left.row(), right.row(), left.column()) < 0);
+	}
+
 	const QVariant vLeft = left.data();
 	const QVariant vRight = right.data();
 
-	// FIXME: Verify that this works with embedded null characters (L'\0'),
-	// which is used to separate GameDesc from FileDesc in a single QString.
 	if (vLeft.type() == QVariant::String &&
 	    vRight.type() == QVariant::String)
 	{
@@ -11,6 +11,8 @@
 
 #include <QSortFilterProxyModel>
 
+class MemCardModel;
+
 class MemCardSortFilterProxyModel : public QSortFilterProxyModel
 {
 	Q_OBJECT
@@ -23,8 +25,33 @@ class MemCardSortFilterProxyModel : public QSortFilterProxyModel
 		Q_DISABLE_COPY(MemCardSortFilterProxyModel)
 
 	public:
+		void setSourceModel(QAbstractItemModel *sourceModel) final;
 		bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const final;
 		bool lessThan(const QModelIndex &left, const QModelIndex &right) const final;
+
+		/**
+		 * Get the filter text.
+		 * @return Filter text.
+		 */
+		QString filterText(void) const;
+
+	public slots:
+		/**
+		 * Set the filter text.
+		 * Only files whose description, filename, or game ID
+		 * contain this text (case-insensitive) will be shown.
+		 * @param text Filter text. (empty to show all files)
+		 */
+		void setFilterText(const QString &text);
+
+	private:
+		// Source model, if it's a MemCardModel.
+		// If set, its precomputed sort keys are used.
+		const MemCardModel *m_memCardModel;
+
+		// Filter text.
+		QString m_filterText;
+		QString m_filterTextFolded;
 };
 
 #endif /* __MCRECOVER_MEMCARDSORTFILTERPROXYMODEL_HPP__ */
@@ -14,11 +14,92 @@
 namespace TimeFuncs {
 
 /**
- * Time difference between Unix and GCN epochs, in seconds.
- * GCN epoch is:  2000/01/01 12:00 AM UTC.
- * Unix epoch is: 1970/01/01 12:00 AM UTC.
+ * Convert a Unix timestamp to a Gregorian calendar date and time.
+ * @param unixTime	[in] Unix timestamp.
+ * @param civil		[out] Calendar date and time.
  */
-static const uint32_t GCN_EPOCH = 0x386D4380;
+void civilFromUnixTime(int64_t unixTime, CivilTime *civil)
+{
+	// Split into days and seconds.
+	int64_t days = unixTime / 86400;
+	int64_t secs = unixTime % 86400;
+	if (secs < 0) {
+		secs += 86400;
+		days--;
+	}
+	civil->hour   = (int)(secs / 3600);
+	civil->minute = (int)((secs / 60) % 60);
+	civil->second = (int)(secs % 60);
+
+	// Convert days to a civil date.
+	// This is the inverse of daysFromCivil().
+	days += 719468;
+	const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	const int64_t doe = days - (era * 146097);
+	const int64_t yoe = (doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365;
+	const int64_t doy = doe - ((yoe * 365) + (yoe / 4) - (yoe / 100));
+	const int64_t mp = ((doy * 5) + 2) / 153;
+	civil->day   = (int)(doy - (((153 * mp) + 2) / 5) + 1);
+	civil->month = (int)(mp < 10 ? mp + 3 : mp - 9);
+	civil->year  = (int)(yoe + (era * 400) + (civil->month <= 2 ? 1 : 0));
+}
+
+/**
+ * Convert a BCD byte to binary.
+ * @param bcd BCD byte.
+ * @return Binary value, or -1 if the byte isn't valid BCD.
+ */
+static inline int bcdToBin(uint8_t bcd)
+{
+	if ((bcd & 0x0F) > 9 || (bcd >> 4) > 9)
+		return -1;
+	return ((bcd >> 4) * 10) + (bcd & 0x0F);
+}
+
+/**
+ * Convert a VMU timestamp to a Unix timestamp.
+ *
+ * NOTE: Dreamcast doesn't support timezones, so these times
+ * will all be handled as UTC.
+ *
+ * @param vmuTimestamp VMU timestamp.
+ * @return Unix timestamp, or INVALID_TIME if the timestamp is invalid.
+ */
+int64_t vmuToUnixTime(const vmu_timestamp &vmuTimestamp)
+{
+	// Timestamp is stored as BCD.
+	const int century = bcdToBin(vmuTimestamp.century);
+	const int year    = bcdToBin(vmuTimestamp.year);
+	const int month   = bcdToBin(vmuTimestamp.month);
+	const int day     = bcdToBin(vmuTimestamp.day);
+	const int hour    = bcdToBin(vmuTimestamp.hour);
+	const int minute  = bcdToBin(vmuTimestamp.minute);
+	const int second  = bcdToBin(vmuTimestamp.second);
+
+	if (century < 0 || year < 0 ||
+	    month < 1 || month > 12 || day < 1 || day > 31 ||
+	    hour < 0 || hour > 23 || minute < 0 || minute > 59 ||
+	    second < 0 || second > 59)
+	{
+		// Invalid timestamp.
+		return INVALID_TIME;
+	}
+
+	return unixTimeFromCivil((century * 100) + year, month, day,
+				 hour, minute, second);
+}
+
+/**
+ * Convert a Unix timestamp to QDateTime.
+ * @param unixTime Unix timestamp.
+ * @return QDateTime in UTC, or invalid QDateTime if unixTime is INVALID_TIME.
+ */
+QDateTime fromUnixTime(int64_t unixTime)
+{
+	if (unixTime == INVALID_TIME)
+		return QDateTime();
+	return QDateTime::fromMSecsSinceEpoch(unixTime * 1000, Qt::UTC);
+}
 
 /**
  * Convert a GCN timestamp to QDateTime.
@@ -31,8 +112,7 @@ static const uint32_t GCN_EPOCH = 0x386D4380;
  */
 QDateTime fromGcnTimestamp(uint32_t gcnTimestamp)
 {
-	return QDateTime::fromMSecsSinceEpoch(
-		((qint64)gcnTimestamp + GCN_EPOCH) * 1000, Qt::UTC);
+	return fromUnixTime(gcnToUnixTime(gcnTimestamp));
 }
 
 /**
@@ -46,9 +126,7 @@ QDateTime fromGcnTimestamp(uint32_t gcnTimestamp)
  */
 uint32_t toGcnTimestamp(const QDateTime &qDateTime)
 {
-	// TODO: How will we handle 32-bit overflow?
-	// TODO: How will we handle timestamps earlier than 2000/01/01?
-	return (uint32_t)(qDateTime.toMSecsSinceEpoch() / 1000) - GCN_EPOCH;
+	return unixTimeToGcn(qDateTime.toMSecsSinceEpoch() / 1000);
 }
 
 /**
@@ -62,26 +140,7 @@ uint32_t toGcnTimestamp(const QDateTime &qDateTime)
  */
 QDateTime fromVmuTimestamp(const vmu_timestamp &vmuTimestamp)
 {
-	// Timestamp is stored as BCD.
-	// TODO: Better way to convert to/from BCD?
-	int year =   ((vmuTimestamp.century >> 4) * 1000) +
-		     ((vmuTimestamp.century & 0xF) * 100) +
-		     ((vmuTimestamp.year >> 4) * 10) +
-		      (vmuTimestamp.year & 0xF);
-	int month =  ((vmuTimestamp.month >> 4) * 10) +
-		      (vmuTimestamp.month & 0xF);
-	int day =    ((vmuTimestamp.day >> 4) * 10) +
-		      (vmuTimestamp.day & 0xF);
-	int hour =   ((vmuTimestamp.hour >> 4) * 10) +
-		      (vmuTimestamp.hour & 0xF);
-	int minute = ((vmuTimestamp.minute >> 4) * 10) +
-		      (vmuTimestamp.minute & 0xF);
-	int second = ((vmuTimestamp.second >> 4) * 10) +
-		      (vmuTimestamp.second & 0xF);
-
-	// TODO: Verify that the values are in range.
-	return QDateTime(QDate(year, month, day),
-			 QTime(hour, minute, second), Qt::UTC);
+	return fromUnixTime(vmuToUnixTime(vmuTimestamp));
 }
 
 }
@@ -20,6 +20,162 @@ extern "C" struct _vmu_timestamp;
 
 namespace TimeFuncs {
 
+/**
+ * Time difference between Unix and GCN epochs, in seconds.
+ * GCN epoch is:  2000/01/01 12:00 AM UTC.
+ * Unix epoch is: 1970/01/01 12:00 AM UTC.
+ */
+static const uint32_t GCN_EPOCH = 0x386D4380;
+
+/**
+ * Invalid Unix timestamp.
+ * Returned if a timestamp can't be decoded.
+ */
+static const int64_t INVALID_TIME = (-0x7FFFFFFFFFFFFFFFLL - 1);
+
+/** Integer conversion functions **/
+// These functions don't use QDateTime, so they can be used
+// for every file on a card without allocating anything.
+// All times are in seconds since the Unix epoch, UTC.
+
+/**
+ * Get the era for a civil date. (internal function)
+ * An era is a 400-year Gregorian cycle, starting on March 1.
+ * @param y Year, adjusted to start on March 1.
+ * @return Era.
+ */
+static inline constexpr int64_t civilEra(int64_t y)
+{
+	return (y >= 0 ? y : y - 399) / 400;
+}
+
+/**
+ * Get the day of the year for a civil date. (internal function)
+ * @param m Month. (1-12)
+ * @param d Day. (1-31)
+ * @return Day of the year, starting on March 1. (0-365)
+ */
+static inline constexpr int64_t civilDayOfYear(int m, int d)
+{
+	return ((153 * (m > 2 ? m - 3 : m + 9)) + 2) / 5 + d - 1;
+}
+
+/**
+ * Get the day of the era for a civil date. (internal function)
+ * @param yoe Year of the era. (0-399)
+ * @param doy Day of the year, starting on March 1. (0-365)
+ * @return Day of the era. (0-146096)
+ */
+static inline constexpr int64_t civilDayOfEra(int64_t yoe, int64_t doy)
+{
+	return (yoe * 365) + (yoe / 4) - (yoe / 100) + doy;
+}
+
+/**
+ * Convert a March-based civil date to days since the Unix epoch. (internal function)
+ * @param y Year, adjusted to start on March 1.
+ * @param m Month. (1-12)
+ * @param d Day. (1-31)
+ * @return Days since the Unix epoch.
+ */
+static inline constexpr int64_t daysFromMarchCivil(int64_t y, int m, int d)
+{
+	return (civilEra(y) * 146097) +
+		civilDayOfEra(y - (civilEra(y) * 400), civilDayOfYear(m, d)) -
+		719468;
+}
+
+/**
+ * Convert a Gregorian calendar date to days since the Unix epoch.
+ * @param y Year.
+ * @param m Month. (1-12)
+ * @param d Day. (1-31)
+ * @return Days since the Unix epoch.
+ */
+static inline constexpr int64_t daysFromCivil(int y, int m, int d)
+{
+	return daysFromMarchCivil(m <= 2 ? (int64_t)y - 1 : (int64_t)y, m, d);
+}
+
+/**
+ * Convert a Gregorian calendar date and time to a Unix timestamp.
+ * @param y Year.
+ * @param m Month. (1-12)
+ * @param d Day. (1-31)
+ * @param hour Hour. (0-23)
+ * @param minute Minute. (0-59)
+ * @param second Second. (0-59)
+ * @return Unix timestamp.
+ */
+static inline constexpr int64_t unixTimeFromCivil(int y, int m, int d,
+	int hour, int minute, int second)
+{
+	return (daysFromCivil(y, m, d) * 86400) +
+		(hour * 3600) + (minute * 60) + second;
+}
+
+/**
+ * Broken-down calendar date and time.
+ */
+struct CivilTime {
+	int year;
+	int month;	// 1-12
+	int day;	// 1-31
+	int hour;	// 0-23
+	int minute;	// 0-59
+	int second;	// 0-59
+};
+
+/**
+ * Convert a Unix timestamp to a Gregorian calendar date and time.
+ * @param unixTime	[in] Unix timestamp.
+ * @param civil		[out] Calendar date and time.
+ */
+void civilFromUnixTime(int64_t unixTime, CivilTime *civil);
+
+/**
+ * Convert a GCN timestamp to a Unix timestamp.
+ * @param gcnTimestamp GCN timestamp.
+ * @return Unix timestamp.
+ */
+static inline constexpr int64_t gcnToUnixTime(uint32_t gcnTimestamp)
+{
+	return (int64_t)gcnTimestamp + GCN_EPOCH;
+}
+
+/**
+ * Convert a Unix timestamp to a GCN timestamp.
+ * TODO: How will we handle 32-bit overflow?
+ * TODO: How will we handle timestamps earlier than 2000/01/01?
+ * @param unixTime Unix timestamp.
+ * @return GCN timestamp.
+ */
+static inline constexpr uint32_t unixTimeToGcn(int64_t unixTime)
+{
+	return (uint32_t)(unixTime - GCN_EPOCH);
+}
+
+/**
+ * Convert a VMU timestamp to a Unix timestamp.
+ *
+ * NOTE: Dreamcast doesn't support timezones, so these times
+ * will all be handled as UTC.
+ *
+ * @param vmuTimestamp VMU timestamp.
+ * @return Unix timestamp, or INVALID_TIME if the timestamp is invalid.
+ */
+int64_t vmuToUnixTime(const struct _vmu_timestamp &vmuTimestamp);
+
+/** QDateTime conversion functions **/
+// These should only be used for display purposes.
+
+/**
+ * Convert a Unix timestamp to QDateTime.
+ * @param unixTime Unix timestamp.
+ * @return QDateTime in UTC, or invalid QDateTime if unixTime is INVALID_TIME.
+ */
+QDateTime fromUnixTime(int64_t unixTime);
+
 /**
  * Convert a GCN timestamp to QDateTime.
  *
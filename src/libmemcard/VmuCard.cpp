@@ -212,8 +212,7 @@ int VmuCardPrivate::loadSysInfo(void)
 	bat_info.valid_freeblocks = 1;
 
 	// Root block.
-	file->seek(VMU_ROOT_BLOCK_ADDRESS * blockSize);
-	qint64 sz = file->read((char*)&mc_root, sizeof(mc_root));
+	qint64 sz = pread(&mc_root, sizeof(mc_root), VMU_ROOT_BLOCK_ADDRESS * blockSize);
 	if (sz < (qint64)sizeof(mc_root)) {
 		// Error reading the root block.
 		// Zero the root block, directory, and FAT.
@@ -338,9 +337,8 @@ int VmuCardPrivate::loadFat(void)
 		return -2;
 	}
 
-	file->seek(mc_root.fat_addr * blockSize);
-	quint64 sz = file->read((char*)&mc_fat, sizeof(mc_fat));
-	if (sz != sizeof(mc_fat)) {
+	qint64 sz = pread(&mc_fat, sizeof(mc_fat), mc_root.fat_addr * blockSize);
+	if (sz != (qint64)sizeof(mc_fat)) {
 		// Error reading the FAT.
 		return -3;
 	}
@@ -407,8 +405,7 @@ int VmuCardPrivate::loadDir(void)
 	for (int block = mc_root.dir_addr; block >= lastBlock;
 	     block--, dir += (VMU_BLOCK_SIZE / sizeof(*dir))) {
 		const int address = (block * blockSize);
-		file->seek(address);
-		qint64 sz = file->read((char*)dir, VMU_BLOCK_SIZE);
+		qint64 sz = pread(dir, VMU_BLOCK_SIZE, address);
 		if (sz < (qint64)VMU_BLOCK_SIZE) {
 			// Error reading the directory table.
 			return -3;
@@ -448,8 +445,10 @@ void VmuCardPrivate::loadFileList(void)
 		emit q->filesRemoved();
 
 	// Reset the used block map.
-	// TODO
-	//resetUsedBlockMap();
+	// Blocks past the user area contain the system area,
+	// so they're always used.
+	usedBlockMap.reset(totalPhysBlocks);
+	usedBlockMap.markUsed(totalUserBlocks, totalPhysBlocks - totalUserBlocks);
 
 	QVector<File*> lstFiles_new;
 	lstFiles_new.reserve(NUM_ELEMENTS(mc_dir));
@@ -483,22 +482,18 @@ void VmuCardPrivate::loadFileList(void)
 		}
 
 		// Mark the file's blocks as used.
-		// TODO
-		/*
 		QVector<uint16_t> fatEntries = vmuFile->fatEntries();
 		foreach (uint16_t block, fatEntries) {
-			if (block >= 5 && block < usedBlockMap.size()) {
+			if (block < totalUserBlocks) {
 				// Valid block.
 				// Increment its entry in the usedBlockMap.
-				if (usedBlockMap[block] < std::numeric_limits<uint8_t>::max())
-					usedBlockMap[block]++;
+				usedBlockMap.ref(block);
 			} else {
 				// Invalid block.
 				// TODO: Store an error value somewhere.
 				fprintf(stderr, "WARNING: File %d has invalid FAT entry 0x%04X.\n", i, block);
 			}
 		}
-		*/
 	}
 
 	if (!lstFiles_new.isEmpty()) {
@@ -528,12 +523,15 @@ VmuCard::~VmuCard()
  * Open an existing VMU image.
  * @param filename VMU image filename.
  * @param parent Parent object.
+ * @param flags Open flags.
  * @return VmuCard object, or nullptr on error.
  */
-VmuCard *VmuCard::open(const QString& filename, QObject *parent)
+VmuCard *VmuCard::open(const QString& filename, QObject *parent,
+	Card::OpenFlags flags)
 {
 	VmuCard *vmuCard = new VmuCard(parent);
 	VmuCardPrivate *const d = vmuCard->d_func();
+	d->setOpenFlags(flags);
 	d->open(filename);
 	return vmuCard;
 }
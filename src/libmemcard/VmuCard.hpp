@@ -32,9 +32,11 @@ class VmuCard : public Card
 		 * Open an existing VMU image.
 		 * @param filename VMU image filename.
 		 * @param parent Parent object.
+		 * @param flags Open flags.
 		 * @return VmuCard object, or nullptr on error.
 		 */
-		static VmuCard *open(const QString& filename, QObject *parent);
+		static VmuCard *open(const QString& filename, QObject *parent,
+			Card::OpenFlags flags = Card::OpenFlags());
 
 		/**
 		 * Format a new VMU image.
@@ -29,7 +29,6 @@ using std::vector;
 
 // Qt includes.
 #include <QtCore/QByteArray>
-#include <QtCore/QTextCodec>
 #include <QtCore/QFile>
 #include <QtCore/QIODevice>
 
@@ -221,7 +220,7 @@ void VmuFilePrivate::loadFileInfo(void)
 
 	// Timestamp.
 	// FIXME: This might be ctime, not mtime...
-	mtime = TimeFuncs::fromVmuTimestamp(dirEntry->ctime);
+	mtime = TimeFuncs::vmuToUnixTime(dirEntry->ctime);
 
 	// Mode.
 	this->mode = 0;
@@ -313,12 +312,6 @@ GcImage *VmuFilePrivate::loadBannerImage(void)
 		return nullptr;
 	}
 
-	// Load the file into memory.
-	// TODO: Optimize by only reading in required data.
-	// TODO: Copy over the block code from GcnFile::loadIconImages(),
-	// but move the "read from X to Y" code down to File.
-	QByteArray data = this->loadFileData();
-
 	// Eyecatch start address.
 	int eyecatchStart = (dirEntry->header_addr * card->blockSize());
 	eyecatchStart += sizeof(*fileHeader);
@@ -327,15 +320,18 @@ GcImage *VmuFilePrivate::loadBannerImage(void)
 		eyecatchStart += (sizeof(vmu_icon_data) * fileHeader->icon_count);
 	}
 
+	// Load the eyecatch.
+	// Only the blocks containing the eyecatch are read.
 	// TODO: Other variants.
 	const int eyecatchSize = VMU_EYECATCH_PALETTE_16_LEN;
-	if (data.size() < (int)(eyecatchStart + eyecatchSize)) {
+	QByteArray data = readData(eyecatchStart, eyecatchSize);
+	if (data.size() < eyecatchSize) {
 		// File is too small.
 		// The eyecatch isn't actually there...
 		return nullptr;
 	}
 
-	const vmu_eyecatch_palette_16 *eyecatch16 = (const vmu_eyecatch_palette_16*)(data.data() + eyecatchStart);
+	const vmu_eyecatch_palette_16 *eyecatch16 = (const vmu_eyecatch_palette_16*)data.data();
 	GcImage *gcImage = DcImageLoader::fromPalette16(
 				VMU_EYECATCH_W, VMU_EYECATCH_H,
 				eyecatch16->eyecatch, sizeof(eyecatch16->eyecatch),
@@ -395,12 +391,6 @@ QVector<GcImage*> VmuFilePrivate::loadIconImages(void)
 	if (iconCount > 8)
 		iconCount = 8;
 
-	// Load the file into memory.
-	// TODO: Optimize by only reading in required data.
-	// TODO: Copy over the block code from GcnFile::loadIconImages(),
-	// but move the "read from X to Y" code down to File.
-	QByteArray data = this->loadFileData();
-
 	// Icon start address.
 	int iconStart = (dirEntry->header_addr * card->blockSize());
 	iconStart += sizeof(*fileHeader);
@@ -408,13 +398,17 @@ QVector<GcImage*> VmuFilePrivate::loadIconImages(void)
 	// Calculate the total icon length.
 	const int totalIconLen = sizeof(vmu_icon_palette) +
 				(sizeof(vmu_icon_data) * iconCount);
-	if (data.size() < (int)(iconStart + totalIconLen)) {
+
+	// Load the icons.
+	// Only the blocks containing the icons are read.
+	QByteArray data = readData(iconStart, totalIconLen);
+	if (data.size() < totalIconLen) {
 		// File is too small.
 		// The icons aren't actually there...
 		return QVector<GcImage*>();
 	}
 
-	const char *pIconStart = (data.data() + iconStart);
+	const char *pIconStart = data.constData();
 	const vmu_icon_palette *palette = (const vmu_icon_palette*)pIconStart;
 	const vmu_icon_data *iconData = (const vmu_icon_data*)(pIconStart + sizeof(*palette));
 	QVector<GcImage*> gcImages;
@@ -454,22 +448,18 @@ void VmuFilePrivate::loadIconImages_ICONDATA_VMS(void)
 	// TODO: Use system-independent values?
 	this->iconAnimMode = 0;
 
-	// Load the file into memory.
-	// TODO: Optimize by only reading in required data.
-	// TODO: Copy over the block code from GcnFile::loadIconImages(),
-	// but move the "read from X to Y" code down to File.
-	QByteArray data = this->loadFileData();
-
 	// Get the ICONDATA_VMS header.
+	// Only the blocks containing the header and icons are read.
 	const int headerStart = (dirEntry->header_addr * card->blockSize());
 	const int headerEnd = (headerStart + sizeof(vmu_card_icon_header));
-	if (data.size() < headerEnd) {
+	QByteArray data = readData(headerStart, sizeof(vmu_card_icon_header));
+	if (data.size() < (int)sizeof(vmu_card_icon_header)) {
 		// File is too small.
 		// The icons aren't actually there...
 		return;
 	}
 	vmu_card_icon_header iconHeader;
-	memcpy(&iconHeader, (data.data() + headerStart), sizeof(iconHeader));
+	memcpy(&iconHeader, data.constData(), sizeof(iconHeader));
 
 	// Byteswap the icon header.
 	iconHeader.icon_mono_offset	= le32_to_cpu(iconHeader.icon_mono_offset);
@@ -478,11 +468,11 @@ void VmuFilePrivate::loadIconImages_ICONDATA_VMS(void)
 	// Load the mono icon.
 	// TODO: Only check for offset != 0?
 	if (iconHeader.icon_mono_offset >= (uint32_t)headerEnd) {
-		int monoIconEnd = iconHeader.icon_mono_offset + sizeof(vmu_card_icon_mono_data);
-		if (data.size() >= monoIconEnd) {
+		data = readData(iconHeader.icon_mono_offset, sizeof(vmu_card_icon_mono_data));
+		if (data.size() >= (int)sizeof(vmu_card_icon_mono_data)) {
 			// Load the monochrome icon.
 			const vmu_card_icon_mono_data *monoIconData =
-				(const vmu_card_icon_mono_data*)(data.data() + iconHeader.icon_mono_offset);
+				(const vmu_card_icon_mono_data*)data.constData();
 			vmu_icon_mono = DcImageLoader::fromMonochrome(
 						VMU_ICON_W, VMU_ICON_H,
 						monoIconData->icon, sizeof(monoIconData->icon));
@@ -492,11 +482,11 @@ void VmuFilePrivate::loadIconImages_ICONDATA_VMS(void)
 	// Load the color icon.
 	// TODO: Only check for offset != 0?
 	if (iconHeader.icon_color_offset >= (uint32_t)headerEnd) {
-		int colorIconEnd = iconHeader.icon_color_offset + sizeof(vmu_card_icon_color_data);
-		if (data.size() >= colorIconEnd) {
+		data = readData(iconHeader.icon_color_offset, sizeof(vmu_card_icon_color_data));
+		if (data.size() >= (int)sizeof(vmu_card_icon_color_data)) {
 			// Load the color icon.
 			const vmu_card_icon_color_data *colorIconData =
-				(const vmu_card_icon_color_data*)(data.data() + iconHeader.icon_color_offset);
+				(const vmu_card_icon_color_data*)data.constData();
 			vmu_icon_color = DcImageLoader::fromPalette16(
 						VMU_ICON_W, VMU_ICON_H,
 						colorIconData->icon, sizeof(colorIconData->icon),
@@ -11,9 +11,11 @@
 // C includes. (C++ namespace)
 #include <cstdlib>
 #include <cassert>
+#include <cstring>
 
 // Qt includes.
 #include <QtCore/QEvent>
+#include <QVBoxLayout>
 
 // Files.
 #include "libmemcard/File.hpp"
@@ -22,14 +24,28 @@
 
 #include "util/byteswap.h"
 #include "sa_defs.h"
+#include "SAEndian.hpp"
+
+// Editor widgets.
+#include "SAGeneral.hpp"
+#include "SAAdventure.hpp"
+#include "SALevelStats.hpp"
+#include "SASubGames.hpp"
+#include "SAMiscEmblems.hpp"
+#include "SALevelClearCount.hpp"
+
+// Flag descriptions
+#include "../models/FlagDescTable.hpp"
 
 // BitFlags
 #include "../models/BitFlagsModel.hpp"
+#include "../widgets/BitFlagsView.hpp"
 #include "SAEventFlags.hpp"
 #include "SANPCFlags.hpp"
 
 // ByteFlags
 #include "../models/ByteFlagsModel.hpp"
+#include "../widgets/ByteFlagsView.hpp"
 #include "SADXMissionFlags.hpp"
 
 // Checksum algorithms.
@@ -56,28 +72,92 @@ class SAEditorPrivate : public EditorWidgetPrivate
 	public:
 		Ui::SAEditor ui;
 
-		// sa_save_slot structs.
+		// Save file data.
+		// The save slots are edited in place in this buffer,
+		// which is kept in host byte order.
+		QByteArray fileData;
+
+		// Byte order of the save file.
+		SAEndian::Endian fileEndian;
+
+		// sa_save_slot structs. (pointers into fileData)
 		QVector<sa_save_slot*> data_main;
 		QVector<sadx_extra_save_slot*> data_sadx;
 
-		// Editor widgets. (non-flags)
-		QVector<SAEditWidget*> saEditWidgets;
-		QVector<SADXEditWidget*> sadxEditWidgets;
+		// Tabs.
+		enum TabID {
+			TAB_GENERAL,
+			TAB_ADVENTURE,
+			TAB_ACTION_STAGES,
+			TAB_SUB_GAMES,
+			TAB_MISC_EMBLEMS,
+			TAB_EVENT_FLAGS,
+			TAB_NPC_FLAGS,
+			TAB_LEVEL_CLEAR_COUNT,
+			TAB_MISSIONS,
+
+			TAB_MAX
+		};
+
+		/**
+		 * Tab state.
+		 * Each tab's editor widget (and flags model, if any)
+		 * is created when the tab is first shown, and is only
+		 * loaded with the current slot's data when visible.
+		 */
+		struct Tab {
+			QWidget *page;			// Tab page.
+			QVBoxLayout *layout;		// Layout for the editor widget.
+			QWidget *widget;		// Editor widget. (nullptr if not created yet)
+			SAEditWidget *saEditWidget;	// SA1 editor widget, if any.
+			SADXEditWidget *sadxEditWidget;	// SADX editor widget, if any.
+			bool stale;			// True if the widget doesn't have the current slot's data.
+		};
+		Tab tabs[TAB_MAX];
 
 		// BitFlagsModel objects.
 		// Used for event flags, NPC flags, etc.
 		// Since BitFlagsView uses a QTreeView with a list model
 		// directly, we're storing the data here instead of
 		// having BitFlagsView store the data.
-		SAEventFlags saEventFlags;
-		SANPCFlags saNPCFlags;
+		// (Created along with the tab.)
+		SAEventFlags *saEventFlags;
+		SANPCFlags *saNPCFlags;
 		BitFlagsModel *saEventFlagsModel;
 		BitFlagsModel *saNPCFlagsModel;
 
 		// ByteFlagsModel objects.
-		SADXMissionFlags sadxMissionFlags;
+		// (Created along with the tab.)
+		SADXMissionFlags *sadxMissionFlags;
 		ByteFlagsModel *sadxMissionFlagsModel;
 
+		/**
+		 * Get the tab ID for a tab page.
+		 * @param page Tab page.
+		 * @return Tab ID, or -1 if not found.
+		 */
+		int tabFromPage(const QWidget *page) const;
+
+		/**
+		 * Create a tab's editor widget, if it hasn't been created yet.
+		 * @param tab Tab ID.
+		 */
+		void initTab(int tab);
+
+		/**
+		 * Load the current slot's data into a tab.
+		 * The tab's editor widget is created if necessary.
+		 * @param tab Tab ID.
+		 */
+		void loadTab(int tab);
+
+		/**
+		 * Save a tab's data to the current slot.
+		 * Nothing is done if the tab is stale.
+		 * @param tab Tab ID.
+		 */
+		void saveTab(int tab);
+
 		/**
 		 * Load data from a file.
 		 * @param file File.
@@ -90,35 +170,43 @@ class SAEditorPrivate : public EditorWidgetPrivate
 		 */
 		void clear(void);
 
+		/**
+		 * Convert the save slots in a buffer between
+		 * the file's byte order and host byte order.
+		 * Nothing is done if the byte orders match.
+		 * @param data Save file data.
+		 */
+		void convertSlots(char *data) const;
+
 		/**
 		 * Update the display.
+		 * Only the visible tab is loaded; all other
+		 * tabs are marked as stale.
 		 */
 		void updateDisplay(void);
 
 		/**
 		 * Save data for the current slot.
+		 * Only tabs that were loaded with the current slot's data are saved.
 		 */
 		void saveCurrentSlot(void);
-
-		/**
-		 * Byteswap an sa_save_slot.
-		 * @param sa_save sa_save_slot.
-		 */
-		static void byteswap_sa_save_slot(sa_save_slot *sa_save);
-
-		/**
-		 * Byteswap an sadx_extra_save_slot.
-		 * @param sa_save sadx_extra_save_slot.
-		 */
-		static void byteswap_sadx_extra_save_slot(sadx_extra_save_slot *sadx_extra_save);
 };
 
 SAEditorPrivate::SAEditorPrivate(SAEditor* q)
 	: super(q)
+	, fileEndian(SAEndian::HostEndian)
+	, saEventFlags(nullptr)
+	, saNPCFlags(nullptr)
 	, saEventFlagsModel(nullptr)
 	, saNPCFlagsModel(nullptr)
+	, sadxMissionFlags(nullptr)
 	, sadxMissionFlagsModel(nullptr)
-{ }
+{
+	memset(tabs, 0, sizeof(tabs));
+	for (int i = 0; i < TAB_MAX; i++) {
+		tabs[i].stale = true;
+	}
+}
 
 SAEditorPrivate::~SAEditorPrivate()
 {
@@ -137,7 +225,9 @@ int SAEditorPrivate::load(File *file)
 	clear();
 
 	// Read the new file.
-	QByteArray data = file->loadFileData();
+	// The save slots are edited in place in this buffer.
+	fileData = file->loadFileData();
+	char *const data = fileData.data();
 
 	// Determine which version of the game this save file is for.
 	// TODO: Test for GCN first, then DC?
@@ -145,48 +235,41 @@ int SAEditorPrivate::load(File *file)
 	int ret = -1;
 	if (qobject_cast<VmuFile*>(file) != nullptr) {
 		// DC version.
+		// Dreamcast's SH-4 is little-endian.
+		fileEndian = SAEndian::LittleEndian;
 
 		// Three, count 'em, *three* save slots!
-		const char *src = (data.data() + SA_SAVE_ADDRESS_DC_0);
+		if (fileData.size() < (int)(SA_SAVE_ADDRESS_DC_0 + (sizeof(sa_save_slot) * 3))) {
+			// File is too small.
+			ret = -3;
+			goto end;
+		}
+		char *src = (data + SA_SAVE_ADDRESS_DC_0);
 		for (int i = 0; i < 3; i++, src += sizeof(sa_save_slot)) {
-			sa_save_slot *const sa_save = new sa_save_slot;
-			memcpy(sa_save, src, sizeof(*sa_save));
-			data_main.append(sa_save);
+			data_main.append(reinterpret_cast<sa_save_slot*>(src));
 			data_sadx.append(nullptr);	// DC version - no SADX extras.
-#if SYS_BYTEORDER == SYS_BIG_ENDIAN
-			// Byteswap the data.
-			// Dreamcast's SH-4 is little-endian.
-			byteswap_sa_save_slot(sa_save);
-#endif /* SYS_BYTEORDER == SYS_BIG_ENDIAN */
-
-			// Loaded successfully.
-			ret = 0;
 		}
+
+		// Loaded successfully.
+		ret = 0;
 	} else if (qobject_cast<GcnFile*>(file) != nullptr) {
 		// GameCube verison.
+		// GameCube's PowerPC 750 is big-endian.
+		fileEndian = SAEndian::BigEndian;
 
 		// Only one save slot.
-		sa_save_slot *const sa_save = new sa_save_slot;
-		memcpy(sa_save, (data.data() + SA_SAVE_ADDRESS_GCN), sizeof(*sa_save));
-		data_main.append(sa_save);
-
-#if SYS_BYTEORDER == SYS_LIL_ENDIAN
-		// Byteswap the data.
-		// GameCube's PowerPC 750 is big-endian.
-		byteswap_sa_save_slot(sa_save);
-#endif /* SYS_BYTEORDER == SYS_LIL_ENDIAN */
+		if (fileData.size() < (int)(SA_SAVE_ADDRESS_GCN + sizeof(sa_save_slot))) {
+			// File is too small.
+			ret = -3;
+			goto end;
+		}
+		data_main.append(reinterpret_cast<sa_save_slot*>(data + SA_SAVE_ADDRESS_GCN));
 
 		// Check for SADX extras.
-		if (data.size() >= (int)(SA_SAVE_ADDRESS_GCN + sizeof(*sa_save) + sizeof(sadx_extra_save_slot))) {
+		if (fileData.size() >= (int)(SA_SAVE_ADDRESS_GCN + sizeof(sa_save_slot) + sizeof(sadx_extra_save_slot))) {
 			// Found SADX extras.
-			sadx_extra_save_slot *const sadx_extra_save = new sadx_extra_save_slot;
-			memcpy(sadx_extra_save, (data.data() + SA_SAVE_ADDRESS_GCN + sizeof(*sa_save)), sizeof(*sadx_extra_save));
-			data_sadx.append(sadx_extra_save);
-#if SYS_BYTEORDER == SYS_LIL_ENDIAN
-			// Byteswap the data.
-			// GameCube's PowerPC 750 is big-endian.
-			byteswap_sadx_extra_save_slot(sadx_extra_save);
-#endif /* SYS_BYTEORDER == SYS_LIL_ENDIAN */
+			data_sadx.append(reinterpret_cast<sadx_extra_save_slot*>
+				(data + SA_SAVE_ADDRESS_GCN + sizeof(sa_save_slot)));
 		} else {
 			// No SADX extras.
 			data_sadx.append(nullptr);
@@ -201,18 +284,28 @@ int SAEditorPrivate::load(File *file)
 		goto end;
 	}
 
+	// Convert the save slots to host byte order.
+	convertSlots(data);
+
 end:
 	if (ret == 0) {
 		// File loaded successfully.
 		this->file = file;
+	} else {
+		clear();
 	}
 
 	// Update the display.
 	Q_Q(SAEditor);
 	setSaveSlots(data_main.size());
 	setGeneralSettings(false);
-	q->setCurrentSaveSlot(0);
-	updateDisplay();
+	if (currentSaveSlot != 0) {
+		// setCurrentSaveSlot() will update the display.
+		q->setCurrentSaveSlot(0);
+	} else {
+		// Save slot didn't change.
+		updateDisplay();
+	}
 	return ret;
 }
 
@@ -221,38 +314,250 @@ end:
  */
 void SAEditorPrivate::clear(void)
 {
-	// Delete all loaded sa_save_slot structs.
-	// NOTE: sa_save_slot is allocated using new, so use delete.
-	foreach (sa_save_slot *sa_save, data_main) {
-		delete sa_save;
-	}
+	// The sa_save_slot structs point into fileData,
+	// so they don't need to be deleted individually.
 	data_main.clear();
+	data_sadx.clear();
+	fileData.clear();
 
-	// Delete loaded SADX extra save structs.
-	// NOTE: sadx_extra_save_slot is allocated using new, so use delete.
+	// The tabs no longer have valid data.
+	for (int i = 0; i < TAB_MAX; i++) {
+		tabs[i].stale = true;
+	}
+}
+
+/**
+ * Convert the save slots in a buffer between
+ * the file's byte order and host byte order.
+ * Nothing is done if the byte orders match.
+ * @param data Save file data.
+ */
+void SAEditorPrivate::convertSlots(char *data) const
+{
+	if (fileEndian == SAEndian::HostEndian)
+		return;
+
+	// Slot pointers are relative to fileData.
+	const char *const base = fileData.constData();
+	foreach (sa_save_slot *sa_save, data_main) {
+		SAEndian::convert<SAEndian::sa_save_slot_fields>(
+			fileEndian, data + ((const char*)sa_save - base));
+	}
 	foreach (sadx_extra_save_slot *sadx_extra_save, data_sadx) {
-		delete sadx_extra_save;
+		if (!sadx_extra_save)
+			continue;
+		SAEndian::convert<SAEndian::sadx_extra_save_slot_fields>(
+			fileEndian, data + ((const char*)sadx_extra_save - base));
+	}
+}
+
+/**
+ * Get the tab ID for a tab page.
+ * @param page Tab page.
+ * @return Tab ID, or -1 if not found.
+ */
+int SAEditorPrivate::tabFromPage(const QWidget *page) const
+{
+	if (!page)
+		return -1;
+	for (int i = 0; i < TAB_MAX; i++) {
+		if (tabs[i].page == page)
+			return i;
+	}
+	return -1;
+}
+
+/**
+ * Create a tab's editor widget, if it hasn't been created yet.
+ * @param tab Tab ID.
+ */
+void SAEditorPrivate::initTab(int tab)
+{
+	assert(tab >= 0 && tab < TAB_MAX);
+	Tab &t = tabs[tab];
+	if (t.widget)
+		return;
+
+	Q_Q(SAEditor);
+	switch (tab) {
+		case TAB_GENERAL: {
+			SAGeneral *const saGeneral = new SAGeneral(t.page);
+			t.saEditWidget = saGeneral;
+			t.sadxEditWidget = saGeneral;
+			break;
+		}
+		case TAB_ADVENTURE:
+			t.saEditWidget = new SAAdventure(t.page);
+			break;
+		case TAB_ACTION_STAGES: {
+			SALevelStats *const saLevelStats = new SALevelStats(t.page);
+			t.saEditWidget = saLevelStats;
+			t.sadxEditWidget = saLevelStats;
+			break;
+		}
+		case TAB_SUB_GAMES: {
+			SASubGames *const saSubGames = new SASubGames(t.page);
+			t.saEditWidget = saSubGames;
+			t.sadxEditWidget = saSubGames;
+			break;
+		}
+		case TAB_MISC_EMBLEMS:
+			t.saEditWidget = new SAMiscEmblems(t.page);
+			break;
+		case TAB_LEVEL_CLEAR_COUNT:
+			t.saEditWidget = new SALevelClearCount(t.page);
+			break;
+
+		case TAB_EVENT_FLAGS: {
+			// SAEventFlags model and widget.
+			saEventFlags = new SAEventFlags(q);
+			saEventFlagsModel = new BitFlagsModel(q);
+			saEventFlagsModel->setBitFlags(saEventFlags);
+			BitFlagsView *const saEventFlagsView = new BitFlagsView(t.page);
+			saEventFlagsView->setBitFlagsModel(saEventFlagsModel);
+			t.widget = saEventFlagsView;
+			break;
+		}
+		case TAB_NPC_FLAGS: {
+			// SANPCFlags model and widget.
+			saNPCFlags = new SANPCFlags(q);
+			saNPCFlagsModel = new BitFlagsModel(q);
+			saNPCFlagsModel->setBitFlags(saNPCFlags);
+			BitFlagsView *const saNPCFlagsView = new BitFlagsView(t.page);
+			saNPCFlagsView->setBitFlagsModel(saNPCFlagsModel);
+			t.widget = saNPCFlagsView;
+			break;
+		}
+		case TAB_MISSIONS: {
+			// SADXMissionFlags model and widget.
+			// NOTE: The view is in a scroll area.
+			sadxMissionFlags = new SADXMissionFlags(q);
+			sadxMissionFlagsModel = new ByteFlagsModel(q);
+			sadxMissionFlagsModel->setByteFlags(sadxMissionFlags);
+			ByteFlagsView *const sadxMissionFlagsView = new ByteFlagsView(ui.scrlMissionsContent);
+			sadxMissionFlagsView->setByteFlagsModel(sadxMissionFlagsModel);
+			t.widget = sadxMissionFlagsView;
+			break;
+		}
+
+		default:
+			assert(!"Invalid tab ID.");
+			return;
+	}
+
+	if (t.saEditWidget) {
+		t.widget = t.saEditWidget;
+
+		// Connect the widgetHasBeenModified() signal.
+		QObject::connect(t.saEditWidget, SIGNAL(hasBeenModified(bool)),
+				 q, SLOT(widgetHasBeenModified(bool)));
+	}
+	t.layout->addWidget(t.widget);
+}
+
+/**
+ * Load the current slot's data into a tab.
+ * The tab's editor widget is created if necessary.
+ * @param tab Tab ID.
+ */
+void SAEditorPrivate::loadTab(int tab)
+{
+	assert(tab >= 0 && tab < TAB_MAX);
+	initTab(tab);
+	if (this->currentSaveSlot < 0 || this->currentSaveSlot >= data_main.size())
+		return;
+
+	const sa_save_slot *sa_save = data_main.at(this->currentSaveSlot);
+	const sadx_extra_save_slot *sadx_extra_save = nullptr;
+	if (this->currentSaveSlot < data_sadx.size()) {
+		sadx_extra_save = data_sadx.at(this->currentSaveSlot);
+	}
+
+	Tab &t = tabs[tab];
+	switch (tab) {
+		case TAB_EVENT_FLAGS:
+			saEventFlags->setAllFlags(&sa_save->events.all[0], NUM_ELEMENTS(sa_save->events.all));
+			break;
+		case TAB_NPC_FLAGS:
+			saNPCFlags->setAllFlags(&sa_save->npc.all[0], NUM_ELEMENTS(sa_save->npc.all));
+			break;
+		case TAB_MISSIONS:
+			// Only shown if SADX extra data is present.
+			if (sadx_extra_save) {
+				sadxMissionFlags->setAllFlags(&sadx_extra_save->missions[0],
+						NUM_ELEMENTS(sadx_extra_save->missions));
+			}
+			break;
+		default:
+			t.saEditWidget->load(sa_save);
+			if (t.sadxEditWidget) {
+				// If there's no SADX extra data, this
+				// hides the SADX editor components.
+				t.sadxEditWidget->loadDX(sadx_extra_save);
+			}
+			break;
+	}
+
+	t.stale = false;
+}
+
+/**
+ * Save a tab's data to the current slot.
+ * Nothing is done if the tab is stale.
+ * @param tab Tab ID.
+ */
+void SAEditorPrivate::saveTab(int tab)
+{
+	assert(tab >= 0 && tab < TAB_MAX);
+	const Tab &t = tabs[tab];
+	if (!t.widget || t.stale)
+		return;
+	if (this->currentSaveSlot < 0 || this->currentSaveSlot >= data_main.size())
+		return;
+
+	sa_save_slot *sa_save = data_main.at(this->currentSaveSlot);
+	sadx_extra_save_slot *sadx_extra_save = nullptr;
+	if (this->currentSaveSlot < data_sadx.size()) {
+		sadx_extra_save = data_sadx.at(this->currentSaveSlot);
+	}
+
+	switch (tab) {
+		case TAB_EVENT_FLAGS:
+			saEventFlags->allFlags(&sa_save->events.all[0], NUM_ELEMENTS(sa_save->events.all));
+			break;
+		case TAB_NPC_FLAGS:
+			saNPCFlags->allFlags(&sa_save->npc.all[0], NUM_ELEMENTS(sa_save->npc.all));
+			break;
+		case TAB_MISSIONS:
+			if (sadx_extra_save) {
+				sadxMissionFlags->allFlags(&sadx_extra_save->missions[0],
+						NUM_ELEMENTS(sadx_extra_save->missions));
+			}
+			break;
+		default:
+			t.saEditWidget->save(sa_save);
+			if (t.sadxEditWidget && sadx_extra_save) {
+				t.sadxEditWidget->saveDX(sadx_extra_save);
+			}
+			break;
 	}
-	data_sadx.clear();
 }
 
 /**
  * Update the display.
+ * Only the visible tab is loaded; all other
+ * tabs are marked as stale.
  */
 void SAEditorPrivate::updateDisplay(void)
 {
 	assert(this->currentSaveSlot >= 0 && this->currentSaveSlot < this->saveSlots);
 
-	// Display the data.
-	const sa_save_slot *sa_save = data_main.at(this->currentSaveSlot);
-	foreach (SAEditWidget *saEditWidget, saEditWidgets) {
-		saEditWidget->load(sa_save);
+	// The current slot's data will be loaded into
+	// each tab when it's shown.
+	for (int i = 0; i < TAB_MAX; i++) {
+		tabs[i].stale = true;
 	}
 
-	// Bit flags.
-	saEventFlags.setAllFlags(&sa_save->events.all[0], NUM_ELEMENTS(sa_save->events.all));
-	saNPCFlags.setAllFlags(&sa_save->npc.all[0], NUM_ELEMENTS(sa_save->npc.all));
-
 	// SADX-specific data.
 	// NOTE: There's no way to hide specific tabs without removing them
 	// from QTabWidget entirely. There is a stylesheet hack to hide
@@ -265,27 +570,12 @@ void SAEditorPrivate::updateDisplay(void)
 		sadx_extra_save = data_sadx.at(this->currentSaveSlot);
 	}
 	if (sadx_extra_save) {
-		// SADX extra data found. Load it.
-		foreach (SADXEditWidget *sadxEditWidget, sadxEditWidgets) {
-			sadxEditWidget->loadDX(sadx_extra_save);
-		}
-
-		// Missions.
-		sadxMissionFlags.setAllFlags(&sadx_extra_save->missions[0],
-				NUM_ELEMENTS(sadx_extra_save->missions));
-
 		if (missions_tab_idx < 0) {
 			// Show the "Missions" tab.
 			ui.tabWidget->addTab(ui.tabMissions, SAEditor::tr("M&issions"));
 			ui.tabWidget->show();
 		}
 	} else {
-		// No SADX extra data.
-		// Make sure the SADX sections are hidden.
-		foreach (SADXEditWidget *sadxEditWidget, sadxEditWidgets) {
-			sadxEditWidget->loadDX(nullptr);
-		}
-
 		if (missions_tab_idx >= 0) {
 			// Hide the "Missions" tab.
 			// TODO: Verify that taking ownership ensures the object
@@ -295,112 +585,28 @@ void SAEditorPrivate::updateDisplay(void)
 			ui.tabMissions->setParent(q);
 		}
 	}
+
+	// Load the visible tab.
+	// NOTE: Adding or removing the "Missions" tab might have
+	// already loaded it via the currentChanged() signal.
+	const int tab = tabFromPage(ui.tabWidget->currentWidget());
+	if (tab >= 0 && tabs[tab].stale) {
+		loadTab(tab);
+	}
 }
 
 /**
  * Save data for the current slot.
+ * Only tabs that were loaded with the current slot's data are saved.
  */
 void SAEditorPrivate::saveCurrentSlot(void)
 {
 	assert(this->currentSaveSlot >= 0 && this->currentSaveSlot < this->saveSlots);
-
-	// Save the data.
-	sa_save_slot *sa_save = data_main.at(this->currentSaveSlot);
-	foreach (SAEditWidget *saEditWidget, saEditWidgets) {
-		saEditWidget->save(sa_save);
-	}
-
-	// Bit flags.
-	saEventFlags.allFlags(&sa_save->events.all[0], NUM_ELEMENTS(sa_save->events.all));
-	saNPCFlags.allFlags(&sa_save->npc.all[0], NUM_ELEMENTS(sa_save->npc.all));
-
-	// SADX extra data?
-	sadx_extra_save_slot *sadx_extra_save = nullptr;
-	if (this->currentSaveSlot < data_sadx.size()) {
-		sadx_extra_save = data_sadx.at(this->currentSaveSlot);
-	}
-	if (sadx_extra_save) {
-		// SADX extra data found. Save it.
-		foreach (SADXEditWidget *sadxEditWidget, sadxEditWidgets) {
-			sadxEditWidget->saveDX(sadx_extra_save);
-		}
-
-		// Missions.
-		sadxMissionFlags.allFlags(&sadx_extra_save->missions[0],
-				NUM_ELEMENTS(sadx_extra_save->missions));
-	}
-}
-
-/**
- * Byteswap an sa_save_slot.
- * @param sa_save sa_save_slot.
- */
-void SAEditorPrivate::byteswap_sa_save_slot(sa_save_slot *sa_save)
-{
-	sa_save->playTime = __swab32(sa_save->playTime);
-
-	// TODO: Combine a few of these loops?
-	for (int i = 0; i < NUM_ELEMENTS(sa_save->scores.all); i++) {
-		sa_save->scores.all[i] = __swab32(sa_save->scores.all[i]);
-	}
-	for (int i = 0; i < NUM_ELEMENTS(sa_save->weights.all); i++) {
-		sa_save->weights.all[i] = __swab16(sa_save->weights.all[i]);
-	}
-	for (int i = 0; i < NUM_ELEMENTS(sa_save->rings.all); i++) {
-		sa_save->rings.all[i] = __swab16(sa_save->rings.all[i]);
-	}
-	for (int i = 0; i < NUM_ELEMENTS(sa_save->mini_game_scores.all); i++) {
-		sa_save->mini_game_scores.all[i] = __swab32(sa_save->mini_game_scores.all[i]);
-	}
-
-	sa_save->last_level = __swab16(sa_save->last_level);
-
-	// Adventure mode.
-	for (int i = 0; i < NUM_ELEMENTS(sa_save->adventure_mode.chr); i++) {
-		// NOTE: We can't use __swab16() to byteswap
-		// int16_t due to sign extension.
-		// TODO: Move to byteswap.h?
-		#define signed_swab16(x) ((((x) >> 8) & 0xFF) | (((x) & 0xFF) << 8))
-		sa_save->adventure_mode.chr[i].unknown1 =
-			signed_swab16(sa_save->adventure_mode.chr[i].unknown1);
-		sa_save->adventure_mode.chr[i].unknown2 =
-			signed_swab16(sa_save->adventure_mode.chr[i].unknown2);
-		sa_save->adventure_mode.chr[i].start_entrance =
-			__swab16(sa_save->adventure_mode.chr[i].start_entrance);
-		sa_save->adventure_mode.chr[i].start_level_and_act =
-			__swab16(sa_save->adventure_mode.chr[i].start_level_and_act);
-		sa_save->adventure_mode.chr[i].unknown3 =
-			signed_swab16(sa_save->adventure_mode.chr[i].unknown3);
+	for (int i = 0; i < TAB_MAX; i++) {
+		saveTab(i);
 	}
 }
 
-/**
- * Byteswap an sadx_extra_save_slot.
- * @param sa_save sadx_extra_save_slot.
- */
-void SAEditorPrivate::byteswap_sadx_extra_save_slot(sadx_extra_save_slot *sadx_extra_save)
-{
-	// Black Market rings.
-	sadx_extra_save->rings_black_market = __swab32(sadx_extra_save->rings_black_market);
-
-	// Metal Sonic level stats.
-	for (int i = 0; i < 10; i++) {
-		sadx_extra_save->scores_metal[i] =
-			__swab32(sadx_extra_save->scores_metal[i]);
-		sadx_extra_save->rings_metal[i]  =
-			__swab16(sadx_extra_save->rings_metal[i]);
-	}
-
-	// Metal Sonic mini-game scores.
-	for (int i = 0; i < NUM_ELEMENTS(sadx_extra_save->mini_game_scores_metal.all); i++) {
-		sadx_extra_save->mini_game_scores_metal.all[i] =
-			__swab32(sadx_extra_save->mini_game_scores_metal.all[i]);
-	}
-
-	// Metal Sonic emblems. (32-bit bitfield, host-endian.)
-	sadx_extra_save->emblems_metal = __swab32(sadx_extra_save->emblems_metal);
-}
-
 /** SAEditor **/
 
 /**
@@ -413,45 +619,30 @@ SAEditor::SAEditor(QWidget *parent)
 	Q_D(SAEditor);
 	d->ui.setupUi(this);
 
-	// Initialize the SAEditWidget vector.
-	d->saEditWidgets.reserve(6);
-	d->saEditWidgets.append(d->ui.saGeneral);
-	d->saEditWidgets.append(d->ui.saAdventure);
-	d->saEditWidgets.append(d->ui.saLevelStats);
-	d->saEditWidgets.append(d->ui.saSubGames);
-	d->saEditWidgets.append(d->ui.saMiscEmblems);
-	d->saEditWidgets.append(d->ui.saLevelClearCount);
-
-	// Initialize the SADXEditWidget vector.
-	d->saEditWidgets.reserve(3);
-	d->sadxEditWidgets.append(d->ui.saGeneral);
-	d->sadxEditWidgets.append(d->ui.saLevelStats);
-	d->sadxEditWidgets.append(d->ui.saSubGames);
-
-	// SAEventFlags model and widget.
-	d->saEventFlagsModel = new BitFlagsModel(this);
-	d->saEventFlagsModel->setBitFlags(&d->saEventFlags);
-	d->ui.saEventFlagsView->setBitFlagsModel(d->saEventFlagsModel);
-
-	// SANPCFlags model and widget.
-	d->saNPCFlagsModel = new BitFlagsModel(this);
-	d->saNPCFlagsModel->setBitFlags(&d->saNPCFlags);
-	d->ui.saNPCFlagsView->setBitFlagsModel(d->saNPCFlagsModel);
-
-	// SADXMissionFlags model and widget.
-	d->sadxMissionFlagsModel = new ByteFlagsModel(this);
-	d->sadxMissionFlagsModel->setByteFlags(&d->sadxMissionFlags);
-	d->ui.sadxMissionFlagsView->setByteFlagsModel(d->sadxMissionFlagsModel);
-
-	// Connect the widgetHasBeenModified() signals.
-	foreach (SAEditWidget *saEditWidget, d->saEditWidgets) {
-		connect(saEditWidget, SIGNAL(hasBeenModified(bool)),
-			this, SLOT(widgetHasBeenModified(bool)));
-	}
-	foreach (SADXEditWidget *sadxEditWidget, d->sadxEditWidgets) {
-		connect(sadxEditWidget, SIGNAL(hasBeenModified(bool)),
-			this, SLOT(widgetHasBeenModified(bool)));
-	}
+	// Tab pages.
+	// The editor widgets are created when each tab is first shown.
+	typedef SAEditorPrivate D;
+	d->tabs[D::TAB_GENERAL].page		= d->ui.tabGeneral;
+	d->tabs[D::TAB_GENERAL].layout		= d->ui.vboxGeneral;
+	d->tabs[D::TAB_ADVENTURE].page		= d->ui.tabAdventure;
+	d->tabs[D::TAB_ADVENTURE].layout	= d->ui.vboxAdventure;
+	d->tabs[D::TAB_ACTION_STAGES].page	= d->ui.tabActionStages;
+	d->tabs[D::TAB_ACTION_STAGES].layout	= d->ui.vboxActionStages;
+	d->tabs[D::TAB_SUB_GAMES].page		= d->ui.tabSubGames;
+	d->tabs[D::TAB_SUB_GAMES].layout	= d->ui.vboxSubGames;
+	d->tabs[D::TAB_MISC_EMBLEMS].page	= d->ui.tabMiscEmblems;
+	d->tabs[D::TAB_MISC_EMBLEMS].layout	= d->ui.vboxExtraEmblems;
+	d->tabs[D::TAB_EVENT_FLAGS].page	= d->ui.tabEventFlags;
+	d->tabs[D::TAB_EVENT_FLAGS].layout	= d->ui.vboxEventFlags;
+	d->tabs[D::TAB_NPC_FLAGS].page		= d->ui.tabNPCFlags;
+	d->tabs[D::TAB_NPC_FLAGS].layout	= d->ui.vboxNPCFlags;
+	d->tabs[D::TAB_LEVEL_CLEAR_COUNT].page	= d->ui.tabLevelClearCount;
+	d->tabs[D::TAB_LEVEL_CLEAR_COUNT].layout = d->ui.vboxLevelClearCount;
+	d->tabs[D::TAB_MISSIONS].page		= d->ui.tabMissions;
+	d->tabs[D::TAB_MISSIONS].layout		= d->ui.vboxSADXMissionsContent;
+
+	connect(d->ui.tabWidget, &QTabWidget::currentChanged,
+		this, &SAEditor::tabWidget_currentChanged_slot);
 }
 
 /**
@@ -461,6 +652,9 @@ SAEditor::SAEditor(QWidget *parent)
 void SAEditor::changeEvent(QEvent *event)
 {
 	if (event->type() == QEvent::LanguageChange) {
+		// Flag descriptions need to be retranslated.
+		FlagDescTable::invalidateTranslations();
+
 		// Retranslate the UI.
 		Q_D(SAEditor);
 		d->ui.retranslateUi(this);
@@ -589,100 +783,43 @@ int SAEditor::save(void)
 	// Make sure the current slot is saved.
 	d->saveCurrentSlot();
 
-	// Read the existing file data first.
-	QByteArray data = d->file->loadFileData();
+	// Convert the save slots to the file's byte order.
+	// The editor's copy is left in host byte order.
+	QByteArray data = d->fileData;
+	d->convertSlots(data.data());
 
-	// Determine which version of the game this save file is for.
+	// Update the checksums.
 	// TODO: Test for GCN first, then DC?
 	int ret = -EINVAL;
 	if (qobject_cast<VmuFile*>(d->file) != nullptr) {
 		// DC version.
-
-		// Three, count 'em, *three* save slots!
-		char *dest = (data.data() + SA_SAVE_ADDRESS_DC_0);
-		for (int i = 0; i < 3; i++, dest += sizeof(sa_save_slot)) {
-			sa_save_slot *const sa_save = reinterpret_cast<sa_save_slot*>(dest);
-			assert(d->data_main.size() > i);
-			if (d->data_main.size() > i) {
-				// Save the slot.
-				memcpy(sa_save, d->data_main.at(i), sizeof(*sa_save));
-#if SYS_BYTEORDER == SYS_BIG_ENDIAN
-				// Byteswap the data.
-				// Dreamcast's SH-4 is little-endian.
-				d->byteswap_sa_save_slot(sa_save);
-#endif /* SYS_BYTEORDER == SYS_BIG_ENDIAN */
-			} else {
-				// No save slot available...
-				// Zero out the data.
-				memset(sa_save, 0, sizeof(*sa_save));
-			}
-
-			// Update the checksums.
-			// TODO: Not tested!
-			// Note that there are two sets of checksums:
-			// - Game checksum (CRC-16) [one per slot]
-			// - VMS checksum (custom)
-			uint8_t *src = (uint8_t*)data.data() + SA_SAVE_ADDRESS_DC_0;
-			for (int i = 0; i < 3; i++, src += sizeof(*sa_save)) {
-				uint16_t crc16 = Checksum::Crc16(src + 4, sizeof(*sa_save) - 4);
-				crc16 = cpu_to_le16(crc16);
-				memcpy(src + 2, &crc16, sizeof(crc16));
-			}
-
-			// VMS checksum.
-			uint16_t vmschk = Checksum::DreamcastVMU(src, data.size(), 0x46);
-			vmschk = cpu_to_le16(vmschk);
-			memcpy(&src[0x46], &vmschk, sizeof(vmschk));
-
-			// Save slots copied.
-			// Now it needs to be written to the file.
+		// TODO: Not tested!
+		// Note that there are two sets of checksums:
+		// - Game checksum (CRC-16) [one per slot]
+		// - VMS checksum (custom)
+		uint8_t *src = (uint8_t*)data.data() + SA_SAVE_ADDRESS_DC_0;
+		for (int i = 0; i < d->data_main.size(); i++, src += sizeof(sa_save_slot)) {
+			uint16_t crc16 = Checksum::Crc16(src + 4, sizeof(sa_save_slot) - 4);
+			crc16 = cpu_to_le16(crc16);
+			memcpy(src + 2, &crc16, sizeof(crc16));
 		}
+
+		// VMS checksum.
+		// This covers the entire file, including the VMS header.
+		uint8_t *const vms = (uint8_t*)data.data();
+		uint16_t vmschk = Checksum::DreamcastVMU(vms, data.size(), 0x46);
+		vmschk = cpu_to_le16(vmschk);
+		memcpy(&vms[0x46], &vmschk, sizeof(vmschk));
 	} else if (qobject_cast<GcnFile*>(d->file) != nullptr) {
 		// GameCube verison.
-
-		// Only one save slot.
-		sa_save_slot *const sa_save = reinterpret_cast<sa_save_slot*>
-			(data.data() + SA_SAVE_ADDRESS_GCN);
-		assert(d->data_main.size() > 0);
-		if (d->data_main.size() > 0) {
-			memcpy(sa_save, d->data_main.at(0), sizeof(*sa_save));
-#if SYS_BYTEORDER == SYS_LIL_ENDIAN
-			// Byteswap the data.
-			// GameCube's PowerPC 750 is big-endian.
-			d->byteswap_sa_save_slot(sa_save);
-#endif /* SYS_BYTEORDER == SYS_LIL_ENDIAN */
-		} else {
-			// No save slot available...
-			// Zero out the data.
-			memset(sa_save, 0, sizeof(*sa_save));
+		// The CRC covers the SADX extras, if present.
+		int crcLen = sizeof(sa_save_slot) - 4;
+		if (!d->data_sadx.isEmpty() && d->data_sadx.at(0) != nullptr) {
+			crcLen += sizeof(sadx_extra_save_slot);
 		}
-
-		// Check for SADX extras.
-		sadx_extra_save_slot *const sadx_extra_save = reinterpret_cast<sadx_extra_save_slot*>
-			(data.data() + SA_SAVE_ADDRESS_GCN + sizeof(*sa_save));
-		if (d->data_sadx.size() > 0) {
-			// Found SADX extras.
-			memcpy(sadx_extra_save, d->data_sadx.at(0), sizeof(*sadx_extra_save));
-#if SYS_BYTEORDER == SYS_LIL_ENDIAN
-			// Byteswap the data.
-			// GameCube's PowerPC 750 is big-endian.
-			d->byteswap_sadx_extra_save_slot(sadx_extra_save);
-#endif /* SYS_BYTEORDER == SYS_LIL_ENDIAN */
-		} else {
-			// No SADX extras.
-			// Zero out the data.
-			memset(sadx_extra_save, 0, sizeof(*sadx_extra_save));
-		}
-
-		// Update the checksum.
-		uint16_t crc16 = Checksum::Crc16((const uint8_t*)data.data() + SA_SAVE_ADDRESS_GCN + 4,
-			sizeof(*sa_save) + sizeof(*sadx_extra_save) - 4);
+		uint16_t crc16 = Checksum::Crc16((const uint8_t*)data.data() + SA_SAVE_ADDRESS_GCN + 4, crcLen);
 		crc16 = cpu_to_be16(crc16);
 		memcpy(data.data() + 0x1442, &crc16, sizeof(crc16));
-
-		// Save slots copied.
-		// Now it needs to be written to the file.
-		ret = 0;
 	} else {
 		// Unsupported file.
 		// TODO: Add support for the Windows version.
@@ -708,6 +845,20 @@ void SAEditor::reload(void)
 	this->setModified(false);
 }
 
+/**
+ * The current tab has changed.
+ * The tab is loaded with the current slot's data if it's stale.
+ * @param index Tab index.
+ */
+void SAEditor::tabWidget_currentChanged_slot(int index)
+{
+	Q_D(SAEditor);
+	const int tab = d->tabFromPage(d->ui.tabWidget->widget(index));
+	if (tab >= 0 && d->tabs[tab].stale) {
+		d->loadTab(tab);
+	}
+}
+
 /**
  * Widget's modified state has been changed.
  * @param modified New modified status.
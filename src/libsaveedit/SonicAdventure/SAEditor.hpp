@@ -82,6 +82,13 @@ class SAEditor : public EditorWidget
 		int setCurrentSaveSlot_int(int saveSlot) final;
 
 	protected slots:
+		/**
+		 * The current tab has changed.
+		 * The tab is loaded with the current slot's data if it's stale.
+		 * @param index Tab index.
+		 */
+		void tabWidget_currentChanged_slot(int index);
+
 		/**
 		 * Widget's modified state has been changed.
 		 * @param modified New modified state.
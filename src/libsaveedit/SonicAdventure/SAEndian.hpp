@@ -0,0 +1,190 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libsaveedit]                     *
+ * SAEndian.hpp: Sonic Adventure - structure byteswapping tables.          *
+ *                                                                         *
+ * Copyright (c) 2015-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBSAVEEDIT_SONICADVENTURE_SAENDIAN_HPP__
+#define __LIBSAVEEDIT_SONICADVENTURE_SAENDIAN_HPP__
+
+#include "sa_defs.h"
+
+// libgctools
+#include "util/byteswap.h"
+
+// C includes.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Byteswapping tables for the sa_defs.h structs.
+ *
+ * The save slots are byteswapped as whole structs, but instead of
+ * a hand-written function for each struct, each multi-byte field is
+ * described by a Field<> type, and each struct has a FieldList<> of
+ * all of its multi-byte fields. convert() swaps every listed field
+ * in place: the save slots are converted to host byte order once
+ * when loading, and a copy is converted back to the file's byte
+ * order when saving.
+ *
+ * Single-byte fields (time codes, flags, etc.) don't need to be
+ * converted and aren't listed.
+ */
+namespace SAEndian {
+
+/**
+ * Byte order.
+ */
+enum Endian {
+	LittleEndian,	// Dreamcast (SH-4)
+	BigEndian,	// GameCube (PowerPC 750)
+
+#if SYS_BYTEORDER == SYS_BIG_ENDIAN
+	HostEndian = BigEndian,
+#else /* SYS_BYTEORDER == SYS_LIL_ENDIAN */
+	HostEndian = LittleEndian,
+#endif
+};
+
+/**
+ * Unsigned integer type with the specified size.
+ * Used to byteswap signed fields without sign extension.
+ */
+template<size_t Size> struct UIntOfSize;
+template<> struct UIntOfSize<1> { typedef uint8_t type; };
+template<> struct UIntOfSize<2> { typedef uint16_t type; };
+template<> struct UIntOfSize<4> { typedef uint32_t type; };
+
+static inline uint8_t swapBytes(uint8_t x) { return x; }
+static inline uint16_t swapBytes(uint16_t x) { return __swab16(x); }
+static inline uint32_t swapBytes(uint32_t x) { return __swab32(x); }
+
+/**
+ * Multi-byte field descriptor.
+ * @param T Field type.
+ * @param Offset Offset of the first element within the struct.
+ * @param Count Number of elements.
+ * @param Stride Distance between elements, in bytes.
+ */
+template<typename T, size_t Offset, size_t Count = 1, size_t Stride = sizeof(T)>
+struct Field {
+	/**
+	 * Byteswap all elements of this field in place.
+	 * @param base Start of the struct.
+	 */
+	static inline void swap(void *base)
+	{
+		typedef typename UIntOfSize<sizeof(T)>::type U;
+		uint8_t *p = static_cast<uint8_t*>(base) + Offset;
+		for (size_t i = 0; i < Count; i++, p += Stride) {
+			U u;
+			memcpy(&u, p, sizeof(u));
+			u = swapBytes(u);
+			memcpy(p, &u, sizeof(u));
+		}
+	}
+};
+
+/**
+ * List of all multi-byte fields in a struct.
+ */
+template<typename... Fields>
+struct FieldList;
+
+template<>
+struct FieldList<> {
+	static inline void swap(void *base) { ((void)base); }
+};
+
+template<typename First, typename... Rest>
+struct FieldList<First, Rest...> {
+	/**
+	 * Byteswap all fields in place.
+	 * @param base Start of the struct.
+	 */
+	static inline void swap(void *base)
+	{
+		First::swap(base);
+		FieldList<Rest...>::swap(base);
+	}
+};
+
+/**
+ * Convert a struct between the specified byte order and host byte order, in place.
+ * Nothing is done if endian is the host byte order.
+ * @param Fields FieldList for the struct.
+ * @param endian Byte order of the buffer.
+ * @param base Start of the struct in the buffer.
+ */
+template<typename Fields>
+static inline void convert(Endian endian, void *base)
+{
+	if (endian != HostEndian) {
+		Fields::swap(base);
+	}
+}
+
+/** Field descriptors **/
+
+// Field with Count elements, covering an entire array member.
+#define SA_FIELD_ARRAY(st, type, member) \
+	SAEndian::Field<type, offsetof(st, member), \
+		sizeof(((st*)0)->member) / sizeof(type)>
+
+// Field at the same offset in each element of an array of structs.
+#define SA_FIELD_STRIDED(st, type, array, member) \
+	SAEndian::Field<type, offsetof(st, array[0].member), \
+		sizeof(((st*)0)->array) / sizeof(((st*)0)->array[0]), \
+		sizeof(((st*)0)->array[0])>
+
+// sa_save_slot
+typedef Field<uint32_t, offsetof(sa_save_slot, playTime)>	sa_save_slot_playTime;
+typedef Field<uint16_t, offsetof(sa_save_slot, last_level)>	sa_save_slot_last_level;
+typedef SA_FIELD_ARRAY(sa_save_slot, uint32_t, scores.all)		sa_save_slot_scores;
+typedef SA_FIELD_ARRAY(sa_save_slot, uint16_t, weights.all)		sa_save_slot_weights;
+typedef SA_FIELD_ARRAY(sa_save_slot, uint16_t, rings.all)		sa_save_slot_rings;
+typedef SA_FIELD_ARRAY(sa_save_slot, uint32_t, mini_game_scores.all)	sa_save_slot_mini_game_scores;
+typedef SA_FIELD_STRIDED(sa_save_slot, int16_t, adventure_mode.chr, unknown1)		sa_save_slot_adv_unknown1;
+typedef SA_FIELD_STRIDED(sa_save_slot, int16_t, adventure_mode.chr, unknown2)		sa_save_slot_adv_unknown2;
+typedef SA_FIELD_STRIDED(sa_save_slot, uint16_t, adventure_mode.chr, start_entrance)	sa_save_slot_adv_start_entrance;
+typedef SA_FIELD_STRIDED(sa_save_slot, uint16_t, adventure_mode.chr, start_level_and_act)	sa_save_slot_adv_start_level_and_act;
+typedef SA_FIELD_STRIDED(sa_save_slot, int16_t, adventure_mode.chr, unknown3)		sa_save_slot_adv_unknown3;
+
+// NOTE: The CRC isn't converted, since it's
+// recalculated in file byte order when saving.
+typedef FieldList<
+	sa_save_slot_playTime,
+	sa_save_slot_scores,
+	sa_save_slot_weights,
+	sa_save_slot_rings,
+	sa_save_slot_mini_game_scores,
+	sa_save_slot_last_level,
+	sa_save_slot_adv_unknown1,
+	sa_save_slot_adv_unknown2,
+	sa_save_slot_adv_start_entrance,
+	sa_save_slot_adv_start_level_and_act,
+	sa_save_slot_adv_unknown3
+	> sa_save_slot_fields;
+
+// sadx_extra_save_slot
+typedef Field<uint32_t, offsetof(sadx_extra_save_slot, rings_black_market)>	sadx_extra_save_slot_rings_black_market;
+typedef SA_FIELD_ARRAY(sadx_extra_save_slot, uint32_t, scores_metal)		sadx_extra_save_slot_scores_metal;
+typedef SA_FIELD_ARRAY(sadx_extra_save_slot, uint16_t, rings_metal)		sadx_extra_save_slot_rings_metal;
+typedef SA_FIELD_ARRAY(sadx_extra_save_slot, uint32_t, mini_game_scores_metal.all)	sadx_extra_save_slot_mini_game_scores_metal;
+// Metal Sonic emblems. (32-bit bitfield, host-endian.)
+typedef Field<uint32_t, offsetof(sadx_extra_save_slot, emblems_metal)>	sadx_extra_save_slot_emblems_metal;
+
+typedef FieldList<
+	sadx_extra_save_slot_rings_black_market,
+	sadx_extra_save_slot_scores_metal,
+	sadx_extra_save_slot_rings_metal,
+	sadx_extra_save_slot_mini_game_scores_metal,
+	sadx_extra_save_slot_emblems_metal
+	> sadx_extra_save_slot_fields;
+
+}
+
+#endif /* __LIBSAVEEDIT_SONICADVENTURE_SAENDIAN_HPP__ */
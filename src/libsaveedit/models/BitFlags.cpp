@@ -7,15 +7,18 @@
  ***************************************************************************/
 
 #include "BitFlags.hpp"
+#include "FlagDescTable.hpp"
+
+// libgctools
+#include "util/byteswap.h"
 
 // Qt includes.
-#include <QtCore/QCoreApplication>
-#include <QtCore/QHash>
 #include <QtCore/QString>
 #include <QtCore/QVector>
 
 // C includes. (C++ namespace)
 #include <cassert>
+#include <cstring>
 
 // TODO: Put this in a common header file somewhere.
 #define NUM_ELEMENTS(x) ((int)(sizeof(x) / sizeof(x[0])))
@@ -40,17 +43,23 @@ class BitFlagsPrivate
 
 	public:
 		// Flag descriptions.
-		// TODO: Shared copy shared by a specific derived
-		// class that's only deleted once all instances
-		// of said class are deleted?
-		QVector<const char*> flags_desc;
-
-		// Flags.
-		// NOTE: QVector<bool> does not have bit "optimization".
-		QVector<bool> flags;
-
-		// Translation context for bit flags.
-		const char *tr_ctx;
+		// Shared by all instances that use the same bit_flag_t array.
+		const FlagDescTable *descTable;
+
+		// Total number of flags.
+		int total_flags;
+
+		// Flags, packed into 32-bit words. (host-endian)
+		// Flag N is bit (N % 32) of words[N / 32].
+		// This matches the save files' bitfield layout once
+		// the words are stored as little-endian, so bulk loads
+		// and stores are a copy plus a byteswap on big-endian.
+		// Unused bits in the last word are always 0.
+		QVector<uint32_t> words;
+
+		// Change mask for flagsChanged().
+		// Reused by setAllFlags() to avoid reallocating it.
+		QVector<uint32_t> changeMask;
 };
 
 /**
@@ -62,7 +71,8 @@ class BitFlagsPrivate
  */
 BitFlagsPrivate::BitFlagsPrivate(int total_flags, const char *tr_ctx,
 				 const bit_flag_t *bit_flags, int count)
-	: tr_ctx(tr_ctx)
+	: descTable(FlagDescTable::get(tr_ctx, bit_flags, count))
+	, total_flags(total_flags)
 {
 	// This is initialized by a derived private class.
 	assert(total_flags > 0);
@@ -70,22 +80,8 @@ BitFlagsPrivate::BitFlagsPrivate(int total_flags, const char *tr_ctx,
 	assert(count >= 0);
 
 	// Initialize flags.
-	// QVector automatically initializes the new elements to false.
-	flags.resize(total_flags);
-
-	// Initialize flags_desc.
-	// TODO: Once per derived class, rather than once per instance?
-	flags_desc.clear();
-	flags_desc.resize(total_flags);
-	for (int i = 0; i < count; i++, bit_flags++) {
-		if (bit_flags->event < 0 || !bit_flags->description) {
-			// End of list.
-			// NOTE: count should have been set correctly...
-			break;
-		}
-
-		flags_desc[bit_flags->event] = bit_flags->description;
-	}
+	// QVector automatically initializes the new elements to 0.
+	words.resize((total_flags + 31) / 32);
 }
 
 /** BitFlags **/
@@ -137,7 +133,7 @@ BitFlags::~BitFlags()
 int BitFlags::count(void) const
 {
 	Q_D(const BitFlags);
-	return d->flags.size();
+	return d->total_flags;
 }
 
 /**
@@ -152,22 +148,12 @@ QString BitFlags::description(int flag) const
 		return tr("Invalid flag ID");
 
 	Q_D(const BitFlags);
-	const char *desc = d->flags_desc[flag];
-	if (!desc) {
+	const QString desc = (d->descTable ? d->descTable->description(flag) : QString());
+	if (desc.isNull()) {
 		// No flag description is available.
 		return tr("Unknown");
 	}
-
-	if (d->tr_ctx) {
-		// Translation context is available.
-		return QCoreApplication::translate(d->tr_ctx, desc);
-	}
-
-	// Translation context is not available.
-	// NOTE: This may end up being slower and/or
-	// using more memory due to lack of implicit
-	// QString sharing.
-	return QLatin1String(desc);
+	return desc;
 }
 
 /**
@@ -181,7 +167,7 @@ bool BitFlags::flag(int flag) const
 		return false;
 
 	Q_D(const BitFlags);
-	return d->flags.at(flag);
+	return !!(d->words.at(flag / 32) & (1U << (flag % 32)));
 }
 
 /**
@@ -195,7 +181,14 @@ void BitFlags::setFlag(int flag, bool value)
 		return;
 
 	Q_D(BitFlags);
-	d->flags[flag] = value;
+	uint32_t &word = d->words[flag / 32];
+	const uint32_t bit = (1U << (flag % 32));
+	if (!!(word & bit) == value) {
+		// Flag is unchanged.
+		return;
+	}
+
+	word ^= bit;
 	emit flagChanged(flag, value);
 }
 
@@ -206,6 +199,8 @@ void BitFlags::setFlag(int flag, bool value)
  * - Too small: Array will be used for the first sz*8 flags.
  * - Too big: Array will be used for count()*8 flags.
  *
+ * Bits in the last byte past count() are cleared.
+ *
  * TODO: Various bit flag encodings.
  *
  * @param data Bit flags.
@@ -221,23 +216,24 @@ int BitFlags::allFlags(uint8_t *data, int sz) const
 
 	// Convert to bits.
 	int bits = sz * 8;
-	if (bits > d->flags.count())
-		bits = d->flags.count();
-
-	// TODO: Verify that this is correct.
-	const bool *flagBool = d->flags.constData();
-	for (int i = 0; i < bits; i++, flagBool++) {
-		if (i % 8 == 0) {
-			// New byte.
-			// TODO: Optimize this?
-			if (i > 0)
-				data++;
-			*data = 0;
-		}
-
-		// Get this flag.
-		*data >>= 1;
-		*data |= (*flagBool ? 0x80 : 0);
+	if (bits > d->total_flags)
+		bits = d->total_flags;
+
+	// Whole words.
+	const uint32_t *pWord = d->words.constData();
+	const int fullWords = bits / 32;
+	for (int i = 0; i < fullWords; i++, pWord++, data += 4) {
+		const uint32_t word = *pWord;
+		const uint32_t leWord = cpu_to_le32(word);
+		memcpy(data, &leWord, 4);
+	}
+
+	// Partial word.
+	const int remBits = bits % 32;
+	if (remBits > 0) {
+		const uint32_t word = (*pWord & ((1U << remBits) - 1));
+		const uint32_t leWord = cpu_to_le32(word);
+		memcpy(data, &leWord, (remBits + 7) / 8);
 	}
 
 	return bits;
@@ -250,6 +246,9 @@ int BitFlags::allFlags(uint8_t *data, int sz) const
  * - Too small: Array will be used for the first sz*8 flags.
  * - Too big: Array will be used for count()*8 flags.
  *
+ * flagsChanged() is emitted with a mask of the flags
+ * that were actually changed, if any.
+ *
  * TODO: Various bit flag encodings.
  *
  * @param data Bit flags.
@@ -265,23 +264,40 @@ int BitFlags::setAllFlags(const uint8_t *data, int sz)
 
 	// Convert to bits.
 	int bits = sz * 8;
-	if (bits > d->flags.count())
-		bits = d->flags.count();
-
-	uint8_t curByte = 0;
-	bool *flagBool = d->flags.data();
-	for (int i = 0; i < bits; i++, flagBool++) {
-		if (i % 8 == 0) {
-			// New byte.
-			curByte = *data++;
-		}
-
-		// Set this flag.
-		*flagBool = (curByte & 0x01);
-		curByte >>= 1;
+	if (bits > d->total_flags)
+		bits = d->total_flags;
+
+	d->changeMask.fill(0, d->words.size());
+	uint32_t *pWord = d->words.data();
+	uint32_t *pMask = d->changeMask.data();
+	uint32_t changed = 0;
+
+	// Whole words.
+	const int fullWords = bits / 32;
+	for (int i = 0; i < fullWords; i++, pWord++, pMask++, data += 4) {
+		uint32_t leWord;
+		memcpy(&leWord, data, 4);
+		const uint32_t word = le32_to_cpu(leWord);
+		*pMask = (*pWord ^ word);
+		*pWord = word;
+		changed |= *pMask;
+	}
+
+	// Partial word.
+	const int remBits = bits % 32;
+	if (remBits > 0) {
+		uint32_t leWord = 0;
+		memcpy(&leWord, data, (remBits + 7) / 8);
+		const uint32_t mask = ((1U << remBits) - 1);
+		const uint32_t word = (le32_to_cpu(leWord) & mask);
+		*pMask = ((*pWord & mask) ^ word);
+		*pWord = ((*pWord & ~mask) | word);
+		changed |= *pMask;
 	}
 
-	emit flagsChanged(0, bits-1);
+	if (changed != 0) {
+		emit flagsChanged(d->changeMask);
+	}
 	return bits;
 }
 
@@ -11,6 +11,7 @@
 
 // Qt includes.
 #include <QtCore/QObject>
+#include <QtCore/QVector>
 
 // Bit flag struct.
 // (Works for ByteFlags as well.)
@@ -81,10 +82,10 @@ class BitFlags : public QObject
 		 * NOTE: If a single flag is changed,
 		 * flagChanged() is emitted instead.
 		 *
-		 * @param firstFlag First flag that has changed.
-		 * @param lastFlag Last flag that has changed.
+		 * @param changeMask Change mask. Flag N has changed if
+		 * bit (N % 32) of changeMask[N / 32] is set.
 		 */
-		void flagsChanged(int firstFlag, int lastFlag);
+		void flagsChanged(const QVector<uint32_t> &changeMask);
 
 	public:
 		/**
@@ -121,6 +122,8 @@ class BitFlags : public QObject
 		 * - Too small: Array will be used for the first sz*8 flags.
 		 * - Too big: Array will be used for count()*8 flags.
 		 *
+		 * Bits in the last byte past count() are cleared.
+		 *
 		 * TODO: Various bit flag encodings.
 		 *
 		 * @param data Bit flags.
@@ -136,6 +139,9 @@ class BitFlags : public QObject
 		 * - Too small: Array will be used for the first sz*8 flags.
 		 * - Too big: Array will be used for count()*8 flags.
 		 *
+		 * flagsChanged() is emitted with a mask of the flags
+		 * that were actually changed, if any.
+		 *
 		 * TODO: Various bit flag encodings.
 		 *
 		 * @param data Bit flags.
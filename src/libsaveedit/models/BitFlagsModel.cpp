@@ -338,19 +338,42 @@ void BitFlagsModel::bitFlags_flagChanged_slot(int flag)
 
 /**
  * BitFlags: Multiple flags have been changed.
- * @param firstFlag First flag that has changed.
- * @param lastFlag Last flag that has changed.
+ * dataChanged() is only emitted for the flags that changed.
+ * @param changeMask Change mask. Flag N has changed if
+ * bit (N % 32) of changeMask[N / 32] is set.
  */
-void BitFlagsModel::bitFlags_flagsChanged_slot(int firstFlag, int lastFlag)
+void BitFlagsModel::bitFlags_flagsChanged_slot(const QVector<uint32_t> &changeMask)
 {
 	Q_D(BitFlagsModel);
 	if (!d->bitFlags)
 		return;
-	else if (firstFlag < 0 || firstFlag >= d->bitFlags->count())
-		return;
-	else if (lastFlag < 0 || lastFlag >= d->bitFlags->count())
-		return;
 
+	// Emit dataChanged() for each run of changed flags.
 	// NOTE: Only COL_CHECKBOX has a checkbox.
-	emit dataChanged(createIndex(firstFlag, COL_CHECKBOX), createIndex(lastFlag, COL_CHECKBOX));
+	const int flagCount = qMin(d->bitFlags->count(), changeMask.size() * 32);
+	int firstFlag = -1;
+	for (int flag = 0; flag < flagCount; flag++) {
+		const uint32_t word = changeMask.at(flag / 32);
+		if ((flag % 32) == 0) {
+			// Skip words that don't end or start a run.
+			if ((firstFlag < 0 && word == 0) ||
+			    (firstFlag >= 0 && word == ~0U))
+			{
+				flag += 31;
+				continue;
+			}
+		}
+
+		const bool changed = !!(word & (1U << (flag % 32)));
+		if (changed && firstFlag < 0) {
+			firstFlag = flag;
+		} else if (!changed && firstFlag >= 0) {
+			emit dataChanged(createIndex(firstFlag, COL_CHECKBOX), createIndex(flag - 1, COL_CHECKBOX));
+			firstFlag = -1;
+		}
+	}
+
+	if (firstFlag >= 0) {
+		emit dataChanged(createIndex(firstFlag, COL_CHECKBOX), createIndex(flagCount - 1, COL_CHECKBOX));
+	}
 }
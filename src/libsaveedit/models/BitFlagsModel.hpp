@@ -11,6 +11,7 @@
 
 // Qt includes.
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QVector>
 
 class BitFlags;
 
@@ -100,10 +101,11 @@ class BitFlagsModel : public QAbstractListModel
 
 		/**
 		 * BitFlags: Multiple flags have been changed.
-		 * @param firstFlag First flag that has changed.
-		 * @param lastFlag Last flag that has changed.
+		 * dataChanged() is only emitted for the flags that changed.
+		 * @param changeMask Change mask. Flag N has changed if
+		 * bit (N % 32) of changeMask[N / 32] is set.
 		 */
-		void bitFlags_flagsChanged_slot(int firstFlag, int lastFlag);
+		void bitFlags_flagsChanged_slot(const QVector<uint32_t> &changeMask);
 };
 
 #endif /* __LIBSAVEEDIT_MODELS_BITFLAGSMODEL_HPP__ */
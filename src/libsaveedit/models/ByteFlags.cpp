@@ -9,10 +9,9 @@
  ***************************************************************************/
 
 #include "ByteFlags.hpp"
+#include "FlagDescTable.hpp"
 
 // Qt includes.
-#include <QtCore/QCoreApplication>
-#include <QtCore/QHash>
 #include <QtCore/QString>
 #include <QtCore/QVector>
 
@@ -42,16 +41,11 @@ class ByteFlagsPrivate
 
 	public:
 		// Object descriptions.
-		// TODO: Shared copy shared by a specific derived
-		// class that's only deleted once all instances
-		// of said class are deleted?
-		QVector<const char*> objs_desc;
+		// Shared by all instances that use the same bit_flag_t array.
+		const FlagDescTable *descTable;
 
 		// Objects, each with 8 flags.
 		QVector<uint8_t> objs;
-
-		// Translation context for bit flags.
-		const char *tr_ctx;
 };
 
 /**
@@ -63,7 +57,7 @@ class ByteFlagsPrivate
  */
 ByteFlagsPrivate::ByteFlagsPrivate(int total_flags, const char *tr_ctx,
 				   const bit_flag_t *byte_flags, int count)
-	: tr_ctx(tr_ctx)
+	: descTable(FlagDescTable::get(tr_ctx, byte_flags, count))
 {
 	// This is initialized by a derived private class.
 	assert(total_flags > 0);
@@ -73,20 +67,6 @@ ByteFlagsPrivate::ByteFlagsPrivate(int total_flags, const char *tr_ctx,
 	// Initialize flags.
 	// QVector automatically initializes the new elements to false.
 	objs.resize(total_flags);
-
-	// Initialize flags_desc.
-	// TODO: Once per derived class, rather than once per instance?
-	objs_desc.clear();
-	objs_desc.resize(total_flags);
-	for (int i = 0; i < count; i++, byte_flags++) {
-		if (byte_flags->event < 0 || !byte_flags->description) {
-			// End of list.
-			// NOTE: count should have been set correctly...
-			break;
-		}
-
-		objs_desc[byte_flags->event] = byte_flags->description;
-	}
 }
 
 /** ByteFlags **/
@@ -153,22 +133,12 @@ QString ByteFlags::description(int id) const
 		return tr("Invalid object ID");
 
 	Q_D(const ByteFlags);
-	const char *desc = d->objs_desc[id];
-	if (!desc) {
+	const QString desc = (d->descTable ? d->descTable->description(id) : QString());
+	if (desc.isNull()) {
 		// No flag description is available.
 		return tr("Unknown");
 	}
-
-	if (d->tr_ctx) {
-		// Translation context is available.
-		return QCoreApplication::translate(d->tr_ctx, desc);
-	}
-
-	// Translation context is not available.
-	// NOTE: This may end up being slower and/or
-	// using more memory due to lack of implicit
-	// QString sharing.
-	return QLatin1String(desc);
+	return desc;
 }
 
 /**
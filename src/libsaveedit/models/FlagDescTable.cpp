@@ -0,0 +1,149 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libsaveedit]                     *
+ * FlagDescTable.cpp: Shared flag description table.                       *
+ *                                                                         *
+ * Copyright (c) 2015-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "FlagDescTable.hpp"
+
+// Qt includes.
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+
+// C includes. (C++ namespace)
+#include <cassert>
+
+/**
+ * Language generation.
+ * Incremented by invalidateTranslations(), which
+ * invalidates all translated descriptions.
+ */
+static QAtomicInt languageGeneration;
+
+/**
+ * Shared tables, indexed by bit_flag_t array.
+ */
+struct FlagDescRegistry {
+	QMutex mutex;
+	QHash<const bit_flag_t*, FlagDescTable*> tables;
+
+	~FlagDescRegistry()
+	{
+		qDeleteAll(tables);
+	}
+};
+Q_GLOBAL_STATIC(FlagDescRegistry, flagDescRegistry)
+
+FlagDescTable::FlagDescTable(const char *tr_ctx, const bit_flag_t *bit_flags, int count)
+	: m_tr_ctx(tr_ctx)
+	, m_bit_flags(bit_flags)
+	, m_count(0)
+	, m_trGeneration(languageGeneration.load())
+{
+	// Find the end of the list.
+	for (; m_count < count; m_count++) {
+		if (bit_flags[m_count].event < 0 || !bit_flags[m_count].description) {
+			// End of list.
+			// NOTE: count should have been set correctly...
+			break;
+		}
+
+		// The array must be sorted for find().
+		assert(m_count == 0 || bit_flags[m_count].event > bit_flags[m_count-1].event);
+	}
+
+	m_trCache.resize(m_count);
+}
+
+/**
+ * Get the shared table for a bit_flag_t array.
+ * The table is created the first time it's requested.
+ * @param tr_ctx Translation context for bit flag descriptions. (may be nullptr)
+ * @param bit_flags Bit flag descriptions, sorted by flag ID.
+ * @param count Number of bit_flags entries.
+ * @return Shared table, or nullptr if there are no descriptions.
+ */
+const FlagDescTable *FlagDescTable::get(const char *tr_ctx, const bit_flag_t *bit_flags, int count)
+{
+	if (!bit_flags || count <= 0)
+		return nullptr;
+
+	FlagDescRegistry *const registry = flagDescRegistry();
+	QMutexLocker locker(&registry->mutex);
+	FlagDescTable *table = registry->tables.value(bit_flags);
+	if (!table) {
+		table = new FlagDescTable(tr_ctx, bit_flags, count);
+		registry->tables.insert(bit_flags, table);
+	}
+
+	assert(table->m_tr_ctx == tr_ctx);
+	return table;
+}
+
+/**
+ * Invalidate all translated descriptions.
+ * This should be called when the UI language changes.
+ */
+void FlagDescTable::invalidateTranslations(void)
+{
+	languageGeneration.ref();
+}
+
+/**
+ * Find a flag in the bit_flag_t array.
+ * @param flag Flag ID.
+ * @return Index in the bit_flag_t array, or -1 if not found.
+ */
+int FlagDescTable::find(int flag) const
+{
+	int lo = 0, hi = m_count - 1;
+	while (lo <= hi) {
+		const int mid = lo + ((hi - lo) / 2);
+		const int event = m_bit_flags[mid].event;
+		if (event == flag) {
+			return mid;
+		} else if (event < flag) {
+			lo = mid + 1;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Get a flag's description.
+ * @param flag Flag ID.
+ * @return Translated description, or null QString if the flag doesn't have one.
+ */
+QString FlagDescTable::description(int flag) const
+{
+	const int idx = find(flag);
+	if (idx < 0)
+		return QString();
+
+	const int generation = languageGeneration.load();
+	if (m_trGeneration != generation) {
+		// Language has changed.
+		m_trCache.fill(QString());
+		m_trGeneration = generation;
+	}
+
+	QString &desc = m_trCache[idx];
+	if (desc.isNull()) {
+		const char *const str = m_bit_flags[idx].description;
+		if (m_tr_ctx) {
+			// Translation context is available.
+			desc = QCoreApplication::translate(m_tr_ctx, str);
+		} else {
+			// Translation context is not available.
+			desc = QLatin1String(str);
+		}
+	}
+	return desc;
+}
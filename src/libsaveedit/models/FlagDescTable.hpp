@@ -0,0 +1,86 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program [libsaveedit]                     *
+ * FlagDescTable.hpp: Shared flag description table.                       *
+ *                                                                         *
+ * Copyright (c) 2015-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __LIBSAVEEDIT_MODELS_FLAGDESCTABLE_HPP__
+#define __LIBSAVEEDIT_MODELS_FLAGDESCTABLE_HPP__
+
+#include "bit_flag.h"
+
+// Qt includes.
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+/**
+ * Shared flag description table.
+ *
+ * One table is shared by all BitFlags and ByteFlags objects that
+ * use the same bit_flag_t array, so each object only needs a pointer
+ * to it. The bit_flag_t array is used directly, so it must be sorted
+ * by flag ID; descriptions are found using a binary search.
+ *
+ * Translated descriptions are cached the first time they're used.
+ * The cache is cleared by invalidateTranslations(), which
+ * must be called when the UI language changes.
+ *
+ * NOTE: Descriptions should only be retrieved from the GUI thread.
+ */
+class FlagDescTable
+{
+	private:
+		FlagDescTable(const char *tr_ctx, const bit_flag_t *bit_flags, int count);
+
+	private:
+		// TODO: Copy Qt's Q_DISABLE_COPY() macro.
+		FlagDescTable(const FlagDescTable &);
+		FlagDescTable &operator=(const FlagDescTable &);
+
+	public:
+		/**
+		 * Get the shared table for a bit_flag_t array.
+		 * The table is created the first time it's requested.
+		 * @param tr_ctx Translation context for bit flag descriptions. (may be nullptr)
+		 * @param bit_flags Bit flag descriptions, sorted by flag ID.
+		 * @param count Number of bit_flags entries.
+		 * @return Shared table, or nullptr if there are no descriptions.
+		 */
+		static const FlagDescTable *get(const char *tr_ctx, const bit_flag_t *bit_flags, int count);
+
+		/**
+		 * Invalidate all translated descriptions.
+		 * This should be called when the UI language changes.
+		 */
+		static void invalidateTranslations(void);
+
+		/**
+		 * Get a flag's description.
+		 * @param flag Flag ID.
+		 * @return Translated description, or null QString if the flag doesn't have one.
+		 */
+		QString description(int flag) const;
+
+	private:
+		/**
+		 * Find a flag in the bit_flag_t array.
+		 * @param flag Flag ID.
+		 * @return Index in the bit_flag_t array, or -1 if not found.
+		 */
+		int find(int flag) const;
+
+	private:
+		const char *const m_tr_ctx;
+		const bit_flag_t *const m_bit_flags;
+		int m_count;
+
+		// Translated descriptions, in bit_flags order.
+		// Null QStrings haven't been translated yet.
+		mutable QVector<QString> m_trCache;
+		// Language generation that m_trCache is valid for.
+		mutable int m_trGeneration;
+};
+
+#endif /* __LIBSAVEEDIT_MODELS_FLAGDESCTABLE_HPP__ */
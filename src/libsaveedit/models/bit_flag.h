@@ -13,6 +13,11 @@
 extern "C" {
 #endif
 
+/**
+ * Bit flag description.
+ * Arrays of bit_flag_t must be sorted by flag ID,
+ * and end with an entry with a negative flag ID.
+ */
 typedef struct _bit_flag_t {
 	int event;
 	const char *description;
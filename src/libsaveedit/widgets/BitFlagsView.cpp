@@ -11,6 +11,7 @@
 #include "../models/BitFlags.hpp"
 #include "../models/BitFlagsModel.hpp"
 #include "../models/PageFilterModel.hpp"
+#include "../models/FlagDescTable.hpp"
 
 // C includes. (C++ namespace)
 #include <cassert>
@@ -183,6 +184,9 @@ BitFlagsView::~BitFlagsView()
 void BitFlagsView::changeEvent(QEvent *event)
 {
 	if (event->type() == QEvent::LanguageChange) {
+		// Flag descriptions need to be retranslated.
+		FlagDescTable::invalidateTranslations();
+
 		// Retranslate the UI.
 		Q_D(BitFlagsView);
 		d->ui.retranslateUi(this);
@@ -11,6 +11,7 @@
 #include "../models/ByteFlags.hpp"
 #include "../models/ByteFlagsModel.hpp"
 #include "../models/PageFilterModel.hpp"
+#include "../models/FlagDescTable.hpp"
 #include "CenteredCheckBoxDelegate.hpp"
 
 // C includes. (C++ namespace)
@@ -184,6 +185,9 @@ ByteFlagsView::~ByteFlagsView()
 void ByteFlagsView::changeEvent(QEvent *event)
 {
 	if (event->type() == QEvent::LanguageChange) {
+		// Flag descriptions need to be retranslated.
+		FlagDescTable::invalidateTranslations();
+
 		// Retranslate the UI.
 		Q_D(ByteFlagsView);
 		d->ui.retranslateUi(this);
@@ -68,12 +68,17 @@ class DockManagerPrivate : public TaskbarButtonManagerPrivate
 		// DockManager.
 		net::launchpad::DockManager *ifDockManager;
 		net::launchpad::DockItem *ifDockItem;
+
+		// Last progress value sent to the DockItem.
+		// -2 if nothing has been sent yet.
+		int lastProgress;
 };
 
 DockManagerPrivate::DockManagerPrivate(DockManager *const q)
 	: super(q)
 	, ifDockManager(nullptr)
 	, ifDockItem(nullptr)
+	, lastProgress(-2)
 {
 	// Make sure the DBus metatypes are registered.
 	registerDBusMetatypes();
@@ -95,6 +100,7 @@ void DockManagerPrivate::close(void)
 	ifDockItem = nullptr;
 	delete ifDockManager;
 	ifDockManager = nullptr;
+	lastProgress = -2;
 }
 
 /**
@@ -195,9 +201,6 @@ void DockManagerPrivate::update(void)
 		return;
 	}
 
-	// Update the DockItem.
-	QVariantMap dockItemProps;
-
 	// Progress.
 	int progress;
 	int curVal = this->progressBarValue;
@@ -209,6 +212,15 @@ void DockManagerPrivate::update(void)
 	} else {
 		progress = (int)(((float)curVal / (float)curMax) * 100);
 	}
+	if (progress == lastProgress) {
+		// Progress hasn't changed.
+		// Don't send another D-Bus message.
+		return;
+	}
+	lastProgress = progress;
+
+	// Update the DockItem.
+	QVariantMap dockItemProps;
 	dockItemProps[QLatin1String("progress")] = progress;
 
 	ifDockItem->UpdateDockItem(dockItemProps);
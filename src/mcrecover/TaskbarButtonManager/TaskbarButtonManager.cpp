@@ -19,7 +19,9 @@ TaskbarButtonManagerPrivate::TaskbarButtonManagerPrivate(TaskbarButtonManager *c
 	, window(nullptr)
 	, progressBarValue(-1)
 	, progressBarMax(-1)
-{ }
+{
+	tmrUpdate.setSingleShot(true);
+}
 
 TaskbarButtonManagerPrivate::~TaskbarButtonManagerPrivate()
 {
@@ -32,7 +34,10 @@ TaskbarButtonManagerPrivate::~TaskbarButtonManagerPrivate()
 TaskbarButtonManager::TaskbarButtonManager(TaskbarButtonManagerPrivate *d, QObject* parent)
 	: super(parent)
 	, d_ptr(d)
-{ }
+{
+	connect(&d->tmrUpdate, &QTimer::timeout,
+		this, &TaskbarButtonManager::tmrUpdate_slot);
+}
 
 TaskbarButtonManager::~TaskbarButtonManager()
 {
@@ -81,7 +86,7 @@ void TaskbarButtonManager::clearProgressBar(void)
 	Q_D(TaskbarButtonManager);
 	d->progressBarValue = -1;
 	d->progressBarMax = -1;
-	this->update();
+	flushUpdate();
 }
 
 /**
@@ -103,7 +108,7 @@ void TaskbarButtonManager::setProgressBarValue(int value)
 	Q_D(TaskbarButtonManager);
 	if (d->progressBarValue != value) {
 		d->progressBarValue = value;
-		this->update();
+		requestUpdate();
 	}
 }
 
@@ -126,10 +131,46 @@ void TaskbarButtonManager::setProgressBarMax(int max)
 	Q_D(TaskbarButtonManager);
 	if (d->progressBarMax != max) {
 		d->progressBarMax = max;
-		this->update();
+		requestUpdate();
 	}
 }
 
+/**
+ * Request a taskbar button update.
+ * If the taskbar button was updated recently,
+ * the update is deferred, and multiple requests
+ * are combined into a single update.
+ */
+void TaskbarButtonManager::requestUpdate(void)
+{
+	Q_D(TaskbarButtonManager);
+	if (d->tmrUpdate.isActive()) {
+		// An update is already pending.
+		return;
+	}
+
+	const qint64 elapsed = (d->lastUpdate.isValid() ? d->lastUpdate.elapsed() : -1);
+	if (elapsed < 0 || elapsed >= TaskbarButtonManagerPrivate::MIN_UPDATE_INTERVAL_MS) {
+		// Update now.
+		flushUpdate();
+	} else {
+		// Defer the update.
+		d->tmrUpdate.start(TaskbarButtonManagerPrivate::MIN_UPDATE_INTERVAL_MS - (int)elapsed);
+	}
+}
+
+/**
+ * Update the taskbar button now.
+ * Any pending update is cancelled.
+ */
+void TaskbarButtonManager::flushUpdate(void)
+{
+	Q_D(TaskbarButtonManager);
+	d->tmrUpdate.stop();
+	d->lastUpdate.start();
+	this->update();
+}
+
 /** Slots **/
 
 /**
@@ -148,3 +189,11 @@ void TaskbarButtonManager::windowDestroyed_slot(QObject *obj)
 		this->setWindow(nullptr);
 	}
 }
+
+/**
+ * Deferred taskbar button update.
+ */
+void TaskbarButtonManager::tmrUpdate_slot(void)
+{
+	flushUpdate();
+}
@@ -88,12 +88,32 @@ class TaskbarButtonManager : public QObject
 		 */
 		virtual void update(void) = 0;
 
+	private:
+		/**
+		 * Request a taskbar button update.
+		 * If the taskbar button was updated recently,
+		 * the update is deferred, and multiple requests
+		 * are combined into a single update.
+		 */
+		void requestUpdate(void);
+
+		/**
+		 * Update the taskbar button now.
+		 * Any pending update is cancelled.
+		 */
+		void flushUpdate(void);
+
 	private slots:
 		/**
 		 * Window we're managing was destroyed.
 		 * @param obj QObject that was destroyed.
 		 */
 		void windowDestroyed_slot(QObject *obj);
+
+		/**
+		 * Deferred taskbar button update.
+		 */
+		void tmrUpdate_slot(void);
 };
 
 #endif /* __MCRECOVER_TASKBARBUTTONMANAGER_TASKBARBUTTONMANAGER_HPP__ */
@@ -11,6 +11,10 @@
 
 #include "TaskbarButtonManager.hpp"
 
+// Qt includes.
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QTimer>
+
 class TaskbarButtonManagerPrivate
 {
 	public:
@@ -30,6 +34,17 @@ class TaskbarButtonManagerPrivate
 		// Status elements.
 		int progressBarValue;	// Current progress. (-1 for no bar)
 		int progressBarMax;	// Maximum progress.
+
+		// Minimum interval between taskbar button updates, in milliseconds.
+		// Updating the taskbar button may require a round-trip to
+		// another process, so progress changes are coalesced.
+		static const int MIN_UPDATE_INTERVAL_MS = 100;
+
+		// Time since the last taskbar button update.
+		QElapsedTimer lastUpdate;
+
+		// Timer for a pending taskbar button update.
+		QTimer tmrUpdate;
 };
 
 #endif /* __MCRECOVER_TASKBARBUTTONMANAGER_TASKBARBUTTONMANAGER_P_HPP__ */
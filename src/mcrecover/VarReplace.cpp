@@ -8,6 +8,12 @@
 
 #include "VarReplace.hpp"
 
+// libmemcard
+#include "libmemcard/TimeFuncs.hpp"
+
+// C includes.
+#include <time.h>
+
 class VarReplacePrivate
 {
 	private:
@@ -31,26 +37,55 @@ class VarReplacePrivate
 			}
 			return true;
 		}
+
+		/**
+		 * Get the current local time.
+		 * The local date and time are returned as if they were UTC,
+		 * since GCN and Dreamcast timestamps don't have timezones.
+		 * @return Current local time, as a Unix timestamp.
+		 */
+		static int64_t currentLocalTime(void);
 };
 
+/**
+ * Get the current local time.
+ * The local date and time are returned as if they were UTC,
+ * since GCN and Dreamcast timestamps don't have timezones.
+ * @return Current local time, as a Unix timestamp.
+ */
+int64_t VarReplacePrivate::currentLocalTime(void)
+{
+	const time_t now = time(nullptr);
+#ifdef _WIN32
+	// MSVCRT's localtime() uses thread-local storage.
+	const struct tm *const ptm = localtime(&now);
+#else /* !_WIN32 */
+	struct tm tmbuf;
+	const struct tm *const ptm = localtime_r(&now, &tmbuf);
+#endif /* _WIN32 */
+	if (!ptm) {
+		// Conversion failed. Use UTC.
+		return (int64_t)now;
+	}
+
+	return TimeFuncs::unixTimeFromCivil(ptm->tm_year + 1900, ptm->tm_mon + 1,
+		ptm->tm_mday, ptm->tm_hour, ptm->tm_min, ptm->tm_sec);
+}
+
 /** VarReplace **/
 
 /**
- * Replace variables in a given string.
- * @param str String to replace variables in.
- * @param vars QHash containing variables for replacement.
- *
- * QHash format:
- * - key: variable name
- * - value: variable value
- *
- * @return str with replaced variables.
+ * Split a string into literal text and variables.
+ * Variable format: $VAR, ${VAR}, $(VAR)
+ * Invalid variable names are returned as literal text.
+ * @param str String.
+ * @return Tokens.
  */
-QString VarReplace::Exec(const QString &str, const QHash<QString, QString> &vars)
+QVector<VarReplace::Token> VarReplace::Tokenize(const QString &str)
 {
-	// Variable format: $VAR, ${VAR}, $(VAR)
-	QString workStr;
-	workStr.reserve(str.size() * 3 / 2);
+	QVector<Token> tokens;
+	QString literal;	// Current literal text.
+	literal.reserve(str.size());
 
 	// Valid variable name characters: [a-zA-Z_]
 	bool inVar = false;	// True if we're currently processing a variable.
@@ -72,7 +107,8 @@ QString VarReplace::Exec(const QString &str, const QHash<QString, QString> &vars
 				if (i + 1 >= str.length()) {
 					// Not enough characters remaining.
 					// TODO: Print error message?
-					workStr += chr;
+					literal += chr;
+					inVar = false;
 					break;
 				}
 
@@ -99,7 +135,7 @@ QString VarReplace::Exec(const QString &str, const QHash<QString, QString> &vars
 				}
 			} else {
 				// Not a dollar sign. Add the character to the string.
-				workStr += chr;
+				literal += chr;
 			}
 		} else {
 			// Currently in a variable.
@@ -152,17 +188,23 @@ QString VarReplace::Exec(const QString &str, const QHash<QString, QString> &vars
 					// TODO: Print a warning message.
 					isVarInvalid = true;
 				} else {
-					// Check if the variable is in the QHash.
-					// NOTE: This requires two lookups.
-					// Just get the value instead of checking contains()?
-					if (!vars.contains(varName)) {
-						// Variable is not in the QHash.
-						// TODO: Print a warning message?
-						isVarInvalid = true;
-					} else {
-						// Variable is in the QHash.
-						workStr += vars.value(varName);
+					// Variable name is valid.
+					if (!literal.isEmpty()) {
+						Token token;
+						token.text = literal;
+						tokens.append(token);
+						literal.clear();
 					}
+
+					Token token;
+					token.name = varName;
+					token.text = QChar(L'$');
+					if (!varDelimStart.isNull())
+						token.text += varDelimStart;
+					token.text += varName;
+					if (!varDelimEnd.isNull())
+						token.text += varDelimEnd;
+					tokens.append(token);
 				}
 
 				// Clear the "in-var" state.
@@ -172,12 +214,12 @@ QString VarReplace::Exec(const QString &str, const QHash<QString, QString> &vars
 			if (isVarInvalid) {
 				// Variable is invalid.
 				// Append the original variable name.
-				workStr += QChar(L'$');
+				literal += QChar(L'$');
 				if (!varDelimStart.isNull())
-					workStr += varDelimStart;
-				workStr += varName;
+					literal += varDelimStart;
+				literal += varName;
 				if (!varDelimEnd.isNull())
-					workStr += varDelimEnd;
+					literal += varDelimEnd;
 
 				// Clear the "in-var" state.
 				inVar = false;
@@ -185,43 +227,61 @@ QString VarReplace::Exec(const QString &str, const QHash<QString, QString> &vars
 
 			// Append the extra character if we didn't have delimiters.
 			if (!chr_extra.isNull())
-				workStr += chr_extra;
+				literal += chr_extra;
 		}
 	}
 
-	// Return the processed string.
-	return workStr;
+	if (inVar) {
+		// String ended right after a variable delimiter.
+		// TODO: Print error message?
+		literal += QChar(L'$');
+		literal += varDelimStart;
+	}
+
+	if (!literal.isEmpty()) {
+		Token token;
+		token.text = literal;
+		tokens.append(token);
+	}
+
+	return tokens;
 }
 
 /**
- * Combine QStringLists of GameDesc variables and FileDesc variables into a QHash.
- * @param gameDescVars GameDesc variables.
- * @param fileDescVars FileDesc variables.
+ * Replace variables in a given string.
+ * @param str String to replace variables in.
+ * @param vars QHash containing variables for replacement.
  *
- * NOTE: The first variable in each match ($G0, $F0) is
- * the full match from PCRE. This usually won't be used,
- * but is included in the variable hash anyway.
+ * QHash format:
+ * - key: variable name
+ * - value: variable value
  *
- * @return QHash containing the variables. (key == ID)
+ * @return str with replaced variables.
  */
-QHash<QString, QString> VarReplace::StringListsToHash(
-	const QStringList &gameDescVars,
-	const QStringList &fileDescVars)
+QString VarReplace::Exec(const QString &str, const QHash<QString, QString> &vars)
 {
-	QHash<QString, QString> vars;
-	QString varName;
-	varName.reserve(4);
+	QString workStr;
+	workStr.reserve(str.size() * 3 / 2);
 
-	for (int i = gameDescVars.size()-1; i >= 0; i--) {
-		varName = QChar(L'G') + QString::number(i);
-		vars.insert(varName, gameDescVars.at(i));
-	}
-	for (int i = fileDescVars.size()-1; i >= 0; i--) {
-		varName = QChar(L'F') + QString::number(i);
-		vars.insert(varName, fileDescVars.at(i));
+	foreach (const Token &token, Tokenize(str)) {
+		if (token.name.isEmpty()) {
+			// Literal text.
+			workStr += token.text;
+			continue;
+		}
+
+		auto iter = vars.constFind(token.name);
+		if (iter != vars.constEnd()) {
+			workStr += *iter;
+		} else {
+			// Variable is not in the QHash.
+			// TODO: Print a warning message?
+			workStr += token.text;
+		}
 	}
 
-	return vars;
+	// Return the processed string.
+	return workStr;
 }
 
 /**
@@ -286,225 +346,213 @@ int VarReplace::strToInt(const QString &str)
 }
 
 /**
- * Apply variable modifiers to a QHash containing variables.
- * @param varModifierDefs	[in] Variable modifier definitions.
- * @param vars			[in, out] Variables to modify.
- * @param qDateTime		[out, opt] If specified, QDateTime for the timestamp.
- * @return 0 on success; non-zero if any modifiers failed.
+ * Apply a variable modifier to a variable.
+ * @param varModifierDef	[in] Variable modifier definition.
+ * @param var			[in, out] Variable to modify.
+ * @param ts			[in, out] Timestamp components.
+ * @return 0 on success; non-zero if the modifier failed.
  */
-int VarReplace::ApplyModifiers(const QHash<QString, VarModifierDef> &varModifierDefs,
-			       QHash<QString, QString> &vars,
-			       QDateTime *qDateTime)
+int VarReplace::ApplyModifier(const VarModifierDef &varModifierDef,
+			      QString &var, TimestampParts &ts)
 {
-	// Timestamp construction.
-	int year = -1, month = -1, day = -1;
-	int hour = -1, minute = -1, second = -1;
-	int ampm = -1;
-
-	// TODO: Verify that all variables to be modified
-	// were present in vars.
-
-	QList<QString> varIDs = vars.keys();
-	foreach (const QString &id, varIDs) {
-		if (!varModifierDefs.contains(id))
-			continue;
+	// Always convert the string to num and char,
+	// in case it's needed for e.g. useAs==month.
+	int num = strToInt(var);
+	num += varModifierDef.addValue;
+	char chr = 0;
+	if (var.size() == 1) {
+		chr = var.at(0).toLatin1();
+		chr += varModifierDef.addValue;
+	}
 
-		QString var = vars.value(id);
-		const VarModifierDef &varModifierDef = varModifierDefs[id];
-
-		// Always convert the string to num and char,
-		// in case it's needed for e.g. useAs==month.
-		int num = strToInt(var);
-		num += varModifierDef.addValue;
-		char chr = 0;
-		if (var.size() == 1) {
-			chr = var.at(0).toLatin1();
-			chr += varModifierDef.addValue;
-		}
+	// Apply the modifier.
+	switch (varModifierDef.varType) {
+		default:
+		case VarModifierDef::VARTYPE_STRING:
+			// Parse as a string.
+			// Nothing special needs to be done here...
+			break;
+
+		case VarModifierDef::VARTYPE_NUMBER:
+			// Parse as a number. (Base 10)
+			var = QString::number(num, 10);
+			break;
+
+		case VarModifierDef::VARTYPE_CHAR:
+			// Parse as an ASCII character.
+			if (var.size() != 1)
+				return -2;
+			var = QChar::fromLatin1(chr);
+			break;
+	}
 
-		// Apply the modifier.
-		switch (varModifierDef.varType) {
-			default:
-			case VarModifierDef::VARTYPE_STRING:
-				// Parse as a string.
-				// Nothing special needs to be done here...
-				break;
-
-			case VarModifierDef::VARTYPE_NUMBER:
-				// Parse as a number. (Base 10)
-				var = QString::number(num, 10);
-				break;
-
-			case VarModifierDef::VARTYPE_CHAR:
-				// Parse as an ASCII character.
-				if (var.size() != 1)
-					return -2;
-				var = QChar::fromLatin1(chr);
-				break;
+	// Pad the variable with fillChar, if necessary.
+	if (var.size() < varModifierDef.minWidth) {
+		var.reserve(varModifierDef.minWidth);
+		QChar fillChar = QChar::fromLatin1(varModifierDef.fillChar);
+		if (varModifierDef.fieldAlign == VarModifierDef::FIELDALIGN_LEFT) {
+			while (var.size() < varModifierDef.minWidth)
+				var.append(fillChar);
+		} else /*if (variableDef.fieldAlign == VarModifierDef::FIELDALIGN_RIGHT)*/ {
+			while (var.size() < varModifierDef.minWidth)
+				var.prepend(fillChar);
 		}
+	}
 
-		// Pad the variable with fillChar, if necessary.
-		if (var.size() < varModifierDef.minWidth) {
-			var.reserve(varModifierDef.minWidth);
-			QChar fillChar = QChar::fromLatin1(varModifierDef.fillChar);
-			if (varModifierDef.fieldAlign == VarModifierDef::FIELDALIGN_LEFT) {
-				while (var.size() < varModifierDef.minWidth)
-					var.append(fillChar);
-			} else /*if (variableDef.fieldAlign == VarModifierDef::FIELDALIGN_RIGHT)*/ {
-				while (var.size() < varModifierDef.minWidth)
-					var.prepend(fillChar);
+	// Check if this variable should be used in the timestamp.
+	switch (varModifierDef.useAs) {
+		default:
+		case VarModifierDef::USEAS_FILENAME:
+			// Not a timestamp component.
+			break;
+
+		case VarModifierDef::USEAS_TS_YEAR:
+			if (num >= 0 && num <= 99) {
+				// 2-digit year.
+				ts.year = num + 2000;
+			} else if (num >= 2000 && num <= 9999) {
+				// 4-digit year.
+				ts.year = num;
+			} else {
+				// Invalid year.
+				return -3;
 			}
-		}
-
-		// Check if this variable should be used in the QDateTime.
-		switch (varModifierDef.useAs) {
-			default:
-			case VarModifierDef::USEAS_FILENAME:
-				// Not a QDateTime component.
-				break;
-
-			case VarModifierDef::USEAS_TS_YEAR:
-				if (num >= 0 && num <= 99) {
-					// 2-digit year.
-					year = num + 2000;
-				} else if (num >= 2000 && num <= 9999) {
-					// 4-digit year.
-					year = num;
-				} else {
-					// Invalid year.
-					return -3;
-				}
-				break;
+			break;
 
-			case VarModifierDef::USEAS_TS_MONTH: {
-				if (num >= 1 && num <= 12) {
-					month = num;
-				} else {
-					// Check for abbreviated month names.
-					static const char month_names[12][4] = {
-						"Jan", "Feb", "Mar", "Apr",
-						"May", "Jun", "Jul", "Aug",
-						"Sep", "Oct", "Nov", "Dec"
-					};
-					bool found = false;
-					for (int i = 0; i < 12; i++) {
-						if (var.compare(QLatin1String(month_names[i]), Qt::CaseInsensitive) == 0) {
-							// Found a match.
-							month = i + 1;
-							found = true;
-							break;
-						}
-					}
-					if (!found) {
-						// Not found.
-						return -4;
+		case VarModifierDef::USEAS_TS_MONTH: {
+			if (num >= 1 && num <= 12) {
+				ts.month = num;
+			} else {
+				// Check for abbreviated month names.
+				static const char month_names[12][4] = {
+					"Jan", "Feb", "Mar", "Apr",
+					"May", "Jun", "Jul", "Aug",
+					"Sep", "Oct", "Nov", "Dec"
+				};
+				bool found = false;
+				for (int i = 0; i < 12; i++) {
+					if (var.compare(QLatin1String(month_names[i]), Qt::CaseInsensitive) == 0) {
+						// Found a match.
+						ts.month = i + 1;
+						found = true;
+						break;
 					}
 				}
-				break;
+				if (!found) {
+					// Not found.
+					return -4;
+				}
 			}
-
-			case VarModifierDef::USEAS_TS_DAY:
-				if (num >= 1 && num <= 31)
-					day = num;
-				else
-					return -5;
-				break;
-
-			case VarModifierDef::USEAS_TS_HOUR:
-				if (num >= 0 && num <= 23)
-					hour = num;
-				else
-					return -6;
-				break;
-
-			case VarModifierDef::USEAS_TS_MINUTE:
-				if (num >= 0 && num <= 59)
-					minute = num;
-				else
-					return -7;
-				break;
-
-			case VarModifierDef::USEAS_TS_SECOND:
-				if (num >= 0 && num <= 59)
-					second = num;
-				else
-					return -8;
-				break;
-
-			case VarModifierDef::USEAS_TS_AMPM:
-				// TODO: Implement this once I encounter
-				// a save file that actually uses it.
-				break;
+			break;
 		}
 
-		// Update the variable in the hash.
-		vars.insert(id, var);
+		case VarModifierDef::USEAS_TS_DAY:
+			if (num >= 1 && num <= 31)
+				ts.day = num;
+			else
+				return -5;
+			break;
+
+		case VarModifierDef::USEAS_TS_HOUR:
+			if (num >= 0 && num <= 23)
+				ts.hour = num;
+			else
+				return -6;
+			break;
+
+		case VarModifierDef::USEAS_TS_MINUTE:
+			if (num >= 0 && num <= 59)
+				ts.minute = num;
+			else
+				return -7;
+			break;
+
+		case VarModifierDef::USEAS_TS_SECOND:
+			if (num >= 0 && num <= 59)
+				ts.second = num;
+			else
+				return -8;
+			break;
+
+		case VarModifierDef::USEAS_TS_AMPM:
+			// TODO: Implement this once I encounter
+			// a save file that actually uses it.
+			break;
 	}
 
-	if (qDateTime) {
-		// Set the QDateTime to the current time for now.
-		const QDateTime currentDateTime(QDateTime::currentDateTime());
-		*qDateTime = currentDateTime;
-		qDateTime->setTimeSpec(Qt::UTC);
-
-		// Adjust the date.
-		QDate date = qDateTime->date();
-		const bool isDateSet = (year != -1 || month != -1 || day != -1);
-		if (year == -1) {
-			year = date.year();
-		}
-		if (month == -1) {
-			month = date.month();
+	// Variable modified successfully.
+	return 0;
+}
+
+/**
+ * Build a timestamp from timestamp components.
+ * Components that weren't set are taken from the current local time.
+ * @param ts Timestamp components.
+ * @return Unix timestamp.
+ */
+int64_t VarReplace::MakeTimestamp(const TimestampParts &ts)
+{
+	int year = ts.year, month = ts.month, day = ts.day;
+	int hour = ts.hour, minute = ts.minute, second = ts.second;
+	const int ampm = ts.ampm;
+
+	// Use the current time for anything that isn't set.
+	// NOTE: This is done with integer arithmetic instead of
+	// QDateTime, since this is called for every search match.
+	const int64_t now = VarReplacePrivate::currentLocalTime();
+	TimeFuncs::CivilTime cur;
+	TimeFuncs::civilFromUnixTime(now, &cur);
+
+	// Adjust the date.
+	const bool isDateSet = (year != -1 || month != -1 || day != -1);
+	if (year == -1) {
+		year = cur.year;
+	}
+	if (month == -1) {
+		month = cur.month;
+	}
+	if (day == -1) {
+		day = cur.day;
+	}
+
+	// Adjust the time.
+	const bool isTimeSet = (hour != -1 || minute != -1);
+	if (isDateSet && !isTimeSet) {
+		// Date was set by the file, but time wasn't.
+		// Assume default of 12:00 AM.
+		hour = 0;
+		minute = 0;
+		second = 0;
+	} else {
+		if (hour == -1) {
+			hour = cur.hour;
 		}
-		if (day == -1) {
-			day = date.day();
+		if (minute == -1) {
+			minute = cur.minute;
 		}
-		date.setDate(year, month, day);
-		qDateTime->setDate(date);
-
-		// Adjust the time.
-		QTime time = qDateTime->time();
-		const bool isTimeSet = (hour != -1 || minute != -1);
-		if (isDateSet && !isTimeSet) {
-			// Date was set by the file, but time wasn't.
-			// Assume default of 12:00 AM.
-			time.setHMS(0, 0, 0);
-		} else {
-			if (hour == -1) {
-				hour = time.hour();
-			}
-			if (minute == -1) {
-				minute = time.minute();
-			}
-			if (second == -1) {
-				second = 0;	// Don't bother using the current second.
-			}
-			if (ampm != -1) {
-				hour %= 12;
-				hour += ampm;
-			}
-			time.setHMS(hour, minute, second);
+		if (second == -1) {
+			second = 0;	// Don't bother using the current second.
 		}
-		qDateTime->setTime(time);
-
-		// If the QDateTime is more than one day
-		// in the future, adjust its years value.
-		// (One-day variance is allowed due to timezone differences.)
-		const QDateTime tomorrow = QDateTime::fromMSecsSinceEpoch(
-			currentDateTime.toMSecsSinceEpoch() + (86400*1000), Qt::UTC);
-
-		if (*qDateTime > tomorrow) {
-			QDate adjDate = qDateTime->date();
-			int curYear = currentDateTime.date().year();
-			// NOTE: Minimum year of 2000 for GCN,
-			// but Dreamcast was released in 1998.
-			if (curYear > 1995) {
-				// Update the QDateTime.
-				qDateTime->setDate(adjDate.addYears(-1));
-			}
+		if (ampm != -1) {
+			hour %= 12;
+			hour += ampm;
 		}
 	}
 
-	// Variables modified successfully.
-	return 0;
+	// If the timestamp is more than one day
+	// in the future, adjust its years value.
+	// (One-day variance is allowed due to timezone differences.)
+	// NOTE: Minimum year of 2000 for GCN,
+	// but Dreamcast was released in 1998.
+	const int64_t tomorrow = now + 86400;
+	int64_t unixTime = TimeFuncs::unixTimeFromCivil(year, month, day, hour, minute, second);
+	if (unixTime > tomorrow && cur.year > 1995) {
+		// Go back one year.
+		// Feb 29 is clamped to Feb 28, same as QDate::addYears().
+		if (month == 2 && day == 29) {
+			day = 28;
+		}
+		unixTime = TimeFuncs::unixTimeFromCivil(year - 1, month, day, hour, minute, second);
+	}
+	return unixTime;
 }
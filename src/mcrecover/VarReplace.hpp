@@ -12,12 +12,14 @@
 // MemCard Recover includes.
 #include "VarModifierDef.hpp"
 
+// C includes.
+#include <stdint.h>
+
 // Qt includes.
 #include <QtCore/qglobal.h>
-#include <QtCore/QDateTime>
 #include <QtCore/QHash>
 #include <QtCore/QString>
-#include <QtCore/QRegularExpression>
+#include <QtCore/QVector>
 
 class VarReplace
 {
@@ -29,6 +31,27 @@ class VarReplace
 		Q_DISABLE_COPY(VarReplace);
 
 	public:
+		/**
+		 * Template token.
+		 * If name is empty, this is literal text.
+		 * Otherwise, this is a variable, and text contains
+		 * the original variable text, e.g. "${G1}", which
+		 * is used if the variable isn't defined.
+		 */
+		struct Token {
+			QString name;	// Variable name.
+			QString text;	// Literal text, or original variable text.
+		};
+
+		/**
+		 * Split a string into literal text and variables.
+		 * Variable format: $VAR, ${VAR}, $(VAR)
+		 * Invalid variable names are returned as literal text.
+		 * @param str String.
+		 * @return Tokens.
+		 */
+		static QVector<Token> Tokenize(const QString &str);
+
 		/**
 		 * Replace variables in a given string.
 		 * @param str String to replace variables in.
@@ -42,21 +65,6 @@ class VarReplace
 		 */
 		static QString Exec(const QString &str, const QHash<QString, QString> &vars);
 
-		/**
-		 * Combine QStringLists of GameDesc variables and FileDesc variables into a QHash.
-		 * @param gameDescVars GameDesc variables.
-		 * @param fileDescVars FileDesc variables.
-		 *
-		 * NOTE: The first variable in each match ($G0, $F0) is
-		 * the full match from PCRE. This usually won't be used,
-		 * but is included in the variable hash anyway.
-		 *
-		 * @return QHash containing the variables. (key == ID)
-		 */
-		static QHash<QString, QString> StringListsToHash(
-			const QStringList &gameDescVars,
-			const QStringList &fileDescVars);
-
 		/**
 		 * Parse a string as an integer.
 		 * This function handles fullwidth numbers.
@@ -66,15 +74,38 @@ class VarReplace
 		static int strToInt(const QString &str);
 
 		/**
-		* Apply variable modifiers to a QHash containing variables.
-		* @param varModifierDefs	[in] Variable modifier definitions.
-		* @param vars			[in, out] Variables to modify.
-		* @param qDateTime		[out, opt] If specified, QDateTime for the timestamp.
-		* @return 0 on success; non-zero if any modifiers failed.
-		*/
-		static int ApplyModifiers(const QHash<QString, VarModifierDef> &varModifierDefs,
-					  QHash<QString, QString> &vars,
-					  QDateTime *qDateTime);
+		 * Timestamp components set by variable modifiers.
+		 * Components that weren't set are -1.
+		 */
+		struct TimestampParts {
+			int year, month, day;
+			int hour, minute, second;
+			int ampm;
+
+			TimestampParts()
+				: year(-1), month(-1), day(-1)
+				, hour(-1), minute(-1), second(-1)
+				, ampm(-1)
+			{ }
+		};
+
+		/**
+		 * Apply a variable modifier to a variable.
+		 * @param varModifierDef	[in] Variable modifier definition.
+		 * @param var			[in, out] Variable to modify.
+		 * @param ts			[in, out] Timestamp components.
+		 * @return 0 on success; non-zero if the modifier failed.
+		 */
+		static int ApplyModifier(const VarModifierDef &varModifierDef,
+					 QString &var, TimestampParts &ts);
+
+		/**
+		 * Build a timestamp from timestamp components.
+		 * Components that weren't set are taken from the current local time.
+		 * @param ts Timestamp components.
+		 * @return Unix timestamp.
+		 */
+		static int64_t MakeTimestamp(const TimestampParts &ts);
 };
 
 #endif /* __MCRECOVER_VARREPLACE_HPP__ */
@@ -0,0 +1,216 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * VarTemplate.cpp: Compiled variable replacement template.                *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "VarTemplate.hpp"
+#include "VarReplace.hpp"
+
+// C includes. (C++ namespace)
+#include <cstring>
+
+// Qt includes.
+#include <QtCore/QRegularExpressionMatch>
+#include <QtCore/QTextCodec>
+
+VarTemplate::VarTemplate()
+{ }
+
+/**
+ * Get a variable index for a variable name.
+ * The variable is added if it isn't present.
+ * @param name Variable name.
+ * @return Variable index, or -1 if this isn't a capture group variable.
+ */
+int VarTemplate::varIndex(const QString &name)
+{
+	// Variable names are "G" or "F", followed by the
+	// capture group index with no leading zeroes.
+	if (name.size() < 2)
+		return -1;
+	const QChar source = name.at(0);
+	if (source != QChar(L'G') && source != QChar(L'F'))
+		return -1;
+	if (name.size() > 2 && name.at(1) == QChar(L'0'))
+		return -1;
+
+	int group = 0;
+	for (int i = 1; i < name.size(); i++) {
+		const ushort chr = name.at(i).unicode();
+		if (chr < '0' || chr > '9' || group > 9999)
+			return -1;
+		group = (group * 10) + (chr - '0');
+	}
+
+	for (int i = 0; i < m_vars.size(); i++) {
+		const Var &var = m_vars.at(i);
+		if (var.source == source.toLatin1() && var.group == group)
+			return i;
+	}
+
+	Var var;
+	var.source = source.toLatin1();
+	var.group = group;
+	var.modifier = -1;
+	m_vars.append(var);
+	return m_vars.size() - 1;
+}
+
+/**
+ * Compile a template.
+ * @param str Template string. (see VarReplace::Tokenize())
+ * @param varModifierDefs Variable modifier definitions.
+ */
+void VarTemplate::compile(const QString &str, const QHash<QString, VarModifierDef> &varModifierDefs)
+{
+	m_vars.clear();
+	m_modifiers.clear();
+	m_tokens.clear();
+
+	foreach (const VarReplace::Token &vrToken, VarReplace::Tokenize(str)) {
+		Token token;
+		token.var = (!vrToken.name.isEmpty() ? varIndex(vrToken.name) : -1);
+		token.text = vrToken.text;
+
+		if (token.var < 0 && !m_tokens.isEmpty() && m_tokens.last().var < 0) {
+			// Merge with the previous literal.
+			// This includes variables that can never be set.
+			m_tokens.last().text += token.text;
+		} else {
+			m_tokens.append(token);
+		}
+	}
+
+	// Pre-encode ASCII literals.
+	// ASCII is the same in all supported text codecs.
+	for (int i = 0; i < m_tokens.size(); i++) {
+		Token &token = m_tokens[i];
+		if (token.var >= 0)
+			continue;
+
+		bool isAscii = true;
+		foreach (const QChar &chr, token.text) {
+			if (chr.unicode() >= 0x80) {
+				isAscii = false;
+				break;
+			}
+		}
+		if (isAscii) {
+			token.ascii = token.text.toLatin1();
+		}
+	}
+
+	// Variable modifiers.
+	// These are applied even if the variable isn't used in
+	// the template, since they may set timestamp components.
+	for (auto iter = varModifierDefs.cbegin(); iter != varModifierDefs.cend(); ++iter) {
+		const int idx = varIndex(iter.key());
+		if (idx < 0)
+			continue;
+
+		m_vars[idx].modifier = m_modifiers.size();
+		m_modifiers.append(iter.value());
+	}
+}
+
+/**
+ * Get the variable values for a match and apply the variable modifiers.
+ * @param gameDescMatch	[in] Game description match.
+ * @param fileDescMatch	[in] File description match.
+ * @param values	[out] Variable values.
+ * @param unixTime	[out, opt] If specified, Unix timestamp for the file.
+ * @return 0 on success; non-zero if any modifiers failed.
+ */
+int VarTemplate::apply(const QRegularExpressionMatch &gameDescMatch,
+		       const QRegularExpressionMatch &fileDescMatch,
+		       Values &values, int64_t *unixTime) const
+{
+	VarReplace::TimestampParts ts;
+	values.resize(m_vars.size());
+
+	for (int i = 0; i < m_vars.size(); i++) {
+		const Var &var = m_vars.at(i);
+		const QRegularExpressionMatch &match =
+			(var.source == 'G' ? gameDescMatch : fileDescMatch);
+		Value &value = values[i];
+
+		if (var.group > match.lastCapturedIndex()) {
+			// Capture group wasn't matched.
+			value.str.clear();
+			value.isSet = false;
+			continue;
+		}
+
+		value.str = match.captured(var.group);
+		value.isSet = true;
+		if (var.modifier >= 0) {
+			int ret = VarReplace::ApplyModifier(m_modifiers.at(var.modifier), value.str, ts);
+			if (ret != 0)
+				return ret;
+		}
+	}
+
+	if (unixTime) {
+		*unixTime = VarReplace::MakeTimestamp(ts);
+	}
+
+	// Variable modifiers applied successfully.
+	return 0;
+}
+
+/**
+ * Expand the template into a fixed-size buffer.
+ * The output is truncated at the first NULL byte,
+ * and the rest of the buffer is zeroed, like strncpy().
+ * @param values	[in] Variable values from apply().
+ * @param textCodec	[in] Text codec. (If nullptr, use Latin-1.)
+ * @param buf		[out] Output buffer.
+ * @param size		[in] Size of buf.
+ */
+void VarTemplate::expand(const Values &values, QTextCodec *textCodec, char *buf, int size) const
+{
+	int pos = 0;
+	QByteArray ba;	// temporary buffer
+
+	foreach (const Token &token, m_tokens) {
+		if (pos >= size)
+			break;
+
+		const char *src;
+		int len;
+		if (token.var < 0 && !token.ascii.isNull()) {
+			// Pre-encoded literal.
+			src = token.ascii.constData();
+			len = token.ascii.size();
+		} else {
+			const QString &str = (token.var >= 0 && values[token.var].isSet
+				? values[token.var].str
+				: token.text);
+			ba = (textCodec ? textCodec->fromUnicode(str) : str.toLatin1());
+			src = ba.constData();
+			len = ba.size();
+		}
+
+		if (len > size - pos) {
+			len = size - pos;
+		}
+		const char *const p_nullChr = (const char*)memchr(src, 0x00, len);
+		if (p_nullChr) {
+			// Found a NULL character. Stop here.
+			len = (int)(p_nullChr - src);
+			memcpy(&buf[pos], src, len);
+			pos += len;
+			break;
+		}
+		memcpy(&buf[pos], src, len);
+		pos += len;
+	}
+
+	// Zero out the rest of the buffer.
+	if (pos < size) {
+		memset(&buf[pos], 0, size - pos);
+	}
+}
@@ -0,0 +1,119 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * VarTemplate.hpp: Compiled variable replacement template.                *
+ *                                                                         *
+ * Copyright (c) 2013-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_VARTEMPLATE_HPP__
+#define __MCRECOVER_VARTEMPLATE_HPP__
+
+// MemCard Recover includes.
+#include "VarModifierDef.hpp"
+
+// C includes.
+#include <stdint.h>
+
+// Qt includes.
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QVector>
+
+class QRegularExpressionMatch;
+class QTextCodec;
+
+/**
+ * Compiled variable replacement template.
+ *
+ * The template string and variable modifiers are parsed once
+ * when the database is loaded. Variables are resolved to
+ * regular expression capture groups:
+ * - $G0, $G1, ...: Game description captures.
+ * - $F0, $F1, ...: File description captures.
+ *
+ * Output is identical to VarReplace::Exec() with a variable hash
+ * containing all capture groups and VarReplace::ApplyModifier()
+ * applied to each of them, but no hashes are built per match.
+ */
+class VarTemplate
+{
+	public:
+		VarTemplate();
+
+	public:
+		/**
+		 * Compile a template.
+		 * @param str Template string. (see VarReplace::Tokenize())
+		 * @param varModifierDefs Variable modifier definitions.
+		 */
+		void compile(const QString &str, const QHash<QString, VarModifierDef> &varModifierDefs);
+
+		/**
+		 * Variable value for a single match.
+		 */
+		struct Value {
+			QString str;	// Value, after modifiers.
+			bool isSet;	// False if the capture group wasn't matched.
+
+			Value() : isSet(false) { }
+		};
+		typedef QVarLengthArray<Value, 8> Values;
+
+		/**
+		 * Get the variable values for a match and apply the variable modifiers.
+		 * @param gameDescMatch	[in] Game description match.
+		 * @param fileDescMatch	[in] File description match.
+		 * @param values	[out] Variable values.
+		 * @param unixTime	[out, opt] If specified, Unix timestamp for the file.
+		 * @return 0 on success; non-zero if any modifiers failed.
+		 */
+		int apply(const QRegularExpressionMatch &gameDescMatch,
+			  const QRegularExpressionMatch &fileDescMatch,
+			  Values &values, int64_t *unixTime) const;
+
+		/**
+		 * Expand the template into a fixed-size buffer.
+		 * The output is truncated at the first NULL byte,
+		 * and the rest of the buffer is zeroed, like strncpy().
+		 * @param values	[in] Variable values from apply().
+		 * @param textCodec	[in] Text codec. (If nullptr, use Latin-1.)
+		 * @param buf		[out] Output buffer.
+		 * @param size		[in] Size of buf.
+		 */
+		void expand(const Values &values, QTextCodec *textCodec, char *buf, int size) const;
+
+	private:
+		/**
+		 * Variable, resolved to a capture group.
+		 */
+		struct Var {
+			char source;	// 'G' for game description; 'F' for file description.
+			int group;	// Capture group index.
+			int modifier;	// Index into m_modifiers, or -1 if none.
+		};
+		QVector<Var> m_vars;
+		QVector<VarModifierDef> m_modifiers;
+
+		/**
+		 * Template token.
+		 */
+		struct Token {
+			int var;		// Index into m_vars, or -1 for literal text.
+			QString text;		// Literal text, or original variable text if unset.
+			QByteArray ascii;	// Literal text, if it's ASCII-only. (codec-independent)
+		};
+		QVector<Token> m_tokens;
+
+		/**
+		 * Get a variable index for a variable name.
+		 * The variable is added if it isn't present.
+		 * @param name Variable name.
+		 * @return Variable index, or -1 if this isn't a capture group variable.
+		 */
+		int varIndex(const QString &name);
+};
+
+#endif /* __MCRECOVER_VARTEMPLATE_HPP__ */
@@ -31,6 +31,7 @@ const ConfigDefaults::DefaultSetting ConfigDefaults::DefaultSettings[] =
 	{"preferredRegion",	"E", 0, 0,	DefaultSetting::VT_NONE, 0, 0},
 	{"searchUsedBlocks",	"false", 0, 0,	DefaultSetting::VT_BOOL, 0, 0},
 	{"animIconFormat",	"APNG", 0, 0,	DefaultSetting::VT_NONE, 0, 0},
+	{"imageCompression",	"default", 0, 0,	DefaultSetting::VT_NONE, 0, 0},
 	{"language",		"", 0, 0,	DefaultSetting::VT_NONE, 0, 0},
 	{"fileType",		"0", 0, 0,	DefaultSetting::VT_NONE, 0, 0},
 
@@ -124,16 +124,37 @@ void GcnCheckFiles::addChecksumDefs(GcnFile *file) const
  * Add checksum definitions to all files on a GcnCard
  * if they don't already have any.
  *
+ * Checksums are verified in the background.
+ * Card::checksumsChanged() is emitted as they're verified.
+ *
  * TODO: Return value?
  */
 void GcnCheckFiles::addChecksumDefs(GcnCard *card) const
 {
+	Q_D(const GcnCheckFiles);
 	const int fileCount = card->fileCount();
+	QVector<File*> files;
+	QVector<QVector<Checksum::ChecksumDef> > checksumDefs;
+	files.reserve(fileCount);
+	checksumDefs.reserve(fileCount);
+
 	for (int i = 0; i < fileCount; i++) {
 		// NOTE: nullptr check *shouldn't* be needed...
 		GcnFile *file = qobject_cast<GcnFile*>(card->getFile(i));
-		if (file != nullptr) {
-			addChecksumDefs(file);
+		if (file == nullptr || file->checksumStatus() != Checksum::CHKST_UNKNOWN) {
+			// No file, or the checksum has already been obtained.
+			continue;
+		}
+
+		QVector<Checksum::ChecksumDef> fileChecksumDefs;
+		foreach (GcnMcFileDb *db, d->dbs) {
+			if (db->findChecksumDefs(file, &fileChecksumDefs)) {
+				files.append(file);
+				checksumDefs.append(fileChecksumDefs);
+				break;
+			}
 		}
 	}
+
+	card->setChecksumDefs(files, checksumDefs);
 }
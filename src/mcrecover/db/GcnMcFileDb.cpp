@@ -16,9 +16,11 @@
 #include "config/ConfigStore.hpp"
 
 #include "GcnMcFileDef.hpp"
-#include "VarReplace.hpp"
 #include "libmemcard/TimeFuncs.hpp"
 
+// libgctools
+#include "TextFuncs.hpp"
+
 // GcnFile
 #include "libmemcard/GcnFile.hpp"
 
@@ -35,8 +37,10 @@
 #include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QHash>
 #include <QtCore/QMap>
 #include <QtCore/QTextCodec>
+#include <QtCore/QVarLengthArray>
 #include <QtCore/QVector>
 #include <QtCore/QXmlStreamReader>
 
@@ -62,6 +66,36 @@ class GcnMcFileDbPrivate
 		 */
 		QMap<uint32_t, QVector<GcnMcFileDef*>*> addr_file_defs;
 
+		/**
+		 * GCN memory card file definitions, indexed by ID6.
+		 * - Key: ID6, from Id6ToKey().
+		 * - Value: QVector<> of GcnMcFileDef*.
+		 *
+		 * Definitions are owned by addr_file_defs.
+		 * Each QVector<> is in the same order as addr_file_defs,
+		 * so lookups return the same definition as a linear search.
+		 */
+		QHash<uint64_t, QVector<GcnMcFileDef*> > id6_file_defs;
+
+		/**
+		 * Convert an ID6 to an id6_file_defs key.
+		 * @param id6 ID6. (6 bytes; not NULL-terminated)
+		 * @return id6_file_defs key.
+		 */
+		static inline uint64_t Id6ToKey(const char *id6)
+		{
+			uint64_t key = 0;
+			for (int i = 0; i < 6; i++) {
+				key = (key << 8) | (uint8_t)id6[i];
+			}
+			return key;
+		}
+
+		/**
+		 * Build the ID6 index from addr_file_defs.
+		 */
+		void buildId6Index(void);
+
 		/**
 		 * Convert a region character to a GcnMcFileDef::regions_t bitfield value.
 		 * @param regionChr Region character.
@@ -98,6 +132,8 @@ class GcnMcFileDbPrivate
 		QString errorString;
 
 		// Text codecs.
+		// NOTE: Only used for encoding filenames.
+		// Comments are decoded using TextFuncs.
 		QTextCodec *const textCodecJP;
 		QTextCodec *const textCodecUS;
 
@@ -105,31 +141,31 @@ class GcnMcFileDbPrivate
 		 * Get a comment from the GCN comment block, converted to UTF-16.
 		 * @param buf Comment block.
 		 * @param siz Size of comment block. (usually 32)
-		 * @param textCodec QTextCodec. (If nullptr, use latin1.)
+		 * @param shiftJis If true, decode as Shift-JIS; otherwise, decode as cp1252.
 		 * @return GCN comment block, converted to UTF-16.
 		 */
-		static QString GetGcnCommentUtf16(const char *buf, int siz, QTextCodec *textCodec);
+		static QString GetGcnCommentUtf16(const char *buf, int siz, bool shiftJis);
 
 		/**
 		 * Get a comment from the GCN comment block, converted to UTF-8.
 		 * @param buf Comment block.
 		 * @param siz Size of comment block. (usually 32)
-		 * @param textCodec QTextCodec. (If nullptr, use latin1.)
+		 * @param shiftJis If true, decode as Shift-JIS; otherwise, decode as cp1252.
 		 * @return GCN comment block, converted to UTF-8.
 		 */
-		static QByteArray GetGcnCommentUtf8(const char *buf, int siz, QTextCodec *textCodec);
+		static QByteArray GetGcnCommentUtf8(const char *buf, int siz, bool shiftJis);
 
 		/**
 		 * Construct a GcnSearchData entry.
 		 * @param matchFileDef	[in] File definition.
-		 * @param vars		[in] Variables.
-		 * @param qDateTime	[in] Timestamp.
+		 * @param values	[in] Variable values.
+		 * @param unixTime	[in] Timestamp. (Unix timestamp)
 		 * @return GcnSearchData entry.
 		 */
 		GcnSearchData constructSearchData(
 			const GcnMcFileDef *matchFileDef,
-			const QHash<QString, QString> &vars,
-			const QDateTime &qDateTime) const;
+			const VarTemplate::Values &values,
+			int64_t unixTime) const;
 };
 
 GcnMcFileDbPrivate::GcnMcFileDbPrivate(GcnMcFileDb *q)
@@ -172,6 +208,9 @@ uint8_t GcnMcFileDbPrivate::RegionCharToBitfield(QChar regionChr)
  */
 void GcnMcFileDbPrivate::clear(void)
 {
+	// Clear the ID6 index first, since it doesn't own anything.
+	id6_file_defs.clear();
+
 	// Delete all GcnMcFileDefs.
 	for (QMap<uint32_t, QVector<GcnMcFileDef*>*>::iterator iter = addr_file_defs.begin();
 	     iter != addr_file_defs.end(); ++iter)
@@ -184,6 +223,19 @@ void GcnMcFileDbPrivate::clear(void)
 	addr_file_defs.clear();
 }
 
+/**
+ * Build the ID6 index from addr_file_defs.
+ */
+void GcnMcFileDbPrivate::buildId6Index(void)
+{
+	id6_file_defs.clear();
+	foreach (QVector<GcnMcFileDef*>* vec, addr_file_defs) {
+		foreach (GcnMcFileDef *gcnMcFileDef, *vec) {
+			id6_file_defs[Id6ToKey(gcnMcFileDef->id6)].append(gcnMcFileDef);
+		}
+	}
+}
+
 
 /**
  * Load a GCN Memory Card File Database.
@@ -233,6 +285,9 @@ int GcnMcFileDbPrivate::load(const QString &filename)
 		return -2;
 	}
 
+	// Index the definitions by ID6 for addChecksumDefs().
+	buildId6Index();
+
 	// Database parsed successfully.
 	errorString = QString();
 	return 0;
@@ -387,6 +442,12 @@ GcnMcFileDef *GcnMcFileDbPrivate::parseXml_file(QXmlStreamReader &xml)
 		gcnMcFileDef->regions |= RegionCharToBitfield(*iter);
 	}
 
+	// Compile the filename template.
+	// NOTE: This must be done after all elements are parsed,
+	// since <variables> may be after <dirEntry>.
+	gcnMcFileDef->filenameTemplate.compile(
+		gcnMcFileDef->dirEntry.filename, gcnMcFileDef->varModifiers);
+
 	// Return the GcnMcFileDef.
 	return gcnMcFileDef;
 }
@@ -782,12 +843,12 @@ void GcnMcFileDbPrivate::parseXml_file_variable(QXmlStreamReader& xml, GcnMcFile
  * Get a comment from the GCN comment block, converted to UTF-16.
  * @param buf Comment block.
  * @param siz Size of comment block. (usually 32)
- * @param textCodec QTextCodec. (If nullptr, use latin1.)
+ * @param shiftJis If true, decode as Shift-JIS; otherwise, decode as cp1252.
  * @return GCN comment block, converted to UTF-16.
  */
-QString GcnMcFileDbPrivate::GetGcnCommentUtf16(const char *buf, int siz, QTextCodec *textCodec)
+QString GcnMcFileDbPrivate::GetGcnCommentUtf16(const char *buf, int siz, bool shiftJis)
 {
-	// Remove trailing NULL characters before converting to UTF-8.
+	// Remove trailing NULL characters before converting to UTF-16.
 	const char *p_nullChr = (const char*)memchr(buf, 0x00, siz);
 	if (p_nullChr) {
 		// Found a NULL character.
@@ -797,45 +858,40 @@ QString GcnMcFileDbPrivate::GetGcnCommentUtf16(const char *buf, int siz, QTextCo
 	}
 
 	// Convert the comment to Unicode.
-	// Trim the comment while we're at it.
-	QString comment;
-	if (!textCodec) {
-		// No text codec was specified.
-		// Default to Latin-1.
-		comment = QString::fromLatin1(buf, siz).trimmed();
-	} else {
-		// Use the text codec.
-		comment = textCodec->toUnicode(buf, siz).trimmed();
-	}
+	// Invalid Shift-JIS characters are replaced with U+FFFD.
+	QVarLengthArray<uint16_t, 64> utf16(siz);
+	const int len = (shiftJis
+		? TextFuncs::sjis_to_utf16(utf16.data(), buf, siz)
+		: TextFuncs::cp1252_to_utf16(utf16.data(), buf, siz));
 
-	// Comment converted to UTF-16.
-	return comment;
+	// Trim the comment while we're at it.
+	return QString(reinterpret_cast<const QChar*>(utf16.constData()), len).trimmed();
 }
 
 /**
  * Get a comment from the GCN comment block, converted to UTF-8.
  * @param buf Comment block.
  * @param siz Size of comment block. (usually 32)
- * @param textCodec QTextCodec. (If nullptr, use latin1.)
+ * @param shiftJis If true, decode as Shift-JIS; otherwise, decode as cp1252.
  * @return GCN comment block, converted to UTF-8.
  */
-QByteArray GcnMcFileDbPrivate::GetGcnCommentUtf8(const char *buf, int siz, QTextCodec *textCodec)
+QByteArray GcnMcFileDbPrivate::GetGcnCommentUtf8(const char *buf, int siz, bool shiftJis)
 {
 	// This is now a wrapper around GetGcnCommentUtf16().
-	return GetGcnCommentUtf16(buf, siz, textCodec).toUtf8();
+	return GetGcnCommentUtf16(buf, siz, shiftJis).toUtf8();
 }
 
 /**
  * Construct a GcnSearchData entry.
  * @param matchFileDef	[in] File definition.
- * @param vars		[in] Variables.
- * @param qDateTime	[in] Timestamp.
+ * @param values	[in] Variable values.
+ * @param unixTime	[in] Timestamp. (Unix timestamp)
  * @return GcnSearchData entry.
  */
 GcnSearchData GcnMcFileDbPrivate::constructSearchData(
 	const GcnMcFileDef *matchFileDef,
-	const QHash<QString, QString> &vars,
-	const QDateTime &qDateTime) const
+	const VarTemplate::Values &values,
+	int64_t unixTime) const
 {
 	// TODO: Implicitly share GcnSearchData?
 	GcnSearchData searchData;
@@ -846,31 +902,14 @@ GcnSearchData GcnMcFileDbPrivate::constructSearchData(
 	memcpy(dirEntry->gamecode, matchFileDef->gamecode, sizeof(dirEntry->gamecode));
 	memcpy(dirEntry->company,  matchFileDef->company,  sizeof(dirEntry->company));
 
-	// Convert the filename to the correct encoding.
-	QByteArray ba;
-
-	// Substitute variables in the filename.
-	QString filename = VarReplace::Exec(matchFileDef->dirEntry.filename, vars);
-
 	// Filename.
+	// JP files use Shift-JIS; US/EU files use cp1252.
+	// If the text codec isn't available, Latin-1 is used.
 	// FIXME: Also for 'S' (used by SADX preview)?
-	if (dirEntry->gamecode[3] == 'J' && textCodecJP) {
-		// JP file. Convert to Shift-JIS.
-		ba = textCodecJP->fromUnicode(filename);
-	} else if (textCodecUS) {
-		// US/EU file. Convert to cp1252.
-		ba = textCodecUS->fromUnicode(filename);
-	}
-
-	if (ba.isEmpty()) {
-		// QByteArray is empty. Conversion failed.
-		// Convert to Latin1 instead.
-		ba = filename.toLatin1();
-	}
-
-	if (ba.length() > (int)sizeof(dirEntry->filename))
-		ba.resize(sizeof(dirEntry->filename));
-	strncpy(dirEntry->filename, ba.constData(), sizeof(dirEntry->filename));
+	QTextCodec *const textCodec = (dirEntry->gamecode[3] == 'J' && textCodecJP
+		? textCodecJP : textCodecUS);
+	matchFileDef->filenameTemplate.expand(values, textCodec,
+		dirEntry->filename, sizeof(dirEntry->filename));
 	// TODO: Make sure the filename is null-terminated?
 
 	// Values.
@@ -882,7 +921,7 @@ GcnSearchData GcnMcFileDbPrivate::constructSearchData(
 	 */
 	dirEntry->pad_00	= 0xFF;
 	dirEntry->bannerfmt	= matchFileDef->dirEntry.bannerFormat;
-	dirEntry->lastmodified	= TimeFuncs::toGcnTimestamp(qDateTime);
+	dirEntry->lastmodified	= TimeFuncs::unixTimeToGcn(unixTime);
 	dirEntry->iconaddr	= matchFileDef->dirEntry.iconAddress;
 	dirEntry->iconfmt	= matchFileDef->dirEntry.iconFormat;
 	dirEntry->iconspeed	= matchFileDef->dirEntry.iconSpeed;
@@ -959,10 +998,16 @@ QVector<GcnSearchData> GcnMcFileDb::checkBlock(const void *buf, int siz) const
 
 		// Get the game description and file description.
 		const char *const commentData = ((const char*)buf + address);
-		const QString gameDescUS = d->GetGcnCommentUtf16(commentData, 32, d->textCodecUS);
-		const QString gameDescJP = d->GetGcnCommentUtf16(commentData, 32, d->textCodecJP);
-		const QString fileDescUS = d->GetGcnCommentUtf16(commentData+32, 32, d->textCodecUS);
-		const QString fileDescJP = d->GetGcnCommentUtf16(commentData+32, 32, d->textCodecJP);
+		// NOTE: ASCII text is identical in both encodings,
+		// so it only needs to be decoded and matched once.
+		const bool gameDescIsAscii = TextFuncs::is_ascii(commentData, 32);
+		const bool fileDescIsAscii = TextFuncs::is_ascii(commentData+32, 32);
+		const QString gameDescUS = d->GetGcnCommentUtf16(commentData, 32, false);
+		const QString gameDescJP = (gameDescIsAscii ? gameDescUS
+			: d->GetGcnCommentUtf16(commentData, 32, true));
+		const QString fileDescUS = d->GetGcnCommentUtf16(commentData+32, 32, false);
+		const QString fileDescJP = (fileDescIsAscii ? fileDescUS
+			: d->GetGcnCommentUtf16(commentData+32, 32, true));
 
 		QVector<GcnMcFileDef*> *vec = d->addr_file_defs.value(address);
 		foreach (const GcnMcFileDef *gcnMcFileDef, *vec) {
@@ -971,6 +1016,10 @@ QVector<GcnSearchData> GcnMcFileDb::checkBlock(const void *buf, int siz) const
 				gcnMcFileDef->search.gameDesc_regex.match(gameDescUS);
 			if (!gameDescMatch.hasMatch()) {
 				// No match for US.
+				if (gameDescIsAscii) {
+					// JP is the same as US.
+					continue;
+				}
 				// Check if the Game Description (JP) matches.
 				gameDescMatch = gcnMcFileDef->search.gameDesc_regex.match(gameDescJP);
 				if (!gameDescMatch.hasMatch()) {
@@ -984,6 +1033,10 @@ QVector<GcnSearchData> GcnMcFileDb::checkBlock(const void *buf, int siz) const
 				gcnMcFileDef->search.fileDesc_regex.match(fileDescUS);
 			if (!fileDescMatch.hasMatch()) {
 				// No match for US.
+				if (fileDescIsAscii) {
+					// JP is the same as US.
+					continue;
+				}
 				// Check if the Game Description (JP) matches.
 				fileDescMatch = gcnMcFileDef->search.fileDesc_regex.match(fileDescJP);
 				if (!fileDescMatch.hasMatch()) {
@@ -994,14 +1047,14 @@ QVector<GcnSearchData> GcnMcFileDb::checkBlock(const void *buf, int siz) const
 
 			// Found a match.
 			// Attempt to apply variable modifiers.
-			QDateTime qDateTime;
-			QHash<QString, QString> vars = VarReplace::StringListsToHash(
-				gameDescMatch.capturedTexts(), fileDescMatch.capturedTexts());
-			int ret = VarReplace::ApplyModifiers(gcnMcFileDef->varModifiers, vars, &qDateTime);
+			int64_t unixTime = 0;
+			VarTemplate::Values values;
+			int ret = gcnMcFileDef->filenameTemplate.apply(
+				gameDescMatch, fileDescMatch, values, &unixTime);
 			if (ret == 0) {
 				// Variable modifiers applied successfully.
 				// Construct a GcnSearchData struct for this file entry.
-				fileMatches.append(d->constructSearchData(gcnMcFileDef, vars, qDateTime));
+				fileMatches.append(d->constructSearchData(gcnMcFileDef, values, unixTime));
 			}
 		}
 	}
@@ -1111,52 +1164,68 @@ bool GcnMcFileDb::addChecksumDefs(GcnFile *file) const
 		return true;
 	}
 
+	QVector<Checksum::ChecksumDef> checksumDefs;
+	if (!findChecksumDefs(file, &checksumDefs)) {
+		// File information not found.
+		return false;
+	}
+
+	// Copy the checksum definitions.
+	file->setChecksumDefs(checksumDefs);
+	return true;
+}
+
+/**
+ * Find checksum definitions for a file.
+ * The file's checksum isn't verified.
+ * @param file		[in] GcnFile
+ * @param checksumDefs	[out] Checksum definitions.
+ * @return True if definitions were found; false if not.
+ */
+bool GcnMcFileDb::findChecksumDefs(const GcnFile *file, QVector<Checksum::ChecksumDef> *checksumDefs) const
+{
 	// TODO: Filename regex?
 
+	// Look up the file's ID6.
+	// NOTE: gamecode and company are right next to each other.
+	Q_D(const GcnMcFileDb);
+	const card_direntry *const dirEntry = file->dirEntry();
+	auto iter = d->id6_file_defs.constFind(GcnMcFileDbPrivate::Id6ToKey(dirEntry->gamecode));
+	if (iter == d->id6_file_defs.constEnd()) {
+		// No definitions for this ID6.
+		return false;
+	}
+
 	// GCN file comments: "GameDesc\0FileDesc"
-	// If no '\0' is present, this is an error.
-	QStringList desc = file->description().split(QChar(L'\0'));
-	if (desc.size() != 2) {
-		// No '\0' is present.
+	// If the description is empty, the comments couldn't be loaded.
+	if (file->description().isEmpty()) {
 		// Can't process this file.
 		return false;
 	}
 
-	const QString &gameDesc = desc[0];
-	const QString &fileDesc = desc[1];
+	const QString gameDesc = file->gameDesc();
+	const QString fileDesc = file->fileDesc();
 
-	// TODO: QHash<> with the game ID?
-	const QString gameID = file->gameID();
-	Q_D(const GcnMcFileDb);
-	foreach (QVector<GcnMcFileDef*>* vec, d->addr_file_defs) {
-		foreach (GcnMcFileDef* gcnMcFileDef, *vec) {
-			// Check if this file matches.
-			if (gameID != QLatin1String(gcnMcFileDef->id6, sizeof(gcnMcFileDef->id6))) {
-				// No match.
-				continue;
-			}
-
-			// Make sure the GameDesc matches.
-			QRegularExpressionMatch gameDescMatch =
-				gcnMcFileDef->search.gameDesc_regex.match(gameDesc);
-			if (!gameDescMatch.hasMatch()) {
-				// Not a match.
-				continue;
-			}
-
-			// Make sure the FileDesc matches.
-			QRegularExpressionMatch fileDescMatch =
-				gcnMcFileDef->search.fileDesc_regex.match(fileDesc);
-			if (!fileDescMatch.hasMatch()) {
-				// Not a match.
-				continue;
-			}
+	foreach (const GcnMcFileDef *gcnMcFileDef, *iter) {
+		// Make sure the GameDesc matches.
+		QRegularExpressionMatch gameDescMatch =
+			gcnMcFileDef->search.gameDesc_regex.match(gameDesc);
+		if (!gameDescMatch.hasMatch()) {
+			// Not a match.
+			continue;
+		}
 
-			// File matches.
-			// Copy the checksum definitions.
-			file->setChecksumDefs(gcnMcFileDef->checksumDefs);
-			return true;
+		// Make sure the FileDesc matches.
+		QRegularExpressionMatch fileDescMatch =
+			gcnMcFileDef->search.fileDesc_regex.match(fileDesc);
+		if (!fileDescMatch.hasMatch()) {
+			// Not a match.
+			continue;
 		}
+
+		// File matches.
+		*checksumDefs = gcnMcFileDef->checksumDefs;
+		return true;
 	}
 
 	// File information not found.
@@ -84,6 +84,15 @@ class GcnMcFileDb : public QObject
 		 * @return True if definitions were added by this class; false if not.
 		 */
 		bool addChecksumDefs(GcnFile *file) const;
+
+		/**
+		 * Find checksum definitions for a file.
+		 * The file's checksum isn't verified.
+		 * @param file		[in] GcnFile
+		 * @param checksumDefs	[out] Checksum definitions.
+		 * @return True if definitions were found; false if not.
+		 */
+		bool findChecksumDefs(const GcnFile *file, QVector<Checksum::ChecksumDef> *checksumDefs) const;
 };
 
 #endif /* __MCRECOVER_GCNMCFILEDB_HPP__ */
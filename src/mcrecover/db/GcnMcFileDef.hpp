@@ -20,6 +20,7 @@
 
 #include "Checksum.hpp"
 #include "VarModifierDef.hpp"
+#include "VarTemplate.hpp"
 
 class GcnMcFileDef {
 	public:
@@ -95,6 +96,12 @@ class GcnMcFileDef {
 		 */
 		QHash<QString, VarModifierDef> varModifiers;
 
+		/**
+		 * Compiled dirEntry.filename template.
+		 * Includes the variable modifiers.
+		 */
+		VarTemplate filenameTemplate;
+
 		// Make sure all fields are initialized.
 		GcnMcFileDef()
 		{
@@ -62,8 +62,6 @@ GcnSearchThreadPrivate::GcnSearchThreadPrivate(GcnSearchThread* q)
 	// Signal passthrough.
 	QObject::connect(worker, &GcnSearchWorker::searchStarted,
 			 q, &GcnSearchThread::searchStarted);
-	QObject::connect(worker, &GcnSearchWorker::searchUpdate,
-			 q, &GcnSearchThread::searchUpdate);
 
 	// We have to handle these signals in order to move
 	// the worker object back to the main thread.
@@ -126,6 +124,23 @@ QString GcnSearchThread::errorString(void) const
 	return d->worker->errorString();
 }
 
+/**
+ * Get the current search progress.
+ *
+ * This function is thread-safe, so it can be called
+ * periodically from the GUI thread while searching.
+ * No signal is emitted for every block searched.
+ *
+ * @param currentPhysBlock	[out, opt] Current physical block number being searched.
+ * @param currentSearchBlock	[out, opt] Number of blocks searched so far.
+ * @param lostFilesFound	[out, opt] Number of "lost" files found.
+ */
+void GcnSearchThread::progress(int *currentPhysBlock, int *currentSearchBlock, int *lostFilesFound) const
+{
+	Q_D(const GcnSearchThread);
+	d->worker->progress(currentPhysBlock, currentSearchBlock, lostFilesFound);
+}
+
 /** Functions. **/
 
 /**
@@ -60,14 +60,6 @@ class GcnSearchThread : public QObject
 		 */
 		void searchFinished(int lostFilesFound);
 
-		/**
-		 * Update search status.
-		 * @param currentPhysBlock Current physical block number being searched.
-		 * @param currentSearchBlock Number of blocks searched so far.
-		 * @param lostFilesFound Number of "lost" files found.
-		 */
-		void searchUpdate(int currentPhysBlock, int currentSearchBlock, int lostFilesFound);
-
 		/**
 		 * An error has occurred during the search.
 		 * @param errorString Error string.
@@ -87,6 +79,19 @@ class GcnSearchThread : public QObject
 		 */
 		QString errorString(void) const;
 
+		/**
+		 * Get the current search progress.
+		 *
+		 * This function is thread-safe, so it can be called
+		 * periodically from the GUI thread while searching.
+		 * No signal is emitted for every block searched.
+		 *
+		 * @param currentPhysBlock	[out, opt] Current physical block number being searched.
+		 * @param currentSearchBlock	[out, opt] Number of blocks searched so far.
+		 * @param lostFilesFound	[out, opt] Number of "lost" files found.
+		 */
+		void progress(int *currentPhysBlock, int *currentSearchBlock, int *lostFilesFound) const;
+
 	public:
 		/**
 		 * Load a GCN Memory Card File database.
@@ -21,12 +21,12 @@
 #include <cstdio>
 
 // C++ includes.
-#include <limits>
 #include <memory>
 using std::list;
 using std::unique_ptr;
 
 // Qt includes.
+#include <QtCore/QAtomicInt>
 #include <QtCore/QVector>
 
 /** GcnSearchWorkerPrivate **/
@@ -62,6 +62,26 @@ class GcnSearchWorkerPrivate
 
 		// Original thread.
 		QThread *origThread;
+
+		// Search progress.
+		// Written by the worker thread and read by
+		// GcnSearchWorker::progress() on the GUI thread.
+		QAtomicInt currentPhysBlock;
+		QAtomicInt currentSearchBlock;
+		QAtomicInt lostFilesFound;
+
+		/**
+		 * Update the search progress.
+		 * @param currentPhysBlock Current physical block number being searched.
+		 * @param currentSearchBlock Number of blocks searched so far.
+		 * @param lostFilesFound Number of "lost" files found.
+		 */
+		inline void setProgress(int currentPhysBlock, int currentSearchBlock, int lostFilesFound)
+		{
+			this->currentPhysBlock.store(currentPhysBlock);
+			this->currentSearchBlock.store(currentSearchBlock);
+			this->lostFilesFound.store(lostFilesFound);
+		}
 };
 
 GcnSearchWorkerPrivate::GcnSearchWorkerPrivate(GcnSearchWorker* q)
@@ -112,6 +132,31 @@ std::list<GcnSearchData> GcnSearchWorker::filesFoundList(void) const
 	return d->filesFoundList;
 }
 
+/**
+ * Get the current search progress.
+ *
+ * This function is thread-safe, so it can be called
+ * periodically from the GUI thread while searching.
+ * The worker doesn't emit a signal for every block.
+ *
+ * @param currentPhysBlock	[out, opt] Current physical block number being searched.
+ * @param currentSearchBlock	[out, opt] Number of blocks searched so far.
+ * @param lostFilesFound	[out, opt] Number of "lost" files found.
+ */
+void GcnSearchWorker::progress(int *currentPhysBlock, int *currentSearchBlock, int *lostFilesFound) const
+{
+	Q_D(const GcnSearchWorker);
+	if (currentPhysBlock) {
+		*currentPhysBlock = d->currentPhysBlock.load();
+	}
+	if (currentSearchBlock) {
+		*currentSearchBlock = d->currentSearchBlock.load();
+	}
+	if (lostFilesFound) {
+		*lostFilesFound = d->lostFilesFound.load();
+	}
+}
+
 /** Properties. **/
 
 /**
@@ -243,6 +288,7 @@ int GcnSearchWorker::searchMemCard(void)
 {
 	Q_D(GcnSearchWorker);
 	d->filesFoundList.clear();
+	d->setProgress(0, 0, 0);
 
 	if (!d->card) {
 		// No card specified.
@@ -267,22 +313,25 @@ int GcnSearchWorker::searchMemCard(void)
 	const int totalPhysBlocks = d->card->totalPhysBlocks();
 
 	// Used block map.
-	QVector<uint8_t> usedBlockMap;
+	BlockMap usedBlockMap;
 	if (!d->searchUsedBlocks) {
 		// Only search empty blocks.
 		usedBlockMap = d->card->usedBlockMap();
 
 		// Put together a block search list.
-		blockSearchList.reserve(totalPhysBlocks - d->card->freeBlocks() - 5);
-		for (int i = (usedBlockMap.size() - 1); i >= 5; i--) {
-			if (usedBlockMap[i] == 0) {
-				blockSearchList.append((uint16_t)i);
+		// NOTE: Blocks are searched from the end of the card.
+		const QVector<BlockMap::Run> freeRuns = usedBlockMap.freeRuns(5);
+		blockSearchList.reserve(usedBlockMap.countFree(5, usedBlockMap.size()));
+		for (int i = freeRuns.size() - 1; i >= 0; i--) {
+			const BlockMap::Run &run = freeRuns.at(i);
+			for (int block = run.start + run.length - 1; block >= run.start; block--) {
+				blockSearchList.append((uint16_t)block);
 			}
 		}
 	} else {
 		// Search through all blocks.
 		// TODO: Mark system blocks as used?
-		usedBlockMap = QVector<uint8_t>(totalPhysBlocks, 0);
+		usedBlockMap.reset(totalPhysBlocks);
 
 		// Put together a block search list.
 		blockSearchList.reserve(totalPhysBlocks - 5);
@@ -309,13 +358,17 @@ int GcnSearchWorker::searchMemCard(void)
 
 	const int totalSearchBlocks = blockSearchList.size();
 	int currentPhysBlock = blockSearchList.value(0);
+	d->setProgress(currentPhysBlock, 0, 0);
 	emit searchStarted(totalPhysBlocks, totalSearchBlocks, currentPhysBlock);
 
+	// NOTE: Progress is published using atomic variables
+	// instead of a signal for every block. The UI polls
+	// it using progress() at a fixed rate.
 	int currentSearchBlock = -1;	// compensate for currentSearchBlock++
+	int lostFilesFound = 0;
 	foreach (currentPhysBlock, blockSearchList) {
 		currentSearchBlock++;
-		fprintf(stderr, "Searching block: %d...\n", currentPhysBlock);
-		emit searchUpdate(currentPhysBlock, currentSearchBlock, d->filesFoundList.size());
+		d->setProgress(currentPhysBlock, currentSearchBlock, lostFilesFound);
 
 		int ret = d->card->readBlock(buf.get(), blockSize, currentPhysBlock);
 		if (ret != blockSize) {
@@ -385,39 +438,38 @@ int GcnSearchWorker::searchMemCard(void)
 
 			// First block is always valid.
 			searchData.fatEntries.append(searchData.dirEntry.block);
-			if (usedBlockMap[searchData.dirEntry.block] < std::numeric_limits<uint8_t>::max())
-				usedBlockMap[searchData.dirEntry.block]++;
+			usedBlockMap.ref(searchData.dirEntry.block);
 
 			uint16_t blocksRemaining = (searchData.dirEntry.length - 1);
-			uint16_t block = (searchData.dirEntry.block + 1);
+			int block = (searchData.dirEntry.block + 1);
 			bool wasWrapped = false;
 
 			// Skip used blocks and go after empty blocks only.
 			while (blocksRemaining > 0) {
-				if (block >= totalPhysBlocks) {
-					// Wraparound.
-					// Do NOT mark the wrapped blocks as used,
-					// since they might be used by actual files.
-					block = 5;
-					wasWrapped = true;
-					continue;
-				} else if (block == searchData.dirEntry.block) {
+				const int freeBlock = usedBlockMap.findNextFree(block);
+				if (!wasWrapped) {
+					if (freeBlock < 0) {
+						// Wraparound.
+						// Do NOT mark the wrapped blocks as used,
+						// since they might be used by actual files.
+						block = 5;
+						wasWrapped = true;
+						continue;
+					}
+				} else if (freeBlock < 0 || freeBlock >= searchData.dirEntry.block) {
 					// ERROR: We wrapped around!
 					// Use the "naive" algorithm after the last valid block.
 					break;
 				}
 
-				// Check if this block is used.
-				if (usedBlockMap[block] == 0) {
-					// Block is not used.
-					searchData.fatEntries.append(block);
-					if (!wasWrapped)
-						usedBlockMap[block]++;
-					blocksRemaining--;
-				}
+				// Block is not used.
+				searchData.fatEntries.append((uint16_t)freeBlock);
+				if (!wasWrapped)
+					usedBlockMap.ref(freeBlock);
+				blocksRemaining--;
 
 				// Next block.
-				block++;
+				block = freeBlock + 1;
 			}
 
 			// Naive block algorithm for the remaining blocks.
@@ -434,21 +486,20 @@ int GcnSearchWorker::searchMemCard(void)
 
 				// Add this block.
 				searchData.fatEntries.append(block);
-				if (usedBlockMap[block] < std::numeric_limits<uint8_t>::max()) {
-					if (!wasWrapped)
-						usedBlockMap[block]++;
-				}
+				if (!wasWrapped)
+					usedBlockMap.ref(block);
 				block++;
 				blocksRemaining--;
 			}
 
 			// Add the search data to the list. (front of list)
 			d->filesFoundList.push_front(searchData);
+			lostFilesFound++;
 		}
 	}
 
-	// Send an update for the last block.
-	emit searchUpdate(5, currentSearchBlock, d->filesFoundList.size());
+	// Update the progress for the last block.
+	d->setProgress(5, currentSearchBlock, lostFilesFound);
 
 	// Search is finished.
 	emit searchFinished(d->filesFoundList.size());
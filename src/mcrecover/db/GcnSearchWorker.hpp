@@ -74,14 +74,6 @@ class GcnSearchWorker : public QObject
 		 */
 		void searchFinished(int lostFilesFound);
 
-		/**
-		 * Update search status.
-		 * @param currentPhysBlock Current physical block number being searched.
-		 * @param currentSearchBlock Number of blocks searched so far.
-		 * @param lostFilesFound Number of "lost" files found.
-		 */
-		void searchUpdate(int currentPhysBlock, int currentSearchBlock, int lostFilesFound);
-
 		/**
 		 * An error has occurred during the search.
 		 * @param errorString Error string.
@@ -107,6 +99,19 @@ class GcnSearchWorker : public QObject
 		 */
 		std::list<GcnSearchData> filesFoundList(void) const;
 
+		/**
+		 * Get the current search progress.
+		 *
+		 * This function is thread-safe, so it can be called
+		 * periodically from the GUI thread while searching.
+		 * The worker doesn't emit a signal for every block.
+		 *
+		 * @param currentPhysBlock	[out, opt] Current physical block number being searched.
+		 * @param currentSearchBlock	[out, opt] Number of blocks searched so far.
+		 * @param lostFilesFound	[out, opt] Number of "lost" files found.
+		 */
+		void progress(int *currentPhysBlock, int *currentSearchBlock, int *lostFilesFound) const;
+
 	public:
 		/** Properties. **/
 
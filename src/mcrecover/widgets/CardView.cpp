@@ -90,11 +90,14 @@ void CardViewPrivate::updateBlockCountDisplay(void)
 		ui.lblCardHeaderStatus->setVisible(false);
 	} else {
 		// Free Block count is invalid.
-		// TODO: Get the actual free block count?
+		// Get the actual free block count from the used block map.
+		const int actualFreeBlocks = card->usedBlockMap().countFree();
 		QIcon icon = McRecoverQApplication::IconFromTheme(QLatin1String("dialog-error"));
 		// TODO: What size?
 		ui.lblFreeBlockStatus->setPixmap(icon.pixmap(16, 16));
-		ui.lblFreeBlockStatus->setToolTip(CardView::tr("Free block count is incorrect."));
+		ui.lblFreeBlockStatus->setToolTip(
+			CardView::tr("Free block count is incorrect. (actual: %L1)")
+				.arg(actualFreeBlocks));
 		ui.lblFreeBlockStatus->setVisible(true);
 	}
 }
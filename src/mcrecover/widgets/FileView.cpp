@@ -11,7 +11,7 @@
 #include "libmemcard/File.hpp"
 #include "libmemcard/GcnFile.hpp" /* FIXME: Remove later */
 #include "libmemcard/VmuFile.hpp" /* FIXME: Remove later */
-#include "IconAnimHelper.hpp"
+#include "IconAnimScheduler.hpp"
 
 // XML template dialog.
 #include "../windows/XmlTemplateDialog.hpp"
@@ -21,9 +21,6 @@
 #include "libsaveedit/EditorWindow.hpp"
 #include "libsaveedit/EditorWidgetFactory.hpp"
 
-// Qt includes.
-#include <QtCore/QTimer>
-
 /** FileViewPrivate **/
 
 #include "ui_FileView.h"
@@ -45,25 +42,14 @@ class FileViewPrivate
 
 		const File *file;
 
-		// Icon animation helper.
-		IconAnimHelper helper;
-
-		// Animation timer.
-		QTimer *animTimer;
-		// Pause count. If >0, animation is paused.
-		int pauseCounter;
+		// Icon animation scheduler.
+		IconAnimScheduler *animScheduler;
 
 		/**
 		 * Update the widget display.
 		 */
 		void updateWidgetDisplay(void);
 
-		/**
-		 * Update the animation timer state.
-		 * Starts the timer if animated icons are present; stops the timer if not.
-		 */
-		void updateAnimTimerState(void);
-
 		/**
 		 * XmlTemplateDialog manager.
 		 */
@@ -73,17 +59,17 @@ class FileViewPrivate
 FileViewPrivate::FileViewPrivate(FileView *q)
 	: q_ptr(q)
 	, file(nullptr)
-	, animTimer(new QTimer(q))
-	, pauseCounter(0)
+	, animScheduler(new IconAnimScheduler(q))
 	, xmlTemplateDialogManager(new XmlTemplateDialogManager(q))
 {
-	// Connect animTimer's timeout() signal.
-	QObject::connect(animTimer, &QTimer::timeout,
-		q, &FileView::animTimer_slot);
+	// Connect animScheduler's iconsChanged() signal.
+	QObject::connect(animScheduler, &IconAnimScheduler::iconsChanged,
+		q, &FileView::animScheduler_iconsChanged_slot);
 }
 
 FileViewPrivate::~FileViewPrivate()
 {
+	delete animScheduler;
 	delete xmlTemplateDialogManager;
 }
 
@@ -96,8 +82,9 @@ void FileViewPrivate::updateWidgetDisplay(void)
 
 	if (!file) {
 		// Clear the widget display.
-		ui.lblFileIcon->clear();
-		ui.lblFileBanner->clear();
+		animScheduler->clear();
+		ui.lblFileIcon->setRegion(ImageAtlas::Region());
+		ui.lblFileBanner->setRegion(ImageAtlas::Region());
 		ui.btnXML->setVisible(false);
 		ui.btnEdit->setVisible(false);
 		ui.lblFilename->clear();
@@ -115,23 +102,15 @@ void FileViewPrivate::updateWidgetDisplay(void)
 	// Set the widget display.
 
 	// File icon.
-	QPixmap icon = file->icon(0);
-	if (!icon.isNull())
-		ui.lblFileIcon->setPixmap(icon);
-	else
-		ui.lblFileIcon->clear();
+	// NOTE: Images are drawn directly from the card's ImageAtlas.
+	ui.lblFileIcon->setRegion(file->iconRegion(0));
 
 	// Icon animation.
-	helper.setFile(file);
-	updateAnimTimerState();
+	// NOTE: addFile() restarts the animation if the file is already present.
+	animScheduler->addFile(file);
 
 	// File banner.
-	QPixmap banner = file->banner();
-	if (!banner.isNull()) {
-		ui.lblFileBanner->setPixmap(banner);
-	} else {
-		ui.lblFileBanner->clear();
-	}
+	ui.lblFileBanner->setRegion(file->bannerRegion());
 
 	// XML button.
 	ui.btnXML->setVisible(true);
@@ -212,23 +191,6 @@ void FileViewPrivate::updateWidgetDisplay(void)
 	}
 }
 
-/**
- * Update the animation timer state.
- * Starts the timer if animated icons are present; stops the timer if not.
- */
-void FileViewPrivate::updateAnimTimerState(void)
-{
-	if (pauseCounter <= 0 && file != nullptr && helper.isAnimated()) {
-		// Animation is not paused, and we have an animated icon.
-		// Start the timer.
-		animTimer->start(IconAnimHelper::FAST_ANIM_TIMER);
-	} else {
-		// Either animation is paused, or we don't have an animated icon.
-		// Stop the timer.
-		animTimer->stop();
-	}
-}
-
 /** FileView **/
 
 FileView::FileView(QWidget *parent)
@@ -275,18 +237,26 @@ void FileView::setFile(const File *file)
 {
 	Q_D(FileView);
 
-	// Disconnect the File's destroyed() signal if a File is already set.
+	// Disconnect the File's signals if a File is already set.
 	if (d->file) {
 		disconnect(d->file, &QObject::destroyed,
 			   this, &FileView::file_destroyed_slot);
+		disconnect(d->file, &File::imagesChanged,
+			   this, &FileView::file_imagesChanged_slot);
+		disconnect(d->file, &File::checksumChanged,
+			   this, &FileView::file_checksumChanged_slot);
 	}
 
 	d->file = file;
 
-	// Connect the File's destroyed() signal.
+	// Connect the File's signals.
 	if (d->file) {
 		connect(d->file, &QObject::destroyed,
 			this, &FileView::file_destroyed_slot);
+		connect(d->file, &File::imagesChanged,
+			this, &FileView::file_imagesChanged_slot);
+		connect(d->file, &File::checksumChanged,
+			this, &FileView::file_checksumChanged_slot);
 	}
 
 	// Update the widget display.
@@ -322,8 +292,7 @@ void FileView::changeEvent(QEvent *event)
 void FileView::pauseAnimation(void)
 {
 	Q_D(FileView);
-	d->pauseCounter++;
-	d->updateAnimTimerState();
+	d->animScheduler->pause();
 }
 
 /**
@@ -335,14 +304,7 @@ void FileView::pauseAnimation(void)
 void FileView::resumeAnimation(void)
 {
 	Q_D(FileView);
-	if (d->pauseCounter > 0) {
-		d->pauseCounter--;
-	} else {
-		// Not paused...
-		d->pauseCounter = 0; // TODO: Probably not needed.
-	}
-
-	d->updateAnimTimerState();
+	d->animScheduler->resume();
 }
 
 /** Private slots. **/
@@ -364,25 +326,38 @@ void FileView::file_destroyed_slot(QObject *obj)
 	}
 }
 
+/**
+ * The File's banner and icons have changed.
+ */
+void FileView::file_imagesChanged_slot(void)
+{
+	// Update the widget display.
+	Q_D(FileView);
+	d->updateWidgetDisplay();
+}
 
 /**
- * Animation timer slot.
+ * The File's checksum has been verified.
  */
-void FileView::animTimer_slot(void)
+void FileView::file_checksumChanged_slot(void)
 {
+	// Update the widget display.
 	Q_D(FileView);
-	if (!d->file || !d->helper.isAnimated() || d->pauseCounter > 0) {
-		// No file is loaded, or the file doesn't have an animated icon.
-		// Stop the animation timer.
-		d->animTimer->stop();
-		return;
-	}
+	d->updateWidgetDisplay();
+}
+
 
-	// Check if the animated icon should be updated.
-	bool iconUpdated = d->helper.tick();
-	if (iconUpdated) {
+/**
+ * Animated icons have changed.
+ * @param files Files whose icons have changed.
+ */
+void FileView::animScheduler_iconsChanged_slot(const QVector<const File*> &files)
+{
+	Q_D(FileView);
+	if (d->file && files.contains(d->file)) {
 		// Icon has been updated.
-		d->ui.lblFileIcon->setPixmap(d->helper.icon());
+		d->ui.lblFileIcon->setRegion(d->file->iconRegion(
+			d->animScheduler->iconIndex(d->file)));
 	}
 }
 
@@ -10,6 +10,7 @@
 #define __MCRECOVER_WIDGETS_FILEVIEW_HPP__
 
 #include <QWidget>
+#include <QtCore/QVector>
 
 class File;
 
@@ -73,9 +74,20 @@ class FileView : public QWidget
 		void file_destroyed_slot(QObject *obj = 0);
 
 		/**
-		 * Animation timer slot.
+		 * The File's banner and icons have changed.
 		 */
-		void animTimer_slot(void);
+		void file_imagesChanged_slot(void);
+
+		/**
+		 * The File's checksum has been verified.
+		 */
+		void file_checksumChanged_slot(void);
+
+		/**
+		 * Animated icons have changed.
+		 * @param files Files whose icons have changed.
+		 */
+		void animScheduler_iconsChanged_slot(const QVector<const File*> &files);
 
 		/**
 		 * XML button was pressed.
@@ -0,0 +1,73 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * ImageRegionLabel.cpp: QLabel that displays an ImageAtlas region.        *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#include "ImageRegionLabel.hpp"
+
+// Qt includes.
+#include <QtGui/QPainter>
+#include <QStyle>
+
+ImageRegionLabel::ImageRegionLabel(QWidget *parent)
+	: super(parent)
+{ }
+
+/**
+ * Get the ImageAtlas region being displayed.
+ * @return Image region.
+ */
+ImageAtlas::Region ImageRegionLabel::region(void) const
+{
+	return m_region;
+}
+
+/**
+ * Set the ImageAtlas region to display.
+ * The image is drawn directly from the atlas,
+ * so no separate QPixmap is created.
+ * @param region Image region. (empty region to clear)
+ */
+void ImageRegionLabel::setRegion(const ImageAtlas::Region &region)
+{
+	const bool sizeChanged = (region.size() != m_region.size());
+	m_region = region;
+	if (sizeChanged) {
+		updateGeometry();
+	}
+	update();
+}
+
+QSize ImageRegionLabel::sizeHint(void) const
+{
+	if (m_region.isNull())
+		return super::sizeHint();
+
+	const QMargins margins = contentsMargins();
+	return m_region.size() + QSize(margins.left() + margins.right(),
+				       margins.top() + margins.bottom());
+}
+
+QSize ImageRegionLabel::minimumSizeHint(void) const
+{
+	if (m_region.isNull())
+		return super::minimumSizeHint();
+	return sizeHint();
+}
+
+void ImageRegionLabel::paintEvent(QPaintEvent *event)
+{
+	if (m_region.isNull()) {
+		// No region. Use the regular QLabel display.
+		super::paintEvent(event);
+		return;
+	}
+
+	QPainter painter(this);
+	const QRect target = QStyle::alignedRect(layoutDirection(),
+		alignment(), m_region.size(), contentsRect());
+	m_region.atlas->draw(&painter, target, m_region);
+}
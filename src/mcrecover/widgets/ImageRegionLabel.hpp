@@ -0,0 +1,54 @@
+/***************************************************************************
+ * GameCube Memory Card Recovery Program.                                  *
+ * ImageRegionLabel.hpp: QLabel that displays an ImageAtlas region.        *
+ *                                                                         *
+ * Copyright (c) 2012-2021 by David Korth.                                 *
+ * SPDX-License-Identifier: GPL-2.0-or-later                               *
+ ***************************************************************************/
+
+#ifndef __MCRECOVER_IMAGEREGIONLABEL_HPP__
+#define __MCRECOVER_IMAGEREGIONLABEL_HPP__
+
+#include "libmemcard/ImageAtlas.hpp"
+
+// Qt includes and classes.
+#include <QLabel>
+class QPaintEvent;
+
+class ImageRegionLabel : public QLabel
+{
+	Q_OBJECT
+	typedef QLabel super;
+
+	public:
+		explicit ImageRegionLabel(QWidget *parent = 0);
+
+	private:
+		Q_DISABLE_COPY(ImageRegionLabel);
+
+	public:
+		/**
+		 * Get the ImageAtlas region being displayed.
+		 * @return Image region.
+		 */
+		ImageAtlas::Region region(void) const;
+
+		/**
+		 * Set the ImageAtlas region to display.
+		 * The image is drawn directly from the atlas,
+		 * so no separate QPixmap is created.
+		 * @param region Image region. (empty region to clear)
+		 */
+		void setRegion(const ImageAtlas::Region &region);
+
+		QSize sizeHint(void) const final;
+		QSize minimumSizeHint(void) const final;
+
+	protected:
+		void paintEvent(QPaintEvent *event) final;
+
+	private:
+		ImageAtlas::Region m_region;
+};
+
+#endif /* __MCRECOVER_IMAGEREGIONLABEL_HPP__ */
@@ -34,7 +34,6 @@ void QTreeViewOpt::dataChanged(const QModelIndex &topLeft,
 	const QVector<int> &roles)
 {
 	bool propagateEvent = true;
-	// TODO: Support for checking multiple items.
 	if (topLeft == bottomRight) {
 		// Single item. This might be an icon animation.
 		// If it is, make sure the icon is onscreen.
@@ -47,6 +46,20 @@ void QTreeViewOpt::dataChanged(const QModelIndex &topLeft,
 			// Don't propagate the event.
 			propagateEvent = false;
 		}
+	} else if (topLeft.column() == bottomRight.column() &&
+		   topLeft.parent() == bottomRight.parent())
+	{
+		// Multiple rows in a single column.
+		// This might be several icon animations at once.
+		// QAbstractItemView repaints the entire viewport for
+		// ranges, so only repaint the visible part of the range.
+		const QRect itemRect = this->visualRect(topLeft) | this->visualRect(bottomRight);
+		const QRect viewportRect(QPoint(0, 0), this->viewport()->size());
+		const QRect updateRect = itemRect & viewportRect;
+		if (!updateRect.isEmpty()) {
+			this->viewport()->update(updateRect);
+		}
+		propagateEvent = false;
 	}
 
 	if (propagateEvent) {
@@ -72,11 +72,19 @@ class StatusBarManagerPrivate
 		// progress bar after the search has completed.
 		static const int SECONDS_TO_HIDE_PROGRESS_BAR = 5;
 
+		// Interval between search status updates, in milliseconds.
+		// The search thread doesn't send updates; instead, the
+		// current status is read from it using this interval.
+		static const int SEARCH_UPDATE_INTERVAL_MS = 50;
+
 		// TaskbarButtonManager.
 		TaskbarButtonManager *taskbarButtonManager;
 
 		// Timer for hiding the progress bar.
 		QTimer tmrHideProgressBar;
+
+		// Timer for updating the search status.
+		QTimer tmrSearchUpdate;
 };
 
 StatusBarManagerPrivate::StatusBarManagerPrivate(StatusBarManager *q)
@@ -101,6 +109,10 @@ StatusBarManagerPrivate::StatusBarManagerPrivate(StatusBarManager *q)
 	tmrHideProgressBar.setSingleShot(true);
 	QObject::connect(&tmrHideProgressBar, &QTimer::timeout,
 		q, &StatusBarManager::hideProgressBar_slot);
+
+	tmrSearchUpdate.setInterval(SEARCH_UPDATE_INTERVAL_MS);
+	QObject::connect(&tmrSearchUpdate, &QTimer::timeout,
+		q, &StatusBarManager::searchUpdate_slot);
 }
 
 StatusBarManagerPrivate::~StatusBarManagerPrivate()
@@ -279,8 +291,6 @@ void StatusBarManager::setSearchThread(GcnSearchThread *searchThread)
 			   this, &StatusBarManager::searchCancelled_slot);
 		disconnect(d->searchThread, &GcnSearchThread::searchFinished,
 			   this, &StatusBarManager::searchFinished_slot);
-		disconnect(d->searchThread, &GcnSearchThread::searchUpdate,
-			   this, &StatusBarManager::searchUpdate_slot);
 		disconnect(d->searchThread, &GcnSearchThread::searchError,
 			   this, &StatusBarManager::searchError_slot);
 	}
@@ -297,14 +307,13 @@ void StatusBarManager::setSearchThread(GcnSearchThread *searchThread)
 			this, &StatusBarManager::searchCancelled_slot);
 		connect(d->searchThread, &GcnSearchThread::searchFinished,
 			this, &StatusBarManager::searchFinished_slot);
-		connect(d->searchThread, &GcnSearchThread::searchUpdate,
-			this, &StatusBarManager::searchUpdate_slot);
 		connect(d->searchThread, &GcnSearchThread::searchError,
 			this, &StatusBarManager::searchError_slot);
 	}
 
 	// TODO: Get current status from the new searchThread.
 	// For now, just clear everything.
+	d->tmrSearchUpdate.stop();
 	d->scanning = false;
 	d->currentPhysBlock = 0;
 	d->totalPhysBlocks = 0;
@@ -432,6 +441,7 @@ void StatusBarManager::object_destroyed_slot(QObject *obj)
 		d->tmrHideProgressBar.stop();
 		d->progressBar = nullptr;
 	} else if (obj == d->searchThread) {
+		d->tmrSearchUpdate.stop();
 		d->searchThread = nullptr;
 	} else if (obj == d->taskbarButtonManager) {
 		d->taskbarButtonManager = nullptr;
@@ -460,6 +470,9 @@ void StatusBarManager::searchStarted_slot(int totalPhysBlocks, int totalSearchBl
 
 	// Stop the Hide Progress Bar timer.
 	d->tmrHideProgressBar.stop();
+
+	// Start reading the search status.
+	d->tmrSearchUpdate.start();
 }
 
 /**
@@ -468,6 +481,7 @@ void StatusBarManager::searchStarted_slot(int totalPhysBlocks, int totalSearchBl
 void StatusBarManager::searchCancelled_slot(void)
 {
 	Q_D(StatusBarManager);
+	d->tmrSearchUpdate.stop();
 	d->scanning = false;
 	d->lastStatusMessage = tr("Scan cancelled.");
 	d->updateStatusBar();
@@ -486,6 +500,7 @@ void StatusBarManager::searchFinished_slot(int lostFilesFound)
 	Q_D(StatusBarManager);
 
 	// Update the search status.
+	d->tmrSearchUpdate.stop();
 	d->scanning = false;
 	d->lostFilesFound = lostFilesFound;
 	d->currentSearchBlock = d->totalSearchBlocks;
@@ -498,13 +513,23 @@ void StatusBarManager::searchFinished_slot(int lostFilesFound)
 
 /**
  * Update search status.
- * @param currentPhysBlock Current physical block number being searched.
- * @param currentSearchBlock Number of blocks searched so far.
- * @param lostFilesFound Number of "lost" files found.
+ * This is called periodically while searching.
  */
-void StatusBarManager::searchUpdate_slot(int currentPhysBlock, int currentSearchBlock, int lostFilesFound)
+void StatusBarManager::searchUpdate_slot(void)
 {
 	Q_D(StatusBarManager);
+	if (!d->scanning || !d->searchThread)
+		return;
+
+	int currentPhysBlock, currentSearchBlock, lostFilesFound;
+	d->searchThread->progress(&currentPhysBlock, &currentSearchBlock, &lostFilesFound);
+	if (currentPhysBlock == d->currentPhysBlock &&
+	    currentSearchBlock == d->currentSearchBlock &&
+	    lostFilesFound == d->lostFilesFound)
+	{
+		// Nothing has changed.
+		return;
+	}
 
 	// Update the search status.
 	// NOTE: When scanning, lastStatusMessage is set by updateStatusBar().
@@ -522,6 +547,7 @@ void StatusBarManager::searchError_slot(QString errorString)
 {
 	Q_D(StatusBarManager);
 
+	d->tmrSearchUpdate.stop();
 	d->scanning = false;
 	d->lastStatusMessage = tr("An error occurred while scanning: %1")
 				.arg(errorString);
@@ -125,11 +125,9 @@ class StatusBarManager : public QObject
 
 		/**
 		 * Update search status.
-		 * @param currentPhysBlock Current physical block number being searched.
-		 * @param currentSearchBlock Number of blocks searched so far.
-		 * @param lostFilesFound Number of "lost" files found.
+		 * This is called periodically while searching.
 		 */
-		void searchUpdate_slot(int currentPhysBlock, int currentSearchBlock, int lostFilesFound);
+		void searchUpdate_slot(void);
 
 		/**
 		 * An error has occurred during the search.
@@ -60,6 +60,9 @@ using std::vector;
 #include <QtCore/QLocale>
 #include <QtCore/QTextCodec>
 #include <QtCore/QMimeData>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
 #include <QtGui/QDragEnterEvent>
 #include <QtGui/QDropEvent>
 #include <QAction>
@@ -80,6 +83,64 @@ using std::vector;
 // Shh... it's a secret to everybody.
 #include "sekrit/HerpDerpEggListener.hpp"
 
+/**
+ * Task to extract a file's banner and icon on a worker thread.
+ * File::saveBanner() and File::saveIcon() only read the file's
+ * decoded images, and each thread has its own GcImageWriter,
+ * so multiple files can be extracted at the same time.
+ */
+class ImageExtractTask : public QRunnable
+{
+	public:
+		/**
+		 * @param file File.
+		 * @param bannerFilename Banner filename, sans extension. (empty to skip)
+		 * @param iconFilename Icon filename, sans extension. (empty to skip)
+		 * @param animImgf Animated image format for animated icons.
+		 * @param compression Compression profile.
+		 * @param imagesFailed Incremented for each image that couldn't be saved.
+		 */
+		ImageExtractTask(const File *file,
+				 const QString &bannerFilename,
+				 const QString &iconFilename,
+				 GcImageWriter::AnimImageFormat animImgf,
+				 GcImageWriter::CompressionProfile compression,
+				 QAtomicInt *imagesFailed)
+			: file(file)
+			, bannerFilename(bannerFilename)
+			, iconFilename(iconFilename)
+			, animImgf(animImgf)
+			, compression(compression)
+			, imagesFailed(imagesFailed)
+		{ }
+
+	private:
+		Q_DISABLE_COPY(ImageExtractTask)
+
+	public:
+		void run(void) final
+		{
+			if (!bannerFilename.isEmpty()) {
+				if (file->saveBanner(bannerFilename, compression) != 0) {
+					imagesFailed->ref();
+				}
+			}
+			if (!iconFilename.isEmpty()) {
+				if (file->saveIcon(iconFilename, animImgf, compression) != 0) {
+					imagesFailed->ref();
+				}
+			}
+		}
+
+	private:
+		const File *const file;
+		const QString bannerFilename;
+		const QString iconFilename;
+		const GcImageWriter::AnimImageFormat animImgf;
+		const GcImageWriter::CompressionProfile compression;
+		QAtomicInt *const imagesFailed;
+};
+
 /** McRecoverWindowPrivate **/
 
 #include "ui_McRecoverWindow.h"
@@ -203,6 +264,12 @@ class McRecoverWindowPrivate
 		 */
 		GcImageWriter::AnimImageFormat animIconFormat(void) const;
 
+		/**
+		 * Get the compression profile to use for extracted images.
+		 * @return Compression profile to use.
+		 */
+		GcImageWriter::CompressionProfile imageCompression(void) const;
+
 		/**
 		 * "Allow Write" checkbox in the toolbar.
 		 * TODO: Better name, and/or change to "Read Only"?
@@ -582,6 +649,20 @@ void McRecoverWindowPrivate::saveFiles(const QVector<File*> &files, QString path
 
 	// Animted image format for icons.
 	GcImageWriter::AnimImageFormat animImgf = animIconFormat();
+	// Compression profile for banners and icons.
+	const GcImageWriter::CompressionProfile compression = imageCompression();
+	// Number of banners and icons that couldn't be saved.
+	QAtomicInt imagesFailed;
+	// Banners and icons are extracted on worker threads,
+	// since encoding them takes much longer than saving
+	// the files themselves.
+	QThreadPool extractPool;
+
+	if ((extractBanners || extractIcons) && card) {
+		// If banners and icons are still being loaded in
+		// the background, they have to finish first.
+		card->waitForLoad();
+	}
 
 	foreach (File *file, files) {
 		if (!singleFile) {
@@ -647,23 +728,38 @@ void McRecoverWindowPrivate::saveFiles(const QVector<File*> &files, QString path
 		}
 
 		// Extract the banner.
-		if (extractBanners) {
-			// TODO: Error handling and details.
-			QString bannerFilename = changeFileExtension(filename, extBanner);
-			file->saveBanner(bannerFilename);
+		// TODO: Error details.
+		QString bannerFilename;
+		if (extractBanners && !file->bannerRegion().isNull()) {
+			// File has a banner.
+			bannerFilename = changeFileExtension(filename, extBanner);
 		}
 
 		// Extract the icon.
-		if (extractIcons) {
-			// TODO: Error handling and details.
-			if (file->iconCount() >= 1) {
-				// File has an icon.
-				QString iconFilename = changeFileExtension(filename, extIcon);
-				file->saveIcon(iconFilename, animImgf);
-			}
+		QString iconFilename;
+		if (extractIcons && file->iconCount() >= 1) {
+			// File has an icon.
+			iconFilename = changeFileExtension(filename, extIcon);
+		}
+
+		if (!bannerFilename.isEmpty() || !iconFilename.isEmpty()) {
+			extractPool.start(new ImageExtractTask(file,
+				bannerFilename, iconFilename,
+				animImgf, compression, &imagesFailed));
 		}
 	}
 
+	// Wait for the banners and icons to be extracted.
+	extractPool.waitForDone();
+
+	const int failed = imagesFailed.load();
+	if (failed > 0) {
+		// Some banners or icons couldn't be saved.
+		QMessageBox::warning(q,
+			McRecoverWindow::tr("Error Saving Images"),
+			McRecoverWindow::tr("%Ln banner or icon image(s) could not be saved.", "", failed));
+	}
+
 	// Update the status bar.
 	QDir dir;
 	if (singleFile) {
@@ -769,6 +865,16 @@ GcImageWriter::AnimImageFormat McRecoverWindowPrivate::animIconFormat(void) cons
 	return animImgf;
 }
 
+/**
+ * Get the compression profile to use for extracted images.
+ * @return Compression profile to use.
+ */
+GcImageWriter::CompressionProfile McRecoverWindowPrivate::imageCompression(void) const
+{
+	QString profile = cfg->get(QLatin1String("imageCompression")).toString();
+	return GcImageWriter::compressionProfileFromName(profile.toLatin1().constData());
+}
+
 /**
  * Read a memory card file and try to guess
  * what system it's for.
@@ -891,6 +997,9 @@ McRecoverWindow::McRecoverWindow(QWidget *parent)
 	// Set the models.
 	d->proxyModel->setSourceModel(d->model);
 	d->ui.lstFileList->setModel(d->proxyModel);
+#if QT_VERSION >= QT_VERSION_CHECK(5,2,0)
+	d->ui.txtFileFilter->setClearButtonEnabled(true);
+#endif /* QT_VERSION >= QT_VERSION_CHECK(5,2,0) */
 
 	// Sort by COL_DESCRIPTION by default.
 	// TODO: Disable sorting on specific columns.
@@ -960,21 +1069,23 @@ void McRecoverWindow::openCard(const QString &filename, FileType type)
 	}
 
 	// Open the specified memory card image.
+	// Banners and icons are loaded in the background,
+	// so the file list can be shown immediately.
 	// TODO: Set this as the last path?
 	const char *className;
 	switch (type) {
 		default:
 		case FileType::GCN:
 			className = "GcnCard";
-			d->card = GcnCard::open(filename, this);
+			d->card = GcnCard::open(filename, this, Card::OPEN_ASYNC);
 			break;
 		case FileType::GCI:
 			className = "GciCard";
-			d->card = GciCard::open(filename, this);
+			d->card = GciCard::open(filename, this, Card::OPEN_ASYNC);
 			break;
 		case FileType::VMS:
 			className = "VmuCard";
-			d->card = VmuCard::open(filename, this);
+			d->card = VmuCard::open(filename, this, Card::OPEN_ASYNC);
 			break;
 	}
 
@@ -1010,7 +1121,7 @@ void McRecoverWindow::openCard(const QString &filename, FileType type)
 	d->filename = filename;
 
 	// If GCN, check file checksums.
-	// TODO: Run this in a separate thread after loading?
+	// NOTE: Checksums are verified in the background.
 	if (type == FileType::GCN) {
 		// TODO: Singleton database management class.
 		// Get the database filenames.
@@ -1768,6 +1879,16 @@ void McRecoverWindow::lstFileList_selectionModel_selectionChanged(
 	d->herpDerp->setSelGameID(file ? file->gameID() : QString());
 }
 
+/**
+ * File list filter text was changed by the user.
+ * @param text Filter text.
+ */
+void McRecoverWindow::on_txtFileFilter_textChanged(const QString &text)
+{
+	Q_D(McRecoverWindow);
+	d->proxyModel->setFilterText(text);
+}
+
 /**
  * Animated icon format was changed by the user.
  * @param animIconFormat Animated icon format.
@@ -119,6 +119,12 @@ class McRecoverWindow : public QMainWindow
 		// lstFileList slots.
 		void lstFileList_selectionModel_selectionChanged(const QItemSelection& selected, const QItemSelection& deselected);
 
+		/**
+		 * File list filter text was changed by the user.
+		 * @param text Filter text.
+		 */
+		void on_txtFileFilter_textChanged(const QString &text);
+
 		/**
 		 * Set the animated icon format.
 		 * This slot is triggered by a QSignalMapper that